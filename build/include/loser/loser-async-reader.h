@@ -0,0 +1,128 @@
+#ifndef loser_async_reader_h
+#define loser_async_reader_h
+
+#include "loser.h"
+
+/*
+ * NOTE: Only available on Linux.
+ *
+ * NOTE: An `LSAsyncReader` must only be used from one thread at a time. It
+ * spawns its own worker threads internally when it needs them.
+ */
+
+// Reads whole files into pooled `LSByteBuffer`s in batches.
+/*
+ * Reads are submitted through io_uring when the kernel allows it. Otherwise,
+ * they are handed to a pool of worker threads issuing `pread()`.
+ */
+typedef struct LSAsyncReader LSAsyncReader;
+
+typedef enum LSAsyncReaderFlags {
+	LS_ASYNC_READER_DEFAULT = 0,
+	// Never use io_uring, even if it is available.
+	LS_ASYNC_READER_NO_URING = 1 << 0
+} LSAsyncReaderFlags;
+
+// Indicates how an `LSAsyncReader` performs its reads.
+typedef enum LSAsyncReaderBackend {
+	LS_ASYNC_READER_URING,
+	LS_ASYNC_READER_THREADS
+} LSAsyncReaderBackend;
+
+// A finished read.
+/*
+ * On success, `bbuf` holds the contents of the file and belongs to the caller.
+ * It may be given back to the reader with `ls_async_reader_recycle()`.
+ *
+ * On failure, `error` holds the `errno` value describing the failure and
+ * `bbuf` is invalid.
+ */
+typedef struct LSAsyncRead {
+	void *user_data;
+	LSStatus status;
+	int error;
+	LSByteBuffer bbuf;
+} LSAsyncRead;
+
+/*
+ * `queue_depth` is the maximum number of reads that may be in flight (i.e.
+ * submitted but not yet reaped) at once.
+ *
+ * Fails if:
+ * - allocation fails
+ * - `queue_depth` is `0`
+ * - neither io_uring nor worker threads could be set up
+ *
+ * Returns `NULL` on failure.
+ */
+LSAsyncReader *ls_async_reader_create(size_t queue_depth,
+		LSAsyncReaderFlags flags);
+
+/*
+ * Waits for the reads already running to finish, then frees the reader, its
+ * pooled buffers and the buffers of any unreaped reads. With the thread
+ * backend, reads still queued (not yet picked up by a worker) are dropped:
+ * their files are closed and their buffers freed without being read into.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `reader` was not previously destroyed
+ */
+void ls_async_reader_destroy(LSAsyncReader *reader);
+
+/*
+ * Constraints:
+ * - `reader` is not `NULL`
+ */
+LSAsyncReaderBackend ls_async_reader_get_backend(const LSAsyncReader *reader);
+
+/*
+ * Returns the number of reads submitted but not yet reaped.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ */
+size_t ls_async_reader_get_inflight(const LSAsyncReader *reader);
+
+/*
+ * Opens the file at `path` and queues a read of its whole contents.
+ *
+ * With the io_uring backend, queued reads are only handed to the kernel on the
+ * next call to `ls_async_reader_reap()`, so that they are submitted in batches.
+ * The file itself is opened synchronously.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `path` is not `NULL`
+ *
+ * Fails if:
+ * - `queue_depth` reads are already in flight
+ * - the file cannot be opened (`errno` is set)
+ * - allocation fails
+ */
+LSStatus ls_async_reader_submit(LSAsyncReader *reader, const char *path,
+		void *user_data);
+
+/*
+ * Stores up to `max` finished reads in `reads`, waiting until at least `min`
+ * are available (or until no reads remain in flight). Returns the number of
+ * reads stored.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `reads` points to an array of at least `max` `LSAsyncRead`s
+ */
+size_t ls_async_reader_reap(LSAsyncReader *reader, LSAsyncRead *reads,
+		size_t max, size_t min);
+
+/*
+ * Gives `bbuf` back to the reader to be reused by a later read. `bbuf` is
+ * invalidated.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `bbuf` is not `NULL`
+ */
+void ls_async_reader_recycle(LSAsyncReader *reader, LSByteBuffer *bbuf);
+
+#endif // loser_async_reader_h
@@ -0,0 +1,123 @@
+#ifndef loser_escape_h
+#define loser_escape_h
+
+/*
+ * NOTE: This header is internal to the library. It is not part of the API.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "loser.h"
+
+/*
+ * Returns the number of bytes at the start of `bytes` which are copied as they
+ * are (`len` if all of them are).
+ */
+typedef size_t (*LSEscapeFindRunFn)(const LSByte *bytes, size_t len,
+		const void *ctx);
+
+// Writes the escape standing for `byte` to `dest`, and returns its length.
+typedef size_t (*LSEscapeWriteFn)(LSByte *dest, LSByte byte);
+
+/*
+ * Appends `sspan` to `bbuf`, copying the runs found by `find_run()` in bulk and
+ * writing every byte between them as its escape (of at most `max_escape_len`
+ * bytes). On failure, `bbuf` is left as it was.
+ *
+ * `bbuf` is reserved room for `sspan` as it is up front, and since runs take no
+ * more room than that, only an escape can need more. Meant to be inlined, with
+ * the callbacks known.
+ *
+ * Constraints:
+ * - `bbuf` and `sspan` are valid
+ * - `max_escape_len` is at least `1`
+ */
+static inline LSStatus ls_escape_append(LSByteBuffer *bbuf,
+		LSStringSpan sspan, size_t max_escape_len,
+		LSEscapeFindRunFn find_run, const void *ctx,
+		LSEscapeWriteFn write_escape)
+{
+	if (ls_bbuf_reserve(bbuf, sspan.len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	const LSByte *bytes = sspan.bytes;
+	size_t len = sspan.len;
+	size_t old_len = bbuf->len;
+
+	size_t pos = 0;
+	for (;;) {
+		size_t run = find_run(&bytes[pos], len - pos, ctx);
+		memcpy(&bbuf->bytes[bbuf->len], &bytes[pos], run);
+		bbuf->len += run;
+		pos += run;
+
+		if (pos == len) {
+			break;
+		}
+
+		size_t growth = max_escape_len - 1;
+		if (bbuf->cap - bbuf->len < len - pos + growth
+				&& ls_bbuf_reserve(bbuf, len - pos + growth)
+				!= LS_SUCCESS) {
+			bbuf->len = old_len;
+			return LS_FAILURE;
+		}
+
+		bbuf->len += write_escape(&bbuf->bytes[bbuf->len], bytes[pos]);
+		++pos;
+	}
+
+	return LS_SUCCESS;
+}
+
+/*
+ * Returns the value of a hexadecimal digit of either case, or `0xff` (so the
+ * values of several digits can be ORed together and checked at once) if `byte`
+ * is not one.
+ */
+static inline uint32_t ls_escape_hex_value(LSByte byte)
+{
+	uint32_t digit = (uint32_t)byte - '0';
+	uint32_t letter = (uint32_t)(byte | 0x20) - 'a';
+
+	return digit < 10 ? digit : letter < 6 ? letter + 10 : 0xff;
+}
+
+/*
+ * Writes `cp` to `dest` as UTF-8, and returns its length.
+ *
+ * Constraints:
+ * - `cp` is a Unicode scalar value
+ * - `dest` has room for 4 bytes
+ */
+static inline size_t ls_escape_encode_utf8(LSByte *dest, uint32_t cp)
+{
+	if (cp < 0x80) {
+		dest[0] = (LSByte)cp;
+		return 1;
+	}
+
+	if (cp < 0x800) {
+		dest[0] = (LSByte)(0xc0 | (cp >> 6));
+		dest[1] = (LSByte)(0x80 | (cp & 0x3f));
+		return 2;
+	}
+
+	if (cp < 0x10000) {
+		dest[0] = (LSByte)(0xe0 | (cp >> 12));
+		dest[1] = (LSByte)(0x80 | ((cp >> 6) & 0x3f));
+		dest[2] = (LSByte)(0x80 | (cp & 0x3f));
+		return 3;
+	}
+
+	dest[0] = (LSByte)(0xf0 | (cp >> 18));
+	dest[1] = (LSByte)(0x80 | ((cp >> 12) & 0x3f));
+	dest[2] = (LSByte)(0x80 | ((cp >> 6) & 0x3f));
+	dest[3] = (LSByte)(0x80 | (cp & 0x3f));
+	return 4;
+}
+
+#endif // loser_escape_h
@@ -0,0 +1,108 @@
+#ifndef loser_thread_pool_h
+#define loser_thread_pool_h
+
+#include "loser.h"
+
+/*
+ * NOTE: Requires POSIX threads.
+ *
+ * NOTE: An `LSThreadPool` must only be used from one thread at a time. The
+ * thread using it takes part in running its tasks.
+ */
+
+// A fixed set of threads for running batches of CPU-bound tasks.
+/*
+ * Every thread has a deque of pending work. Threads which run out of work
+ * steal from the others' deques, so uneven tasks still keep all threads busy.
+ * Nothing is allocated per batch or per task.
+ */
+typedef struct LSThreadPool LSThreadPool;
+
+enum { LS_THREAD_POOL_MAX_THREADS = 256 };
+
+// A task of a batch, identified by its index in the batch.
+typedef void (*LSTaskFn)(void *ctx, size_t task_idx);
+
+// Processes `sspans[0]`..`sspans[nsspans - 1]`, which are the elements from
+// index `first_idx` of the whole array.
+typedef void (*LSSpansFn)(void *ctx, const LSStringSpan *sspans,
+		size_t nsspans, size_t first_idx);
+
+/*
+ * Creates a pool of `nthreads` threads, counting the thread which will be
+ * using the pool (i.e. `nthreads - 1` threads are spawned).
+ *
+ * Fails if:
+ * - allocation fails
+ * - `nthreads` is `0` or greater than `LS_THREAD_POOL_MAX_THREADS`
+ * - the threads could not be spawned
+ *
+ * Returns `NULL` on failure.
+ */
+LSThreadPool *ls_thread_pool_create(size_t nthreads);
+
+/*
+ * Constraints:
+ * - `pool` is not `NULL`
+ * - `pool` was not previously destroyed
+ */
+void ls_thread_pool_destroy(LSThreadPool *pool);
+
+/*
+ * Constraints:
+ * - `pool` is not `NULL`
+ */
+size_t ls_thread_pool_get_nthreads(const LSThreadPool *pool);
+
+/*
+ * Calls `fn(ctx, i)` for every `i` below `ntasks`, spread over the threads of
+ * `pool`, and waits for all of them to return.
+ *
+ * Tasks are scheduled one at a time, so each should be worth far more than a
+ * lock round trip. Use `ls_parallel_for_spans()` for fine-grained work.
+ *
+ * Constraints:
+ * - `pool` is not `NULL`
+ * - `fn` is not `NULL`
+ */
+void ls_thread_pool_run(LSThreadPool *pool, size_t ntasks, LSTaskFn fn,
+		void *ctx);
+
+/*
+ * Calls `fn` on consecutive runs of `sspans`, together covering each span
+ * exactly once, spread over the threads of `pool`, and waits for all calls to
+ * return.
+ *
+ * The length of the runs is tuned to `fn`: the first few runs are timed on the
+ * calling thread, and the rest of the array is cut into runs of roughly 50us
+ * each (but at least a few per thread). Arrays which take too little time in
+ * total are processed on the calling thread alone.
+ *
+ * Constraints:
+ * - `pool` is not `NULL`
+ * - `sspans` points to an array of at least `nsspans` spans
+ * - `fn` is not `NULL`
+ */
+void ls_parallel_for_spans(LSThreadPool *pool, const LSStringSpan *sspans,
+		size_t nsspans, LSSpansFn fn, void *ctx);
+
+/*
+ * Sorts `sspans` like `ls_sspan_sort()`, but on all threads of `pool`.
+ *
+ * Uses sample sort: the spans are split into buckets of roughly equal size
+ * around sampled splitters, which are then sorted independently. Needs scratch
+ * memory of about four times the size of the array.
+ *
+ * Constraints:
+ * - `pool` is not `NULL`
+ * - `sspans` points to an array of at least `nsspans` spans
+ *         OR is `NULL`
+ *
+ * Fails if:
+ * - `sspans` is `NULL`
+ * - memory allocation fails
+ */
+LSStatus ls_sspan_parallel_sort(LSThreadPool *pool, LSStringSpan *sspans,
+		size_t nsspans);
+
+#endif // loser_thread_pool_h
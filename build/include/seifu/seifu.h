@@ -0,0 +1,14 @@
+#ifndef seifu_h
+#define seifu_h
+#include <stddef.h>
+#include <stdint.h>
+typedef enum SeifuStatus { SEIFU_OK = 0, SEIFU_OVERFLOW } SeifuStatus;
+static inline SeifuStatus seifu_add(size_t a, size_t b, size_t *out)
+{ if (a > SIZE_MAX - b) return SEIFU_OVERFLOW; *out = a + b; return SEIFU_OK; }
+static inline SeifuStatus seifu_mul(size_t a, size_t b, size_t *out)
+{ if (b && a > SIZE_MAX / b) return SEIFU_OVERFLOW; *out = a * b; return SEIFU_OK; }
+static inline size_t seifu_add_bounded(size_t a, size_t b)
+{ return a > SIZE_MAX - b ? SIZE_MAX : a + b; }
+static inline size_t seifu_div_round_bounded(size_t a, size_t b)
+{ return a / b + (a % b >= (b + 1) / 2); }
+#endif
@@ -0,0 +1,8 @@
+#ifndef tyrant_h
+#define tyrant_h
+#include <stdbool.h>
+#include <stddef.h>
+void *tyrant_alloc(size_t size);
+void *tyrant_realloc(void *ptr, size_t size, bool *success);
+void tyrant_free(void *ptr);
+#endif
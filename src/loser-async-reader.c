@@ -0,0 +1,757 @@
+#ifdef __linux__
+
+#define _GNU_SOURCE
+
+#include "loser-async-reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+#include <tyrant/tyrant.h>
+
+enum {
+	UNKNOWN_SIZE_INIT_CAP = 4096,
+	MAX_WORKERS = 64
+};
+
+typedef struct Slot {
+	// set from submission until the read is reaped
+	bool in_use;
+	int fd;
+	bool size_known;
+	size_t size;
+	LSByteBuffer bbuf;
+	void *user_data;
+	int error;
+	struct iovec iov;
+} Slot;
+
+typedef struct URing {
+	int fd;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+} URing;
+
+// A fixed-capacity FIFO of slot indices.
+typedef struct SlotQueue {
+	size_t *idxs;
+	size_t head;
+	size_t len;
+} SlotQueue;
+
+typedef struct Workers {
+	pthread_t threads[MAX_WORKERS];
+	size_t nthreads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t job_ready;
+	pthread_cond_t read_done;
+	SlotQueue jobs;
+	SlotQueue done;
+	bool shutdown;
+} Workers;
+
+struct LSAsyncReader {
+	LSAsyncReaderBackend backend;
+	size_t queue_depth;
+
+	Slot *slots;
+	size_t *free_slots;
+	size_t nfree_slots;
+
+	LSByteBuffer *pool;
+	size_t pool_len;
+	size_t pool_cap;
+
+	union {
+		URing uring;
+		Workers workers;
+	} impl;
+};
+
+static LSStatus uring_setup(URing *uring, size_t entries);
+static void uring_teardown(URing *uring);
+static void uring_queue_read(LSAsyncReader *reader, size_t slot_idx);
+static LSStatus uring_enter(URing *uring, unsigned min_complete);
+static size_t uring_drain(LSAsyncReader *reader, LSAsyncRead *reads,
+		size_t max);
+
+static LSStatus workers_setup(LSAsyncReader *reader);
+static void workers_teardown(Workers *workers);
+static void *worker_main(void *arg);
+static void read_blocking(Slot *slot);
+
+static LSStatus slot_queue_create(SlotQueue *queue, size_t cap);
+static void slot_queue_push(SlotQueue *queue, size_t cap, size_t idx);
+static size_t slot_queue_pop(SlotQueue *queue, size_t cap);
+
+static LSAsyncRead finish_slot(LSAsyncReader *reader, size_t slot_idx);
+static LSStatus slot_grow(Slot *slot);
+static LSByteBuffer pool_take(LSAsyncReader *reader, size_t min_cap);
+static void *alloc_array(size_t nmemb, size_t size);
+
+LSAsyncReader *ls_async_reader_create(size_t queue_depth,
+		LSAsyncReaderFlags flags)
+{
+	if (queue_depth == 0 || queue_depth > UINT32_MAX / 2) {
+		return NULL;
+	}
+
+	LSAsyncReader *reader = tyrant_alloc(sizeof(*reader));
+	if (!reader) {
+		return NULL;
+	}
+
+	*reader = (LSAsyncReader){
+		.queue_depth = queue_depth,
+		.slots = alloc_array(queue_depth, sizeof(Slot)),
+		.free_slots = alloc_array(queue_depth, sizeof(size_t)),
+		.nfree_slots = queue_depth,
+		.pool = alloc_array(queue_depth, sizeof(LSByteBuffer)),
+		.pool_len = 0,
+		.pool_cap = queue_depth
+	};
+	if (!reader->slots || !reader->free_slots || !reader->pool) {
+		goto fail;
+	}
+
+	for (size_t i = 0; i < queue_depth; ++i) {
+		reader->slots[i].in_use = false;
+		reader->free_slots[i] = queue_depth - 1 - i;
+	}
+
+	if (!(flags & LS_ASYNC_READER_NO_URING)
+			&& uring_setup(&reader->impl.uring, queue_depth)
+			== LS_SUCCESS) {
+		reader->backend = LS_ASYNC_READER_URING;
+		return reader;
+	}
+
+	if (workers_setup(reader) == LS_SUCCESS) {
+		reader->backend = LS_ASYNC_READER_THREADS;
+		return reader;
+	}
+
+fail:
+	tyrant_free(reader->slots);
+	tyrant_free(reader->free_slots);
+	tyrant_free(reader->pool);
+	tyrant_free(reader);
+
+	return NULL;
+}
+
+void ls_async_reader_destroy(LSAsyncReader *reader)
+{
+	if (reader->backend == LS_ASYNC_READER_URING) {
+		// the kernel may still be writing into our buffers
+		LSAsyncRead read;
+		while (ls_async_reader_reap(reader, &read, 1, 1) == 1) {
+			ls_bbuf_destroy(&read.bbuf);
+		}
+
+		uring_teardown(&reader->impl.uring);
+	} else {
+		workers_teardown(&reader->impl.workers);
+	}
+
+	// slots still in use are either unreaped or were never started
+	for (size_t i = 0; i < reader->queue_depth; ++i) {
+		if (reader->slots[i].in_use) {
+			close(reader->slots[i].fd);
+			ls_bbuf_destroy(&reader->slots[i].bbuf);
+		}
+	}
+
+	for (size_t i = 0; i < reader->pool_len; ++i) {
+		ls_bbuf_destroy(&reader->pool[i]);
+	}
+
+	tyrant_free(reader->slots);
+	tyrant_free(reader->free_slots);
+	tyrant_free(reader->pool);
+	tyrant_free(reader);
+}
+
+LSAsyncReaderBackend ls_async_reader_get_backend(const LSAsyncReader *reader)
+{
+	return reader->backend;
+}
+
+size_t ls_async_reader_get_inflight(const LSAsyncReader *reader)
+{
+	return reader->queue_depth - reader->nfree_slots;
+}
+
+LSStatus ls_async_reader_submit(LSAsyncReader *reader, const char *path,
+		void *user_data)
+{
+	if (reader->nfree_slots == 0) {
+		errno = EBUSY;
+		return LS_FAILURE;
+	}
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return LS_FAILURE;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+
+		return LS_FAILURE;
+	}
+
+	// some files (e.g. in procfs) report a size of 0 but aren't empty
+	bool size_known = S_ISREG(st.st_mode) && st.st_size > 0;
+	size_t size = size_known ? (size_t)st.st_size : 0;
+
+	LSByteBuffer bbuf = pool_take(reader,
+			size_known ? size : UNKNOWN_SIZE_INIT_CAP);
+	if (!ls_bbuf_is_valid(bbuf)) {
+		close(fd);
+		errno = ENOMEM;
+
+		return LS_FAILURE;
+	}
+
+	size_t slot_idx = reader->free_slots[--reader->nfree_slots];
+	reader->slots[slot_idx] = (Slot){
+		.in_use = true,
+		.fd = fd,
+		.size_known = size_known,
+		.size = size,
+		.bbuf = bbuf,
+		.user_data = user_data,
+		.error = 0
+	};
+
+	if (reader->backend == LS_ASYNC_READER_URING) {
+		uring_queue_read(reader, slot_idx);
+		return LS_SUCCESS;
+	}
+
+	Workers *workers = &reader->impl.workers;
+
+	pthread_mutex_lock(&workers->mutex);
+	slot_queue_push(&workers->jobs, reader->queue_depth, slot_idx);
+	pthread_cond_signal(&workers->job_ready);
+	pthread_mutex_unlock(&workers->mutex);
+
+	return LS_SUCCESS;
+}
+
+size_t ls_async_reader_reap(LSAsyncReader *reader, LSAsyncRead *reads,
+		size_t max, size_t min)
+{
+	size_t inflight = ls_async_reader_get_inflight(reader);
+	if (min > inflight) {
+		min = inflight;
+	}
+	if (min > max) {
+		min = max;
+	}
+
+	size_t nreads = 0;
+
+	if (reader->backend == LS_ASYNC_READER_URING) {
+		URing *uring = &reader->impl.uring;
+
+		if (uring_enter(uring, 0) != LS_SUCCESS) {
+			return 0;
+		}
+
+		for (;;) {
+			nreads += uring_drain(reader, &reads[nreads],
+					max - nreads);
+			if (nreads >= min) {
+				break;
+			}
+
+			if (uring_enter(uring, 1) != LS_SUCCESS) {
+				break;
+			}
+		}
+
+		return nreads;
+	}
+
+	Workers *workers = &reader->impl.workers;
+	size_t done[64];
+
+	pthread_mutex_lock(&workers->mutex);
+	while (workers->done.len < min) {
+		pthread_cond_wait(&workers->read_done, &workers->mutex);
+	}
+
+	size_t ndone = workers->done.len;
+	if (ndone > max) {
+		ndone = max;
+	}
+
+	while (nreads < ndone) {
+		// finish slots outside the lock, in batches
+		size_t nbatch = ndone - nreads;
+		if (nbatch > sizeof(done) / sizeof(done[0])) {
+			nbatch = sizeof(done) / sizeof(done[0]);
+		}
+
+		for (size_t i = 0; i < nbatch; ++i) {
+			done[i] = slot_queue_pop(&workers->done,
+					reader->queue_depth);
+		}
+		pthread_mutex_unlock(&workers->mutex);
+
+		for (size_t i = 0; i < nbatch; ++i) {
+			reads[nreads++] = finish_slot(reader, done[i]);
+		}
+
+		pthread_mutex_lock(&workers->mutex);
+	}
+	pthread_mutex_unlock(&workers->mutex);
+
+	return nreads;
+}
+
+void ls_async_reader_recycle(LSAsyncReader *reader, LSByteBuffer *bbuf)
+{
+	if (!ls_bbuf_is_valid(*bbuf)) {
+		return;
+	}
+
+	if (reader->pool_len == reader->pool_cap) {
+		ls_bbuf_destroy(bbuf);
+	} else {
+		bbuf->len = 0;
+		reader->pool[reader->pool_len++] = *bbuf;
+	}
+
+	ls_bbuf_invalidate(bbuf);
+}
+
+LSStatus uring_setup(URing *uring, size_t entries)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	int fd = syscall(__NR_io_uring_setup, (unsigned)entries, &params);
+	if (fd < 0) {
+		return LS_FAILURE;
+	}
+
+	*uring = (URing){ .fd = fd };
+
+	uring->sq_ring_size = params.sq_off.array
+			+ params.sq_entries * sizeof(unsigned);
+	uring->cq_ring_size = params.cq_off.cqes
+			+ params.cq_entries * sizeof(struct io_uring_cqe);
+	uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap && uring->cq_ring_size > uring->sq_ring_size) {
+		uring->sq_ring_size = uring->cq_ring_size;
+	}
+
+	uring->sq_ring = mmap(NULL, uring->sq_ring_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			fd, IORING_OFF_SQ_RING);
+	if (uring->sq_ring == MAP_FAILED) {
+		close(fd);
+		return LS_FAILURE;
+	}
+
+	if (single_mmap) {
+		uring->cq_ring = uring->sq_ring;
+	} else {
+		uring->cq_ring = mmap(NULL, uring->cq_ring_size,
+				PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE,
+				fd, IORING_OFF_CQ_RING);
+		if (uring->cq_ring == MAP_FAILED) {
+			munmap(uring->sq_ring, uring->sq_ring_size);
+			close(fd);
+			return LS_FAILURE;
+		}
+	}
+
+	uring->sqes = mmap(NULL, uring->sqes_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			fd, IORING_OFF_SQES);
+	if (uring->sqes == MAP_FAILED) {
+		if (!single_mmap) {
+			munmap(uring->cq_ring, uring->cq_ring_size);
+		}
+		munmap(uring->sq_ring, uring->sq_ring_size);
+		close(fd);
+		return LS_FAILURE;
+	}
+
+	char *sq = uring->sq_ring;
+	uring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	uring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	uring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+	uring->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+	char *cq = uring->cq_ring;
+	uring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	uring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	uring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	return LS_SUCCESS;
+}
+
+void uring_teardown(URing *uring)
+{
+	munmap(uring->sqes, uring->sqes_size);
+	if (uring->cq_ring != uring->sq_ring) {
+		munmap(uring->cq_ring, uring->cq_ring_size);
+	}
+	munmap(uring->sq_ring, uring->sq_ring_size);
+	close(uring->fd);
+}
+
+void uring_queue_read(LSAsyncReader *reader, size_t slot_idx)
+{
+	URing *uring = &reader->impl.uring;
+	Slot *slot = &reader->slots[slot_idx];
+
+	slot->iov = (struct iovec){
+		.iov_base = &slot->bbuf.bytes[slot->bbuf.len],
+		.iov_len = slot->bbuf.cap - slot->bbuf.len
+	};
+
+	// we are the only producer, so the tail needs no ordering on load
+	unsigned tail = *uring->sq_tail;
+	unsigned idx = tail & uring->sq_mask;
+
+	struct io_uring_sqe *sqe = &uring->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = slot->fd;
+	sqe->off = slot->bbuf.len;
+	sqe->addr = (uintptr_t)&slot->iov;
+	sqe->len = 1;
+	sqe->user_data = slot_idx;
+
+	uring->sq_array[idx] = idx;
+	__atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+LSStatus uring_enter(URing *uring, unsigned min_complete)
+{
+	unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+	unsigned to_submit = *uring->sq_tail - head;
+	unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+	if (to_submit == 0 && min_complete == 0) {
+		return LS_SUCCESS;
+	}
+
+	for (;;) {
+		long ret = syscall(__NR_io_uring_enter, uring->fd, to_submit,
+				min_complete, flags, NULL, 0);
+		if (ret >= 0) {
+			return LS_SUCCESS;
+		}
+		if (errno != EINTR && errno != EAGAIN) {
+			return LS_FAILURE;
+		}
+	}
+}
+
+size_t uring_drain(LSAsyncReader *reader, LSAsyncRead *reads, size_t max)
+{
+	URing *uring = &reader->impl.uring;
+
+	size_t nreads = 0;
+	unsigned head = *uring->cq_head;
+	unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+	// each completion yields at most one finished read
+	for (; head != tail && nreads < max; ++head) {
+		struct io_uring_cqe *cqe = &uring->cqes[head & uring->cq_mask];
+		size_t slot_idx = cqe->user_data;
+		Slot *slot = &reader->slots[slot_idx];
+
+		bool finished = true;
+		if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+			finished = false;
+		} else if (cqe->res < 0) {
+			slot->error = -cqe->res;
+		} else if (cqe->res > 0) {
+			slot->bbuf.len += cqe->res;
+
+			bool got_all = slot->size_known
+					&& slot->bbuf.len >= slot->size;
+			if (!got_all) {
+				finished = slot_grow(slot) != LS_SUCCESS;
+			}
+		}
+
+		if (finished) {
+			reads[nreads++] = finish_slot(reader, slot_idx);
+		} else {
+			uring_queue_read(reader, slot_idx);
+		}
+	}
+
+	__atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+
+	// hand any continuations to the kernel without waiting
+	uring_enter(uring, 0);
+
+	return nreads;
+}
+
+LSStatus workers_setup(LSAsyncReader *reader)
+{
+	Workers *workers = &reader->impl.workers;
+	*workers = (Workers){ .shutdown = false };
+
+	if (slot_queue_create(&workers->jobs, reader->queue_depth)
+			!= LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+	if (slot_queue_create(&workers->done, reader->queue_depth)
+			!= LS_SUCCESS) {
+		tyrant_free(workers->jobs.idxs);
+		return LS_FAILURE;
+	}
+
+	pthread_mutex_init(&workers->mutex, NULL);
+	pthread_cond_init(&workers->job_ready, NULL);
+	pthread_cond_init(&workers->read_done, NULL);
+
+	// reads block on I/O rather than CPU, so oversubscribe a bit
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nthreads = ncpus > 0 ? 2 * (size_t)ncpus : 2;
+	if (nthreads > MAX_WORKERS) {
+		nthreads = MAX_WORKERS;
+	}
+	if (nthreads > reader->queue_depth) {
+		nthreads = reader->queue_depth;
+	}
+
+	for (size_t i = 0; i < nthreads; ++i) {
+		if (pthread_create(&workers->threads[i], NULL, worker_main,
+				reader) != 0) {
+			break;
+		}
+		workers->nthreads++;
+	}
+
+	if (workers->nthreads == 0) {
+		workers_teardown(workers);
+		return LS_FAILURE;
+	}
+
+	return LS_SUCCESS;
+}
+
+void workers_teardown(Workers *workers)
+{
+	pthread_mutex_lock(&workers->mutex);
+	workers->shutdown = true;
+	pthread_cond_broadcast(&workers->job_ready);
+	pthread_mutex_unlock(&workers->mutex);
+
+	for (size_t i = 0; i < workers->nthreads; ++i) {
+		pthread_join(workers->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&workers->read_done);
+	pthread_cond_destroy(&workers->job_ready);
+	pthread_mutex_destroy(&workers->mutex);
+
+	tyrant_free(workers->jobs.idxs);
+	tyrant_free(workers->done.idxs);
+}
+
+void *worker_main(void *arg)
+{
+	LSAsyncReader *reader = arg;
+	Workers *workers = &reader->impl.workers;
+
+	pthread_mutex_lock(&workers->mutex);
+	for (;;) {
+		while (workers->jobs.len == 0 && !workers->shutdown) {
+			pthread_cond_wait(&workers->job_ready, &workers->mutex);
+		}
+		if (workers->shutdown) {
+			break;
+		}
+
+		size_t slot_idx = slot_queue_pop(&workers->jobs,
+				reader->queue_depth);
+		pthread_mutex_unlock(&workers->mutex);
+
+		read_blocking(&reader->slots[slot_idx]);
+
+		pthread_mutex_lock(&workers->mutex);
+		slot_queue_push(&workers->done, reader->queue_depth, slot_idx);
+		pthread_cond_signal(&workers->read_done);
+	}
+	pthread_mutex_unlock(&workers->mutex);
+
+	return NULL;
+}
+
+void read_blocking(Slot *slot)
+{
+	LSByteBuffer *bbuf = &slot->bbuf;
+
+	for (;;) {
+		ssize_t nread = pread(slot->fd, &bbuf->bytes[bbuf->len],
+				bbuf->cap - bbuf->len, bbuf->len);
+		if (nread < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+
+			slot->error = errno;
+			return;
+		}
+		if (nread == 0) {
+			return;
+		}
+
+		bbuf->len += nread;
+
+		if (slot->size_known && bbuf->len >= slot->size) {
+			return;
+		}
+		if (slot_grow(slot) != LS_SUCCESS) {
+			return;
+		}
+	}
+}
+
+LSStatus slot_queue_create(SlotQueue *queue, size_t cap)
+{
+	*queue = (SlotQueue){
+		.idxs = alloc_array(cap, sizeof(size_t)),
+		.head = 0,
+		.len = 0
+	};
+
+	return queue->idxs ? LS_SUCCESS : LS_FAILURE;
+}
+
+void slot_queue_push(SlotQueue *queue, size_t cap, size_t idx)
+{
+	queue->idxs[(queue->head + queue->len) % cap] = idx;
+	queue->len++;
+}
+
+size_t slot_queue_pop(SlotQueue *queue, size_t cap)
+{
+	size_t idx = queue->idxs[queue->head];
+	queue->head = (queue->head + 1) % cap;
+	queue->len--;
+
+	return idx;
+}
+
+LSAsyncRead finish_slot(LSAsyncReader *reader, size_t slot_idx)
+{
+	Slot *slot = &reader->slots[slot_idx];
+
+	close(slot->fd);
+	slot->in_use = false;
+	reader->free_slots[reader->nfree_slots++] = slot_idx;
+
+	if (slot->error != 0) {
+		ls_async_reader_recycle(reader, &slot->bbuf);
+
+		return (LSAsyncRead){
+			.user_data = slot->user_data,
+			.status = LS_FAILURE,
+			.error = slot->error,
+			.bbuf = LS_AN_INVALID_BBUF
+		};
+	}
+
+	return (LSAsyncRead){
+		.user_data = slot->user_data,
+		.status = LS_SUCCESS,
+		.error = 0,
+		.bbuf = ls_bbuf_move(&slot->bbuf)
+	};
+}
+
+// Makes room for more data once the buffer is full.
+LSStatus slot_grow(Slot *slot)
+{
+	if (slot->bbuf.len < slot->bbuf.cap) {
+		return LS_SUCCESS;
+	}
+
+	if (ls_bbuf_expand_by(&slot->bbuf, slot->bbuf.cap) != LS_SUCCESS) {
+		slot->error = ENOMEM;
+		return LS_FAILURE;
+	}
+
+	return LS_SUCCESS;
+}
+
+LSByteBuffer pool_take(LSAsyncReader *reader, size_t min_cap)
+{
+	if (reader->pool_len == 0) {
+		return ls_bbuf_create_with_init_cap(min_cap);
+	}
+
+	// prefer the most recently recycled buffer--it's likely still cached
+	LSByteBuffer bbuf = reader->pool[--reader->pool_len];
+	if (bbuf.cap < min_cap
+			&& ls_bbuf_expand_to(&bbuf, min_cap) != LS_SUCCESS) {
+		ls_bbuf_destroy(&bbuf);
+		return LS_AN_INVALID_BBUF;
+	}
+
+	return bbuf;
+}
+
+void *alloc_array(size_t nmemb, size_t size)
+{
+	if (size != 0 && nmemb > SIZE_MAX / size) {
+		return NULL;
+	}
+
+	return tyrant_alloc(nmemb * size);
+}
+
+#else
+
+// `LSAsyncReader` is only available on Linux.
+typedef int ls_async_reader_unavailable;
+
+#endif // __linux__
@@ -0,0 +1,344 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "loser-simd.h"
+
+typedef size_t (*FindFn)(const LSByte *bytes, size_t len, const LSByteSet *set,
+		bool in);
+typedef size_t (*CountFn)(const LSByte *bytes, size_t len,
+		const LSByteSet *set);
+
+static FindFn resolve_find(void);
+static FindFn resolve_find_last(void);
+static CountFn resolve_count(void);
+
+LS_DISPATCH(size_t, find,
+		(const LSByte *bytes, size_t len, const LSByteSet *set, bool in),
+		(bytes, len, set, in), resolve_find)
+LS_DISPATCH(size_t, find_last,
+		(const LSByte *bytes, size_t len, const LSByteSet *set, bool in),
+		(bytes, len, set, in), resolve_find_last)
+LS_DISPATCH(size_t, count,
+		(const LSByte *bytes, size_t len, const LSByteSet *set),
+		(bytes, len, set), resolve_count)
+
+static size_t find_scalar(const LSByte *bytes, size_t len,
+		const LSByteSet *set, bool in);
+static size_t find_last_scalar(const LSByte *bytes, size_t len,
+		const LSByteSet *set, bool in);
+static size_t count_scalar(const LSByte *bytes, size_t len,
+		const LSByteSet *set);
+
+#ifdef LS_SIMD_X86
+static size_t find_avx2(const LSByte *bytes, size_t len, const LSByteSet *set,
+		bool in);
+static size_t find_last_avx2(const LSByte *bytes, size_t len,
+		const LSByteSet *set, bool in);
+static size_t count_avx2(const LSByte *bytes, size_t len,
+		const LSByteSet *set);
+#endif
+
+// `A-Z a-z 0-9 - . _ ~`
+const LSByteSet LS_URL_UNRESERVED_SET = { ._bits = {
+		{ 0xa8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8,
+		  0xf8, 0xf8, 0xf0, 0x50, 0x50, 0x54, 0xd4, 0x70 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+} };
+
+// the above and ``! $ & ' ( ) * + , ; = : @ /``
+const LSByteSet LS_URL_PATH_SET = { ._bits = {
+		{ 0xb8, 0xfc, 0xf8, 0xf8, 0xfc, 0xf8, 0xfc, 0xfc,
+		  0xfc, 0xfc, 0xfc, 0x5c, 0x54, 0x5c, 0xd4, 0x74 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+} };
+
+// the above and `?`
+const LSByteSet LS_URL_QUERY_SET = { ._bits = {
+		{ 0xb8, 0xfc, 0xf8, 0xf8, 0xfc, 0xf8, 0xfc, 0xfc,
+		  0xfc, 0xfc, 0xfc, 0x5c, 0x54, 0x5c, 0xd4, 0x7c },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+} };
+
+// `' ' \t \n \v \f \r`
+const LSByteSet LS_ASCII_WHITESPACE_SET = { ._bits = {
+		{ 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		  0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+} };
+
+LSByteSet ls_byte_set_from_sspan(LSStringSpan sspan)
+{
+	LSByteSet set = { 0 };
+
+	if (!ls_sspan_is_valid(sspan)) {
+		return set;
+	}
+
+	for (size_t i = 0; i < sspan.len; ++i) {
+		ls_byte_set_add(&set, sspan.bytes[i]);
+	}
+
+	return set;
+}
+
+LSByteSet ls_byte_set_from_cstr(const char *cstr)
+{
+	return ls_byte_set_from_sspan(ls_sspan_from_cstr(cstr));
+}
+
+size_t ls_sspan_find_first_of(LSStringSpan sspan, const LSByteSet *set)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return SIZE_MAX;
+	}
+
+	size_t idx = find(sspan.bytes, sspan.len, set, true);
+
+	return idx == sspan.len ? SIZE_MAX : idx;
+}
+
+size_t ls_sspan_find_first_not_of(LSStringSpan sspan, const LSByteSet *set)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return SIZE_MAX;
+	}
+
+	size_t idx = find(sspan.bytes, sspan.len, set, false);
+
+	return idx == sspan.len ? SIZE_MAX : idx;
+}
+
+LSStringSpan ls_sspan_trim(LSStringSpan sspan, const LSByteSet *set)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return LS_AN_INVALID_SSPAN;
+	}
+
+	size_t start = find(sspan.bytes, sspan.len, set, false);
+	if (start == sspan.len) {
+		return ls_sspan_create(&sspan.bytes[start], 0);
+	}
+
+	// the byte at `start` is not in `set`, so the end is past it
+	size_t end = start + find_last(&sspan.bytes[start], sspan.len - start,
+			set, false);
+
+	return ls_sspan_create(&sspan.bytes[start], end - start);
+}
+
+size_t ls_sspan_count_of(LSStringSpan sspan, const LSByteSet *set)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return 0;
+	}
+
+	return count(sspan.bytes, sspan.len, set);
+}
+
+FindFn resolve_find(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return find_avx2;
+	}
+#endif
+
+	return find_scalar;
+}
+
+FindFn resolve_find_last(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return find_last_avx2;
+	}
+#endif
+
+	return find_last_scalar;
+}
+
+CountFn resolve_count(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return count_avx2;
+	}
+#endif
+
+	return count_scalar;
+}
+
+/*
+ * Returns the index of the first byte which is (if `in`) or is not (otherwise)
+ * in `set`, or `len` if there is none.
+ */
+size_t find_scalar(const LSByte *bytes, size_t len, const LSByteSet *set,
+		bool in)
+{
+	for (size_t i = 0; i < len; ++i) {
+		if (ls_byte_set_contains(set, bytes[i]) == in) {
+			return i;
+		}
+	}
+
+	return len;
+}
+
+/*
+ * Like `find_scalar()`, but returns one past the index of the last such byte,
+ * or `0` if there is none.
+ */
+size_t find_last_scalar(const LSByte *bytes, size_t len, const LSByteSet *set,
+		bool in)
+{
+	for (; len > 0; --len) {
+		if (ls_byte_set_contains(set, bytes[len - 1]) == in) {
+			return len;
+		}
+	}
+
+	return 0;
+}
+
+size_t count_scalar(const LSByte *bytes, size_t len, const LSByteSet *set)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < len; ++i) {
+		n += ls_byte_set_contains(set, bytes[i]);
+	}
+
+	return n;
+}
+
+#ifdef LS_SIMD_X86
+
+/*
+ * Sets the bytes of the result to `0xff` where `v` has a byte in the set whose
+ * bitmap halves are broadcast into `rows_low` and `rows_high`, and to `0`
+ * elsewhere.
+ *
+ * The low nibble of each byte picks a row of the bitmap (from one half or the
+ * other, by the top bit), and the high nibble picks the bit within it.
+ */
+LS_TARGET_AVX2
+static inline __m256i avx2_in_set(__m256i v, __m256i rows_low,
+		__m256i rows_high)
+{
+	const __m256i BITS = _mm256_setr_epi8(
+			1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+			1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m256i LOW_NIBBLE = _mm256_set1_epi8(0x0f);
+
+	__m256i low = _mm256_and_si256(v, LOW_NIBBLE);
+	__m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), LOW_NIBBLE);
+
+	__m256i row = _mm256_blendv_epi8(
+			_mm256_shuffle_epi8(rows_low, low),
+			_mm256_shuffle_epi8(rows_high, low), v);
+	__m256i bit = _mm256_shuffle_epi8(BITS, high);
+
+	return _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+}
+
+LS_TARGET_AVX2
+static inline __m256i avx2_rows(const LSByteSet *set, size_t half)
+{
+	return _mm256_broadcastsi128_si256(
+			_mm_loadu_si128((const __m128i *)set->_bits[half]));
+}
+
+LS_TARGET_AVX2
+size_t find_avx2(const LSByte *bytes, size_t len, const LSByteSet *set,
+		bool in)
+{
+	const __m256i ROWS_LOW = avx2_rows(set, 0);
+	const __m256i ROWS_HIGH = avx2_rows(set, 1);
+	const uint64_t FLIP = in ? 0 : UINT64_MAX;
+
+	size_t i = 0;
+	for (; len - i >= 64; i += 64) {
+		__m256i v0 = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+		__m256i v1 = _mm256_loadu_si256((const __m256i *)&bytes[i + 32]);
+		uint64_t mask = ((uint64_t)(uint32_t)_mm256_movemask_epi8(
+				avx2_in_set(v0, ROWS_LOW, ROWS_HIGH))
+				| (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				avx2_in_set(v1, ROWS_LOW, ROWS_HIGH)) << 32) ^ FLIP;
+		if (mask != 0) {
+			return i + (size_t)__builtin_ctzll(mask);
+		}
+	}
+
+	for (; len - i >= 32; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+				avx2_in_set(v, ROWS_LOW, ROWS_HIGH)) ^ (uint32_t)FLIP;
+		if (mask != 0) {
+			return i + (size_t)__builtin_ctz(mask);
+		}
+	}
+
+	return i + find_scalar(&bytes[i], len - i, set, in);
+}
+
+LS_TARGET_AVX2
+size_t find_last_avx2(const LSByte *bytes, size_t len, const LSByteSet *set,
+		bool in)
+{
+	const __m256i ROWS_LOW = avx2_rows(set, 0);
+	const __m256i ROWS_HIGH = avx2_rows(set, 1);
+	const uint32_t FLIP = in ? 0 : UINT32_MAX;
+
+	for (; len >= 32; len -= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&bytes[len - 32]);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+				avx2_in_set(v, ROWS_LOW, ROWS_HIGH)) ^ FLIP;
+		if (mask != 0) {
+			return len - (size_t)__builtin_clz(mask);
+		}
+	}
+
+	return find_last_scalar(bytes, len, set, in);
+}
+
+/*
+ * Counts in byte lanes (subtracting each `0xff` match adds one), and sums the
+ * lanes before any of them can overflow.
+ */
+LS_TARGET_AVX2
+size_t count_avx2(const LSByte *bytes, size_t len, const LSByteSet *set)
+{
+	const __m256i ROWS_LOW = avx2_rows(set, 0);
+	const __m256i ROWS_HIGH = avx2_rows(set, 1);
+
+	size_t n = 0;
+	size_t i = 0;
+	while (len - i >= 32) {
+		size_t nblocks = (len - i) / 32;
+		if (nblocks > 255) {
+			nblocks = 255;
+		}
+
+		__m256i counts = _mm256_setzero_si256();
+		for (size_t block = 0; block < nblocks; ++block, i += 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+			counts = _mm256_sub_epi8(counts,
+					avx2_in_set(v, ROWS_LOW, ROWS_HIGH));
+		}
+
+		uint64_t sums[4];
+		_mm256_storeu_si256((__m256i *)sums,
+				_mm256_sad_epu8(counts, _mm256_setzero_si256()));
+		n += (size_t)(sums[0] + sums[1] + sums[2] + sums[3]);
+	}
+
+	return n + count_scalar(&bytes[i], len - i, set);
+}
+
+#endif // LS_SIMD_X86
@@ -0,0 +1,263 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "loser-simd.h"
+
+typedef bool (*EqualsIcaseFn)(const LSByte *a, const LSByte *b, size_t len);
+typedef void (*FlipCaseFn)(LSByte *bytes, size_t len, LSByte first);
+
+static EqualsIcaseFn resolve_equals_icase(void);
+static FlipCaseFn resolve_flip_case(void);
+
+LS_DISPATCH(bool, equals_icase, (const LSByte *a, const LSByte *b, size_t len),
+		(a, b, len), resolve_equals_icase)
+LS_DISPATCH_VOID(flip_case, (LSByte *bytes, size_t len, LSByte first),
+		(bytes, len, first), resolve_flip_case)
+
+static bool equals_icase_scalar(const LSByte *a, const LSByte *b, size_t len);
+static void flip_case_scalar(LSByte *bytes, size_t len, LSByte first);
+static uint64_t swar_in_range(uint64_t word, LSByte first);
+static uint64_t swar_to_lower(uint64_t word);
+static LSByte to_lower(LSByte byte);
+static void store_u64(LSByte *bytes, uint64_t word);
+static uint64_t mix_u64(uint64_t x);
+
+#ifdef LS_SIMD_X86
+static bool equals_icase_avx2(const LSByte *a, const LSByte *b, size_t len);
+static void flip_case_avx2(LSByte *bytes, size_t len, LSByte first);
+#endif
+
+bool ls_sspan_equals_icase(LSStringSpan a, LSStringSpan b)
+{
+	return ls_sspan_is_valid(a)
+			&& ls_sspan_is_valid(b)
+			&& a.len == b.len
+			&& equals_icase(a.bytes, b.bytes, a.len);
+}
+
+uint64_t ls_sspan_hash_icase(LSStringSpan sspan)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return 0;
+	}
+
+	const LSByte *bytes = sspan.bytes;
+	size_t len = sspan.len;
+
+	/*
+	 * A multiply-rotate hash over case-folded words. It only has to be
+	 * consistent with `ls_sspan_equals_icase()`, so no SIMD variant is needed.
+	 * Words are loaded little-endian so the hash is the same on every CPU.
+	 */
+	const uint64_t K = UINT64_C(0x9e3779b97f4a7c15);
+	uint64_t hash = (uint64_t)len * K;
+
+	size_t i = 0;
+	for (; len - i >= 8; i += 8) {
+		uint64_t word = swar_to_lower(ls_simd_load_u64_le(&bytes[i]));
+		hash = (((hash << 5) | (hash >> 59)) ^ word) * K;
+	}
+
+	if (i < len) {
+		LSByte tail[8] = { 0 };
+		memcpy(tail, &bytes[i], len - i);
+
+		uint64_t word = swar_to_lower(ls_simd_load_u64_le(tail));
+		hash = (((hash << 5) | (hash >> 59)) ^ word) * K;
+	}
+
+	return mix_u64(hash);
+}
+
+LSStatus ls_bbuf_to_lower(LSByteBuffer *bbuf)
+{
+	if (!ls_bbuf_is_valid(*bbuf)) {
+		return LS_FAILURE;
+	}
+
+	flip_case(bbuf->bytes, bbuf->len, 'A');
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_bbuf_to_upper(LSByteBuffer *bbuf)
+{
+	if (!ls_bbuf_is_valid(*bbuf)) {
+		return LS_FAILURE;
+	}
+
+	flip_case(bbuf->bytes, bbuf->len, 'a');
+
+	return LS_SUCCESS;
+}
+
+EqualsIcaseFn resolve_equals_icase(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return equals_icase_avx2;
+	}
+#endif
+
+	return equals_icase_scalar;
+}
+
+FlipCaseFn resolve_flip_case(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return flip_case_avx2;
+	}
+#endif
+
+	return flip_case_scalar;
+}
+
+bool equals_icase_scalar(const LSByte *a, const LSByte *b, size_t len)
+{
+	size_t i = 0;
+	for (; len - i >= 8; i += 8) {
+		uint64_t word_a = ls_simd_load_u64(&a[i]);
+		uint64_t word_b = ls_simd_load_u64(&b[i]);
+
+		if (word_a != word_b
+				&& swar_to_lower(word_a) != swar_to_lower(word_b)) {
+			return false;
+		}
+	}
+
+	for (; i < len; ++i) {
+		if (to_lower(a[i]) != to_lower(b[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Toggles the case bit (0x20) of every byte in `first`..`first + 25`, i.e.
+ * lowercases for `first == 'A'` and uppercases for `first == 'a'`.
+ */
+void flip_case_scalar(LSByte *bytes, size_t len, LSByte first)
+{
+	size_t i = 0;
+	for (; len - i >= 8; i += 8) {
+		uint64_t word = ls_simd_load_u64(&bytes[i]);
+		store_u64(&bytes[i], word ^ (swar_in_range(word, first) >> 2));
+	}
+
+	for (; i < len; ++i) {
+		if ((LSByte)(bytes[i] - first) < 26) {
+			bytes[i] ^= 0x20;
+		}
+	}
+}
+
+/*
+ * Returns a word with the high bit of each byte set iff that byte of `word`
+ * lies in `first`..`first + 25`. `first` must be ASCII.
+ *
+ * Adding to the low seven bits of each byte can not carry into the next byte,
+ * so every byte is compared independently.
+ */
+uint64_t swar_in_range(uint64_t word, LSByte first)
+{
+	const uint64_t ONES = UINT64_C(0x0101010101010101);
+	const uint64_t HIGH_BITS = UINT64_C(0x8080808080808080);
+
+	uint64_t heptets = word & ~HIGH_BITS;
+	uint64_t is_ge_first = heptets + ONES * (0x80 - first);
+	uint64_t is_gt_last = heptets + ONES * (0x80 - (first + 26));
+
+	return is_ge_first & ~is_gt_last & ~word & HIGH_BITS;
+}
+
+uint64_t swar_to_lower(uint64_t word)
+{
+	return word ^ (swar_in_range(word, 'A') >> 2);
+}
+
+LSByte to_lower(LSByte byte)
+{
+	return (LSByte)(byte - 'A') < 26 ? byte ^ 0x20 : byte;
+}
+
+void store_u64(LSByte *bytes, uint64_t word)
+{
+	memcpy(bytes, &word, sizeof(word));
+}
+
+// The finalizer of MurmurHash3.
+uint64_t mix_u64(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= UINT64_C(0xff51afd7ed558ccd);
+	x ^= x >> 33;
+	x *= UINT64_C(0xc4ceb9fe1a85ec53);
+	x ^= x >> 33;
+
+	return x;
+}
+
+#ifdef LS_SIMD_X86
+
+/*
+ * Returns `0x20` in each byte of `v` that lies in `first`..`first + 25` and `0`
+ * elsewhere. Biasing by `0x80 - first` moves the range to the bottom of the
+ * signed byte range, where a single signed compare picks it out.
+ */
+LS_TARGET_AVX2
+static inline __m256i avx2_case_bits(__m256i v, LSByte first)
+{
+	__m256i bias = _mm256_set1_epi8((char)(0x80 - first));
+	__m256i biased = _mm256_add_epi8(v, bias);
+	__m256i in_range = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26),
+			biased);
+
+	return _mm256_and_si256(in_range, _mm256_set1_epi8(0x20));
+}
+
+LS_TARGET_AVX2
+static inline __m256i avx2_to_lower(__m256i v)
+{
+	return _mm256_xor_si256(v, avx2_case_bits(v, 'A'));
+}
+
+LS_TARGET_AVX2
+bool equals_icase_avx2(const LSByte *a, const LSByte *b, size_t len)
+{
+	size_t i = 0;
+	for (; len - i >= 32; i += 32) {
+		__m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+		__m256i vb = _mm256_loadu_si256((const __m256i *)&b[i]);
+		__m256i eq = _mm256_cmpeq_epi8(avx2_to_lower(va),
+				avx2_to_lower(vb));
+
+		if ((uint32_t)_mm256_movemask_epi8(eq) != UINT32_MAX) {
+			return false;
+		}
+	}
+
+	return equals_icase_scalar(&a[i], &b[i], len - i);
+}
+
+LS_TARGET_AVX2
+void flip_case_avx2(LSByte *bytes, size_t len, LSByte first)
+{
+	size_t i = 0;
+	for (; len - i >= 32; i += 32) {
+		__m256i *block = (__m256i *)&bytes[i];
+		__m256i v = _mm256_loadu_si256(block);
+		_mm256_storeu_si256(block,
+				_mm256_xor_si256(v, avx2_case_bits(v, first)));
+	}
+
+	flip_case_scalar(&bytes[i], len - i, first);
+}
+
+#endif // LS_SIMD_X86
@@ -0,0 +1,362 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tyrant/tyrant.h>
+
+#include "loser-simd.h"
+
+/*
+ * The input is classified one block (one bitmap word) at a time, and fields are
+ * found by walking the set bits of the block, so scanning costs next to
+ * nothing per byte of a field, and only a few instructions per field.
+ */
+enum {
+	BLOCK_LEN = 64,
+	INIT_FIELDS_CAP = 16
+};
+
+typedef uint64_t (*ClassifyFn)(const LSByte *bytes, size_t len,
+		LSByte delimiter);
+
+static ClassifyFn resolve_classify(void);
+
+LS_DISPATCH(uint64_t, classify,
+		(const LSByte *bytes, size_t len, LSByte delimiter),
+		(bytes, len, delimiter), resolve_classify)
+
+static size_t next_structural(LSCsvReader *reader, size_t from);
+static size_t find_field_end(LSCsvReader *reader, size_t from);
+static bool find_closing_quote(LSCsvReader *reader, size_t from, size_t *close,
+		bool *doubled);
+static LSStatus unescape_quotes(LSByteBuffer *scratch, LSStringSpan quoted);
+static LSStatus push_field(LSCsvReader *reader, size_t idx,
+		LSStringSpan field);
+static uint64_t classify_scalar(const LSByte *bytes, size_t len,
+		LSByte delimiter);
+
+#ifdef LS_SIMD_X86
+static uint64_t classify_avx2(const LSByte *bytes, size_t len,
+		LSByte delimiter);
+#endif
+
+LSCsvReader ls_csv_reader_create(LSStringSpan input, LSByte delimiter)
+{
+	if (!ls_sspan_is_valid(input)
+			|| delimiter == '"'
+			|| delimiter == '\n'
+			|| delimiter == '\r') {
+		return LS_AN_INVALID_CSV_READER;
+	}
+
+	LSStringSpan *fields = tyrant_alloc(INIT_FIELDS_CAP * sizeof(*fields));
+	if (!fields) {
+		return LS_AN_INVALID_CSV_READER;
+	}
+
+	LSByteBuffer scratch = ls_bbuf_create();
+	if (!ls_bbuf_is_valid(scratch)) {
+		tyrant_free(fields);
+		return LS_AN_INVALID_CSV_READER;
+	}
+
+	return (LSCsvReader){
+		._input = input,
+		._pos = 0,
+		._delimiter = delimiter,
+		._mask_pos = SIZE_MAX,
+		._mask = 0,
+		._fields_cap = INIT_FIELDS_CAP,
+		._fields = fields,
+		._scratch = scratch
+	};
+}
+
+void ls_csv_reader_destroy(LSCsvReader *reader)
+{
+	tyrant_free(reader->_fields);
+	ls_bbuf_destroy(&reader->_scratch);
+}
+
+LSStatus ls_csv_reader_next(LSCsvReader *reader, const LSStringSpan **fields,
+		size_t *nfields)
+{
+	if (!ls_csv_reader_is_valid(*reader)) {
+		return LS_FAILURE;
+	}
+
+	const LSByte *bytes = reader->_input.bytes;
+	size_t len = reader->_input.len;
+	LSByte delimiter = reader->_delimiter;
+
+	size_t pos = reader->_pos;
+	if (pos == len) {
+		*fields = reader->_fields;
+		*nfields = 0;
+		return LS_SUCCESS;
+	}
+
+	reader->_scratch.len = 0;
+
+	size_t count = 0;
+	for (;;) {
+		LSStringSpan field;
+		size_t end;
+
+		if (pos < len && bytes[pos] == '"') {
+			size_t close;
+			bool doubled;
+			if (!find_closing_quote(reader, pos + 1, &close, &doubled)) {
+				return LS_FAILURE;
+			}
+
+			field = ls_sspan_create(&bytes[pos + 1], close - pos - 1);
+			if (doubled) {
+				size_t old_len = reader->_scratch.len;
+				if (unescape_quotes(&reader->_scratch, field)
+						!= LS_SUCCESS) {
+					return LS_FAILURE;
+				}
+
+				// pointed into the scratch buffer once it stops moving
+				field = (LSStringSpan){
+					.len = reader->_scratch.len - old_len,
+					.bytes = NULL
+				};
+			}
+
+			end = close + 1;
+			if (len - end >= 2 && bytes[end] == '\r'
+					&& bytes[end + 1] == '\n') {
+				++end;
+			}
+
+			if (end < len && bytes[end] != delimiter && bytes[end] != '\n') {
+				return LS_FAILURE;
+			}
+		} else {
+			end = find_field_end(reader, pos);
+
+			size_t field_len = end - pos;
+			if (end < len && bytes[end] == '\n'
+					&& field_len > 0 && bytes[end - 1] == '\r') {
+				--field_len;
+			}
+
+			field = ls_sspan_create(&bytes[pos], field_len);
+		}
+
+		if (push_field(reader, count, field) != LS_SUCCESS) {
+			return LS_FAILURE;
+		}
+		++count;
+
+		if (end == len) {
+			pos = len;
+			break;
+		}
+
+		pos = end + 1;
+		if (bytes[end] == '\n') {
+			break;
+		}
+	}
+
+	size_t offset = 0;
+	for (size_t i = 0; i < count; ++i) {
+		LSStringSpan *field = &reader->_fields[i];
+		if (!field->bytes) {
+			field->bytes = &reader->_scratch.bytes[offset];
+			offset += field->len;
+		}
+	}
+
+	reader->_pos = pos;
+	*fields = reader->_fields;
+	*nfields = count;
+
+	return LS_SUCCESS;
+}
+
+ClassifyFn resolve_classify(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return classify_avx2;
+	}
+#endif
+
+	return classify_scalar;
+}
+
+/*
+ * Returns the index of the first delimiter, `'\n'` or `'"'` at or after `from`,
+ * or the length of the input if there is none.
+ */
+size_t next_structural(LSCsvReader *reader, size_t from)
+{
+	size_t len = reader->_input.len;
+
+	while (from < len) {
+		if (from < reader->_mask_pos
+				|| from - reader->_mask_pos >= BLOCK_LEN) {
+			reader->_mask_pos = from;
+			reader->_mask = classify(&reader->_input.bytes[from],
+					len - from, reader->_delimiter);
+		}
+
+		size_t skip = from - reader->_mask_pos;
+		uint64_t mask = reader->_mask >> skip << skip;
+		if (mask != 0) {
+			return reader->_mask_pos + ls_simd_lowest_bit_idx(mask);
+		}
+
+		from = reader->_mask_pos + BLOCK_LEN;
+	}
+
+	return len;
+}
+
+// Returns the index of the delimiter or `'\n'` ending an unquoted field.
+size_t find_field_end(LSCsvReader *reader, size_t from)
+{
+	const LSByte *bytes = reader->_input.bytes;
+	size_t len = reader->_input.len;
+
+	size_t idx = next_structural(reader, from);
+	while (idx < len && bytes[idx] == '"') {
+		idx = next_structural(reader, idx + 1);
+	}
+
+	return idx;
+}
+
+/*
+ * Finds the `'"'` closing a quoted field whose contents start at `from`, and
+ * whether they contain any doubled quotes. Returns `false` if the field is not
+ * closed.
+ */
+bool find_closing_quote(LSCsvReader *reader, size_t from, size_t *close,
+		bool *doubled)
+{
+	const LSByte *bytes = reader->_input.bytes;
+	size_t len = reader->_input.len;
+
+	*doubled = false;
+	for (;;) {
+		size_t idx = next_structural(reader, from);
+		if (idx == len) {
+			return false;
+		}
+
+		if (bytes[idx] != '"') {
+			from = idx + 1;
+		} else if (len - idx >= 2 && bytes[idx + 1] == '"') {
+			*doubled = true;
+			from = idx + 2;
+		} else {
+			*close = idx;
+			return true;
+		}
+	}
+}
+
+// Appends `quoted` to `scratch` with every `""` in it turned into `"`.
+LSStatus unescape_quotes(LSByteBuffer *scratch, LSStringSpan quoted)
+{
+	if (ls_bbuf_reserve(scratch, quoted.len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	size_t pos = 0;
+	while (pos < quoted.len) {
+		const LSByte *quote = memchr(&quoted.bytes[pos], '"',
+				quoted.len - pos);
+		size_t run = quote
+				? (size_t)(quote - &quoted.bytes[pos]) + 1
+				: quoted.len - pos;
+
+		memcpy(&scratch->bytes[scratch->len], &quoted.bytes[pos], run);
+		scratch->len += run;
+
+		// skip the second quote of the pair
+		pos += quote ? run + 1 : run;
+	}
+
+	return LS_SUCCESS;
+}
+
+LSStatus push_field(LSCsvReader *reader, size_t idx, LSStringSpan field)
+{
+	if (idx == reader->_fields_cap) {
+		if (reader->_fields_cap > SIZE_MAX / 2 / sizeof(LSStringSpan)) {
+			return LS_FAILURE;
+		}
+
+		size_t new_cap = reader->_fields_cap * 2;
+
+		bool success;
+		reader->_fields = tyrant_realloc(reader->_fields,
+				new_cap * sizeof(LSStringSpan), &success);
+		if (!success) {
+			return LS_FAILURE;
+		}
+
+		reader->_fields_cap = new_cap;
+	}
+
+	reader->_fields[idx] = field;
+
+	return LS_SUCCESS;
+}
+
+/*
+ * Returns a mask of the delimiters, `'\n'`s and `'"'`s among the first
+ * `BLOCK_LEN` (or fewer, if `len` is less) bytes.
+ */
+uint64_t classify_scalar(const LSByte *bytes, size_t len, LSByte delimiter)
+{
+	size_t n = len < BLOCK_LEN ? len : BLOCK_LEN;
+
+	uint64_t mask = 0;
+	for (size_t i = 0; i < n; ++i) {
+		LSByte byte = bytes[i];
+		if (byte == delimiter || byte == '\n' || byte == '"') {
+			mask |= (uint64_t)1 << i;
+		}
+	}
+
+	return mask;
+}
+
+#ifdef LS_SIMD_X86
+
+LS_TARGET_AVX2
+uint64_t classify_avx2(const LSByte *bytes, size_t len, LSByte delimiter)
+{
+	if (len < BLOCK_LEN) {
+		return classify_scalar(bytes, len, delimiter);
+	}
+
+	const __m256i DELIMITER = _mm256_set1_epi8((char)delimiter);
+	const __m256i NEWLINE = _mm256_set1_epi8('\n');
+	const __m256i QUOTE = _mm256_set1_epi8('"');
+
+	uint64_t mask = 0;
+	for (size_t i = 0; i < BLOCK_LEN; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+		__m256i structural = _mm256_or_si256(
+				_mm256_cmpeq_epi8(v, DELIMITER),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, NEWLINE),
+						_mm256_cmpeq_epi8(v, QUOTE)));
+
+		mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structural) << i;
+	}
+
+	return mask;
+}
+
+#endif // LS_SIMD_X86
@@ -0,0 +1,602 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "loser-escape.h"
+#include "loser-simd.h"
+
+typedef void (*EncodeBase64Fn)(LSByte *dest, const LSByte *src,
+		size_t ngroups, bool url);
+typedef bool (*DecodeBase64Fn)(LSByte *dest, const LSByte *src, size_t nquads,
+		bool url);
+typedef void (*EncodeHexFn)(LSByte *dest, const LSByte *src, size_t len);
+typedef bool (*DecodeHexFn)(LSByte *dest, const LSByte *src, size_t len);
+
+static EncodeBase64Fn resolve_encode_base64(void);
+static DecodeBase64Fn resolve_decode_base64(void);
+static EncodeHexFn resolve_encode_hex(void);
+static DecodeHexFn resolve_decode_hex(void);
+
+LS_DISPATCH_VOID(encode_base64,
+		(LSByte *dest, const LSByte *src, size_t ngroups, bool url),
+		(dest, src, ngroups, url), resolve_encode_base64)
+LS_DISPATCH(bool, decode_base64,
+		(LSByte *dest, const LSByte *src, size_t nquads, bool url),
+		(dest, src, nquads, url), resolve_decode_base64)
+LS_DISPATCH_VOID(encode_hex, (LSByte *dest, const LSByte *src, size_t len),
+		(dest, src, len), resolve_encode_hex)
+LS_DISPATCH(bool, decode_hex, (LSByte *dest, const LSByte *src, size_t len),
+		(dest, src, len), resolve_decode_hex)
+
+static void encode_base64_scalar(LSByte *dest, const LSByte *src,
+		size_t ngroups, bool url);
+static bool decode_base64_scalar(LSByte *dest, const LSByte *src,
+		size_t nquads, bool url);
+static void encode_hex_scalar(LSByte *dest, const LSByte *src, size_t len);
+static bool decode_hex_scalar(LSByte *dest, const LSByte *src, size_t len);
+
+#ifdef LS_SIMD_X86
+static void encode_base64_avx2(LSByte *dest, const LSByte *src,
+		size_t ngroups, bool url);
+static bool decode_base64_avx2(LSByte *dest, const LSByte *src, size_t nquads,
+		bool url);
+static void encode_hex_avx2(LSByte *dest, const LSByte *src, size_t len);
+static bool decode_hex_avx2(LSByte *dest, const LSByte *src, size_t len);
+#endif
+
+static const char BASE64_ALPHABET[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char BASE64_URL_ALPHABET[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+// values of the characters of each alphabet, `0xff` for all other bytes
+static const LSByte BASE64_VALUES[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+	0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+	0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24,
+	0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+	0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff,
+};
+
+static const LSByte BASE64_URL_VALUES[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+	0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+	0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+	0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24,
+	0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+	0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff,
+};
+
+LSStatus ls_bbuf_append_base64(LSByteBuffer *bbuf, LSStringSpan sspan,
+		LSBase64Flags flags)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(sspan)) {
+		return LS_FAILURE;
+	}
+
+	bool url = flags & LS_BASE64_URL;
+	bool pad = !(flags & LS_BASE64_NO_PADDING);
+
+	size_t ngroups = sspan.len / 3;
+	size_t rem = sspan.len % 3;
+	size_t tail_len = rem == 0 ? 0 : pad ? 4 : rem + 1;
+	if (ngroups > (SIZE_MAX - tail_len) / 4) {
+		return LS_FAILURE;
+	}
+
+	size_t len = ngroups * 4 + tail_len;
+	if (ls_bbuf_reserve(bbuf, len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	encode_base64(dest, sspan.bytes, ngroups, url);
+
+	if (rem != 0) {
+		const char *alphabet = url ? BASE64_URL_ALPHABET : BASE64_ALPHABET;
+		const LSByte *src = &sspan.bytes[ngroups * 3];
+		LSByte *tail = &dest[ngroups * 4];
+
+		uint32_t bits = (uint32_t)src[0] << 16
+				| (rem == 2 ? (uint32_t)src[1] << 8 : 0);
+		tail[0] = (LSByte)alphabet[bits >> 18];
+		tail[1] = (LSByte)alphabet[(bits >> 12) & 0x3f];
+		if (rem == 2) {
+			tail[2] = (LSByte)alphabet[(bits >> 6) & 0x3f];
+		}
+
+		if (pad) {
+			tail[2] = rem == 2 ? tail[2] : '=';
+			tail[3] = '=';
+		}
+	}
+
+	bbuf->len += len;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_sspan_decode_base64(LSStringSpan sspan, LSBase64Flags flags,
+		LSByteBuffer *bbuf)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(sspan)) {
+		return LS_FAILURE;
+	}
+
+	bool url = flags & LS_BASE64_URL;
+	const LSByte *src = sspan.bytes;
+	size_t len = sspan.len;
+
+	if (!(flags & LS_BASE64_NO_PADDING)) {
+		if (len % 4 != 0) {
+			return LS_FAILURE;
+		}
+
+		for (size_t i = 0; i < 2 && len > 0 && src[len - 1] == '='; ++i) {
+			--len;
+		}
+	}
+
+	size_t nquads = len / 4;
+	size_t rem = len % 4;
+	if (rem == 1) {
+		return LS_FAILURE;
+	}
+
+	size_t decoded_len = nquads * 3 + (rem == 0 ? 0 : rem - 1);
+	if (ls_bbuf_reserve(bbuf, decoded_len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	if (!decode_base64(dest, src, nquads, url)) {
+		return LS_FAILURE;
+	}
+
+	if (rem != 0) {
+		const LSByte *values = url ? BASE64_URL_VALUES : BASE64_VALUES;
+		const LSByte *tail = &src[nquads * 4];
+
+		uint32_t a = values[tail[0]];
+		uint32_t b = values[tail[1]];
+		uint32_t c = rem == 3 ? values[tail[2]] : 0;
+
+		// the bits past the last whole byte must be zero
+		uint32_t unused = rem == 2 ? b & 0x0f : c & 0x03;
+		if (((a | b | c) & 0x80) || unused != 0) {
+			return LS_FAILURE;
+		}
+
+		uint32_t bits = a << 18 | b << 12 | c << 6;
+		dest[nquads * 3] = (LSByte)(bits >> 16);
+		if (rem == 3) {
+			dest[nquads * 3 + 1] = (LSByte)(bits >> 8);
+		}
+	}
+
+	bbuf->len += decoded_len;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_bbuf_append_hex_encoded(LSByteBuffer *bbuf, LSStringSpan sspan)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(sspan)
+			|| sspan.len > SIZE_MAX / 2) {
+		return LS_FAILURE;
+	}
+
+	if (ls_bbuf_reserve(bbuf, sspan.len * 2) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	encode_hex(&bbuf->bytes[bbuf->len], sspan.bytes, sspan.len);
+	bbuf->len += sspan.len * 2;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_sspan_decode_hex(LSStringSpan sspan, LSByteBuffer *bbuf)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(sspan)
+			|| sspan.len % 2 != 0) {
+		return LS_FAILURE;
+	}
+
+	size_t len = sspan.len / 2;
+	if (ls_bbuf_reserve(bbuf, len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	if (!decode_hex(&bbuf->bytes[bbuf->len], sspan.bytes, len)) {
+		return LS_FAILURE;
+	}
+
+	bbuf->len += len;
+
+	return LS_SUCCESS;
+}
+
+EncodeBase64Fn resolve_encode_base64(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return encode_base64_avx2;
+	}
+#endif
+
+	return encode_base64_scalar;
+}
+
+DecodeBase64Fn resolve_decode_base64(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return decode_base64_avx2;
+	}
+#endif
+
+	return decode_base64_scalar;
+}
+
+EncodeHexFn resolve_encode_hex(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return encode_hex_avx2;
+	}
+#endif
+
+	return encode_hex_scalar;
+}
+
+DecodeHexFn resolve_decode_hex(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return decode_hex_avx2;
+	}
+#endif
+
+	return decode_hex_scalar;
+}
+
+// Encodes `ngroups` groups of 3 bytes as 4 characters each.
+void encode_base64_scalar(LSByte *dest, const LSByte *src, size_t ngroups,
+		bool url)
+{
+	const char *alphabet = url ? BASE64_URL_ALPHABET : BASE64_ALPHABET;
+
+	for (size_t i = 0; i < ngroups; ++i) {
+		uint32_t bits = (uint32_t)src[0] << 16
+				| (uint32_t)src[1] << 8
+				| (uint32_t)src[2];
+		dest[0] = (LSByte)alphabet[bits >> 18];
+		dest[1] = (LSByte)alphabet[(bits >> 12) & 0x3f];
+		dest[2] = (LSByte)alphabet[(bits >> 6) & 0x3f];
+		dest[3] = (LSByte)alphabet[bits & 0x3f];
+
+		src += 3;
+		dest += 4;
+	}
+}
+
+/*
+ * Decodes `nquads` groups of 4 characters into 3 bytes each. Returns `false` if
+ * any character is outside the alphabet, in which case `dest` holds garbage.
+ */
+bool decode_base64_scalar(LSByte *dest, const LSByte *src, size_t nquads,
+		bool url)
+{
+	const LSByte *values = url ? BASE64_URL_VALUES : BASE64_VALUES;
+
+	// the values of invalid characters are the only ones with the high bit set
+	uint32_t any_invalid = 0;
+	for (size_t i = 0; i < nquads; ++i) {
+		uint32_t a = values[src[0]];
+		uint32_t b = values[src[1]];
+		uint32_t c = values[src[2]];
+		uint32_t d = values[src[3]];
+		any_invalid |= a | b | c | d;
+
+		uint32_t bits = a << 18 | b << 12 | c << 6 | d;
+		dest[0] = (LSByte)(bits >> 16);
+		dest[1] = (LSByte)(bits >> 8);
+		dest[2] = (LSByte)bits;
+
+		src += 4;
+		dest += 3;
+	}
+
+	return !(any_invalid & 0x80);
+}
+
+void encode_hex_scalar(LSByte *dest, const LSByte *src, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		dest[2 * i] = (LSByte)HEX_DIGITS[src[i] >> 4];
+		dest[2 * i + 1] = (LSByte)HEX_DIGITS[src[i] & 0x0f];
+	}
+}
+
+// Decodes `len` bytes from `2 * len` digits, like `decode_base64_scalar()`.
+bool decode_hex_scalar(LSByte *dest, const LSByte *src, size_t len)
+{
+	uint32_t any_invalid = 0;
+	for (size_t i = 0; i < len; ++i) {
+		uint32_t high = ls_escape_hex_value(src[2 * i]);
+		uint32_t low = ls_escape_hex_value(src[2 * i + 1]);
+		any_invalid |= high | low;
+
+		dest[i] = (LSByte)(high << 4 | low);
+	}
+
+	return !(any_invalid & 0x80);
+}
+
+#ifdef LS_SIMD_X86
+
+/*
+ * The base64 kernels follow Muła and Lemire, "Faster Base64 Encoding and
+ * Decoding Using AVX2 Instructions" (2018). Each lane turns 12 bytes into 16
+ * characters, or back.
+ */
+LS_TARGET_AVX2
+void encode_base64_avx2(LSByte *dest, const LSByte *src, size_t ngroups,
+		bool url)
+{
+	// each 32-bit word gets bytes `1, 0, 2, 1` of its group of 3
+	const __m256i SPREAD = _mm256_setr_epi8(
+			1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+			1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	// what to add to a 6-bit value to get its character, by range
+	const char PLUS = url ? '-' - 62 : '+' - 62;
+	const char SLASH = url ? '_' - 63 : '/' - 63;
+	const __m256i OFFSETS = _mm256_setr_epi8(
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, PLUS,
+			SLASH, 'A', 0, 0,
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, PLUS,
+			SLASH, 'A', 0, 0);
+
+	size_t len = ngroups * 3;
+	size_t i = 0;
+	// 28 bytes are loaded for the 24 encoded
+	for (; len - i >= 28; i += 24) {
+		__m128i low = _mm_loadu_si128((const __m128i *)&src[i]);
+		__m128i high = _mm_loadu_si128((const __m128i *)&src[i + 12]);
+		__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(low),
+				high, 1);
+		in = _mm256_shuffle_epi8(in, SPREAD);
+
+		// move the 4 6-bit fields of each word into a byte of their own
+		__m256i ac = _mm256_mulhi_epu16(
+				_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+				_mm256_set1_epi32(0x04000040));
+		__m256i bd = _mm256_mullo_epi16(
+				_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+				_mm256_set1_epi32(0x01000010));
+		__m256i values = _mm256_or_si256(ac, bd);
+
+		// 0..25 map to 13, 26..51 to 0 and 52..63 to 1..12
+		__m256i ranges = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+		__m256i is_upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+		ranges = _mm256_or_si256(ranges,
+				_mm256_and_si256(is_upper, _mm256_set1_epi8(13)));
+
+		__m256i chars = _mm256_add_epi8(values,
+				_mm256_shuffle_epi8(OFFSETS, ranges));
+		_mm256_storeu_si256((__m256i *)&dest[i / 3 * 4], chars);
+	}
+
+	encode_base64_scalar(&dest[i / 3 * 4], &src[i], ngroups - i / 3, url);
+}
+
+LS_TARGET_AVX2
+bool decode_base64_avx2(LSByte *dest, const LSByte *src, size_t nquads,
+		bool url)
+{
+	// a character is valid iff its classes by low and high nibble are disjoint
+	const __m256i LUT_LOW = _mm256_setr_epi8(
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m256i LUT_HIGH = _mm256_setr_epi8(
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	// what to add to a character to get its value, by high nibble
+	const __m256i LUT_ROLL = _mm256_setr_epi8(
+			0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i SLASH = _mm256_set1_epi8(0x2f);
+	const __m256i PACK = _mm256_setr_epi8(
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+	/*
+	 * 32 bytes are stored for the 24 decoded, so at least 8 more must
+	 * follow, i.e. 3 more groups.
+	 */
+	size_t q = 0;
+	for (; nquads - q >= 11; q += 8) {
+		__m256i in = _mm256_loadu_si256((const __m256i *)&src[q * 4]);
+
+		// map `-` and `_` to `+` and `/` after rejecting those
+		if (url) {
+			__m256i is_standard = _mm256_or_si256(
+					_mm256_cmpeq_epi8(in, _mm256_set1_epi8('+')),
+					_mm256_cmpeq_epi8(in, SLASH));
+			if (!_mm256_testz_si256(is_standard, is_standard)) {
+				return false;
+			}
+
+			__m256i shift = _mm256_or_si256(
+					_mm256_and_si256(
+							_mm256_cmpeq_epi8(in, _mm256_set1_epi8('-')),
+							_mm256_set1_epi8('+' - '-')),
+					_mm256_and_si256(
+							_mm256_cmpeq_epi8(in, _mm256_set1_epi8('_')),
+							_mm256_set1_epi8('/' - '_')));
+			in = _mm256_add_epi8(in, shift);
+		}
+
+		__m256i high_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4),
+				SLASH);
+		__m256i low_nibbles = _mm256_and_si256(in, SLASH);
+		__m256i high_classes = _mm256_shuffle_epi8(LUT_HIGH, high_nibbles);
+		__m256i low_classes = _mm256_shuffle_epi8(LUT_LOW, low_nibbles);
+		if (!_mm256_testz_si256(low_classes, high_classes)) {
+			return false;
+		}
+
+		// `/` shares its high nibble with `+`, so it is told apart first
+		__m256i is_slash = _mm256_cmpeq_epi8(in, SLASH);
+		__m256i roll = _mm256_shuffle_epi8(LUT_ROLL,
+				_mm256_add_epi8(is_slash, high_nibbles));
+		__m256i values = _mm256_add_epi8(in, roll);
+
+		// pack the 4 6-bit values of each word into 3 bytes
+		__m256i pairs = _mm256_maddubs_epi16(values,
+				_mm256_set1_epi32(0x01400140));
+		__m256i words = _mm256_madd_epi16(pairs,
+				_mm256_set1_epi32(0x00011000));
+		__m256i packed = _mm256_shuffle_epi8(words, PACK);
+		packed = _mm256_permutevar8x32_epi32(packed,
+				_mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+		_mm256_storeu_si256((__m256i *)&dest[q * 3], packed);
+	}
+
+	return decode_base64_scalar(&dest[q * 3], &src[q * 4], nquads - q, url);
+}
+
+LS_TARGET_AVX2
+void encode_hex_avx2(LSByte *dest, const LSByte *src, size_t len)
+{
+	const __m256i DIGITS = _mm256_setr_epi8(
+			'0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+			'0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+	const __m256i LOW_NIBBLES = _mm256_set1_epi8(0x0f);
+
+	size_t i = 0;
+	for (; len - i >= 32; i += 32) {
+		__m256i in = _mm256_loadu_si256((const __m256i *)&src[i]);
+		__m256i high = _mm256_shuffle_epi8(DIGITS, _mm256_and_si256(
+				_mm256_srli_epi16(in, 4), LOW_NIBBLES));
+		__m256i low = _mm256_shuffle_epi8(DIGITS,
+				_mm256_and_si256(in, LOW_NIBBLES));
+
+		// interleaving works within lanes: bytes 0..7 and 16..23, then the rest
+		__m256i first = _mm256_unpacklo_epi8(high, low);
+		__m256i second = _mm256_unpackhi_epi8(high, low);
+		_mm256_storeu_si256((__m256i *)&dest[2 * i],
+				_mm256_permute2x128_si256(first, second, 0x20));
+		_mm256_storeu_si256((__m256i *)&dest[2 * i + 32],
+				_mm256_permute2x128_si256(first, second, 0x31));
+	}
+
+	encode_hex_scalar(&dest[2 * i], &src[i], len - i);
+}
+
+/*
+ * Returns the values of the hexadecimal digits in `in`, and sets the bytes of
+ * `*valid` to `0xff` where `in` has a digit and to `0` elsewhere.
+ */
+LS_TARGET_AVX2
+static inline __m256i avx2_hex_values(__m256i in, __m256i *valid)
+{
+	__m256i digit = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+	__m256i is_digit = _mm256_cmpeq_epi8(
+			_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+
+	__m256i letter = _mm256_sub_epi8(
+			_mm256_or_si256(in, _mm256_set1_epi8(0x20)),
+			_mm256_set1_epi8('a'));
+	__m256i is_letter = _mm256_cmpeq_epi8(
+			_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+
+	*valid = _mm256_or_si256(is_digit, is_letter);
+
+	return _mm256_blendv_epi8(
+			_mm256_add_epi8(letter, _mm256_set1_epi8(10)), digit,
+			is_digit);
+}
+
+LS_TARGET_AVX2
+bool decode_hex_avx2(LSByte *dest, const LSByte *src, size_t len)
+{
+	// high digit times 16 plus low digit
+	const __m256i WEIGHTS = _mm256_set1_epi16(0x0110);
+
+	size_t i = 0;
+	for (; len - i >= 32; i += 32) {
+		__m256i valid_a;
+		__m256i valid_b;
+		__m256i a = avx2_hex_values(_mm256_loadu_si256(
+				(const __m256i *)&src[2 * i]), &valid_a);
+		__m256i b = avx2_hex_values(_mm256_loadu_si256(
+				(const __m256i *)&src[2 * i + 32]), &valid_b);
+
+		__m256i valid = _mm256_and_si256(valid_a, valid_b);
+		if ((uint32_t)_mm256_movemask_epi8(valid) != UINT32_MAX) {
+			return false;
+		}
+
+		// packing works within lanes, so the middle quarters are swapped
+		__m256i packed = _mm256_packus_epi16(
+				_mm256_maddubs_epi16(a, WEIGHTS),
+				_mm256_maddubs_epi16(b, WEIGHTS));
+		_mm256_storeu_si256((__m256i *)&dest[i],
+				_mm256_permute4x64_epi64(packed, 0xd8));
+	}
+
+	return decode_hex_scalar(&dest[i], &src[2 * i], len - i);
+}
+
+#endif // LS_SIMD_X86
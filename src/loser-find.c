@@ -0,0 +1,281 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "loser-simd.h"
+
+/*
+ * Candidates are matched in batches of up to 64 (one bitmap word): first by
+ * length (and, for short needles, by their whole inline representation), then
+ * by their bytes. The bytes of every survivor of a batch are prefetched before
+ * any of them is compared, so that the cache misses overlap.
+ */
+enum { BATCH_LEN = 64 };
+
+typedef uint64_t (*SspanLenMaskFn)(const LSStringSpan *sspans, size_t n,
+		size_t len);
+typedef uint64_t (*SsoLenMaskFn)(const LSSSOString *ssos, size_t n, size_t len);
+typedef uint64_t (*SsoShortMaskFn)(const LSSSOString *ssos, size_t n,
+		const LSSSOString *needle);
+
+static SspanLenMaskFn resolve_sspan_len_mask(void);
+static SsoLenMaskFn resolve_sso_len_mask(void);
+static SsoShortMaskFn resolve_sso_short_mask(void);
+
+LS_DISPATCH(uint64_t, sspan_len_mask,
+		(const LSStringSpan *sspans, size_t n, size_t len),
+		(sspans, n, len), resolve_sspan_len_mask)
+LS_DISPATCH(uint64_t, sso_len_mask,
+		(const LSSSOString *ssos, size_t n, size_t len),
+		(ssos, n, len), resolve_sso_len_mask)
+LS_DISPATCH(uint64_t, sso_short_mask,
+		(const LSSSOString *ssos, size_t n, const LSSSOString *needle),
+		(ssos, n, needle), resolve_sso_short_mask)
+
+static uint64_t sspan_len_mask_scalar(const LSStringSpan *sspans, size_t n,
+		size_t len);
+static uint64_t sso_len_mask_scalar(const LSSSOString *ssos, size_t n,
+		size_t len);
+static uint64_t sso_short_mask_scalar(const LSSSOString *ssos, size_t n,
+		const LSSSOString *needle);
+static void prefetch(const void *ptr);
+
+#ifdef LS_SIMD_X86
+static uint64_t sspan_len_mask_avx2(const LSStringSpan *sspans, size_t n,
+		size_t len);
+static uint64_t sso_len_mask_avx2(const LSSSOString *ssos, size_t n,
+		size_t len);
+static uint64_t sso_short_mask_avx2(const LSSSOString *ssos, size_t n,
+		const LSSSOString *needle);
+#endif
+
+size_t ls_sso_find_equal(LSSSOString needle, const LSSSOString *ssos,
+		size_t nssos)
+{
+	const LSByte *needle_bytes = ls_sso_get_bytes(&needle);
+	if (!needle_bytes || !ssos) {
+		return SIZE_MAX;
+	}
+
+	bool is_short = needle.len <= LS_SHORT_STRING_MAX_LEN;
+
+	for (size_t base = 0; base < nssos; base += BATCH_LEN) {
+		const LSSSOString *batch = &ssos[base];
+		size_t batch_len = ls_simd_size_min(nssos - base, BATCH_LEN);
+
+		if (is_short) {
+			uint64_t mask = sso_short_mask(batch, batch_len, &needle);
+			if (mask != 0) {
+				return base + ls_simd_lowest_bit_idx(mask);
+			}
+
+			continue;
+		}
+
+		uint64_t mask = sso_len_mask(batch, batch_len, needle.len);
+		for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {
+			prefetch(batch[ls_simd_lowest_bit_idx(bits)]._long.bytes);
+		}
+
+		for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {
+			size_t i = ls_simd_lowest_bit_idx(bits);
+			const LSByte *bytes = batch[i]._long.bytes;
+
+			if (bytes && memcmp(bytes, needle_bytes, needle.len) == 0) {
+				return base + i;
+			}
+		}
+	}
+
+	return SIZE_MAX;
+}
+
+LSStatus ls_sspan_filter_equal(LSStringSpan needle, const LSStringSpan *sspans,
+		size_t nsspans, uint64_t *bitmap)
+{
+	if (!ls_sspan_is_valid(needle) || !sspans || !bitmap) {
+		return LS_FAILURE;
+	}
+
+	for (size_t base = 0; base < nsspans; base += BATCH_LEN) {
+		const LSStringSpan *batch = &sspans[base];
+		size_t batch_len = ls_simd_size_min(nsspans - base, BATCH_LEN);
+
+		uint64_t mask = sspan_len_mask(batch, batch_len, needle.len);
+		for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {
+			prefetch(batch[ls_simd_lowest_bit_idx(bits)].bytes);
+		}
+
+		for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {
+			size_t i = ls_simd_lowest_bit_idx(bits);
+			const LSByte *bytes = batch[i].bytes;
+
+			if (!bytes || memcmp(bytes, needle.bytes, needle.len) != 0) {
+				mask &= ~((uint64_t)1 << i);
+			}
+		}
+
+		bitmap[base / BATCH_LEN] = mask;
+	}
+
+	return LS_SUCCESS;
+}
+
+SspanLenMaskFn resolve_sspan_len_mask(void)
+{
+#ifdef LS_SIMD_X86
+	// the kernels assume the 64-bit layouts
+	if (ls_simd_has_avx2() && sizeof(LSStringSpan) == 16) {
+		return sspan_len_mask_avx2;
+	}
+#endif
+
+	return sspan_len_mask_scalar;
+}
+
+SsoLenMaskFn resolve_sso_len_mask(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2() && sizeof(LSSSOString) == 32) {
+		return sso_len_mask_avx2;
+	}
+#endif
+
+	return sso_len_mask_scalar;
+}
+
+SsoShortMaskFn resolve_sso_short_mask(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2() && sizeof(LSSSOString) == 32) {
+		return sso_short_mask_avx2;
+	}
+#endif
+
+	return sso_short_mask_scalar;
+}
+
+uint64_t sspan_len_mask_scalar(const LSStringSpan *sspans, size_t n,
+		size_t len)
+{
+	uint64_t mask = 0;
+	for (size_t i = 0; i < n; ++i) {
+		mask |= (uint64_t)(sspans[i].len == len) << i;
+	}
+
+	return mask;
+}
+
+uint64_t sso_len_mask_scalar(const LSSSOString *ssos, size_t n, size_t len)
+{
+	uint64_t mask = 0;
+	for (size_t i = 0; i < n; ++i) {
+		mask |= (uint64_t)(ssos[i].len == len) << i;
+	}
+
+	return mask;
+}
+
+/*
+ * The bytes past the end of a short string are always zero, so a short needle
+ * equals exactly those candidates with the same representation (which also
+ * rules out long and invalid candidates by their lengths).
+ */
+uint64_t sso_short_mask_scalar(const LSSSOString *ssos, size_t n,
+		const LSSSOString *needle)
+{
+	uint64_t mask = 0;
+	for (size_t i = 0; i < n; ++i) {
+		bool equal = ssos[i]._short.len == needle->_short.len
+				&& memcmp(ssos[i]._short._mut_bytes,
+						needle->_short._mut_bytes,
+						sizeof(needle->_short._mut_bytes))
+						== 0;
+		mask |= (uint64_t)equal << i;
+	}
+
+	return mask;
+}
+
+// Never faults, not even for `NULL`.
+void prefetch(const void *ptr)
+{
+#ifdef __GNUC__
+	__builtin_prefetch(ptr);
+#else
+	(void)ptr;
+#endif
+}
+
+#ifdef LS_SIMD_X86
+
+LS_TARGET_AVX2
+uint64_t sspan_len_mask_avx2(const LSStringSpan *sspans, size_t n, size_t len)
+{
+	__m256i needle_len = _mm256_set1_epi64x((long long)len);
+
+	uint64_t mask = 0;
+	size_t i = 0;
+	for (; n - i >= 4; i += 4) {
+		// { len, bytes } pairs: gather the four lengths into one vector
+		__m256i a = _mm256_loadu_si256((const __m256i *)&sspans[i]);
+		__m256i b = _mm256_loadu_si256((const __m256i *)&sspans[i + 2]);
+		__m256i lens = _mm256_permute4x64_epi64(
+				_mm256_unpacklo_epi64(a, b), 0xd8);
+
+		__m256i eq = _mm256_cmpeq_epi64(lens, needle_len);
+		mask |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(eq)) << i;
+	}
+
+	if (i < n) {
+		mask |= sspan_len_mask_scalar(&sspans[i], n - i, len) << i;
+	}
+
+	return mask;
+}
+
+LS_TARGET_AVX2
+uint64_t sso_len_mask_avx2(const LSSSOString *ssos, size_t n, size_t len)
+{
+	__m256i needle_len = _mm256_set1_epi64x((long long)len);
+	__m256i idxs = _mm256_setr_epi64x(0, 4, 8, 12);
+
+	uint64_t mask = 0;
+	size_t i = 0;
+	for (; n - i >= 4; i += 4) {
+		__m256i lens = _mm256_i64gather_epi64(
+				(const long long *)&ssos[i], idxs, 8);
+
+		__m256i eq = _mm256_cmpeq_epi64(lens, needle_len);
+		mask |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(eq)) << i;
+	}
+
+	if (i < n) {
+		mask |= sso_len_mask_scalar(&ssos[i], n - i, len) << i;
+	}
+
+	return mask;
+}
+
+LS_TARGET_AVX2
+uint64_t sso_short_mask_avx2(const LSSSOString *ssos, size_t n,
+		const LSSSOString *needle)
+{
+	__m256i needle_repr = _mm256_loadu_si256((const __m256i *)needle);
+
+	uint64_t mask = 0;
+	for (size_t i = 0; i < n; ++i) {
+		__m256i repr = _mm256_loadu_si256((const __m256i *)&ssos[i]);
+		__m256i eq = _mm256_cmpeq_epi8(repr, needle_repr);
+
+		bool equal = (uint32_t)_mm256_movemask_epi8(eq) == UINT32_MAX;
+		mask |= (uint64_t)equal << i;
+	}
+
+	return mask;
+}
+
+#endif // LS_SIMD_X86
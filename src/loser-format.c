@@ -0,0 +1,1353 @@
+#include "loser.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "loser-format-tables.h"
+#include "loser-simd.h"
+
+/*
+ * Numbers are formatted straight into reserved capacity of the buffer: the
+ * number of digits is computed up front (without a loop), then the digits are
+ * written backwards, two at a time, from a table of all pairs.
+ */
+enum {
+	// enough for any `uint64_t` in decimal (20 digits) or hex (16 digits)
+	MAX_U64_DIGITS = 20,
+
+	// longest output of the shortest float formatting, e.g.
+	// `-0.0000022250738585072014` or `-2.2250738585072014e-308`
+	MAX_SHORTEST_LEN = 32,
+	// a decimal point this far out (or further) calls for an exponent
+	MAX_FIXED_POINT_POS = 21,
+	MIN_FIXED_POINT_POS = -5,
+
+	// `ls_bbuf_append_f64_fixed()` is exact without `snprintf()` up to
+	MAX_FAST_DECIMALS = 22
+};
+
+/*
+ * Floats are formatted with Ryu (Ulf Adams, "Ryu: Fast Float-to-String
+ * Conversion", PLDI 2018), which finds the shortest decimal that rounds back
+ * to the same float, using only fixed-width integer arithmetic. Both `float`s
+ * and `double`s go through the `double` tables: more precision than needed
+ * does not change the result.
+ */
+typedef struct FloatFormat {
+	uint32_t mantissa_bits;
+	uint32_t exponent_bits;
+	int32_t bias;
+} FloatFormat;
+
+static const FloatFormat F64_FORMAT = { 52, 11, 1023 };
+static const FloatFormat F32_FORMAT = { 23, 8, 127 };
+
+// `mantissa * 10^exponent`
+typedef struct Decimal {
+	uint64_t mantissa;
+	int32_t exponent;
+} Decimal;
+
+typedef enum FormatLength {
+	LENGTH_NONE = 0,
+	LENGTH_HH,
+	LENGTH_H,
+	LENGTH_L,
+	LENGTH_LL,
+	LENGTH_J,
+	LENGTH_Z,
+	LENGTH_T
+} FormatLength;
+
+// A parsed conversion specification of `ls_bbuf_appendf()`, e.g. `%-8.3lld`.
+typedef struct FormatSpec {
+	bool left_justify;
+	bool zero_pad;
+	// `'+'`, `' '` or `'\0'`
+	char sign;
+	size_t width;
+	bool has_precision;
+	size_t precision;
+	FormatLength length;
+	char conversion;
+} FormatSpec;
+
+// The argument of a `FormatSpec`, of the type given by its conversion.
+typedef struct FormatArg {
+	int64_t i;
+	uint64_t u;
+	double f;
+	// also for `%s`, with the length limited by the precision
+	LSStringSpan sspan;
+	LSByte c;
+} FormatArg;
+
+typedef enum FormatResult {
+	FORMAT_DONE,
+	FORMAT_INVALID,
+	FORMAT_OUT_OF_SPACE
+} FormatResult;
+
+static const char DIGIT_PAIRS[200] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+static const char HEX_DIGITS[16] = "0123456789abcdef";
+
+static LSStatus append_u64(LSByteBuffer *bbuf, uint64_t value, bool negative,
+		size_t min_digits);
+static LSStatus append_hex(LSByteBuffer *bbuf, uint64_t value,
+		size_t min_digits);
+static size_t count_digits(uint64_t value);
+static size_t count_hex_digits(uint64_t value);
+static void write_digits(LSByte *end, uint64_t value);
+static void write_hex_digits(LSByte *end, uint64_t value);
+static LSStatus reserve(LSByteBuffer *bbuf, size_t len);
+
+static LSStatus append_shortest(LSByteBuffer *bbuf, uint64_t bits,
+		FloatFormat format);
+static LSStatus append_special(LSByteBuffer *bbuf, bool negative,
+		const char *cstr);
+static size_t write_shortest(LSByte *dest, bool negative, Decimal decimal);
+static Decimal shortest_decimal(uint64_t ieee_mantissa,
+		uint32_t ieee_exponent, FloatFormat format);
+static uint64_t mul_shift_64(uint64_t m, const uint64_t *mul, int32_t j);
+static uint32_t pow5_factor(uint64_t value);
+static bool is_multiple_of_pow5(uint64_t value, uint32_t p);
+static bool is_multiple_of_pow2(uint64_t value, uint32_t p);
+static uint32_t log10_pow2(int32_t e);
+static uint32_t log10_pow5(int32_t e);
+static int32_t pow5_bits(int32_t e);
+static LSStatus append_fixed(LSByteBuffer *bbuf, double value,
+		size_t ndecimals);
+static LSStatus append_fixed_snprintf(LSByteBuffer *bbuf, double value,
+		size_t ndecimals);
+static uint32_t float_to_bits(float value);
+
+static FormatResult format(LSByteBuffer *bbuf, const char *fmt,
+		va_list *args, size_t *max_len);
+static bool parse_spec(const char **fmt, va_list *args, FormatSpec *spec);
+static bool parse_int_or_arg(const char **fmt, va_list *args, int *value);
+static bool take_arg(const FormatSpec *spec, va_list *args, FormatArg *arg,
+		size_t *max_len);
+static LSStatus write_field(LSByteBuffer *bbuf, const FormatSpec *spec,
+		const FormatArg *arg);
+static LSStatus pad_field(LSByteBuffer *bbuf, size_t start,
+		const FormatSpec *spec, bool zero_pad);
+static int64_t take_signed(va_list *args, FormatLength length);
+static uint64_t take_unsigned(va_list *args, FormatLength length);
+static int format_with_snprintf(char *dest, size_t cap,
+		const FormatSpec *spec, double value);
+static size_t fixed_max_len(double value, size_t ndecimals);
+static void upper_case(LSByte *bytes, size_t len);
+static LSStatus append_bytes(LSByteBuffer *bbuf, const void *bytes,
+		size_t len);
+
+LSStatus ls_bbuf_append_u64(LSByteBuffer *bbuf, uint64_t value)
+{
+	return append_u64(bbuf, value, false, 0);
+}
+
+LSStatus ls_bbuf_append_i64(LSByteBuffer *bbuf, int64_t value)
+{
+	// negating in unsigned arithmetic is fine even for `INT64_MIN`
+	return value < 0
+			? append_u64(bbuf, -(uint64_t)value, true, 0)
+			: append_u64(bbuf, (uint64_t)value, false, 0);
+}
+
+LSStatus ls_bbuf_append_hex(LSByteBuffer *bbuf, uint64_t value)
+{
+	return append_hex(bbuf, value, 0);
+}
+
+LSStatus ls_bbuf_append_u64_padded(LSByteBuffer *bbuf, uint64_t value,
+		size_t min_digits)
+{
+	return append_u64(bbuf, value, false, min_digits);
+}
+
+LSStatus ls_bbuf_append_i64_padded(LSByteBuffer *bbuf, int64_t value,
+		size_t min_digits)
+{
+	return value < 0
+			? append_u64(bbuf, -(uint64_t)value, true, min_digits)
+			: append_u64(bbuf, (uint64_t)value, false, min_digits);
+}
+
+LSStatus ls_bbuf_append_hex_padded(LSByteBuffer *bbuf, uint64_t value,
+		size_t min_digits)
+{
+	return append_hex(bbuf, value, min_digits);
+}
+
+LSStatus ls_bbuf_append_f64(LSByteBuffer *bbuf, double value)
+{
+	return append_shortest(bbuf, ls_simd_double_to_bits(value), F64_FORMAT);
+}
+
+LSStatus ls_bbuf_append_f32(LSByteBuffer *bbuf, float value)
+{
+	return append_shortest(bbuf, float_to_bits(value), F32_FORMAT);
+}
+
+LSStatus ls_bbuf_append_f64_fixed(LSByteBuffer *bbuf, double value,
+		size_t ndecimals)
+{
+	return append_fixed(bbuf, value, ndecimals);
+}
+
+LSStatus ls_bbuf_append_f32_fixed(LSByteBuffer *bbuf, float value,
+		size_t ndecimals)
+{
+	// every `float` is exactly representable as a `double`
+	return append_fixed(bbuf, value, ndecimals);
+}
+
+LSStatus ls_bbuf_appendf(LSByteBuffer *bbuf, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	LSStatus status = ls_bbuf_vappendf(bbuf, fmt, args);
+	va_end(args);
+
+	return status;
+}
+
+/*
+ * Formats in one pass, straight into the spare capacity of `bbuf`, as long as
+ * every piece fits. If one does not, the whole output is measured first (as an
+ * upper bound), reserved at once, and formatted again.
+ */
+LSStatus ls_bbuf_vappendf(LSByteBuffer *bbuf, const char *fmt, va_list args)
+{
+	if (!ls_bbuf_is_valid(*bbuf) || !fmt) {
+		return LS_FAILURE;
+	}
+
+	size_t old_len = bbuf->len;
+
+	// (copies: the address of a `va_list` parameter is not always a `va_list *`)
+	va_list fast_args;
+	va_copy(fast_args, args);
+	FormatResult result = format(bbuf, fmt, &fast_args, NULL);
+	va_end(fast_args);
+
+	if (result == FORMAT_DONE) {
+		return LS_SUCCESS;
+	}
+
+	bbuf->len = old_len;
+	if (result == FORMAT_INVALID) {
+		return LS_FAILURE;
+	}
+
+	va_list sizing_args;
+	va_copy(sizing_args, args);
+	size_t max_len;
+	result = format(NULL, fmt, &sizing_args, &max_len);
+	va_end(sizing_args);
+
+	// (`snprintf()` writes a null terminator past the end)
+	if (result != FORMAT_DONE || max_len == SIZE_MAX
+			|| reserve(bbuf, max_len + 1) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	va_list writing_args;
+	va_copy(writing_args, args);
+	result = format(bbuf, fmt, &writing_args, NULL);
+	va_end(writing_args);
+
+	if (result != FORMAT_DONE) {
+		bbuf->len = old_len;
+		return LS_FAILURE;
+	}
+
+	return LS_SUCCESS;
+}
+
+LSStatus append_u64(LSByteBuffer *bbuf, uint64_t value, bool negative,
+		size_t min_digits)
+{
+	size_t ndigits = count_digits(value);
+	size_t npadding = min_digits > ndigits ? min_digits - ndigits : 0;
+	size_t len = negative + ndigits;
+
+	if (npadding > SIZE_MAX - len
+			|| reserve(bbuf, len + npadding) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	if (negative) {
+		*dest++ = '-';
+	}
+
+	memset(dest, '0', npadding);
+	write_digits(&dest[npadding + ndigits], value);
+
+	bbuf->len += len + npadding;
+
+	return LS_SUCCESS;
+}
+
+LSStatus append_hex(LSByteBuffer *bbuf, uint64_t value, size_t min_digits)
+{
+	size_t ndigits = count_hex_digits(value);
+	size_t npadding = min_digits > ndigits ? min_digits - ndigits : 0;
+
+	if (npadding > SIZE_MAX - ndigits
+			|| reserve(bbuf, ndigits + npadding) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	memset(dest, '0', npadding);
+	write_hex_digits(&dest[npadding + ndigits], value);
+
+	bbuf->len += ndigits + npadding;
+
+	return LS_SUCCESS;
+}
+
+LSStatus append_shortest(LSByteBuffer *bbuf, uint64_t bits, FloatFormat format)
+{
+	uint32_t sign_shift = format.mantissa_bits + format.exponent_bits;
+	bool negative = (bits >> sign_shift) & 1;
+	uint64_t ieee_mantissa = bits & ((UINT64_C(1) << format.mantissa_bits) - 1);
+	uint32_t ieee_exponent = (uint32_t)(bits >> format.mantissa_bits)
+			& ((UINT32_C(1) << format.exponent_bits) - 1);
+
+	// (unlike `printf()`, which may print `-nan`)
+	if (ieee_exponent == (UINT32_C(1) << format.exponent_bits) - 1) {
+		return ieee_mantissa != 0 ? append_special(bbuf, false, "nan")
+				: append_special(bbuf, negative, "inf");
+	}
+	if (ieee_exponent == 0 && ieee_mantissa == 0) {
+		return append_special(bbuf, negative, "0");
+	}
+
+	if (reserve(bbuf, MAX_SHORTEST_LEN) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	Decimal decimal = shortest_decimal(ieee_mantissa, ieee_exponent, format);
+	bbuf->len += write_shortest(&bbuf->bytes[bbuf->len], negative, decimal);
+
+	return LS_SUCCESS;
+}
+
+// Appends `cstr` (e.g. `"inf"`), preceded by a minus sign if `negative`.
+LSStatus append_special(LSByteBuffer *bbuf, bool negative, const char *cstr)
+{
+	size_t len = strlen(cstr);
+
+	if (reserve(bbuf, negative + len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	if (negative) {
+		*dest++ = '-';
+	}
+	memcpy(dest, cstr, len);
+
+	bbuf->len += negative + len;
+
+	return LS_SUCCESS;
+}
+
+/*
+ * Writes `decimal` like JavaScript's `Number.prototype.toString()` (e.g.
+ * `123`, `0.001`, `1.5e+300`, `5e-324`) and returns the number of bytes
+ * written, at most `MAX_SHORTEST_LEN`.
+ */
+size_t write_shortest(LSByte *dest, bool negative, Decimal decimal)
+{
+	LSByte digits[MAX_U64_DIGITS];
+	size_t ndigits = count_digits(decimal.mantissa);
+	write_digits(&digits[ndigits], decimal.mantissa);
+
+	// the value is `0.<digits> * 10^point_pos`
+	int32_t point_pos = (int32_t)ndigits + decimal.exponent;
+
+	LSByte *start = dest;
+	if (negative) {
+		*dest++ = '-';
+	}
+
+	if (point_pos >= (int32_t)ndigits && point_pos <= MAX_FIXED_POINT_POS) {
+		memcpy(dest, digits, ndigits);
+		memset(&dest[ndigits], '0', point_pos - ndigits);
+		dest += point_pos;
+	} else if (point_pos > 0 && point_pos <= MAX_FIXED_POINT_POS) {
+		memcpy(dest, digits, point_pos);
+		dest[point_pos] = '.';
+		memcpy(&dest[point_pos + 1], &digits[point_pos],
+				ndigits - point_pos);
+		dest += ndigits + 1;
+	} else if (point_pos <= 0 && point_pos > MIN_FIXED_POINT_POS - 1) {
+		size_t nzeros = (size_t)-point_pos;
+		memcpy(dest, "0.", 2);
+		memset(&dest[2], '0', nzeros);
+		memcpy(&dest[2 + nzeros], digits, ndigits);
+		dest += 2 + nzeros + ndigits;
+	} else {
+		*dest++ = digits[0];
+		if (ndigits > 1) {
+			*dest++ = '.';
+			memcpy(dest, &digits[1], ndigits - 1);
+			dest += ndigits - 1;
+		}
+
+		int32_t exponent = point_pos - 1;
+		*dest++ = 'e';
+		*dest++ = exponent < 0 ? '-' : '+';
+
+		uint64_t abs_exponent = exponent < 0 ? -(int64_t)exponent
+				: exponent;
+		size_t nexponent_digits = count_digits(abs_exponent);
+		write_digits(&dest[nexponent_digits], abs_exponent);
+		dest += nexponent_digits;
+	}
+
+	return dest - start;
+}
+
+/*
+ * Returns the shortest decimal in the interval of reals which round to the
+ * given float (the one closest to the float if there are several). This is
+ * `d2d()` of the reference implementation of Ryu, for any float format.
+ */
+Decimal shortest_decimal(uint64_t ieee_mantissa, uint32_t ieee_exponent,
+		FloatFormat format)
+{
+	// step 1: decode, with two extra bits of precision for the bounds
+	int32_t e2;
+	uint64_t m2;
+	if (ieee_exponent == 0) {
+		e2 = 1 - format.bias - (int32_t)format.mantissa_bits - 2;
+		m2 = ieee_mantissa;
+	} else {
+		e2 = (int32_t)ieee_exponent - format.bias
+				- (int32_t)format.mantissa_bits - 2;
+		m2 = (UINT64_C(1) << format.mantissa_bits) | ieee_mantissa;
+	}
+	bool accept_bounds = (m2 & 1) == 0;
+
+	// step 2: the interval is (mm, mp) around mv, all times 2^e2, where
+	// the lower bound is closer for powers of two
+	uint64_t mv = 4 * m2;
+	uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+	// step 3: convert the interval to decimal, keeping track of whether
+	// the digits cut off are all zeros
+	uint64_t vr;
+	uint64_t vp;
+	uint64_t vm;
+	int32_t e10;
+	bool vm_is_trailing_zeros = false;
+	bool vr_is_trailing_zeros = false;
+	if (e2 >= 0) {
+		uint32_t q = log10_pow2(e2) - (e2 > 3);
+		e10 = (int32_t)q;
+		int32_t k = POW5_INV_BITCOUNT + pow5_bits((int32_t)q) - 1;
+		int32_t i = -e2 + (int32_t)q + k;
+
+		vr = mul_shift_64(4 * m2, POW5_INV_SPLIT[q], i);
+		vp = mul_shift_64(4 * m2 + 2, POW5_INV_SPLIT[q], i);
+		vm = mul_shift_64(4 * m2 - 1 - mm_shift, POW5_INV_SPLIT[q], i);
+
+		if (q <= 21) {
+			// at most one of mp, mv and mm is a multiple of 5
+			if (mv % 5 == 0) {
+				vr_is_trailing_zeros = is_multiple_of_pow5(mv, q);
+			} else if (accept_bounds) {
+				vm_is_trailing_zeros = is_multiple_of_pow5(
+						mv - 1 - mm_shift, q);
+			} else {
+				vp -= is_multiple_of_pow5(mv + 2, q);
+			}
+		}
+	} else {
+		uint32_t q = log10_pow5(-e2) - (-e2 > 1);
+		e10 = (int32_t)q + e2;
+		int32_t i = -e2 - (int32_t)q;
+		int32_t k = pow5_bits(i) - POW5_BITCOUNT;
+		int32_t j = (int32_t)q - k;
+
+		vr = mul_shift_64(4 * m2, POW5_SPLIT[i], j);
+		vp = mul_shift_64(4 * m2 + 2, POW5_SPLIT[i], j);
+		vm = mul_shift_64(4 * m2 - 1 - mm_shift, POW5_SPLIT[i], j);
+
+		if (q <= 1) {
+			// mv = 4 * m2 always has at least two trailing zero bits
+			vr_is_trailing_zeros = true;
+			if (accept_bounds) {
+				vm_is_trailing_zeros = mm_shift == 1;
+			} else {
+				--vp;
+			}
+		} else if (q < 63) {
+			vr_is_trailing_zeros = is_multiple_of_pow2(mv, q);
+		}
+	}
+
+	// step 4: remove digits for as long as the bounds differ
+	int32_t removed = 0;
+	uint32_t last_removed_digit = 0;
+	uint64_t output;
+	if (vm_is_trailing_zeros || vr_is_trailing_zeros) {
+		// the rare general case
+		while (vp / 10 > vm / 10) {
+			vm_is_trailing_zeros &= vm % 10 == 0;
+			vr_is_trailing_zeros &= last_removed_digit == 0;
+			last_removed_digit = (uint32_t)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		if (vm_is_trailing_zeros) {
+			while (vm % 10 == 0) {
+				vr_is_trailing_zeros &= last_removed_digit == 0;
+				last_removed_digit = (uint32_t)(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+
+		// round half to even if the exact value is ...50...0
+		if (vr_is_trailing_zeros && last_removed_digit == 5
+				&& vr % 2 == 0) {
+			last_removed_digit = 4;
+		}
+
+		// vr + 1 if vr is out of bounds or if rounding up
+		output = vr + ((vr == vm && (!accept_bounds
+				|| !vm_is_trailing_zeros))
+				|| last_removed_digit >= 5);
+	} else {
+		bool round_up = false;
+
+		// usually at least two digits can go
+		if (vp / 100 > vm / 100) {
+			round_up = vr % 100 >= 50;
+			vr /= 100;
+			vp /= 100;
+			vm /= 100;
+			removed += 2;
+		}
+
+		while (vp / 10 > vm / 10) {
+			round_up = vr % 10 >= 5;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		output = vr + (vr == vm || round_up);
+	}
+
+	return (Decimal){ .mantissa = output, .exponent = e10 + removed };
+}
+
+// Returns `(m * mul) >> j`, where `mul` is 128 bits and `j` is 64 to 127.
+uint64_t mul_shift_64(uint64_t m, const uint64_t *mul, int32_t j)
+{
+#ifdef LS_HAS_UINT128
+	LSUint128 b0 = (LSUint128)m * mul[0];
+	LSUint128 b2 = (LSUint128)m * mul[1];
+
+	return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+#else
+	uint64_t b0_hi;
+	uint64_t b0_lo;
+	uint64_t b2_hi;
+	uint64_t b2_lo;
+	ls_simd_mul_64x64(m, mul[0], &b0_hi, &b0_lo);
+	ls_simd_mul_64x64(m, mul[1], &b2_hi, &b2_lo);
+
+	// (high half of the low product) + (the high product), then shift
+	uint64_t lo = b0_hi + b2_lo;
+	uint64_t hi = b2_hi + (lo < b0_hi);
+
+	uint32_t dist = (uint32_t)(j - 64);
+	return dist == 0 ? lo : (hi << (64 - dist)) | (lo >> dist);
+#endif
+}
+
+uint32_t pow5_factor(uint64_t value)
+{
+	uint32_t count = 0;
+	while (value % 5 == 0) {
+		value /= 5;
+		count++;
+	}
+
+	return count;
+}
+
+bool is_multiple_of_pow5(uint64_t value, uint32_t p)
+{
+	return pow5_factor(value) >= p;
+}
+
+bool is_multiple_of_pow2(uint64_t value, uint32_t p)
+{
+	return (value & ((UINT64_C(1) << p) - 1)) == 0;
+}
+
+// Returns `floor(log10(2^e))` for `e` in `0..1650`.
+uint32_t log10_pow2(int32_t e)
+{
+	return ((uint32_t)e * 78913) >> 18;
+}
+
+// Returns `floor(log10(5^e))` for `e` in `0..2620`.
+uint32_t log10_pow5(int32_t e)
+{
+	return ((uint32_t)e * 732923) >> 20;
+}
+
+// Returns the number of bits of `5^e` for `e` in `0..3528`.
+int32_t pow5_bits(int32_t e)
+{
+	return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+/*
+ * Rounds half to even on the exact binary value, like glibc's `printf()`. Up
+ * to `MAX_FAST_DECIMALS` decimals of values below 2^54, that is done with
+ * 128-bit integers: `m * 2^e * 10^ndecimals` fits in 128 bits, so rounding it
+ * to an integer is just a shift. Everything else goes through `snprintf()`.
+ */
+LSStatus append_fixed(LSByteBuffer *bbuf, double value, size_t ndecimals)
+{
+	uint64_t bits = ls_simd_double_to_bits(value);
+	bool negative = bits >> 63;
+	uint64_t ieee_mantissa = bits & ((UINT64_C(1) << 52) - 1);
+	uint32_t ieee_exponent = (uint32_t)(bits >> 52) & 0x7ff;
+
+	if (ieee_exponent == 0x7ff) {
+		return append_special(bbuf, negative, ieee_mantissa != 0 ? "nan"
+				: "inf");
+	}
+
+#ifdef LS_HAS_UINT128
+	// value = m * 2^e
+	uint64_t m = ieee_exponent == 0 ? ieee_mantissa
+			: (UINT64_C(1) << 52) | ieee_mantissa;
+	int32_t e = (ieee_exponent == 0 ? 1 : (int32_t)ieee_exponent) - 1075;
+
+	if (ndecimals > MAX_FAST_DECIMALS
+			|| (e > 0 && (int32_t)ls_simd_bit_width(m) + e > 54)) {
+		return append_fixed_snprintf(bbuf, value, ndecimals);
+	}
+
+	LSUint128 scaled = m;
+	for (size_t i = 0; i < ndecimals; ++i) {
+		scaled *= 10;
+	}
+
+	// below 2^54 * 10^22 < 2^128
+	if (e >= 0) {
+		scaled <<= e;
+	} else if (-e >= 128) {
+		// less than half (`scaled` < 2^127)
+		scaled = 0;
+	} else {
+		uint32_t shift = (uint32_t)-e;
+		LSUint128 half = (LSUint128)1 << (shift - 1);
+		LSUint128 rem = scaled & ((half << 1) - 1);
+
+		scaled >>= shift;
+		scaled += rem > half || (rem == half && (scaled & 1));
+	}
+
+	// in chunks of 19 digits, as 10^19 < 2^64 (and 2^128 < 10^57), although
+	// the whole value usually fits in 64 bits: 128-bit divisions are slow
+	const uint64_t TEN_POW_19 = UINT64_C(10000000000000000000);
+	LSByte digits[3 * 19];
+	memset(digits, '0', sizeof(digits));
+
+	size_t end = sizeof(digits);
+	while (scaled >> 64 != 0) {
+		write_digits(&digits[end], (uint64_t)(scaled % TEN_POW_19));
+		scaled /= TEN_POW_19;
+		end -= 19;
+	}
+
+	size_t ndigits = sizeof(digits) - end;
+	if (scaled != 0) {
+		write_digits(&digits[end], (uint64_t)scaled);
+		ndigits += count_digits((uint64_t)scaled);
+	}
+
+	// at least one digit before the point
+	if (ndigits < ndecimals + 1) {
+		ndigits = ndecimals + 1;
+	}
+	const LSByte *first = &digits[sizeof(digits) - ndigits];
+
+	size_t len = negative + ndigits + (ndecimals > 0);
+	if (reserve(bbuf, len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	if (negative) {
+		*dest++ = '-';
+	}
+
+	size_t nint_digits = ndigits - ndecimals;
+	memcpy(dest, first, nint_digits);
+	if (ndecimals > 0) {
+		dest[nint_digits] = '.';
+		memcpy(&dest[nint_digits + 1], &first[nint_digits], ndecimals);
+	}
+
+	bbuf->len += len;
+
+	return LS_SUCCESS;
+#else
+	return append_fixed_snprintf(bbuf, value, ndecimals);
+#endif
+}
+
+LSStatus append_fixed_snprintf(LSByteBuffer *bbuf, double value,
+		size_t ndecimals)
+{
+	if (ndecimals > INT_MAX) {
+		return LS_FAILURE;
+	}
+
+	int len = snprintf(NULL, 0, "%.*f", (int)ndecimals, value);
+	if (len < 0 || reserve(bbuf, (size_t)len + 1) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	// the null terminator lands in the reserved space past the end
+	snprintf((char *)&bbuf->bytes[bbuf->len], (size_t)len + 1, "%.*f",
+			(int)ndecimals, value);
+	bbuf->len += len;
+
+	return LS_SUCCESS;
+}
+
+uint32_t float_to_bits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+/*
+ * Writes `fmt` with `args` to `bbuf` as long as every piece fits in its spare
+ * capacity, or only adds up an upper bound of the output length in `*max_len`
+ * if `bbuf` is `NULL`.
+ */
+FormatResult format(LSByteBuffer *bbuf, const char *fmt, va_list *args,
+		size_t *max_len)
+{
+	size_t total = 0;
+
+	while (*fmt) {
+		const char *percent = strchr(fmt, '%');
+		size_t literal_len = percent ? (size_t)(percent - fmt) : strlen(fmt);
+
+		if (bbuf) {
+			if (bbuf->cap - bbuf->len <= literal_len) {
+				return FORMAT_OUT_OF_SPACE;
+			}
+			append_bytes(bbuf, fmt, literal_len);
+		} else if (literal_len > SIZE_MAX - total) {
+			return FORMAT_INVALID;
+		}
+		total += literal_len;
+
+		if (!percent) {
+			break;
+		}
+
+		fmt = percent + 1;
+		FormatSpec spec;
+		FormatArg arg = { 0 };
+		size_t field_len;
+		if (!parse_spec(&fmt, args, &spec)
+				|| !take_arg(&spec, args, &arg, &field_len)) {
+			return FORMAT_INVALID;
+		}
+		field_len = field_len > spec.width ? field_len : spec.width;
+
+		// (the `<=` leaves room for the null terminator of `snprintf()`)
+		if (bbuf) {
+			if (bbuf->cap - bbuf->len <= field_len) {
+				return FORMAT_OUT_OF_SPACE;
+			}
+			if (write_field(bbuf, &spec, &arg) != LS_SUCCESS) {
+				return FORMAT_INVALID;
+			}
+		} else if (field_len > SIZE_MAX - total) {
+			return FORMAT_INVALID;
+		}
+		total += field_len;
+	}
+
+	if (max_len) {
+		*max_len = total;
+	}
+
+	return FORMAT_DONE;
+}
+
+/*
+ * Parses the conversion specification after a `%` at `*fmt` (taking the
+ * arguments of `*`s), and advances `*fmt` past it.
+ *
+ * Returns `false` if it is malformed.
+ */
+bool parse_spec(const char **fmt, va_list *args, FormatSpec *spec)
+{
+	const char *c = *fmt;
+	*spec = (FormatSpec){ .length = LENGTH_NONE };
+
+	for (;; ++c) {
+		if (*c == '-') {
+			spec->left_justify = true;
+		} else if (*c == '0') {
+			spec->zero_pad = true;
+		} else if (*c == '+') {
+			spec->sign = '+';
+		} else if (*c == ' ') {
+			spec->sign = spec->sign ? spec->sign : ' ';
+		} else {
+			break;
+		}
+	}
+
+	int width = 0;
+	if (!parse_int_or_arg(&c, args, &width)) {
+		return false;
+	}
+	// a negative width argument is a `-` flag
+	if (width < 0) {
+		spec->left_justify = true;
+		spec->width = -(size_t)width;
+	} else {
+		spec->width = (size_t)width;
+	}
+
+	if (*c == '.') {
+		++c;
+
+		int precision = 0;
+		if (!parse_int_or_arg(&c, args, &precision)) {
+			return false;
+		}
+		// a negative precision argument is no precision
+		spec->has_precision = precision >= 0;
+		spec->precision = precision >= 0 ? (size_t)precision : 0;
+	}
+
+	switch (*c) {
+	case 'h':
+		spec->length = c[1] == 'h' ? LENGTH_HH : LENGTH_H;
+		c += 1 + (c[1] == 'h');
+		break;
+	case 'l':
+		spec->length = c[1] == 'l' ? LENGTH_LL : LENGTH_L;
+		c += 1 + (c[1] == 'l');
+		break;
+	case 'j':
+		spec->length = LENGTH_J;
+		++c;
+		break;
+	case 'z':
+		spec->length = LENGTH_Z;
+		++c;
+		break;
+	case 't':
+		spec->length = LENGTH_T;
+		++c;
+		break;
+	}
+
+	if (*c == '\0') {
+		return false;
+	}
+
+	spec->conversion = *c;
+	*fmt = c + 1;
+
+	return true;
+}
+
+/*
+ * Parses decimal digits at `*fmt`, or takes an `int` argument for a `*`.
+ *
+ * Returns `false` if the digits exceed `INT_MAX`.
+ */
+bool parse_int_or_arg(const char **fmt, va_list *args, int *value)
+{
+	if (**fmt == '*') {
+		*value = va_arg(*args, int);
+		++*fmt;
+		return true;
+	}
+
+	int parsed = 0;
+	for (; **fmt >= '0' && **fmt <= '9'; ++*fmt) {
+		int digit = **fmt - '0';
+		if (parsed > (INT_MAX - digit) / 10) {
+			return false;
+		}
+		parsed = parsed * 10 + digit;
+	}
+
+	*value = parsed;
+
+	return true;
+}
+
+/*
+ * Takes the argument of `spec` into `*arg`, storing an upper bound of its
+ * formatted length (without the width) in `*max_len`.
+ *
+ * Returns `false` if the conversion or the argument are not supported.
+ */
+bool take_arg(const FormatSpec *spec, va_list *args, FormatArg *arg,
+		size_t *max_len)
+{
+	bool is_float_length = spec->length == LENGTH_NONE
+			|| spec->length == LENGTH_L;
+
+	switch (spec->conversion) {
+	case '%':
+		*max_len = 1;
+		return spec->length == LENGTH_NONE;
+	case 'd':
+	case 'i':
+		arg->i = take_signed(args, spec->length);
+		// sign, then the digits or zero padding
+		*max_len = 1 + (spec->precision > MAX_U64_DIGITS ? spec->precision
+				: MAX_U64_DIGITS);
+		return true;
+	case 'u':
+	case 'x':
+	case 'X':
+		arg->u = take_unsigned(args, spec->length);
+		*max_len = spec->precision > MAX_U64_DIGITS ? spec->precision
+				: MAX_U64_DIGITS;
+		return true;
+	case 'c':
+		arg->c = (LSByte)va_arg(*args, int);
+		*max_len = 1;
+		return spec->length == LENGTH_NONE;
+	case 'p':
+		arg->u = (uintptr_t)va_arg(*args, void *);
+		*max_len = 2 + 16;
+		return spec->length == LENGTH_NONE;
+	case 's': {
+		const char *cstr = va_arg(*args, const char *);
+		if (!cstr || spec->length != LENGTH_NONE) {
+			return false;
+		}
+
+		const char *nul = spec->has_precision
+				? memchr(cstr, '\0', spec->precision) : NULL;
+		size_t len = !spec->has_precision ? strlen(cstr)
+				: nul ? (size_t)(nul - cstr) : spec->precision;
+		arg->sspan = ls_sspan_create((const LSByte *)cstr, len);
+		*max_len = len;
+		return true;
+	}
+	case 'S':
+	case 'T':
+		if (spec->conversion == 'S') {
+			arg->sspan = va_arg(*args, LSStringSpan);
+		} else {
+			arg->sspan = ls_sspan_from_string(va_arg(*args, LSString));
+		}
+		if (!ls_sspan_is_valid(arg->sspan)
+				|| spec->length != LENGTH_NONE) {
+			return false;
+		}
+
+		if (spec->has_precision && spec->precision < arg->sspan.len) {
+			arg->sspan.len = spec->precision;
+		}
+		*max_len = arg->sspan.len;
+		return true;
+	case 'f':
+	case 'F':
+		arg->f = va_arg(*args, double);
+		*max_len = fixed_max_len(arg->f,
+				spec->has_precision ? spec->precision : 6);
+		return is_float_length;
+	case 'e':
+	case 'E':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A': {
+		arg->f = va_arg(*args, double);
+		int len = format_with_snprintf(NULL, 0, spec, arg->f);
+		*max_len = len >= 0 ? (size_t)len : 0;
+		return len >= 0 && is_float_length;
+	}
+	default:
+		return false;
+	}
+}
+
+// Writes the (already taken) `arg` of `spec`.
+LSStatus write_field(LSByteBuffer *bbuf, const FormatSpec *spec,
+		const FormatArg *arg)
+{
+	size_t start = bbuf->len;
+	LSStatus status = LS_SUCCESS;
+	bool is_number = false;
+
+	switch (spec->conversion) {
+	case '%':
+		status = append_bytes(bbuf, "%", 1);
+		break;
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X': {
+		char sign = '\0';
+		uint64_t magnitude = arg->u;
+		if (spec->conversion == 'd' || spec->conversion == 'i') {
+			bool negative = arg->i < 0;
+			sign = negative ? '-' : spec->sign;
+			magnitude = negative ? -(uint64_t)arg->i : (uint64_t)arg->i;
+		}
+
+		if (sign) {
+			status = append_bytes(bbuf, &sign, 1);
+		}
+
+		// no digits at all for `0` with a precision of `0`
+		if (!spec->has_precision || spec->precision > 0 || magnitude != 0) {
+			size_t min_digits = spec->has_precision ? spec->precision : 1;
+			bool hex = spec->conversion == 'x' || spec->conversion == 'X';
+			status |= hex ? append_hex(bbuf, magnitude, min_digits)
+					: append_u64(bbuf, magnitude, false, min_digits);
+		}
+
+		if (spec->conversion == 'X') {
+			upper_case(&bbuf->bytes[start], bbuf->len - start);
+		}
+
+		// a precision takes over from zero padding
+		is_number = !spec->has_precision;
+		break;
+	}
+	case 'c':
+		status = append_bytes(bbuf, &arg->c, 1);
+		break;
+	case 'p':
+		status = append_bytes(bbuf, "0x", 2);
+		status |= append_hex(bbuf, arg->u, 1);
+		break;
+	case 's':
+	case 'S':
+	case 'T':
+		status = append_bytes(bbuf, arg->sspan.bytes, arg->sspan.len);
+		break;
+	case 'f':
+	case 'F':
+		if (spec->sign && !(ls_simd_double_to_bits(arg->f) >> 63)) {
+			status = append_bytes(bbuf, &spec->sign, 1);
+		}
+
+		status |= append_fixed(bbuf, arg->f,
+				spec->has_precision ? spec->precision : 6);
+		if (spec->conversion == 'F') {
+			upper_case(&bbuf->bytes[start], bbuf->len - start);
+		}
+
+		// `inf` and `nan` are padded with spaces
+		is_number = isfinite(arg->f);
+		break;
+	default: {
+		// `e`, `g` and `a`, measured with the same call
+		int len = format_with_snprintf(NULL, 0, spec, arg->f);
+		status = len < 0 ? LS_FAILURE : reserve(bbuf, (size_t)len + 1);
+		if (status == LS_SUCCESS) {
+			format_with_snprintf((char *)&bbuf->bytes[bbuf->len],
+					(size_t)len + 1, spec, arg->f);
+			bbuf->len += len;
+		}
+
+		is_number = isfinite(arg->f);
+		break;
+	}
+	}
+
+	if (status != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	return pad_field(bbuf, start, spec, is_number && spec->zero_pad);
+}
+
+/*
+ * Pads the field from `start` to the end of `bbuf` to `spec->width`: with
+ * zeros after the sign if `zero_pad` (which the caller only passes for finite
+ * numbers), otherwise with spaces on the side given by `spec`.
+ */
+LSStatus pad_field(LSByteBuffer *bbuf, size_t start, const FormatSpec *spec,
+		bool zero_pad)
+{
+	size_t len = bbuf->len - start;
+	if (len >= spec->width) {
+		return LS_SUCCESS;
+	}
+
+	size_t npad = spec->width - len;
+	if (reserve(bbuf, npad) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *field = &bbuf->bytes[start];
+	if (spec->left_justify) {
+		memset(&field[len], ' ', npad);
+	} else {
+		size_t nsign = len > 0
+				&& (field[0] == '-' || field[0] == '+' || field[0] == ' ');
+		size_t nkept = zero_pad ? nsign : 0;
+
+		memmove(&field[nkept + npad], &field[nkept], len - nkept);
+		memset(&field[nkept], zero_pad ? '0' : ' ', npad);
+	}
+
+	bbuf->len += npad;
+
+	return LS_SUCCESS;
+}
+
+int64_t take_signed(va_list *args, FormatLength length)
+{
+	switch (length) {
+	case LENGTH_HH:
+		return (signed char)va_arg(*args, int);
+	case LENGTH_H:
+		return (short)va_arg(*args, int);
+	case LENGTH_L:
+		return va_arg(*args, long);
+	case LENGTH_LL:
+		return va_arg(*args, long long);
+	case LENGTH_J:
+		return va_arg(*args, intmax_t);
+	case LENGTH_Z:
+	case LENGTH_T:
+		// (the signed type of `size_t`)
+		return va_arg(*args, ptrdiff_t);
+	default:
+		return va_arg(*args, int);
+	}
+}
+
+uint64_t take_unsigned(va_list *args, FormatLength length)
+{
+	switch (length) {
+	case LENGTH_HH:
+		return (unsigned char)va_arg(*args, unsigned);
+	case LENGTH_H:
+		return (unsigned short)va_arg(*args, unsigned);
+	case LENGTH_L:
+		return va_arg(*args, unsigned long);
+	case LENGTH_LL:
+		return va_arg(*args, unsigned long long);
+	case LENGTH_J:
+		return va_arg(*args, uintmax_t);
+	case LENGTH_Z:
+	case LENGTH_T:
+		return va_arg(*args, size_t);
+	default:
+		return va_arg(*args, unsigned);
+	}
+}
+
+/*
+ * Formats `value` like `spec` (without the width, which is padded separately)
+ * with `snprintf()`, and returns its result.
+ */
+int format_with_snprintf(char *dest, size_t cap, const FormatSpec *spec,
+		double value)
+{
+	char fmt[8];
+	size_t len = 0;
+
+	fmt[len++] = '%';
+	if (spec->sign) {
+		fmt[len++] = spec->sign;
+	}
+	fmt[len++] = '.';
+	fmt[len++] = '*';
+	fmt[len++] = spec->conversion;
+	fmt[len] = '\0';
+
+	// (a negative precision is no precision)
+	int precision = spec->has_precision ? (int)spec->precision : -1;
+
+	return snprintf(dest, cap, fmt, precision, value);
+}
+
+// Returns an upper bound of the length of `append_fixed()`'s output.
+size_t fixed_max_len(double value, size_t ndecimals)
+{
+	uint64_t bits = ls_simd_double_to_bits(value);
+	uint32_t ieee_exponent = (uint32_t)(bits >> 52) & 0x7ff;
+	if (ieee_exponent == 0x7ff) {
+		return 4;
+	}
+
+	// `value` is below 2^e, which has `log10_pow2(e) + 1` digits, and
+	// rounding may add one more
+	int32_t e = (int32_t)ieee_exponent - 1022;
+	size_t nint_digits = e <= 0 ? 1 : log10_pow2(e) + 2;
+
+	return 1 + nint_digits + (ndecimals > 0) + ndecimals;
+}
+
+void upper_case(LSByte *bytes, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		if (bytes[i] >= 'a' && bytes[i] <= 'z') {
+			bytes[i] -= 'a' - 'A';
+		}
+	}
+}
+
+// `ls_bbuf_append()` for space which is usually reserved already.
+LSStatus append_bytes(LSByteBuffer *bbuf, const void *bytes, size_t len)
+{
+	if (reserve(bbuf, len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	memcpy(&bbuf->bytes[bbuf->len], bytes, len);
+	bbuf->len += len;
+
+	return LS_SUCCESS;
+}
+
+/*
+ * Estimates the digit count from the bit width (`1233 / 4096` approximates
+ * `log10(2)`), which is either exact or one too small, and corrects it with a
+ * single table lookup.
+ */
+size_t count_digits(uint64_t value)
+{
+	static const uint64_t POWERS_OF_10[MAX_U64_DIGITS] = {
+		UINT64_C(1),
+		UINT64_C(10),
+		UINT64_C(100),
+		UINT64_C(1000),
+		UINT64_C(10000),
+		UINT64_C(100000),
+		UINT64_C(1000000),
+		UINT64_C(10000000),
+		UINT64_C(100000000),
+		UINT64_C(1000000000),
+		UINT64_C(10000000000),
+		UINT64_C(100000000000),
+		UINT64_C(1000000000000),
+		UINT64_C(10000000000000),
+		UINT64_C(100000000000000),
+		UINT64_C(1000000000000000),
+		UINT64_C(10000000000000000),
+		UINT64_C(100000000000000000),
+		UINT64_C(1000000000000000000),
+		UINT64_C(10000000000000000000)
+	};
+
+	// `| 1` gives `0` one digit and changes nothing else
+	value |= 1;
+	size_t estimate = (ls_simd_bit_width(value) * 1233) >> 12;
+
+	return estimate + (estimate < MAX_U64_DIGITS
+			&& value >= POWERS_OF_10[estimate]);
+}
+
+size_t count_hex_digits(uint64_t value)
+{
+	return (ls_simd_bit_width(value | 1) + 3) / 4;
+}
+
+/*
+ * Writes the decimal digits of `value` so that the last one lands before `end`.
+ *
+ * Blocks of 8 digits are split off first, so that the pairs are extracted with
+ * (cheaper) 32-bit arithmetic.
+ */
+void write_digits(LSByte *end, uint64_t value)
+{
+	while (value >= 100000000) {
+		uint32_t block = (uint32_t)(value % 100000000);
+		value /= 100000000;
+
+		for (size_t i = 0; i < 4; ++i) {
+			end -= 2;
+			memcpy(end, &DIGIT_PAIRS[(block % 100) * 2], 2);
+			block /= 100;
+		}
+	}
+
+	uint32_t rest = (uint32_t)value;
+	while (rest >= 100) {
+		end -= 2;
+		memcpy(end, &DIGIT_PAIRS[(rest % 100) * 2], 2);
+		rest /= 100;
+	}
+
+	if (rest >= 10) {
+		end -= 2;
+		memcpy(end, &DIGIT_PAIRS[rest * 2], 2);
+	} else {
+		end[-1] = (LSByte)('0' + rest);
+	}
+}
+
+void write_hex_digits(LSByte *end, uint64_t value)
+{
+	do {
+		*--end = (LSByte)HEX_DIGITS[value & 0xf];
+		value >>= 4;
+	} while (value != 0);
+}
+
+// `ls_bbuf_reserve()`, minus the call when the space is already there.
+LSStatus reserve(LSByteBuffer *bbuf, size_t len)
+{
+	if (ls_bbuf_is_valid(*bbuf) && bbuf->cap - bbuf->len >= len) {
+		return LS_SUCCESS;
+	}
+
+	return ls_bbuf_reserve(bbuf, len);
+}
@@ -6,6 +6,10 @@ LS_LINK(const LSByte *)ls_short_string_get_bytes(
 		const LSShortString *short_string);
 LS_LINK(bool) ls_sspan_is_valid(LSStringSpan sspan);
 LS_LINK(bool) ls_bbuf_is_valid(LSByteBuffer bbuf);
+LS_LINK(bool) ls_line_reader_is_valid(LSLineReader reader);
+LS_LINK(bool) ls_utf8_index_is_valid(LSUtf8Index index);
+LS_LINK(bool) ls_template_is_valid(LSTemplate tmpl);
+LS_LINK(bool) ls_csv_reader_is_valid(LSCsvReader reader);
 LS_LINK(LSSSOStringType) ls_sso_get_type(LSSSOString sso);
 LS_LINK(bool) ls_sso_is_valid(LSSSOString sso);
 LS_LINK(const LSByte *)ls_sso_get_bytes(const LSSSOString *sso);
@@ -53,4 +57,8 @@ LS_LINK(LSStatus) ls_bbuf_insert_short_string(LSByteBuffer *bbuf, size_t idx,
 LS_LINK(LSStatus) ls_bbuf_insert_sso(LSByteBuffer *bbuf, size_t idx,
 		LSSSOString sso);
 
+LS_LINK(void) ls_byte_set_add(LSByteSet *set, LSByte byte);
+LS_LINK(void) ls_byte_set_remove(LSByteSet *set, LSByte byte);
+LS_LINK(bool) ls_byte_set_contains(const LSByteSet *set, LSByte byte);
+
 #undef LS_LINK
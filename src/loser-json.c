@@ -0,0 +1,282 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tyrant/tyrant.h>
+
+#include "loser-escape.h"
+#include "loser-simd.h"
+
+typedef size_t (*FindSpecialFn)(const LSByte *bytes, size_t len);
+
+static FindSpecialFn resolve_find_special(void);
+
+LS_DISPATCH(size_t, find_special, (const LSByte *bytes, size_t len),
+		(bytes, len), resolve_find_special)
+
+static size_t find_clean_run(const LSByte *bytes, size_t len, const void *ctx);
+static size_t write_escape(LSByte *dest, LSByte byte);
+static bool parse_hex4(const LSByte *bytes, size_t len, uint32_t *value);
+static bool is_special(LSByte byte);
+static size_t find_special_scalar(const LSByte *bytes, size_t len);
+
+#ifdef LS_SIMD_X86
+static size_t find_special_avx2(const LSByte *bytes, size_t len);
+#endif
+
+LSStatus ls_bbuf_append_json_escaped(LSByteBuffer *bbuf, LSStringSpan sspan)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(sspan)) {
+		return LS_FAILURE;
+	}
+
+	// the longest escape is `\u00XX`
+	return ls_escape_append(bbuf, sspan, 6, find_clean_run, NULL,
+			write_escape);
+}
+
+LSString ls_sspan_json_unescape(LSStringSpan sspan)
+{
+	if (!ls_sspan_is_valid(sspan) || sspan.len == SIZE_MAX) {
+		return LS_AN_INVALID_STRING;
+	}
+
+	if (sspan.len == 0) {
+		return LS_EMPTY_STRING;
+	}
+
+	// every escape is at least 2 bytes long, and stands for at most 4
+	LSByte *dest = tyrant_alloc(ls_simd_padded_size(sspan.len + 1));
+	if (!dest) {
+		return LS_AN_INVALID_STRING;
+	}
+
+	const LSByte *bytes = sspan.bytes;
+	size_t len = sspan.len;
+	size_t nwritten = 0;
+
+	size_t pos = 0;
+	for (;;) {
+		size_t run = find_special(&bytes[pos], len - pos);
+		memcpy(&dest[nwritten], &bytes[pos], run);
+		nwritten += run;
+		pos += run;
+
+		if (pos == len) {
+			break;
+		}
+
+		// quotes and control characters must be escaped
+		if (bytes[pos] != '\\' || len - pos < 2) {
+			goto fail;
+		}
+
+		LSByte escaped = bytes[pos + 1];
+		pos += 2;
+
+		uint32_t cp;
+		switch (escaped) {
+		case '"':
+		case '\\':
+		case '/':
+			dest[nwritten++] = escaped;
+			continue;
+		case 'b':
+			dest[nwritten++] = '\b';
+			continue;
+		case 'f':
+			dest[nwritten++] = '\f';
+			continue;
+		case 'n':
+			dest[nwritten++] = '\n';
+			continue;
+		case 'r':
+			dest[nwritten++] = '\r';
+			continue;
+		case 't':
+			dest[nwritten++] = '\t';
+			continue;
+		case 'u':
+			break;
+		default:
+			goto fail;
+		}
+
+		if (!parse_hex4(&bytes[pos], len - pos, &cp)) {
+			goto fail;
+		}
+		pos += 4;
+
+		// a high surrogate must be followed by an escaped low one
+		if (cp >= 0xd800 && cp < 0xe000) {
+			uint32_t low;
+			if (cp >= 0xdc00
+					|| len - pos < 6
+					|| bytes[pos] != '\\'
+					|| bytes[pos + 1] != 'u'
+					|| !parse_hex4(&bytes[pos + 2], len - pos - 2, &low)
+					|| low < 0xdc00 || low >= 0xe000) {
+				goto fail;
+			}
+			pos += 6;
+
+			cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+		}
+
+		nwritten += ls_escape_encode_utf8(&dest[nwritten], cp);
+	}
+
+	dest[nwritten] = '\0';
+
+	return (LSString){
+		.len = nwritten,
+		.bytes = dest
+	};
+
+fail:
+	tyrant_free(dest);
+	return LS_AN_INVALID_STRING;
+}
+
+FindSpecialFn resolve_find_special(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return find_special_avx2;
+	}
+#endif
+
+	return find_special_scalar;
+}
+
+// Returns the length of the run before the first byte which `is_special()`.
+size_t find_clean_run(const LSByte *bytes, size_t len, const void *ctx)
+{
+	(void)ctx;
+
+	return find_special(bytes, len);
+}
+
+size_t write_escape(LSByte *dest, LSByte byte)
+{
+	static const char HEX_DIGITS[] = "0123456789abcdef";
+
+	LSByte short_escape;
+	switch (byte) {
+	case '"':  short_escape = '"';  break;
+	case '\\': short_escape = '\\'; break;
+	case '\b': short_escape = 'b';  break;
+	case '\f': short_escape = 'f';  break;
+	case '\n': short_escape = 'n';  break;
+	case '\r': short_escape = 'r';  break;
+	case '\t': short_escape = 't';  break;
+	default:
+		memcpy(dest, "\\u00", 4);
+		dest[4] = (LSByte)HEX_DIGITS[byte >> 4];
+		dest[5] = (LSByte)HEX_DIGITS[byte & 0xf];
+		return 6;
+	}
+
+	dest[0] = '\\';
+	dest[1] = short_escape;
+
+	return 2;
+}
+
+// Parses exactly 4 hexadecimal digits of either case.
+bool parse_hex4(const LSByte *bytes, size_t len, uint32_t *value)
+{
+	if (len < 4) {
+		return false;
+	}
+
+	uint32_t acc = 0;
+	uint32_t any_invalid = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		uint32_t digit = ls_escape_hex_value(bytes[i]);
+		any_invalid |= digit;
+
+		acc = (acc << 4) | digit;
+	}
+
+	*value = acc;
+
+	return !(any_invalid & 0x80);
+}
+
+// Whether `byte` must be escaped in a JSON string.
+bool is_special(LSByte byte)
+{
+	return byte < 0x20 || byte == '"' || byte == '\\';
+}
+
+/*
+ * Returns the index of the first byte which `is_special()`, or `len` if there
+ * is none.
+ *
+ * Subtracting a byte value from every byte of a word flags (with the high bit)
+ * each byte below it. A borrow can flag false positives, but only in bytes
+ * above a true one, so the lowest flag is always right.
+ */
+size_t find_special_scalar(const LSByte *bytes, size_t len)
+{
+	const uint64_t ONES = UINT64_C(0x0101010101010101);
+	const uint64_t HIGH_BITS = UINT64_C(0x8080808080808080);
+
+	size_t i = 0;
+	for (; len - i >= 8; i += 8) {
+		uint64_t word = ls_simd_load_u64_le(&bytes[i]);
+		uint64_t quotes = word ^ (ONES * '"');
+		uint64_t backslashes = word ^ (ONES * '\\');
+
+		uint64_t flags = (((word - ONES * 0x20) & ~word)
+				| ((quotes - ONES) & ~quotes)
+				| ((backslashes - ONES) & ~backslashes))
+				& HIGH_BITS;
+		if (flags != 0) {
+			return i + ls_simd_lowest_bit_idx(flags) / 8;
+		}
+	}
+
+	for (; i < len; ++i) {
+		if (is_special(bytes[i])) {
+			return i;
+		}
+	}
+
+	return len;
+}
+
+#ifdef LS_SIMD_X86
+
+LS_TARGET_AVX2
+size_t find_special_avx2(const LSByte *bytes, size_t len)
+{
+	const __m256i QUOTE = _mm256_set1_epi8('"');
+	const __m256i BACKSLASH = _mm256_set1_epi8('\\');
+	const __m256i LAST_CONTROL = _mm256_set1_epi8(0x1f);
+
+	size_t i = 0;
+	for (; len - i >= 32; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+		// `v` is at most `0x1f` iff the unsigned maximum of both is `0x1f`
+		__m256i is_control = _mm256_cmpeq_epi8(
+				_mm256_max_epu8(v, LAST_CONTROL), LAST_CONTROL);
+		__m256i special = _mm256_or_si256(is_control,
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, QUOTE),
+						_mm256_cmpeq_epi8(v, BACKSLASH)));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+		if (mask != 0) {
+			return i + (size_t)__builtin_ctz(mask);
+		}
+	}
+
+	return i + find_special_scalar(&bytes[i], len - i);
+}
+
+#endif // LS_SIMD_X86
@@ -0,0 +1,572 @@
+#include "loser.h"
+
+#include <float.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loser-parse-tables.h"
+#include "loser-simd.h"
+
+/*
+ * Digits are read eight at a time as one little-endian word (SWAR): a single
+ * test tells whether all eight bytes are digits, and three multiplications
+ * turn them into their value.
+ */
+enum {
+	// at most 19 digits always fit in a `uint64_t`, 20 digits might
+	MAX_U64_DIGITS = 20,
+	MAX_EXACT_DIGITS = 19,
+
+	// enough to tell where any decimal rounds to: halfway points between
+	// doubles have at most 767 significant digits
+	MAX_FALLBACK_DIGITS = 768,
+	// far beyond the range of doubles, even with `MAX_FALLBACK_DIGITS`
+	MAX_FALLBACK_EXPONENT = 100000,
+	// explicit exponents are clamped to this while parsing them
+	MAX_EXPLICIT_EXPONENT = 0x10000000,
+
+	// `mantissa * 10^exponent` is exact in a double within these bounds
+	MAX_FAST_MANTISSA_BITS = 53,
+	MAX_FAST_EXPONENT = 22
+};
+
+static const uint64_t DOUBLE_MANTISSA_BITS = 52;
+static const int32_t DOUBLE_MIN_EXPONENT = -1023;
+static const int32_t DOUBLE_INFINITE_POWER = 0x7ff;
+static const uint64_t DOUBLE_INF_BITS = UINT64_C(0x7ff0000000000000);
+static const uint64_t DOUBLE_NAN_BITS = UINT64_C(0x7ff8000000000000);
+
+// The digits of `int_digits.frac_digits * 10^exponent`.
+typedef struct DecimalParts {
+	const LSByte *int_digits;
+	size_t nint_digits;
+	const LSByte *frac_digits;
+	size_t nfrac_digits;
+	int64_t exponent;
+} DecimalParts;
+
+// A double as its biased exponent and its mantissa without the implicit bit.
+typedef struct BinaryFloat {
+	uint64_t mantissa;
+	int32_t power2;
+} BinaryFloat;
+
+static bool parse_magnitude(const LSByte *bytes, size_t len,
+		uint64_t *magnitude, size_t *ndigits);
+static size_t parse_digits(const LSByte *bytes, size_t len, uint64_t *value);
+static size_t count_leading_digits(uint64_t word);
+static uint32_t parse_eight_digits(uint64_t word);
+static bool is_digit(LSByte byte);
+static size_t parse_exponent(const LSByte *bytes, size_t len,
+		int64_t *exponent);
+static size_t parse_special(const LSByte *bytes, size_t len, double *value);
+static double decimal_to_double(const DecimalParts *parts, uint64_t mantissa);
+static BinaryFloat eisel_lemire(int64_t q, uint64_t w);
+static int32_t binary_exponent(int64_t q);
+static double fallback_to_double(const DecimalParts *parts, size_t first);
+static LSByte digit_at(const DecimalParts *parts, size_t idx);
+static double bits_to_double(uint64_t bits);
+
+LSStatus ls_sspan_parse_u64(LSStringSpan sspan, uint64_t *value,
+		size_t *nconsumed)
+{
+	*value = 0;
+	*nconsumed = 0;
+
+	if (!sspan.bytes) {
+		return LS_FAILURE;
+	}
+
+	size_t nsign = sspan.len > 0 && sspan.bytes[0] == '+';
+
+	uint64_t magnitude = 0;
+	size_t ndigits;
+	bool in_range = parse_magnitude(&sspan.bytes[nsign], sspan.len - nsign,
+			&magnitude, &ndigits);
+	if (ndigits == 0) {
+		return LS_FAILURE;
+	}
+
+	*nconsumed = nsign + ndigits;
+	if (!in_range) {
+		*value = UINT64_MAX;
+		return LS_FAILURE;
+	}
+
+	*value = magnitude;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_sspan_parse_i64(LSStringSpan sspan, int64_t *value,
+		size_t *nconsumed)
+{
+	*value = 0;
+	*nconsumed = 0;
+
+	if (!sspan.bytes) {
+		return LS_FAILURE;
+	}
+
+	bool negative = sspan.len > 0 && sspan.bytes[0] == '-';
+	size_t nsign = negative || (sspan.len > 0 && sspan.bytes[0] == '+');
+
+	uint64_t magnitude = 0;
+	size_t ndigits;
+	bool in_range = parse_magnitude(&sspan.bytes[nsign], sspan.len - nsign,
+			&magnitude, &ndigits);
+	if (ndigits == 0) {
+		return LS_FAILURE;
+	}
+
+	*nconsumed = nsign + ndigits;
+
+	uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : INT64_MAX;
+	if (!in_range || magnitude > limit) {
+		*value = negative ? INT64_MIN : INT64_MAX;
+		return LS_FAILURE;
+	}
+
+	// `-INT64_MIN` does not fit, so negate one less than the magnitude
+	*value = !negative || magnitude == 0 ? (int64_t)magnitude
+			: -(int64_t)(magnitude - 1) - 1;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_sspan_parse_f64(LSStringSpan sspan, double *value,
+		size_t *nconsumed)
+{
+	*value = 0;
+	*nconsumed = 0;
+
+	if (!sspan.bytes) {
+		return LS_FAILURE;
+	}
+
+	const LSByte *bytes = sspan.bytes;
+	size_t len = sspan.len;
+
+	bool negative = len > 0 && bytes[0] == '-';
+	size_t nsign = negative || (len > 0 && bytes[0] == '+');
+	size_t i = nsign;
+
+	// the mantissa wraps around past 19 digits, which is dealt with later
+	uint64_t mantissa = 0;
+	DecimalParts parts = { .int_digits = &bytes[i] };
+	parts.nint_digits = parse_digits(&bytes[i], len - i, &mantissa);
+	i += parts.nint_digits;
+
+	parts.frac_digits = &bytes[i];
+	if (i < len && bytes[i] == '.') {
+		parts.frac_digits = &bytes[i + 1];
+		parts.nfrac_digits = parse_digits(&bytes[i + 1], len - i - 1,
+				&mantissa);
+		i += 1 + parts.nfrac_digits;
+	}
+
+	if (parts.nint_digits + parts.nfrac_digits == 0) {
+		size_t nspecial = parse_special(&bytes[nsign], len - nsign, value);
+		if (nspecial == 0) {
+			return LS_FAILURE;
+		}
+
+		*value = negative ? -*value : *value;
+		*nconsumed = nsign + nspecial;
+
+		return LS_SUCCESS;
+	}
+
+	// an exponent without digits is not part of the number
+	i += parse_exponent(&bytes[i], len - i, &parts.exponent);
+	*nconsumed = i;
+
+	double result = decimal_to_double(&parts, mantissa);
+	*value = negative ? -result : result;
+
+	return ls_simd_double_to_bits(result) == DOUBLE_INF_BITS ? LS_FAILURE
+			: LS_SUCCESS;
+}
+
+/*
+ * Parses the digits at the start of `bytes` into `*magnitude`, storing their
+ * count (including leading zeros) in `*ndigits`.
+ *
+ * Returns `false` if the value does not fit in a `uint64_t`.
+ */
+bool parse_magnitude(const LSByte *bytes, size_t len, uint64_t *magnitude,
+		size_t *ndigits)
+{
+	size_t nzeros = 0;
+	while (nzeros < len && bytes[nzeros] == '0') {
+		nzeros++;
+	}
+
+	uint64_t value = 0;
+	size_t nsignificant = parse_digits(&bytes[nzeros], len - nzeros, &value);
+	*ndigits = nzeros + nsignificant;
+
+	if (nsignificant < MAX_U64_DIGITS) {
+		*magnitude = value;
+		return true;
+	}
+	if (nsignificant > MAX_U64_DIGITS) {
+		return false;
+	}
+
+	// 20 digits may not fit (and `value` may have wrapped): check the last one
+	uint64_t head = 0;
+	parse_digits(&bytes[nzeros], MAX_U64_DIGITS - 1, &head);
+	uint64_t last = bytes[nzeros + MAX_U64_DIGITS - 1] - '0';
+	if (head > (UINT64_MAX - last) / 10) {
+		return false;
+	}
+
+	*magnitude = head * 10 + last;
+
+	return true;
+}
+
+/*
+ * Appends the digits at the start of `bytes` to `*value` (modulo 2^64) and
+ * returns their count.
+ */
+size_t parse_digits(const LSByte *bytes, size_t len, uint64_t *value)
+{
+	uint64_t acc = *value;
+	size_t i = 0;
+
+	while (len - i >= 8) {
+		uint64_t word = ls_simd_load_u64_le(&bytes[i]);
+		if (count_leading_digits(word) < 8) {
+			break;
+		}
+
+		acc = acc * 100000000 + parse_eight_digits(word);
+		i += 8;
+	}
+
+	while (i < len && is_digit(bytes[i])) {
+		acc = acc * 10 + (bytes[i] - '0');
+		i++;
+	}
+
+	*value = acc;
+
+	return i;
+}
+
+// Counts the digits at the start of the little-endian `word`.
+size_t count_leading_digits(uint64_t word)
+{
+	// `'0'`..`'9'` become `0`..`9`, and only those stay below `0x80` when
+	// `0x76` is added to their low 7 bits (which never carries)
+	uint64_t values = word ^ UINT64_C(0x3030303030303030);
+	uint64_t non_digits = (((values & UINT64_C(0x7f7f7f7f7f7f7f7f))
+			+ UINT64_C(0x7676767676767676)) | values)
+			& UINT64_C(0x8080808080808080);
+
+	return non_digits ? ls_simd_lowest_bit_idx(non_digits) / 8 : 8;
+}
+
+// Returns the value of the 8 digits of the little-endian `word`.
+uint32_t parse_eight_digits(uint64_t word)
+{
+	const uint64_t MASK = UINT64_C(0x000000ff000000ff);
+	// `100 + (1000000 << 32)` and `1 + (10000 << 32)`
+	const uint64_t MUL1 = UINT64_C(0x000f424000000064);
+	const uint64_t MUL2 = UINT64_C(0x0000271000000001);
+
+	word -= UINT64_C(0x3030303030303030);
+	// pairs of digits, then groups of four, then all eight
+	word = word * 10 + (word >> 8);
+	word = ((word & MASK) * MUL1 + ((word >> 16) & MASK) * MUL2) >> 32;
+
+	return (uint32_t)word;
+}
+
+bool is_digit(LSByte byte)
+{
+	return byte >= '0' && byte <= '9';
+}
+
+/*
+ * Parses an exponent like `e-5` at the start of `bytes`, adding it to
+ * `*exponent` (clamped to `MAX_EXPLICIT_EXPONENT`), and returns its length.
+ *
+ * Returns `0` if there is no exponent.
+ */
+size_t parse_exponent(const LSByte *bytes, size_t len, int64_t *exponent)
+{
+	if (len == 0 || (bytes[0] != 'e' && bytes[0] != 'E')) {
+		return 0;
+	}
+
+	bool negative = len > 1 && bytes[1] == '-';
+	size_t i = 1 + (negative || (len > 1 && bytes[1] == '+'));
+	if (i == len || !is_digit(bytes[i])) {
+		return 0;
+	}
+
+	int64_t value = 0;
+	for (; i < len && is_digit(bytes[i]); ++i) {
+		if (value < MAX_EXPLICIT_EXPONENT) {
+			value = value * 10 + (bytes[i] - '0');
+		}
+	}
+
+	*exponent += negative ? -value : value;
+
+	return i;
+}
+
+/*
+ * Parses `inf`, `infinity` or `nan` (ignoring case) at the start of `bytes`,
+ * and returns its length.
+ *
+ * Returns `0` if there is none of those.
+ */
+size_t parse_special(const LSByte *bytes, size_t len, double *value)
+{
+	static const struct {
+		const char *cstr;
+		uint64_t bits;
+	} SPECIALS[] = {
+		{ "infinity", DOUBLE_INF_BITS },
+		{ "inf", DOUBLE_INF_BITS },
+		{ "nan", DOUBLE_NAN_BITS },
+	};
+
+	for (size_t i = 0; i < sizeof(SPECIALS) / sizeof(SPECIALS[0]); ++i) {
+		size_t special_len = strlen(SPECIALS[i].cstr);
+		if (len < special_len) {
+			continue;
+		}
+
+		LSStringSpan prefix = ls_sspan_create(bytes, special_len);
+		LSStringSpan special = ls_sspan_create(
+				(const LSByte *)SPECIALS[i].cstr, special_len);
+		if (ls_sspan_equals_icase(prefix, special)) {
+			*value = bits_to_double(SPECIALS[i].bits);
+			return special_len;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Returns `parts` as the nearest double (rounding ties to even), where
+ * `mantissa` holds `parts` digits modulo 2^64.
+ *
+ * Tries, in order:
+ * - Clinger's fast path: both the mantissa and the power of ten are exact
+ *   doubles, so a single (correctly rounded) operation gives the result
+ * - Eisel-Lemire: one or two 64x128-bit multiplications with a truncated
+ *   power of five, which always decide the rounding for up to 19 digits
+ * - `strtod()` on a bounded copy of the digits, when more than 19 significant
+ *   digits leave the result undecided
+ */
+double decimal_to_double(const DecimalParts *parts, uint64_t mantissa)
+{
+	size_t ndigits = parts->nint_digits + parts->nfrac_digits;
+	int64_t exponent = parts->exponent - (int64_t)parts->nfrac_digits;
+	size_t first = 0;
+	bool truncated = false;
+
+	if (ndigits > MAX_EXACT_DIGITS) {
+		// leading zeros do not count, the rest is cut to 19 digits
+		while (first < ndigits && digit_at(parts, first) == '0') {
+			first++;
+		}
+
+		size_t end = ndigits - first > MAX_EXACT_DIGITS
+				? first + MAX_EXACT_DIGITS : ndigits;
+		mantissa = 0;
+		for (size_t i = first; i < end; ++i) {
+			mantissa = mantissa * 10 + (digit_at(parts, i) - '0');
+		}
+
+		truncated = end < ndigits;
+		exponent += (int64_t)(ndigits - end);
+	}
+
+#if FLT_EVAL_METHOD == 0
+	static const double POWERS_OF_10[MAX_FAST_EXPONENT + 1] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+		1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	if (!truncated && mantissa <= UINT64_C(1) << MAX_FAST_MANTISSA_BITS
+			&& exponent >= -MAX_FAST_EXPONENT
+			&& exponent <= MAX_FAST_EXPONENT) {
+		double value = (double)mantissa;
+
+		return exponent < 0 ? value / POWERS_OF_10[-exponent]
+				: value * POWERS_OF_10[exponent];
+	}
+#endif
+
+	BinaryFloat binary = eisel_lemire(exponent, mantissa);
+
+	// the dropped digits put the value between `mantissa` and `mantissa + 1`
+	if (truncated) {
+		BinaryFloat upper = eisel_lemire(exponent, mantissa + 1);
+		if (upper.mantissa != binary.mantissa
+				|| upper.power2 != binary.power2) {
+			return fallback_to_double(parts, first);
+		}
+	}
+
+	return bits_to_double(binary.mantissa
+			| ((uint64_t)binary.power2 << DOUBLE_MANTISSA_BITS));
+}
+
+/*
+ * Returns the nearest double to `w * 10^q` (rounding ties to even). Follows
+ * Daniel Lemire, "Number Parsing at a Gigabyte per Second" (2021), which is
+ * exact for any `w` (Noble Mushtak and Daniel Lemire, "Fast Number Parsing
+ * Without Fallback", 2023).
+ */
+BinaryFloat eisel_lemire(int64_t q, uint64_t w)
+{
+	const BinaryFloat ZERO = { 0, 0 };
+	const BinaryFloat INF = { 0, DOUBLE_INFINITE_POWER };
+
+	if (w == 0 || q < SMALLEST_POW10) {
+		return ZERO;
+	}
+	if (q > LARGEST_POW10) {
+		return INF;
+	}
+
+	size_t lz = 64 - ls_simd_bit_width(w);
+	w <<= lz;
+
+	// the upper bits of `w * 5^q`, computed exactly enough to round to the
+	// mantissa plus 2 bits (rounding and sticky)
+	const uint64_t *pow5 = POW5_128[q - SMALLEST_POW10];
+	const uint64_t PRECISION_MASK = UINT64_MAX >> (DOUBLE_MANTISSA_BITS + 3);
+	uint64_t hi;
+	uint64_t lo;
+	ls_simd_mul_64x64(w, pow5[0], &hi, &lo);
+	if ((hi & PRECISION_MASK) == PRECISION_MASK) {
+		uint64_t hi2;
+		uint64_t lo2;
+		ls_simd_mul_64x64(w, pow5[1], &hi2, &lo2);
+
+		lo += hi2;
+		hi += hi2 > lo;
+	}
+
+	uint32_t upper_bit = (uint32_t)(hi >> 63);
+	uint32_t shift = upper_bit + 64 - (uint32_t)DOUBLE_MANTISSA_BITS - 3;
+	uint64_t mantissa = hi >> shift;
+	int32_t power2 = binary_exponent(q) + (int32_t)upper_bit - (int32_t)lz
+			- DOUBLE_MIN_EXPONENT;
+
+	if (power2 <= 0) {
+		// subnormal: shift in the exponent, then round
+		if (-power2 + 1 >= 64) {
+			return ZERO;
+		}
+
+		mantissa >>= -power2 + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+
+		// rounding up may have made it normal
+		bool normal = mantissa >= UINT64_C(1) << DOUBLE_MANTISSA_BITS;
+		mantissa &= ~(UINT64_C(1) << DOUBLE_MANTISSA_BITS);
+
+		return (BinaryFloat){ mantissa, normal };
+	}
+
+	// an exact tie (only possible for small `q`) rounds to even, not up
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1
+			&& (mantissa << shift) == hi) {
+		mantissa &= ~UINT64_C(1);
+	}
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= UINT64_C(2) << DOUBLE_MANTISSA_BITS) {
+		mantissa = UINT64_C(1) << DOUBLE_MANTISSA_BITS;
+		power2++;
+	}
+	mantissa &= ~(UINT64_C(1) << DOUBLE_MANTISSA_BITS);
+
+	if (power2 >= DOUBLE_INFINITE_POWER) {
+		return INF;
+	}
+
+	return (BinaryFloat){ mantissa, power2 };
+}
+
+// Returns `floor(log2(10^q)) + 63` for `q` in `-342..308`.
+int32_t binary_exponent(int64_t q)
+{
+	// `217706 / 2^16` is `log2(10)`, close enough over that range
+	int64_t scaled = q * 217706;
+
+	return (int32_t)(scaled >= 0 ? scaled >> 16
+			: -((-scaled + 0xffff) >> 16)) + 63;
+}
+
+/*
+ * Hands the significant digits from `first` to `strtod()` as `<digits>e<exp>`
+ * (which needs no decimal point, so the locale does not matter). Digits past
+ * `MAX_FALLBACK_DIGITS` cannot change the rounding, except by not all being
+ * zeros, so they are replaced with a single `1` in that case.
+ */
+double fallback_to_double(const DecimalParts *parts, size_t first)
+{
+	char cstr[MAX_FALLBACK_DIGITS + 1 + 32];
+
+	size_t ndigits = parts->nint_digits + parts->nfrac_digits;
+	size_t end = ndigits - first > MAX_FALLBACK_DIGITS
+			? first + MAX_FALLBACK_DIGITS : ndigits;
+
+	size_t len = 0;
+	for (size_t i = first; i < end; ++i) {
+		cstr[len++] = (char)digit_at(parts, i);
+	}
+
+	int64_t exponent = parts->exponent - (int64_t)parts->nfrac_digits
+			+ (int64_t)(ndigits - end);
+	for (size_t i = end; i < ndigits; ++i) {
+		if (digit_at(parts, i) != '0') {
+			cstr[len++] = '1';
+			exponent--;
+			break;
+		}
+	}
+
+	if (exponent > MAX_FALLBACK_EXPONENT) {
+		exponent = MAX_FALLBACK_EXPONENT;
+	} else if (exponent < -MAX_FALLBACK_EXPONENT) {
+		exponent = -MAX_FALLBACK_EXPONENT;
+	}
+	snprintf(&cstr[len], sizeof(cstr) - len, "e%d", (int)exponent);
+
+	return strtod(cstr, NULL);
+}
+
+// Indexes the integer digits followed by the fraction digits.
+LSByte digit_at(const DecimalParts *parts, size_t idx)
+{
+	return idx < parts->nint_digits ? parts->int_digits[idx]
+			: parts->frac_digits[idx - parts->nint_digits];
+}
+
+double bits_to_double(uint64_t bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
@@ -0,0 +1,95 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "loser-escape.h"
+
+static size_t find_safe_run(const LSByte *bytes, size_t len, const void *ctx);
+static size_t write_escape(LSByte *dest, LSByte byte);
+
+LSStatus ls_bbuf_append_percent_encoded(LSByteBuffer *bbuf, LSStringSpan sspan,
+		const LSByteSet *charset)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(sspan)) {
+		return LS_FAILURE;
+	}
+
+	// `%` left as-is would be read back as the start of an escape
+	LSByteSet safe = *charset;
+	ls_byte_set_remove(&safe, '%');
+
+	return ls_escape_append(bbuf, sspan, 3, find_safe_run, &safe,
+			write_escape);
+}
+
+LSStatus ls_sspan_percent_decode(LSStringSpan sspan, LSByteBuffer *bbuf)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(sspan)) {
+		return LS_FAILURE;
+	}
+
+	// each `%XX` becomes one byte, so the output never outgrows `sspan`
+	if (ls_bbuf_reserve(bbuf, sspan.len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	const LSByte *bytes = sspan.bytes;
+	size_t len = sspan.len;
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	size_t nwritten = 0;
+
+	size_t pos = 0;
+	while (pos < len) {
+		const LSByte *percent = memchr(&bytes[pos], '%', len - pos);
+		size_t run = percent ? (size_t)(percent - &bytes[pos]) : len - pos;
+		memcpy(&dest[nwritten], &bytes[pos], run);
+		nwritten += run;
+		pos += run;
+
+		if (pos == len) {
+			break;
+		}
+
+		if (len - pos < 3) {
+			return LS_FAILURE;
+		}
+
+		uint32_t high = ls_escape_hex_value(bytes[pos + 1]);
+		uint32_t low = ls_escape_hex_value(bytes[pos + 2]);
+		if ((high | low) & 0x80) {
+			return LS_FAILURE;
+		}
+
+		dest[nwritten++] = (LSByte)(high << 4 | low);
+		pos += 3;
+	}
+
+	bbuf->len += nwritten;
+
+	return LS_SUCCESS;
+}
+
+// Returns the length of the run of bytes in the `LSByteSet` at `ctx`.
+size_t find_safe_run(const LSByte *bytes, size_t len, const void *ctx)
+{
+	size_t idx = ls_sspan_find_first_not_of(ls_sspan_create(bytes, len), ctx);
+
+	return idx == SIZE_MAX ? len : idx;
+}
+
+// Writes `byte` as `%XX`, with uppercase hex digits (per RFC 3986).
+size_t write_escape(LSByte *dest, LSByte byte)
+{
+	static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+	dest[0] = '%';
+	dest[1] = (LSByte)HEX_DIGITS[byte >> 4];
+	dest[2] = (LSByte)HEX_DIGITS[byte & 0x0f];
+
+	return 3;
+}
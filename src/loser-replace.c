@@ -0,0 +1,273 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tyrant/tyrant.h>
+
+#include "loser-simd.h"
+
+typedef size_t (*FindFn)(const LSByte *bytes, size_t len, const LSByte *needle,
+		size_t needle_len);
+
+static FindFn resolve_find(void);
+
+LS_DISPATCH(size_t, find, (const LSByte *bytes, size_t len,
+		const LSByte *needle, size_t needle_len),
+		(bytes, len, needle, needle_len), resolve_find)
+
+static size_t count_matches(LSStringSpan sspan, LSStringSpan needle);
+static size_t replace_into(LSByte *dest, LSStringSpan src, LSStringSpan needle,
+		LSStringSpan replacement, size_t nmatches);
+static bool replaced_len(size_t len, size_t nmatches, size_t needle_len,
+		size_t replacement_len, size_t *new_len);
+static size_t find_scalar(const LSByte *bytes, size_t len, const LSByte *needle,
+		size_t needle_len);
+
+#ifdef LS_SIMD_X86
+static size_t find_avx2(const LSByte *bytes, size_t len, const LSByte *needle,
+		size_t needle_len);
+#endif
+
+LSString ls_sspan_replace_all(LSStringSpan sspan, LSStringSpan needle,
+		LSStringSpan replacement)
+{
+	if (!ls_sspan_is_valid(sspan)
+			|| !ls_sspan_is_valid(needle)
+			|| !ls_sspan_is_valid(replacement)
+			|| needle.len == 0) {
+		return LS_AN_INVALID_STRING;
+	}
+
+	size_t nmatches = count_matches(sspan, needle);
+
+	size_t len;
+	if (!replaced_len(sspan.len, nmatches, needle.len, replacement.len, &len)
+			|| len == SIZE_MAX) {
+		return LS_AN_INVALID_STRING;
+	}
+
+	if (len == 0) {
+		return LS_EMPTY_STRING;
+	}
+
+	LSByte *bytes = tyrant_alloc(ls_simd_padded_size(len + 1));
+	if (!bytes) {
+		return LS_AN_INVALID_STRING;
+	}
+
+	replace_into(bytes, sspan, needle, replacement, nmatches);
+	bytes[len] = '\0';
+
+	return (LSString){
+		.len = len,
+		.bytes = bytes
+	};
+}
+
+LSStatus ls_bbuf_replace_all(LSByteBuffer *bbuf, LSStringSpan needle,
+		LSStringSpan replacement)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !ls_sspan_is_valid(needle)
+			|| !ls_sspan_is_valid(replacement)
+			|| needle.len == 0) {
+		return LS_FAILURE;
+	}
+
+	LSStringSpan src = ls_sspan_from_bbuf(*bbuf);
+
+	// without growth, writing never gets ahead of reading
+	if (replacement.len <= needle.len) {
+		bbuf->len = replace_into(bbuf->bytes, src, needle, replacement,
+				SIZE_MAX);
+		return LS_SUCCESS;
+	}
+
+	size_t nmatches = count_matches(src, needle);
+	if (nmatches == 0) {
+		return LS_SUCCESS;
+	}
+
+	size_t len;
+	if (!replaced_len(src.len, nmatches, needle.len, replacement.len, &len)
+			|| ls_bbuf_reserve(bbuf, len - src.len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	/*
+	 * Moving the contents to the end of the new length leaves exactly enough
+	 * room in front of them for the growth, so rewriting them front to back
+	 * never overwrites bytes that have yet to be read.
+	 */
+	size_t shift = len - src.len;
+	memmove(&bbuf->bytes[shift], bbuf->bytes, src.len);
+
+	src.bytes = &bbuf->bytes[shift];
+	bbuf->len = replace_into(bbuf->bytes, src, needle, replacement, nmatches);
+
+	return LS_SUCCESS;
+}
+
+FindFn resolve_find(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return find_avx2;
+	}
+#endif
+
+	return find_scalar;
+}
+
+size_t count_matches(LSStringSpan sspan, LSStringSpan needle)
+{
+	size_t nmatches = 0;
+
+	size_t pos = 0;
+	while (sspan.len - pos >= needle.len) {
+		size_t idx = find(&sspan.bytes[pos], sspan.len - pos, needle.bytes,
+				needle.len);
+		if (idx == SIZE_MAX) {
+			break;
+		}
+
+		++nmatches;
+		pos += idx + needle.len;
+	}
+
+	return nmatches;
+}
+
+/*
+ * Writes `src` with its first `nmatches` matches of `needle` replaced to
+ * `dest`, and returns the number of bytes written. With `nmatches` of
+ * `SIZE_MAX`, every match is replaced.
+ *
+ * `dest` may overlap `src` as long as it does not get ahead of it by more than
+ * the growth from replacing.
+ */
+size_t replace_into(LSByte *dest, LSStringSpan src, LSStringSpan needle,
+		LSStringSpan replacement, size_t nmatches)
+{
+	size_t written = 0;
+
+	size_t pos = 0;
+	for (size_t i = 0; i < nmatches && src.len - pos >= needle.len; ++i) {
+		size_t idx = find(&src.bytes[pos], src.len - pos, needle.bytes,
+				needle.len);
+		if (idx == SIZE_MAX) {
+			break;
+		}
+
+		memmove(&dest[written], &src.bytes[pos], idx);
+		written += idx;
+		memcpy(&dest[written], replacement.bytes, replacement.len);
+		written += replacement.len;
+
+		pos += idx + needle.len;
+	}
+
+	memmove(&dest[written], &src.bytes[pos], src.len - pos);
+	written += src.len - pos;
+
+	return written;
+}
+
+bool replaced_len(size_t len, size_t nmatches, size_t needle_len,
+		size_t replacement_len, size_t *new_len)
+{
+	// the matches are disjoint, so they can not add up to more than `len`
+	size_t kept = len - nmatches * needle_len;
+
+	if (nmatches != 0 && replacement_len > (SIZE_MAX - kept) / nmatches) {
+		return false;
+	}
+
+	*new_len = kept + nmatches * replacement_len;
+
+	return true;
+}
+
+/*
+ * Returns the index of the first occurrence of `needle` in `bytes`, or
+ * `SIZE_MAX` if there is none. `needle_len` is at least `1`.
+ */
+size_t find_scalar(const LSByte *bytes, size_t len, const LSByte *needle,
+		size_t needle_len)
+{
+	if (needle_len > len) {
+		return SIZE_MAX;
+	}
+
+	// `memchr()` is vectorized by every libc worth using
+	size_t nstarts = len - needle_len + 1;
+	for (size_t i = 0; i < nstarts; ++i) {
+		const LSByte *first = memchr(&bytes[i], needle[0], nstarts - i);
+		if (!first) {
+			break;
+		}
+
+		i = (size_t)(first - bytes);
+		if (memcmp(&bytes[i + 1], &needle[1], needle_len - 1) == 0) {
+			return i;
+		}
+	}
+
+	return SIZE_MAX;
+}
+
+#ifdef LS_SIMD_X86
+
+/*
+ * Compares 32 candidate positions at a time by the first and the last byte of
+ * `needle`, and only compares the bytes in between at positions where both
+ * match. Two bytes far apart rarely match by chance, even in text with a
+ * skewed byte distribution.
+ */
+LS_TARGET_AVX2
+size_t find_avx2(const LSByte *bytes, size_t len, const LSByte *needle,
+		size_t needle_len)
+{
+	if (needle_len > len) {
+		return SIZE_MAX;
+	}
+
+	if (needle_len == 1) {
+		const LSByte *match = memchr(bytes, needle[0], len);
+		return match ? (size_t)(match - bytes) : SIZE_MAX;
+	}
+
+	__m256i first = _mm256_set1_epi8((char)needle[0]);
+	__m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+
+	size_t nstarts = len - needle_len + 1;
+	size_t i = 0;
+	for (; nstarts - i >= 32; i += 32) {
+		__m256i block_first = _mm256_loadu_si256(
+				(const __m256i *)&bytes[i]);
+		__m256i block_last = _mm256_loadu_si256(
+				(const __m256i *)&bytes[i + needle_len - 1]);
+		__m256i eq = _mm256_and_si256(
+				_mm256_cmpeq_epi8(block_first, first),
+				_mm256_cmpeq_epi8(block_last, last));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(eq);
+		while (mask != 0) {
+			size_t idx = i + (size_t)__builtin_ctz(mask);
+			if (memcmp(&bytes[idx + 1], &needle[1], needle_len - 2) == 0) {
+				return idx;
+			}
+
+			mask &= mask - 1;
+		}
+	}
+
+	size_t idx = find_scalar(&bytes[i], len - i, needle, needle_len);
+
+	return idx == SIZE_MAX ? SIZE_MAX : i + idx;
+}
+
+#endif // LS_SIMD_X86
@@ -0,0 +1,207 @@
+#ifndef loser_simd_h
+#define loser_simd_h
+
+/*
+ * NOTE: This header is internal to the library. It is not part of the API.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "loser.h"
+
+/*
+ * Kernels for newer instruction sets are compiled with per-function target
+ * attributes and picked at runtime, so the library itself can still be built
+ * for (and run on) a baseline CPU.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define LS_SIMD_X86 1
+#include <immintrin.h>
+
+#define LS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __SIZEOF_INT128__
+#define LS_HAS_UINT128 1
+__extension__ typedef unsigned __int128 LSUint128;
+#endif
+
+/*
+ * Declares a function pointer `name` which resolves itself on first call.
+ * `resolver` returns the implementation to use and must be a function taking no
+ * arguments.
+ *
+ * Usage:
+ *     LS_DISPATCH(bool, is_ascii, (const LSByte *bytes, size_t len),
+ *             (bytes, len), resolve_is_ascii)
+ */
+#define LS_DISPATCH(ret, name, params, args, resolver) \
+	typedef ret (*name##_fn) params; \
+	static ret name##_first_call params; \
+	static name##_fn name##_impl = name##_first_call; \
+	static ret name##_first_call params \
+	{ \
+		name##_fn fn = resolver(); \
+		__atomic_store_n(&name##_impl, fn, __ATOMIC_RELAXED); \
+		return fn args; \
+	} \
+	static inline ret name params \
+	{ \
+		return __atomic_load_n(&name##_impl, __ATOMIC_RELAXED) args; \
+	}
+
+// Like `LS_DISPATCH`, for functions returning `void`.
+#define LS_DISPATCH_VOID(name, params, args, resolver) \
+	typedef void (*name##_fn) params; \
+	static void name##_first_call params; \
+	static name##_fn name##_impl = name##_first_call; \
+	static void name##_first_call params \
+	{ \
+		name##_fn fn = resolver(); \
+		__atomic_store_n(&name##_impl, fn, __ATOMIC_RELAXED); \
+		fn args; \
+	} \
+	static inline void name params \
+	{ \
+		__atomic_load_n(&name##_impl, __ATOMIC_RELAXED) args; \
+	}
+
+/*
+ * Returns the size to allocate for `size` bytes of data so that
+ * `LS_TAIL_PADDING` bytes can be read past them. Padded sizes are also rounded
+ * up to a multiple of 16. Returns `SIZE_MAX` (which no allocator will satisfy)
+ * on overflow.
+ */
+static inline size_t ls_simd_padded_size(size_t size)
+{
+	if (LS_TAIL_PADDING == 0) {
+		return size;
+	}
+
+	if (size > SIZE_MAX - LS_TAIL_PADDING - 15) {
+		return SIZE_MAX;
+	}
+
+	return (size + LS_TAIL_PADDING + 15) & ~(size_t)15;
+}
+
+static inline size_t ls_simd_size_min(size_t a, size_t b)
+{
+	return a < b ? a : b;
+}
+
+// Loads 8 bytes as a word, in native byte order.
+static inline uint64_t ls_simd_load_u64(const LSByte *bytes)
+{
+	uint64_t word;
+	memcpy(&word, bytes, sizeof(word));
+
+	return word;
+}
+
+// Loads 8 bytes as a little-endian word, so `bytes[0]` is the lowest byte.
+static inline uint64_t ls_simd_load_u64_le(const LSByte *bytes)
+{
+	uint64_t word = ls_simd_load_u64(bytes);
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) \
+		&& __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return __builtin_bswap64(word);
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	return word;
+#else
+	word = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		word |= (uint64_t)bytes[i] << (8 * i);
+	}
+
+	return word;
+#endif
+}
+
+// Returns the index of the lowest set bit of `word`, which is not `0`.
+static inline size_t ls_simd_lowest_bit_idx(uint64_t word)
+{
+#ifdef __GNUC__
+	return (size_t)__builtin_ctzll(word);
+#else
+	size_t idx = 0;
+	while (!(word & 1)) {
+		word >>= 1;
+		idx++;
+	}
+
+	return idx;
+#endif
+}
+
+// Returns the number of bits needed to represent `value` (`0` for `0`).
+static inline size_t ls_simd_bit_width(uint64_t value)
+{
+#ifdef __GNUC__
+	return value ? 64 - (size_t)__builtin_clzll(value) : 0;
+#else
+	size_t width = 0;
+	while (value != 0) {
+		value >>= 1;
+		width++;
+	}
+
+	return width;
+#endif
+}
+
+// Computes the full 128-bit product of `a` and `b`.
+static inline void ls_simd_mul_64x64(uint64_t a, uint64_t b, uint64_t *hi,
+		uint64_t *lo)
+{
+#ifdef LS_HAS_UINT128
+	LSUint128 product = (LSUint128)a * b;
+
+	*hi = (uint64_t)(product >> 64);
+	*lo = (uint64_t)product;
+#else
+	// from 32-bit halves
+	uint64_t a_lo = a & UINT32_MAX;
+	uint64_t a_hi = a >> 32;
+	uint64_t b_lo = b & UINT32_MAX;
+	uint64_t b_hi = b >> 32;
+
+	uint64_t lo_lo = a_lo * b_lo;
+	uint64_t hi_lo = a_hi * b_lo;
+	uint64_t lo_hi = a_lo * b_hi;
+	uint64_t hi_hi = a_hi * b_hi;
+
+	uint64_t mid = (lo_lo >> 32) + (hi_lo & UINT32_MAX)
+			+ (lo_hi & UINT32_MAX);
+
+	*lo = (mid << 32) | (lo_lo & UINT32_MAX);
+	*hi = hi_hi + (hi_lo >> 32) + (lo_hi >> 32) + (mid >> 32);
+#endif
+}
+
+static inline uint64_t ls_simd_double_to_bits(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+static inline bool ls_simd_has_avx2(void)
+{
+#ifdef LS_SIMD_X86
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+#endif // loser_simd_h
@@ -0,0 +1,613 @@
+#include "loser.h"
+#include "loser-thread-pool.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tyrant/tyrant.h>
+
+#include "loser-simd.h"
+
+/*
+ * Strings are sorted with multikey quicksort (Bentley and Sedgewick, "Fast
+ * Algorithms for Sorting and Searching Strings", 1997), taking 8 bytes at a
+ * time as one "character".
+ *
+ * The sort permutes an array of records, each caching the current 8-byte key
+ * of its string next to the string's location. Partitioning only ever touches
+ * the records, which sit contiguously in memory; the strings themselves are
+ * read once per record and level, to refresh the keys.
+ */
+typedef struct SortRecord {
+	uint64_t key;
+	const LSByte *bytes;
+	size_t len;
+	size_t idx;
+} SortRecord;
+
+enum {
+	// subarrays no longer than this are insertion sorted
+	INSERTION_SORT_MAX = 16,
+
+	KEY_LEN = sizeof(uint64_t)
+};
+
+/*
+ * The parallel sort is a sample sort: every thread classifies a chunk of the
+ * records into buckets delimited by splitters taken from a sorted sample, the
+ * records are scattered into their buckets, and the buckets are sorted
+ * independently.
+ *
+ * Records equal to a splitter get a bucket of their own, which needs no
+ * sorting, so that heavy duplicates can not pile up in one bucket. There are
+ * several buckets per thread to even out the remaining imbalance.
+ */
+enum {
+	// arrays shorter than this are not worth the threads
+	PARALLEL_SORT_MIN = 1 << 16,
+
+	BUCKETS_PER_THREAD = 8,
+	SAMPLES_PER_BUCKET = 32
+};
+
+typedef struct ParallelSort {
+	LSStringSpan *sspans;
+	size_t nsspans;
+
+	SortRecord *recs;
+	SortRecord *scattered;
+	uint16_t *bucket_idxs;
+
+	size_t nchunks;
+	size_t chunk_len;
+
+	SortRecord *splitters;
+	size_t nsplitters;
+
+	size_t nbuckets;
+	// `nchunks` rows of `nbuckets` counts, then offsets
+	size_t *chunk_offsets;
+	// `nbuckets + 1` offsets
+	size_t *bucket_offsets;
+} ParallelSort;
+
+static void sort_records(SortRecord *recs, size_t nrecs);
+static LSStatus choose_splitters(ParallelSort *sort);
+static void load_chunk(void *ctx, size_t chunk_idx);
+static void classify_chunk(void *ctx, size_t chunk_idx);
+static void scatter_chunk(void *ctx, size_t chunk_idx);
+static void sort_bucket(void *ctx, size_t bucket_idx);
+static void store_chunk(void *ctx, size_t chunk_idx);
+static size_t classify(const ParallelSort *sort, const SortRecord *rec);
+static void mkqs(SortRecord *recs, size_t nrecs, size_t depth);
+static size_t sort_ended(SortRecord *recs, size_t nrecs, size_t depth);
+static void insertion_sort(SortRecord *recs, size_t nrecs, size_t depth);
+static void load_keys(SortRecord *recs, size_t nrecs, size_t depth);
+static uint64_t choose_pivot(const SortRecord *recs, size_t nrecs);
+static uint64_t median_of_3(uint64_t a, uint64_t b, uint64_t c);
+static int compare_from(const SortRecord *a, const SortRecord *b,
+		size_t depth);
+static uint64_t load_key(const LSByte *bytes, size_t len, size_t depth);
+static void swap_records(SortRecord *a, SortRecord *b);
+
+LSStatus ls_sspan_sort(LSStringSpan *sspans, size_t nsspans)
+{
+	if (!sspans) {
+		return LS_FAILURE;
+	}
+
+	if (nsspans < 2) {
+		return LS_SUCCESS;
+	}
+
+	if (nsspans > SIZE_MAX / sizeof(SortRecord)) {
+		return LS_FAILURE;
+	}
+
+	SortRecord *recs = tyrant_alloc(nsspans * sizeof(*recs));
+	if (!recs) {
+		return LS_FAILURE;
+	}
+
+	for (size_t i = 0; i < nsspans; ++i) {
+		recs[i] = (SortRecord){
+			.bytes = sspans[i].bytes,
+			.len = sspans[i].len,
+			.idx = i
+		};
+	}
+
+	sort_records(recs, nsspans);
+
+	// spans are fully described by their records, so no permuting is needed
+	for (size_t i = 0; i < nsspans; ++i) {
+		sspans[i] = recs[i].bytes
+				? ls_sspan_create(recs[i].bytes, recs[i].len)
+				: LS_AN_INVALID_SSPAN;
+	}
+
+	tyrant_free(recs);
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_sso_sort(LSSSOString *ssos, size_t nssos)
+{
+	if (!ssos) {
+		return LS_FAILURE;
+	}
+
+	if (nssos < 2) {
+		return LS_SUCCESS;
+	}
+
+	if (nssos > SIZE_MAX / sizeof(SortRecord)) {
+		return LS_FAILURE;
+	}
+
+	SortRecord *recs = tyrant_alloc(nssos * sizeof(*recs));
+	LSSSOString *copy = tyrant_alloc(nssos * sizeof(*copy));
+	if (!recs || !copy) {
+		tyrant_free(recs);
+		tyrant_free(copy);
+		return LS_FAILURE;
+	}
+
+	for (size_t i = 0; i < nssos; ++i) {
+		recs[i] = (SortRecord){
+			.bytes = ls_sso_get_bytes(&ssos[i]),
+			.len = ssos[i].len,
+			.idx = i
+		};
+	}
+
+	sort_records(recs, nssos);
+
+	// short strings point into `ssos` itself, so it is only rearranged once
+	// every record has been sorted
+	memcpy(copy, ssos, nssos * sizeof(*copy));
+	for (size_t i = 0; i < nssos; ++i) {
+		ssos[i] = copy[recs[i].idx];
+	}
+
+	tyrant_free(recs);
+	tyrant_free(copy);
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_sspan_parallel_sort(LSThreadPool *pool, LSStringSpan *sspans,
+		size_t nsspans)
+{
+	if (!sspans) {
+		return LS_FAILURE;
+	}
+
+	size_t nthreads = ls_thread_pool_get_nthreads(pool);
+	if (nthreads == 1 || nsspans < PARALLEL_SORT_MIN) {
+		return ls_sspan_sort(sspans, nsspans);
+	}
+
+	if (nsspans > SIZE_MAX / 2 / sizeof(SortRecord)) {
+		return LS_FAILURE;
+	}
+
+	size_t max_nsplitters = BUCKETS_PER_THREAD * nthreads - 1;
+
+	ParallelSort sort = {
+		.sspans = sspans,
+		.nsspans = nsspans,
+		.recs = tyrant_alloc(nsspans * sizeof(SortRecord)),
+		.scattered = tyrant_alloc(nsspans * sizeof(SortRecord)),
+		.bucket_idxs = tyrant_alloc(nsspans * sizeof(uint16_t)),
+		.nchunks = nthreads,
+		.chunk_len = (nsspans + nthreads - 1) / nthreads,
+		.splitters = tyrant_alloc(max_nsplitters * sizeof(SortRecord)),
+		.chunk_offsets = tyrant_alloc(nthreads * (2 * max_nsplitters + 1)
+				* sizeof(size_t)),
+		.bucket_offsets = tyrant_alloc((2 * max_nsplitters + 2)
+				* sizeof(size_t))
+	};
+
+	LSStatus status = LS_FAILURE;
+	if (!sort.recs || !sort.scattered || !sort.bucket_idxs
+			|| !sort.splitters || !sort.chunk_offsets
+			|| !sort.bucket_offsets) {
+		goto out;
+	}
+
+	ls_thread_pool_run(pool, sort.nchunks, load_chunk, &sort);
+
+	if (choose_splitters(&sort) != LS_SUCCESS) {
+		goto out;
+	}
+
+	ls_thread_pool_run(pool, sort.nchunks, classify_chunk, &sort);
+
+	// turn the counts into offsets, bucket by bucket
+	size_t offset = 0;
+	for (size_t b = 0; b < sort.nbuckets; ++b) {
+		sort.bucket_offsets[b] = offset;
+		for (size_t c = 0; c < sort.nchunks; ++c) {
+			size_t *count = &sort.chunk_offsets[c * sort.nbuckets + b];
+			size_t chunk_count = *count;
+			*count = offset;
+			offset += chunk_count;
+		}
+	}
+	sort.bucket_offsets[sort.nbuckets] = offset;
+
+	ls_thread_pool_run(pool, sort.nchunks, scatter_chunk, &sort);
+	ls_thread_pool_run(pool, sort.nbuckets, sort_bucket, &sort);
+	ls_thread_pool_run(pool, sort.nchunks, store_chunk, &sort);
+
+	status = LS_SUCCESS;
+
+out:
+	tyrant_free(sort.recs);
+	tyrant_free(sort.scattered);
+	tyrant_free(sort.bucket_idxs);
+	tyrant_free(sort.splitters);
+	tyrant_free(sort.chunk_offsets);
+	tyrant_free(sort.bucket_offsets);
+
+	return status;
+}
+
+// Sorts invalid records (those without bytes) first, then the rest.
+void sort_records(SortRecord *recs, size_t nrecs)
+{
+	size_t ninvalid = 0;
+	for (size_t i = 0; i < nrecs; ++i) {
+		if (!recs[i].bytes) {
+			swap_records(&recs[ninvalid], &recs[i]);
+			ninvalid++;
+		}
+	}
+
+	load_keys(&recs[ninvalid], nrecs - ninvalid, 0);
+	mkqs(&recs[ninvalid], nrecs - ninvalid, 0);
+}
+
+/*
+ * Picks up to `BUCKETS_PER_THREAD * nthreads - 1` distinct splitters, evenly
+ * spaced in a sorted sample of the valid records, and sets up the buckets
+ * around them.
+ */
+LSStatus choose_splitters(ParallelSort *sort)
+{
+	size_t max_nsplitters = BUCKETS_PER_THREAD * sort->nchunks - 1;
+	size_t nsamples = (max_nsplitters + 1) * SAMPLES_PER_BUCKET;
+
+	SortRecord *samples = tyrant_alloc(nsamples * sizeof(*samples));
+	if (!samples) {
+		return LS_FAILURE;
+	}
+
+	// one sample from each stretch of `stride` records, at a pseudo-random
+	// offset so that periodic input can not fool the sampling
+	size_t stride = sort->nsspans / nsamples;
+	uint32_t seed = 1;
+	size_t nvalid = 0;
+	for (size_t i = 0; i < nsamples; ++i) {
+		seed = seed * 1103515245 + 12345;
+		const SortRecord *rec = &sort->recs[i * stride
+				+ (seed >> 8) % stride];
+
+		if (rec->bytes) {
+			samples[nvalid++] = *rec;
+		}
+	}
+
+	sort_records(samples, nvalid);
+
+	sort->nsplitters = 0;
+	for (size_t i = 1; i <= max_nsplitters && nvalid > 0; ++i) {
+		SortRecord splitter = samples[i * nvalid / (max_nsplitters + 1)];
+		splitter.key = load_key(splitter.bytes, splitter.len, 0);
+
+		if (sort->nsplitters > 0 && compare_from(&sort->splitters[
+				sort->nsplitters - 1], &splitter, 0) == 0) {
+			continue;
+		}
+
+		sort->splitters[sort->nsplitters++] = splitter;
+	}
+
+	sort->nbuckets = 2 * sort->nsplitters + 1;
+
+	tyrant_free(samples);
+
+	return LS_SUCCESS;
+}
+
+void load_chunk(void *ctx, size_t chunk_idx)
+{
+	ParallelSort *sort = ctx;
+	size_t start = chunk_idx * sort->chunk_len;
+	size_t end = ls_simd_size_min(start + sort->chunk_len, sort->nsspans);
+
+	for (size_t i = start; i < end; ++i) {
+		const LSStringSpan *sspan = &sort->sspans[i];
+		sort->recs[i] = (SortRecord){
+			.key = sspan->bytes ? load_key(sspan->bytes, sspan->len, 0)
+					: 0,
+			.bytes = sspan->bytes,
+			.len = sspan->len,
+			.idx = i
+		};
+	}
+}
+
+void classify_chunk(void *ctx, size_t chunk_idx)
+{
+	ParallelSort *sort = ctx;
+	size_t start = chunk_idx * sort->chunk_len;
+	size_t end = ls_simd_size_min(start + sort->chunk_len, sort->nsspans);
+	size_t *counts = &sort->chunk_offsets[chunk_idx * sort->nbuckets];
+
+	for (size_t b = 0; b < sort->nbuckets; ++b) {
+		counts[b] = 0;
+	}
+
+	for (size_t i = start; i < end; ++i) {
+		size_t bucket_idx = classify(sort, &sort->recs[i]);
+		sort->bucket_idxs[i] = (uint16_t)bucket_idx;
+		counts[bucket_idx]++;
+	}
+}
+
+void scatter_chunk(void *ctx, size_t chunk_idx)
+{
+	ParallelSort *sort = ctx;
+	size_t start = chunk_idx * sort->chunk_len;
+	size_t end = ls_simd_size_min(start + sort->chunk_len, sort->nsspans);
+	size_t *offsets = &sort->chunk_offsets[chunk_idx * sort->nbuckets];
+
+	for (size_t i = start; i < end; ++i) {
+		sort->scattered[offsets[sort->bucket_idxs[i]]++] = sort->recs[i];
+	}
+}
+
+void sort_bucket(void *ctx, size_t bucket_idx)
+{
+	ParallelSort *sort = ctx;
+
+	// odd buckets hold records equal to a splitter
+	if (bucket_idx % 2 == 1) {
+		return;
+	}
+
+	size_t start = sort->bucket_offsets[bucket_idx];
+	size_t end = sort->bucket_offsets[bucket_idx + 1];
+	sort_records(&sort->scattered[start], end - start);
+}
+
+void store_chunk(void *ctx, size_t chunk_idx)
+{
+	ParallelSort *sort = ctx;
+	size_t start = chunk_idx * sort->chunk_len;
+	size_t end = ls_simd_size_min(start + sort->chunk_len, sort->nsspans);
+
+	for (size_t i = start; i < end; ++i) {
+		const SortRecord *rec = &sort->scattered[i];
+		sort->sspans[i] = rec->bytes
+				? ls_sspan_create(rec->bytes, rec->len)
+				: LS_AN_INVALID_SSPAN;
+	}
+}
+
+/*
+ * Returns `2 * i` for records between splitters `i - 1` and `i`, and `2 * i + 1`
+ * for records equal to splitter `i`. Invalid records go into the first bucket.
+ */
+size_t classify(const ParallelSort *sort, const SortRecord *rec)
+{
+	if (!rec->bytes) {
+		return 0;
+	}
+
+	size_t lo = 0;
+	size_t hi = sort->nsplitters;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		int cmp = compare_from(rec, &sort->splitters[mid], 0);
+		if (cmp < 0) {
+			hi = mid;
+		} else if (cmp > 0) {
+			lo = mid + 1;
+		} else {
+			return 2 * mid + 1;
+		}
+	}
+
+	return 2 * lo;
+}
+
+/*
+ * Sorts `recs` by the bytes of their strings from `depth` onwards, given that
+ * all of them agree on the bytes before `depth` and that their keys hold the
+ * 8 bytes from `depth`.
+ *
+ * Recursion only ever goes into the two smaller of the three partitions, each
+ * of which is at most half of the whole, so the stack stays logarithmic.
+ */
+void mkqs(SortRecord *recs, size_t nrecs, size_t depth)
+{
+	while (nrecs > INSERTION_SORT_MAX) {
+		uint64_t pivot = choose_pivot(recs, nrecs);
+
+		// [0, lt) < pivot, [lt, i) == pivot, (gt, nrecs) > pivot
+		size_t lt = 0;
+		size_t i = 0;
+		size_t gt = nrecs;
+		while (i < gt) {
+			uint64_t key = recs[i].key;
+			if (key < pivot) {
+				swap_records(&recs[lt++], &recs[i++]);
+			} else if (key > pivot) {
+				swap_records(&recs[i], &recs[--gt]);
+			} else {
+				i++;
+			}
+		}
+
+		SortRecord *parts[3] = { recs, &recs[lt], &recs[gt] };
+		size_t lens[3] = { lt, gt - lt, nrecs - gt };
+		size_t largest = lens[1] >= lens[0] && lens[1] >= lens[2] ? 1
+				: lens[0] >= lens[2] ? 0 : 2;
+
+		for (size_t p = 0; p < 3; ++p) {
+			if (p == largest) {
+				continue;
+			}
+
+			if (p == 1) {
+				// equal keys: move on to the next 8 bytes
+				size_t nended = sort_ended(parts[1], lens[1], depth);
+				load_keys(&parts[1][nended], lens[1] - nended,
+						depth + KEY_LEN);
+				mkqs(&parts[1][nended], lens[1] - nended,
+						depth + KEY_LEN);
+			} else {
+				mkqs(parts[p], lens[p], depth);
+			}
+		}
+
+		recs = parts[largest];
+		nrecs = lens[largest];
+		if (largest == 1) {
+			size_t nended = sort_ended(recs, nrecs, depth);
+			recs += nended;
+			nrecs -= nended;
+			depth += KEY_LEN;
+			load_keys(recs, nrecs, depth);
+		}
+	}
+
+	insertion_sort(recs, nrecs, depth);
+}
+
+/*
+ * Given records with equal keys at `depth`, moves those whose strings end
+ * within the key to the front, ordered by length, and returns their number.
+ *
+ * Keys are zero-padded, so a string ending within its key is a prefix of every
+ * longer string with the same key: the ended strings sort first, shortest
+ * first, and strings of the same length among them are equal.
+ */
+size_t sort_ended(SortRecord *recs, size_t nrecs, size_t depth)
+{
+	size_t nended = 0;
+	for (size_t len = depth; len <= depth + KEY_LEN; ++len) {
+		for (size_t i = nended; i < nrecs; ++i) {
+			if (recs[i].len == len) {
+				swap_records(&recs[nended++], &recs[i]);
+			}
+		}
+	}
+
+	return nended;
+}
+
+void insertion_sort(SortRecord *recs, size_t nrecs, size_t depth)
+{
+	for (size_t i = 1; i < nrecs; ++i) {
+		SortRecord rec = recs[i];
+
+		size_t j = i;
+		while (j > 0 && compare_from(&recs[j - 1], &rec, depth) > 0) {
+			recs[j] = recs[j - 1];
+			j--;
+		}
+
+		recs[j] = rec;
+	}
+}
+
+void load_keys(SortRecord *recs, size_t nrecs, size_t depth)
+{
+	for (size_t i = 0; i < nrecs; ++i) {
+		recs[i].key = load_key(recs[i].bytes, recs[i].len, depth);
+	}
+}
+
+/*
+ * Takes Tukey's ninther (the median of three medians of three) of keys spread
+ * over `recs`. The partitioning leaves organ-pipe patterns behind in presorted
+ * input, on which a plain median of three picks poor pivots.
+ */
+uint64_t choose_pivot(const SortRecord *recs, size_t nrecs)
+{
+	size_t step = nrecs / 8;
+
+	uint64_t keys[9];
+	for (size_t i = 0; i < 9; ++i) {
+		keys[i] = recs[i < 8 ? i * step : nrecs - 1].key;
+	}
+
+	return median_of_3(median_of_3(keys[0], keys[1], keys[2]),
+			median_of_3(keys[3], keys[4], keys[5]),
+			median_of_3(keys[6], keys[7], keys[8]));
+}
+
+uint64_t median_of_3(uint64_t a, uint64_t b, uint64_t c)
+{
+	if (a < b) {
+		return b < c ? b : a < c ? c : a;
+	}
+
+	return a < c ? a : b < c ? c : b;
+}
+
+// Compares the strings of `a` and `b` from `depth` on, using the cached keys.
+int compare_from(const SortRecord *a, const SortRecord *b, size_t depth)
+{
+	if (a->key != b->key) {
+		return a->key < b->key ? -1 : 1;
+	}
+
+	// the keys cover everything up to `depth + KEY_LEN` (zero-padded)
+	size_t skip = depth + KEY_LEN;
+	if (a->len <= skip || b->len <= skip) {
+		return (a->len > b->len) - (a->len < b->len);
+	}
+
+	size_t len = ls_simd_size_min(a->len, b->len) - skip;
+	int cmp = memcmp(&a->bytes[skip], &b->bytes[skip], len);
+	if (cmp != 0) {
+		return cmp;
+	}
+
+	return (a->len > b->len) - (a->len < b->len);
+}
+
+/*
+ * Loads the (zero-padded) 8 bytes from `depth` such that comparing keys orders
+ * them like `memcmp()`.
+ */
+uint64_t load_key(const LSByte *bytes, size_t len, size_t depth)
+{
+	if (len <= depth) {
+		return 0;
+	}
+
+	size_t nbytes = ls_simd_size_min(len - depth, KEY_LEN);
+
+	uint64_t key = 0;
+	for (size_t i = 0; i < nbytes; ++i) {
+		key |= (uint64_t)bytes[depth + i] << (8 * (KEY_LEN - 1 - i));
+	}
+
+	return key;
+}
+
+void swap_records(SortRecord *a, SortRecord *b)
+{
+	SortRecord tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
@@ -0,0 +1,233 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tyrant/tyrant.h>
+
+struct LSTemplateInstr {
+	// `NULL` for a slot
+	const LSByte *bytes;
+	// length of the literal, or the slot
+	size_t len_or_slot;
+};
+
+typedef struct LSTemplateInstr Instr;
+
+static size_t count_byte(const LSByte *bytes, size_t len, LSByte byte);
+static size_t find_brace(const LSByte *bytes, size_t len, size_t start);
+static size_t find_name(const LSStringSpan *names, size_t nnames,
+		LSStringSpan name);
+
+LSTemplate ls_template_create(LSStringSpan sspan)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return LS_AN_INVALID_TEMPLATE;
+	}
+
+	/*
+	 * Every placeholder starts with a `{`, so there are at most `nopen` slots
+	 * and `nopen + 1` literals between them.
+	 */
+	size_t nopen = count_byte(sspan.bytes, sspan.len, '{');
+	size_t per_open = 2 * sizeof(Instr) + sizeof(LSStringSpan);
+	if (sspan.len > SIZE_MAX / 2 || nopen >= SIZE_MAX / 2 / per_open) {
+		return LS_AN_INVALID_TEMPLATE;
+	}
+
+	size_t max_instrs = 2 * nopen + 1;
+
+	/*
+	 * One allocation holds the instructions, the names and the bytes they
+	 * point to: unescaped literals, each run merged, and each name once.
+	 */
+	Instr *instrs = tyrant_alloc(max_instrs * sizeof(Instr)
+			+ nopen * sizeof(LSStringSpan) + sspan.len);
+	if (!instrs) {
+		return LS_AN_INVALID_TEMPLATE;
+	}
+
+	LSStringSpan *names = (LSStringSpan *)&instrs[max_instrs];
+	LSByte *copy = (LSByte *)&names[nopen];
+
+	const LSByte *bytes = sspan.bytes;
+	size_t len = sspan.len;
+	size_t ninstrs = 0;
+	size_t nnames = 0;
+	size_t ncopied = 0;
+	size_t run_start = 0;
+	size_t literals_len = 0;
+
+	for (size_t i = 0; i < len; ) {
+		size_t brace = find_brace(bytes, len, i);
+		memcpy(&copy[ncopied], &bytes[i], brace - i);
+		ncopied += brace - i;
+		if (brace == len) {
+			break;
+		}
+
+		// escaped brace
+		if (brace + 1 < len && bytes[brace + 1] == bytes[brace]) {
+			copy[ncopied++] = bytes[brace];
+			i = brace + 2;
+			continue;
+		}
+
+		size_t name_start = brace + 1;
+		size_t name_end = find_brace(bytes, len, name_start);
+		if (bytes[brace] == '}'
+				|| name_end == len
+				|| bytes[name_end] == '{'
+				|| name_end == name_start) {
+			tyrant_free(instrs);
+			return LS_AN_INVALID_TEMPLATE;
+		}
+
+		if (ncopied > run_start) {
+			instrs[ninstrs++] = (Instr){
+				.bytes = &copy[run_start],
+				.len_or_slot = ncopied - run_start,
+			};
+			literals_len += ncopied - run_start;
+		}
+
+		LSStringSpan name = {
+			.len = name_end - name_start,
+			.bytes = &bytes[name_start],
+		};
+		size_t slot = find_name(names, nnames, name);
+		if (slot == SIZE_MAX) {
+			memcpy(&copy[ncopied], name.bytes, name.len);
+			names[nnames] = (LSStringSpan){
+				.len = name.len,
+				.bytes = &copy[ncopied],
+			};
+			ncopied += name.len;
+			slot = nnames++;
+		}
+
+		instrs[ninstrs++] = (Instr){ .bytes = NULL, .len_or_slot = slot };
+		run_start = ncopied;
+		i = name_end + 1;
+	}
+
+	if (ncopied > run_start) {
+		instrs[ninstrs++] = (Instr){
+			.bytes = &copy[run_start],
+			.len_or_slot = ncopied - run_start,
+		};
+		literals_len += ncopied - run_start;
+	}
+
+	return (LSTemplate){
+		.nslots = nnames,
+		._ninstrs = ninstrs,
+		._literals_len = literals_len,
+		._instrs = instrs,
+		._names = names,
+	};
+}
+
+void ls_template_destroy(LSTemplate *tmpl)
+{
+	tyrant_free(tmpl->_instrs);
+}
+
+size_t ls_template_get_slot(const LSTemplate *tmpl, LSStringSpan name)
+{
+	if (!ls_template_is_valid(*tmpl) || !ls_sspan_is_valid(name)) {
+		return SIZE_MAX;
+	}
+
+	return find_name(tmpl->_names, tmpl->nslots, name);
+}
+
+LSStatus ls_template_render(const LSTemplate *tmpl, const LSStringSpan *values,
+		size_t nvalues, LSByteBuffer *bbuf)
+{
+	if (!ls_template_is_valid(*tmpl)
+			|| !ls_bbuf_is_valid(*bbuf)
+			|| nvalues < tmpl->nslots
+			|| (!values && nvalues != 0)) {
+		return LS_FAILURE;
+	}
+
+	for (size_t i = 0; i < tmpl->nslots; ++i) {
+		if (!ls_sspan_is_valid(values[i])) {
+			return LS_FAILURE;
+		}
+	}
+
+	const Instr *instrs = tmpl->_instrs;
+	size_t ninstrs = tmpl->_ninstrs;
+
+	size_t len = tmpl->_literals_len;
+	for (size_t i = 0; i < ninstrs; ++i) {
+		if (instrs[i].bytes) {
+			continue;
+		}
+
+		size_t value_len = values[instrs[i].len_or_slot].len;
+		if (value_len > SIZE_MAX - len) {
+			return LS_FAILURE;
+		}
+		len += value_len;
+	}
+
+	if (ls_bbuf_reserve(bbuf, len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	for (size_t i = 0; i < ninstrs; ++i) {
+		LSStringSpan piece = instrs[i].bytes
+				? (LSStringSpan){
+					.len = instrs[i].len_or_slot,
+					.bytes = instrs[i].bytes,
+				}
+				: values[instrs[i].len_or_slot];
+		memcpy(dest, piece.bytes, piece.len);
+		dest += piece.len;
+	}
+
+	bbuf->len += len;
+
+	return LS_SUCCESS;
+}
+
+size_t count_byte(const LSByte *bytes, size_t len, LSByte byte)
+{
+	size_t count = 0;
+
+	const LSByte *end = &bytes[len];
+	for (const LSByte *p = bytes;
+			(p = memchr(p, byte, (size_t)(end - p))) != NULL;
+			++p) {
+		++count;
+	}
+
+	return count;
+}
+
+size_t find_brace(const LSByte *bytes, size_t len, size_t start)
+{
+	size_t i = start;
+	while (i < len && bytes[i] != '{' && bytes[i] != '}') {
+		++i;
+	}
+
+	return i;
+}
+
+size_t find_name(const LSStringSpan *names, size_t nnames, LSStringSpan name)
+{
+	for (size_t i = 0; i < nnames; ++i) {
+		if (ls_sspan_equals(names[i], name)) {
+			return i;
+		}
+	}
+
+	return SIZE_MAX;
+}
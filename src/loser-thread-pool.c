@@ -0,0 +1,534 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "loser-thread-pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <tyrant/tyrant.h>
+
+#include "loser-simd.h"
+
+/*
+ * Every batch is a range of indices, cut into subranges which the threads run
+ * through a callback. Each thread starts with an equal share of the range in
+ * its own deque. It keeps halving the subrange it is about to run, pushing the
+ * upper halves back onto its deque, until the subrange is no longer than the
+ * batch's grain. Threads run subranges from the bottom of their own deques and,
+ * once those are empty, steal from the top of the others' (where the biggest
+ * subranges are).
+ */
+enum {
+	// halving from `SIZE_MAX` never needs more
+	DEQUE_CAP = 64,
+
+	// `ls_parallel_for_spans()` aims for subranges taking about this long
+	TARGET_CHUNK_NS = 50 * 1000,
+	// and times at least this much of the work up front to get there
+	MIN_PROBE_NS = 10 * 1000,
+	MIN_PROBE_LEN = 16,
+	// subranges per thread, at least, to leave something to steal
+	MIN_CHUNKS_PER_THREAD = 4
+};
+
+typedef void (*RangeFn)(void *ctx, size_t start, size_t end);
+
+typedef struct Range {
+	size_t start;
+	size_t end;
+} Range;
+
+/*
+ * A fixed-capacity deque of ranges. The owner pushes and pops at the bottom,
+ * thieves take from the top.
+ */
+typedef struct Deque {
+	pthread_mutex_t mutex;
+	Range ranges[DEQUE_CAP];
+	size_t top;
+	size_t bottom;
+} Deque;
+
+typedef struct Participant {
+	LSThreadPool *pool;
+	size_t idx;
+	pthread_t thread;
+	Deque deque;
+} Participant;
+
+struct LSThreadPool {
+	// `participants[0]` stands for the thread using the pool
+	Participant *participants;
+	size_t nthreads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t batch_ready;
+	pthread_cond_t batch_done;
+	// signalled when ranges are pushed while threads are idle, and when the
+	// batch is done
+	pthread_cond_t work_ready;
+
+	// the current batch (bumping `generation` wakes the threads for it)
+	RangeFn fn;
+	void *ctx;
+	size_t grain;
+	// atomic; the mutex is only taken once it drops to `0`
+	size_t nremaining;
+	size_t nbusy;
+	// atomic; bumped after every push of split-off ranges
+	uint64_t npushes;
+	// the threads waiting on `work_ready`, read atomically by pushers
+	size_t nidle;
+	uint64_t generation;
+	bool shutdown;
+};
+
+typedef struct TaskBatch {
+	LSTaskFn fn;
+	void *ctx;
+} TaskBatch;
+
+typedef struct SpansBatch {
+	const LSStringSpan *sspans;
+	// the index in `sspans` of index `0` of the batch
+	size_t offset;
+	LSSpansFn fn;
+	void *ctx;
+} SpansBatch;
+
+static void run_batch(LSThreadPool *pool, size_t len, size_t grain,
+		RangeFn fn, void *ctx);
+static void *thread_main(void *arg);
+static void participate(LSThreadPool *pool, size_t self, RangeFn fn,
+		void *ctx, size_t grain);
+static bool wait_for_work(LSThreadPool *pool, uint64_t npushes);
+static bool steal(LSThreadPool *pool, size_t self, Range *range);
+static size_t tune_grain(size_t nthreads, size_t len, double ns_per_elem);
+static void run_tasks(void *ctx, size_t start, size_t end);
+static void run_spans(void *ctx, size_t start, size_t end);
+
+static void deque_init(Deque *deque);
+static void deque_destroy(Deque *deque);
+static bool deque_push(Deque *deque, Range range);
+static bool deque_pop(Deque *deque, Range *range);
+static bool deque_steal(Deque *deque, Range *range);
+
+static double now_ns(void);
+
+LSThreadPool *ls_thread_pool_create(size_t nthreads)
+{
+	if (nthreads == 0 || nthreads > LS_THREAD_POOL_MAX_THREADS) {
+		return NULL;
+	}
+
+	LSThreadPool *pool = tyrant_alloc(sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+
+	*pool = (LSThreadPool){
+		.participants = tyrant_alloc(nthreads * sizeof(Participant)),
+		.nthreads = 1,
+		.shutdown = false
+	};
+	if (!pool->participants) {
+		tyrant_free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->batch_ready, NULL);
+	pthread_cond_init(&pool->batch_done, NULL);
+	pthread_cond_init(&pool->work_ready, NULL);
+
+	for (size_t i = 0; i < nthreads; ++i) {
+		pool->participants[i].pool = pool;
+		pool->participants[i].idx = i;
+		deque_init(&pool->participants[i].deque);
+	}
+
+	for (size_t i = 1; i < nthreads; ++i) {
+		Participant *participant = &pool->participants[i];
+		if (pthread_create(&participant->thread, NULL, thread_main,
+				participant) != 0) {
+			// the deques past the spawned threads still need destroying
+			for (size_t j = i + 1; j < nthreads; ++j) {
+				deque_destroy(&pool->participants[j].deque);
+			}
+			deque_destroy(&participant->deque);
+
+			ls_thread_pool_destroy(pool);
+			return NULL;
+		}
+		pool->nthreads++;
+	}
+
+	return pool;
+}
+
+void ls_thread_pool_destroy(LSThreadPool *pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->shutdown = true;
+	pthread_cond_broadcast(&pool->batch_ready);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (size_t i = 1; i < pool->nthreads; ++i) {
+		pthread_join(pool->participants[i].thread, NULL);
+	}
+
+	for (size_t i = 0; i < pool->nthreads; ++i) {
+		deque_destroy(&pool->participants[i].deque);
+	}
+
+	pthread_cond_destroy(&pool->work_ready);
+	pthread_cond_destroy(&pool->batch_done);
+	pthread_cond_destroy(&pool->batch_ready);
+	pthread_mutex_destroy(&pool->mutex);
+
+	tyrant_free(pool->participants);
+	tyrant_free(pool);
+}
+
+size_t ls_thread_pool_get_nthreads(const LSThreadPool *pool)
+{
+	return pool->nthreads;
+}
+
+void ls_thread_pool_run(LSThreadPool *pool, size_t ntasks, LSTaskFn fn,
+		void *ctx)
+{
+	TaskBatch batch = { .fn = fn, .ctx = ctx };
+	run_batch(pool, ntasks, 1, run_tasks, &batch);
+}
+
+void ls_parallel_for_spans(LSThreadPool *pool, const LSStringSpan *sspans,
+		size_t nsspans, LSSpansFn fn, void *ctx)
+{
+	// time growing prefixes of the work to estimate its cost per span
+	size_t nprobed = 0;
+	size_t probe_len = MIN_PROBE_LEN;
+	double start_ns = now_ns();
+	double elapsed_ns = 0;
+	while (nprobed < nsspans && elapsed_ns < MIN_PROBE_NS) {
+		size_t len = ls_simd_size_min(probe_len, nsspans - nprobed);
+		fn(ctx, &sspans[nprobed], len, nprobed);
+
+		nprobed += len;
+		probe_len *= 2;
+		elapsed_ns = now_ns() - start_ns;
+	}
+
+	size_t nrest = nsspans - nprobed;
+	if (nrest == 0) {
+		return;
+	}
+
+	double ns_per_span = elapsed_ns / (double)nprobed;
+	SpansBatch batch = {
+		.sspans = sspans,
+		.offset = nprobed,
+		.fn = fn,
+		.ctx = ctx
+	};
+
+	// the rest is too little to be worth waking the threads for
+	if (pool->nthreads == 1
+			|| ns_per_span * (double)nrest < TARGET_CHUNK_NS) {
+		run_spans(&batch, 0, nrest);
+		return;
+	}
+
+	size_t grain = tune_grain(pool->nthreads, nrest, ns_per_span);
+	run_batch(pool, nrest, grain, run_spans, &batch);
+}
+
+/*
+ * Runs `fn` over subranges of `0`..`len` no longer than `grain` (but for deque
+ * overflow), on all threads of `pool`, and waits until every thread is done
+ * with the batch.
+ */
+void run_batch(LSThreadPool *pool, size_t len, size_t grain, RangeFn fn,
+		void *ctx)
+{
+	if (len == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->fn = fn;
+	pool->ctx = ctx;
+	pool->grain = grain;
+	__atomic_store_n(&pool->nremaining, len, __ATOMIC_RELAXED);
+
+	// the deques are all empty between batches
+	size_t nthreads = pool->nthreads;
+	for (size_t i = 0; i < nthreads; ++i) {
+		Range share = {
+			.start = len / nthreads * i + ls_simd_size_min(i, len % nthreads),
+			.end = len / nthreads * (i + 1)
+					+ ls_simd_size_min(i + 1, len % nthreads)
+		};
+
+		if (share.start < share.end) {
+			Deque *deque = &pool->participants[i].deque;
+			pthread_mutex_lock(&deque->mutex);
+			deque_push(deque, share);
+			pthread_mutex_unlock(&deque->mutex);
+		}
+	}
+
+	pool->generation++;
+	pthread_cond_broadcast(&pool->batch_ready);
+	pthread_mutex_unlock(&pool->mutex);
+
+	participate(pool, 0, fn, ctx, grain);
+
+	// no thread may still be looking at `ctx` (or the deques) on return
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->nbusy > 0) {
+		pthread_cond_wait(&pool->batch_done, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+void *thread_main(void *arg)
+{
+	Participant *participant = arg;
+	LSThreadPool *pool = participant->pool;
+	uint64_t seen_generation = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+	for (;;) {
+		while (pool->generation == seen_generation && !pool->shutdown) {
+			pthread_cond_wait(&pool->batch_ready, &pool->mutex);
+		}
+		if (pool->shutdown) {
+			break;
+		}
+
+		// a batch may already be over by the time a thread wakes for it
+		seen_generation = pool->generation;
+		if (__atomic_load_n(&pool->nremaining, __ATOMIC_ACQUIRE) == 0) {
+			continue;
+		}
+
+		RangeFn fn = pool->fn;
+		void *ctx = pool->ctx;
+		size_t grain = pool->grain;
+		pool->nbusy++;
+		pthread_mutex_unlock(&pool->mutex);
+
+		participate(pool, participant->idx, fn, ctx, grain);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->nbusy == 0) {
+			pthread_cond_signal(&pool->batch_done);
+		}
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+// Runs and steals subranges of the current batch until all of it is done.
+void participate(LSThreadPool *pool, size_t self, RangeFn fn, void *ctx,
+		size_t grain)
+{
+	Deque *deque = &pool->participants[self].deque;
+
+	for (;;) {
+		Range range;
+
+		// taken before looking, so that no push after the look goes unnoticed
+		uint64_t npushes = __atomic_load_n(&pool->npushes, __ATOMIC_SEQ_CST);
+
+		pthread_mutex_lock(&deque->mutex);
+		bool popped = deque_pop(deque, &range);
+		pthread_mutex_unlock(&deque->mutex);
+
+		if (!popped && !steal(pool, self, &range)) {
+			if (!wait_for_work(pool, npushes)) {
+				return;
+			}
+			continue;
+		}
+
+		bool pushed = false;
+		pthread_mutex_lock(&deque->mutex);
+		while (range.end - range.start > grain) {
+			size_t mid = range.start + (range.end - range.start) / 2;
+			if (!deque_push(deque, (Range){ mid, range.end })) {
+				break;
+			}
+			range.end = mid;
+			pushed = true;
+		}
+		pthread_mutex_unlock(&deque->mutex);
+
+		if (pushed) {
+			__atomic_add_fetch(&pool->npushes, 1, __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&pool->nidle, __ATOMIC_SEQ_CST) > 0) {
+				pthread_mutex_lock(&pool->mutex);
+				pthread_cond_broadcast(&pool->work_ready);
+				pthread_mutex_unlock(&pool->mutex);
+			}
+		}
+
+		fn(ctx, range.start, range.end);
+
+		if (__atomic_sub_fetch(&pool->nremaining, range.end - range.start,
+				__ATOMIC_ACQ_REL) == 0) {
+			pthread_mutex_lock(&pool->mutex);
+			pthread_cond_broadcast(&pool->work_ready);
+			pthread_mutex_unlock(&pool->mutex);
+		}
+	}
+}
+
+/*
+ * Blocks until ranges are pushed after `npushes` was read, or the batch is done
+ * (the last subranges may still be running elsewhere after a failed steal).
+ * Returns `false` if the batch is done.
+ */
+bool wait_for_work(LSThreadPool *pool, uint64_t npushes)
+{
+	pthread_mutex_lock(&pool->mutex);
+	__atomic_add_fetch(&pool->nidle, 1, __ATOMIC_SEQ_CST);
+
+	bool done;
+	for (;;) {
+		done = __atomic_load_n(&pool->nremaining, __ATOMIC_ACQUIRE) == 0;
+		if (done
+				|| __atomic_load_n(&pool->npushes, __ATOMIC_SEQ_CST)
+				!= npushes) {
+			break;
+		}
+
+		pthread_cond_wait(&pool->work_ready, &pool->mutex);
+	}
+
+	__atomic_sub_fetch(&pool->nidle, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&pool->mutex);
+
+	return !done;
+}
+
+// Tries the other threads' deques in turn, starting from the next thread.
+bool steal(LSThreadPool *pool, size_t self, Range *range)
+{
+	for (size_t i = 1; i < pool->nthreads; ++i) {
+		Deque *victim = &pool->participants[(self + i) % pool->nthreads]
+				.deque;
+
+		pthread_mutex_lock(&victim->mutex);
+		bool stolen = deque_steal(victim, range);
+		pthread_mutex_unlock(&victim->mutex);
+
+		if (stolen) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Picks a grain of about `TARGET_CHUNK_NS` worth of work, so that the cost of
+ * splitting and stealing is noise, but small enough that every thread gets
+ * several subranges to balance the load with.
+ */
+size_t tune_grain(size_t nthreads, size_t len, double ns_per_elem)
+{
+	double target = ns_per_elem > 0 ? TARGET_CHUNK_NS / ns_per_elem : len;
+	size_t grain = target < (double)len ? (size_t)target : len;
+
+	size_t max_grain = len / (nthreads * MIN_CHUNKS_PER_THREAD);
+	if (grain > max_grain) {
+		grain = max_grain;
+	}
+
+	return grain > 0 ? grain : 1;
+}
+
+void run_tasks(void *ctx, size_t start, size_t end)
+{
+	TaskBatch *batch = ctx;
+
+	for (size_t i = start; i < end; ++i) {
+		batch->fn(batch->ctx, i);
+	}
+}
+
+void run_spans(void *ctx, size_t start, size_t end)
+{
+	SpansBatch *batch = ctx;
+	size_t first_idx = batch->offset + start;
+
+	batch->fn(batch->ctx, &batch->sspans[first_idx], end - start, first_idx);
+}
+
+void deque_init(Deque *deque)
+{
+	pthread_mutex_init(&deque->mutex, NULL);
+	deque->top = 0;
+	deque->bottom = 0;
+}
+
+void deque_destroy(Deque *deque)
+{
+	pthread_mutex_destroy(&deque->mutex);
+}
+
+// Fails if the deque is full.
+bool deque_push(Deque *deque, Range range)
+{
+	if (deque->bottom == DEQUE_CAP) {
+		return false;
+	}
+
+	deque->ranges[deque->bottom++] = range;
+
+	return true;
+}
+
+bool deque_pop(Deque *deque, Range *range)
+{
+	if (deque->top == deque->bottom) {
+		return false;
+	}
+
+	*range = deque->ranges[--deque->bottom];
+	if (deque->top == deque->bottom) {
+		deque->top = 0;
+		deque->bottom = 0;
+	}
+
+	return true;
+}
+
+bool deque_steal(Deque *deque, Range *range)
+{
+	if (deque->top == deque->bottom) {
+		return false;
+	}
+
+	*range = deque->ranges[deque->top++];
+	if (deque->top == deque->bottom) {
+		deque->top = 0;
+		deque->bottom = 0;
+	}
+
+	return true;
+}
+
+double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
@@ -0,0 +1,829 @@
+#include "loser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tyrant/tyrant.h>
+
+#include "loser-escape.h"
+#include "loser-simd.h"
+
+typedef bool (*ValidateFn)(const LSByte *src, LSByte *dest, size_t len);
+typedef bool (*IsAsciiFn)(const LSByte *bytes, size_t len);
+typedef size_t (*CountFn)(const LSByte *bytes, size_t len);
+
+static ValidateFn resolve_validate_utf8(void);
+static IsAsciiFn resolve_is_ascii(void);
+static CountFn resolve_count_code_points(void);
+static CountFn resolve_count_utf16_units(void);
+
+LS_DISPATCH(bool, validate_utf8, (const LSByte *src, LSByte *dest, size_t len),
+		(src, dest, len), resolve_validate_utf8)
+LS_DISPATCH(bool, is_ascii, (const LSByte *bytes, size_t len),
+		(bytes, len), resolve_is_ascii)
+LS_DISPATCH(size_t, count_code_points, (const LSByte *bytes, size_t len),
+		(bytes, len), resolve_count_code_points)
+LS_DISPATCH(size_t, count_utf16_units, (const LSByte *bytes, size_t len),
+		(bytes, len), resolve_count_utf16_units)
+
+enum {
+	// code points between consecutive offsets stored in an `LSUtf8Index`
+	INDEX_STRIDE = 64
+};
+
+static size_t decode_one(const LSByte *bytes, size_t len, uint32_t *cp);
+static bool validate_utf8_scalar(const LSByte *src, LSByte *dest, size_t len);
+static bool is_ascii_scalar(const LSByte *bytes, size_t len);
+static size_t count_code_points_scalar(const LSByte *bytes, size_t len);
+static size_t count_utf16_units_scalar(const LSByte *bytes, size_t len);
+static size_t popcount_high_bits(uint64_t word);
+
+#ifdef LS_SIMD_X86
+static bool validate_utf8_avx2(const LSByte *src, LSByte *dest, size_t len);
+static bool is_ascii_avx2(const LSByte *bytes, size_t len);
+static size_t count_code_points_avx2(const LSByte *bytes, size_t len);
+static size_t count_utf16_units_avx2(const LSByte *bytes, size_t len);
+#endif
+
+bool ls_sspan_is_valid_utf8(LSStringSpan sspan)
+{
+	return ls_sspan_is_valid(sspan)
+			&& validate_utf8(sspan.bytes, NULL, sspan.len);
+}
+
+bool ls_sspan_is_ascii(LSStringSpan sspan)
+{
+	return ls_sspan_is_valid(sspan)
+			&& is_ascii(sspan.bytes, sspan.len);
+}
+
+LSString ls_string_create_utf8(const LSByte *bytes, size_t len)
+{
+	if (!bytes || len == SIZE_MAX) {
+		return LS_AN_INVALID_STRING;
+	}
+
+	if (len == 0) {
+		return LS_EMPTY_STRING;
+	}
+
+	LSByte *bytes_cpy = tyrant_alloc(ls_simd_padded_size(len + 1));
+	if (!bytes_cpy) {
+		return LS_AN_INVALID_STRING;
+	}
+
+	if (!validate_utf8(bytes, bytes_cpy, len)) {
+		tyrant_free(bytes_cpy);
+		return LS_AN_INVALID_STRING;
+	}
+
+	bytes_cpy[len] = '\0';
+
+	return (LSString){
+		.len = len,
+		.bytes = bytes_cpy
+	};
+}
+
+LSSSOString ls_sso_create_utf8(const LSByte *bytes, size_t len)
+{
+	if (len > LS_SHORT_STRING_MAX_LEN) {
+		LSString string = ls_string_create_utf8(bytes, len);
+		if (!ls_string_is_valid(string)) {
+			return LS_AN_INVALID_SSO;
+		}
+
+		return (LSSSOString){ ._long = string };
+	}
+
+	if (!bytes || !validate_utf8(bytes, NULL, len)) {
+		return LS_AN_INVALID_SSO;
+	}
+
+	return ls_sso_create(bytes, len);
+}
+
+size_t ls_sspan_utf8_count(LSStringSpan sspan)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return 0;
+	}
+
+	return count_code_points(sspan.bytes, sspan.len);
+}
+
+size_t ls_sspan_utf16_len(LSStringSpan sspan)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return 0;
+	}
+
+	return count_utf16_units(sspan.bytes, sspan.len);
+}
+
+LSUtf8Index ls_utf8_index_create(LSStringSpan sspan)
+{
+	if (!ls_sspan_is_valid(sspan)) {
+		return LS_AN_INVALID_UTF8_INDEX;
+	}
+
+	size_t ncode_points = count_code_points(sspan.bytes, sspan.len);
+	size_t noffsets = (ncode_points + INDEX_STRIDE - 1) / INDEX_STRIDE;
+
+	// allocate at least one offset so that an empty index is still valid
+	size_t *offsets = tyrant_alloc((noffsets + 1) * sizeof(size_t));
+	if (!offsets) {
+		return LS_AN_INVALID_UTF8_INDEX;
+	}
+
+	/*
+	 * Offsets are at least `INDEX_STRIDE` bytes apart, so each chunk holds at
+	 * most one of them. Only those chunks need to be scanned byte-by-byte.
+	 */
+	size_t noffsets_found = 0;
+	size_t nseen = 0;
+	for (size_t start = 0; noffsets_found < noffsets; start += INDEX_STRIDE) {
+		size_t chunk_len = sspan.len - start < INDEX_STRIDE
+				? sspan.len - start
+				: INDEX_STRIDE;
+		const LSByte *chunk = &sspan.bytes[start];
+
+		size_t next_offset_cp = noffsets_found * INDEX_STRIDE;
+		size_t nchunk = count_code_points(chunk, chunk_len);
+		if (nseen + nchunk <= next_offset_cp) {
+			nseen += nchunk;
+			continue;
+		}
+
+		for (size_t i = 0; i < chunk_len; ++i) {
+			if ((chunk[i] & 0xc0) == 0x80) {
+				continue;
+			}
+
+			if (nseen == next_offset_cp) {
+				offsets[noffsets_found++] = start + i;
+			}
+			nseen++;
+		}
+	}
+
+	return (LSUtf8Index){
+		.ncode_points = ncode_points,
+		._offsets = offsets
+	};
+}
+
+void ls_utf8_index_destroy(LSUtf8Index *index)
+{
+	tyrant_free(index->_offsets);
+}
+
+size_t ls_utf8_index_get_offset(const LSUtf8Index *index, LSStringSpan sspan,
+		size_t cp_idx)
+{
+	if (!ls_utf8_index_is_valid(*index)
+			|| !ls_sspan_is_valid(sspan)
+			|| cp_idx > index->ncode_points) {
+		return SIZE_MAX;
+	}
+
+	if (cp_idx == index->ncode_points) {
+		return sspan.len;
+	}
+
+	size_t offset = index->_offsets[cp_idx / INDEX_STRIDE];
+	for (size_t nskip = cp_idx % INDEX_STRIDE; nskip > 0; --nskip) {
+		do {
+			offset++;
+		} while ((sspan.bytes[offset] & 0xc0) == 0x80);
+	}
+
+	return offset;
+}
+
+LSStatus ls_sspan_to_utf16(LSStringSpan sspan, uint16_t *units, size_t cap,
+		size_t *nunits)
+{
+	if (!ls_sspan_is_valid(sspan) || !units) {
+		return LS_FAILURE;
+	}
+
+	const LSByte *bytes = sspan.bytes;
+	size_t len = sspan.len;
+
+	size_t i = 0;
+	size_t n = 0;
+	while (i < len) {
+#ifdef __SSE2__
+		// widen runs of ASCII 16 bytes at a time
+		if (len - i >= 16 && cap - n >= 16) {
+			__m128i block = _mm_loadu_si128((const __m128i *)&bytes[i]);
+			if (_mm_movemask_epi8(block) == 0) {
+				__m128i zero = _mm_setzero_si128();
+				_mm_storeu_si128((__m128i *)&units[n],
+						_mm_unpacklo_epi8(block, zero));
+				_mm_storeu_si128((__m128i *)&units[n + 8],
+						_mm_unpackhi_epi8(block, zero));
+
+				i += 16;
+				n += 16;
+				continue;
+			}
+		}
+#endif
+
+		uint32_t cp;
+		size_t seq_len = decode_one(&bytes[i], len - i, &cp);
+		if (seq_len == 0) {
+			return LS_FAILURE;
+		}
+
+		if (cp < 0x10000) {
+			if (n == cap) {
+				return LS_FAILURE;
+			}
+
+			units[n++] = cp;
+		} else {
+			if (cap - n < 2) {
+				return LS_FAILURE;
+			}
+
+			cp -= 0x10000;
+			units[n++] = 0xd800 | (cp >> 10);
+			units[n++] = 0xdc00 | (cp & 0x3ff);
+		}
+
+		i += seq_len;
+	}
+
+	*nunits = n;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_bbuf_append_from_utf16(LSByteBuffer *bbuf, const uint16_t *units,
+		size_t nunits)
+{
+	if (!ls_bbuf_is_valid(*bbuf) || !units) {
+		return LS_FAILURE;
+	}
+
+	// measure (and validate) first so that we only have to reserve once
+	size_t len = 0;
+	for (size_t i = 0; i < nunits; ++i) {
+		uint16_t unit = units[i];
+
+		if (unit < 0x80) {
+			len += 1;
+		} else if (unit < 0x800) {
+			len += 2;
+		} else if (unit >= 0xd800 && unit <= 0xdbff) {
+			if (i + 1 == nunits
+					|| units[i + 1] < 0xdc00
+					|| units[i + 1] > 0xdfff) {
+				return LS_FAILURE; // unpaired high surrogate
+			}
+
+			len += 4;
+			i++;
+		} else if (unit >= 0xdc00 && unit <= 0xdfff) {
+			return LS_FAILURE; // unpaired low surrogate
+		} else {
+			len += 3;
+		}
+	}
+
+	if (ls_bbuf_reserve(bbuf, len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+
+	size_t i = 0;
+	while (i < nunits) {
+#ifdef __SSE2__
+		// narrow runs of ASCII 8 units at a time
+		if (nunits - i >= 8) {
+			__m128i block = _mm_loadu_si128((const __m128i *)&units[i]);
+			__m128i non_ascii = _mm_and_si128(block,
+					_mm_set1_epi16((short)0xff80));
+			__m128i is_ascii = _mm_cmpeq_epi16(non_ascii,
+					_mm_setzero_si128());
+			if (_mm_movemask_epi8(is_ascii) == 0xffff) {
+				_mm_storel_epi64((__m128i *)dest,
+						_mm_packus_epi16(block, block));
+
+				i += 8;
+				dest += 8;
+				continue;
+			}
+		}
+#endif
+
+		uint32_t cp = units[i++];
+		if (cp >= 0xd800 && cp <= 0xdbff) {
+			cp = 0x10000 + ((cp - 0xd800) << 10) + (units[i++] - 0xdc00);
+		}
+
+		dest += ls_escape_encode_utf8(dest, cp);
+	}
+
+	bbuf->len += len;
+
+	return LS_SUCCESS;
+}
+
+ValidateFn resolve_validate_utf8(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return validate_utf8_avx2;
+	}
+#endif
+
+	return validate_utf8_scalar;
+}
+
+IsAsciiFn resolve_is_ascii(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return is_ascii_avx2;
+	}
+#endif
+
+	return is_ascii_scalar;
+}
+
+CountFn resolve_count_code_points(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return count_code_points_avx2;
+	}
+#endif
+
+	return count_code_points_scalar;
+}
+
+CountFn resolve_count_utf16_units(void)
+{
+#ifdef LS_SIMD_X86
+	if (ls_simd_has_avx2()) {
+		return count_utf16_units_avx2;
+	}
+#endif
+
+	return count_utf16_units_scalar;
+}
+
+/*
+ * Decodes the sequence at the start of `bytes` according to Table 3-7 of the
+ * Unicode Standard. Returns its length, or `0` if it is ill-formed.
+ */
+size_t decode_one(const LSByte *bytes, size_t len, uint32_t *cp)
+{
+	LSByte lead = bytes[0];
+	if (lead < 0x80) {
+		*cp = lead;
+		return 1;
+	}
+
+	size_t seq_len;
+	uint32_t value;
+	LSByte min = 0x80;
+	LSByte max = 0xbf;
+
+	if (lead < 0xc2) {
+		return 0; // continuation or overlong 2-byte lead
+	} else if (lead < 0xe0) {
+		seq_len = 2;
+		value = lead & 0x1f;
+	} else if (lead < 0xf0) {
+		seq_len = 3;
+		value = lead & 0x0f;
+		if (lead == 0xe0) {
+			min = 0xa0; // overlong
+		} else if (lead == 0xed) {
+			max = 0x9f; // surrogate
+		}
+	} else if (lead < 0xf5) {
+		seq_len = 4;
+		value = lead & 0x07;
+		if (lead == 0xf0) {
+			min = 0x90; // overlong
+		} else if (lead == 0xf4) {
+			max = 0x8f; // above U+10FFFF
+		}
+	} else {
+		return 0;
+	}
+
+	if (len < seq_len || bytes[1] < min || bytes[1] > max) {
+		return 0;
+	}
+
+	value = (value << 6) | (bytes[1] & 0x3f);
+	for (size_t i = 2; i < seq_len; ++i) {
+		if ((bytes[i] & 0xc0) != 0x80) {
+			return 0;
+		}
+
+		value = (value << 6) | (bytes[i] & 0x3f);
+	}
+
+	*cp = value;
+
+	return seq_len;
+}
+
+// Validates `src`, copying it to `dest` along the way (unless `dest` is `NULL`).
+bool validate_utf8_scalar(const LSByte *src, LSByte *dest, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		// skip over runs of ASCII a word at a time
+		if (len - i >= 8
+				&& (ls_simd_load_u64(&src[i]) & 0x8080808080808080) == 0) {
+			if (dest) {
+				memcpy(&dest[i], &src[i], 8);
+			}
+			i += 8;
+			continue;
+		}
+
+		uint32_t cp;
+		size_t seq_len = decode_one(&src[i], len - i, &cp);
+		if (seq_len == 0) {
+			return false;
+		}
+
+		if (dest) {
+			memcpy(&dest[i], &src[i], seq_len);
+		}
+		i += seq_len;
+	}
+
+	return true;
+}
+
+bool is_ascii_scalar(const LSByte *bytes, size_t len)
+{
+	uint64_t acc = 0;
+
+	size_t i = 0;
+	for (; len - i >= 8; i += 8) {
+		acc |= ls_simd_load_u64(&bytes[i]);
+	}
+
+	LSByte tail = 0;
+	for (; i < len; ++i) {
+		tail |= bytes[i];
+	}
+
+	return ((acc & 0x8080808080808080) | (tail & 0x80)) == 0;
+}
+
+size_t count_code_points_scalar(const LSByte *bytes, size_t len)
+{
+	size_t count = 0;
+
+	size_t i = 0;
+	for (; len - i >= 8; i += 8) {
+		uint64_t word = ls_simd_load_u64(&bytes[i]);
+		uint64_t is_cont = word & ~(word << 1); // 10______
+
+		count += 8 - popcount_high_bits(is_cont);
+	}
+
+	for (; i < len; ++i) {
+		count += (bytes[i] & 0xc0) != 0x80;
+	}
+
+	return count;
+}
+
+// A 4-byte sequence needs a surrogate pair, i.e. one extra unit.
+size_t count_utf16_units_scalar(const LSByte *bytes, size_t len)
+{
+	size_t count = count_code_points_scalar(bytes, len);
+
+	size_t i = 0;
+	for (; len - i >= 8; i += 8) {
+		uint64_t word = ls_simd_load_u64(&bytes[i]);
+		uint64_t is_4_lead = word & (word << 1) & (word << 2) & (word << 3);
+
+		count += popcount_high_bits(is_4_lead);
+	}
+
+	for (; i < len; ++i) {
+		count += bytes[i] >= 0xf0;
+	}
+
+	return count;
+}
+
+// Counts the bytes of `word` which have their high bit set.
+size_t popcount_high_bits(uint64_t word)
+{
+	uint64_t ones = (word >> 7) & 0x0101010101010101;
+
+	return (ones * 0x0101010101010101) >> 56;
+}
+
+#ifdef LS_SIMD_X86
+
+/*
+ * The lookup-table algorithm of Keiser and Lemire ("Validating UTF-8 In Less
+ * Than One Instruction Per Byte", 2021).
+ *
+ * Every pair of adjacent bytes is classified by three 16-entry tables indexed
+ * by the high nibble of the first byte, the low nibble of the first byte and
+ * the high nibble of the second byte. Each table entry is a set of error
+ * bits; an error is present wherever all three agree. Sequences of 3 and 4
+ * bytes are checked separately by looking 2 and 3 bytes back.
+ */
+enum {
+	TOO_SHORT = 1 << 0,      // 11______ 0_______  or  11______ 11______
+	TOO_LONG = 1 << 1,       // 0_______ 10______
+	OVERLONG_3 = 1 << 2,     // 11100000 100_____
+	TOO_LARGE = 1 << 3,      // 11110100 1001____ ...
+	SURROGATE = 1 << 4,      // 11101101 101_____
+	OVERLONG_2 = 1 << 5,     // 1100000_ 10______
+	TOO_LARGE_1000 = 1 << 6, // 11110101 1000____ ...
+	OVERLONG_4 = 1 << 6,     // 11110000 1000____
+	TWO_CONTS = 1 << 7,      // 10______ 10______
+	CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS
+};
+
+static const LSByte BYTE_1_HIGH_TABLE[16] = {
+	// 0_______ ________ <ASCII in byte 1>
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	// 10______ ________ <continuation in byte 1>
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+	// 1100____ ________ <two byte lead in byte 1>
+	TOO_SHORT | OVERLONG_2,
+	// 1101____ ________ <two byte lead in byte 1>
+	TOO_SHORT,
+	// 1110____ ________ <three byte lead in byte 1>
+	TOO_SHORT | OVERLONG_3 | SURROGATE,
+	// 1111____ ________ <four+ byte lead in byte 1>
+	TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+};
+
+static const LSByte BYTE_1_LOW_TABLE[16] = {
+	// ____0000 ________
+	CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+	// ____0001 ________
+	CARRY | OVERLONG_2,
+	// ____001_ ________
+	CARRY,
+	CARRY,
+	// ____0100 ________
+	CARRY | TOO_LARGE,
+	// ____0101 ________
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	// ____011_ ________
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	// ____1___ ________
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	// ____1101 ________
+	CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000
+};
+
+static const LSByte BYTE_2_HIGH_TABLE[16] = {
+	// ________ 0_______ <ASCII in byte 2>
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	// ________ 1000____
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000
+			| OVERLONG_4,
+	// ________ 1001____
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+	// ________ 101_____
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	// ________ 11______
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+LS_TARGET_AVX2
+static inline __m256i avx2_prev(__m256i input, __m256i prev_input, int n)
+{
+	__m256i shifted_in = _mm256_permute2x128_si256(prev_input, input, 0x21);
+
+	switch (n) {
+	case 1:
+		return _mm256_alignr_epi8(input, shifted_in, 16 - 1);
+	case 2:
+		return _mm256_alignr_epi8(input, shifted_in, 16 - 2);
+	default:
+		return _mm256_alignr_epi8(input, shifted_in, 16 - 3);
+	}
+}
+
+// Looks up each nibble of `idxs` in `table`.
+LS_TARGET_AVX2
+static inline __m256i avx2_lookup16(const LSByte table[16], __m256i idxs)
+{
+	__m128i table128 = _mm_loadu_si128((const __m128i *)table);
+
+	return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(table128), idxs);
+}
+
+LS_TARGET_AVX2
+static inline __m256i avx2_high_nibbles(__m256i v)
+{
+	return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+}
+
+LS_TARGET_AVX2
+static inline __m256i avx2_utf8_errors(__m256i input, __m256i prev_input)
+{
+	__m256i prev1 = avx2_prev(input, prev_input, 1);
+
+	__m256i byte_1_high = avx2_lookup16(BYTE_1_HIGH_TABLE,
+			avx2_high_nibbles(prev1));
+	__m256i byte_1_low = avx2_lookup16(BYTE_1_LOW_TABLE,
+			_mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)));
+	__m256i byte_2_high = avx2_lookup16(BYTE_2_HIGH_TABLE,
+			avx2_high_nibbles(input));
+
+	__m256i special_cases = _mm256_and_si256(byte_1_high,
+			_mm256_and_si256(byte_1_low, byte_2_high));
+
+	// only 111_____ and 1111____ survive these with their high bit set
+	__m256i prev2 = avx2_prev(input, prev_input, 2);
+	__m256i prev3 = avx2_prev(input, prev_input, 3);
+	__m256i is_third_byte = _mm256_subs_epu8(prev2,
+			_mm256_set1_epi8((char)(0xe0 - 0x80)));
+	__m256i is_fourth_byte = _mm256_subs_epu8(prev3,
+			_mm256_set1_epi8((char)(0xf0 - 0x80)));
+	__m256i must_be_cont = _mm256_and_si256(
+			_mm256_or_si256(is_third_byte, is_fourth_byte),
+			_mm256_set1_epi8((char)0x80));
+
+	return _mm256_xor_si256(must_be_cont, special_cases);
+}
+
+// Flags a sequence which is cut off at the end of `input`.
+LS_TARGET_AVX2
+static inline __m256i avx2_incomplete(__m256i input)
+{
+	__m256i max = _mm256_setr_epi8(
+			-1, -1, -1, -1, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1,
+			(char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+
+	return _mm256_subs_epu8(input, max);
+}
+
+LS_TARGET_AVX2
+bool validate_utf8_avx2(const LSByte *src, LSByte *dest, size_t len)
+{
+	__m256i error = _mm256_setzero_si256();
+	__m256i prev_input = _mm256_setzero_si256();
+	__m256i prev_incomplete = _mm256_setzero_si256();
+
+	for (size_t i = 0; i < len; i += 32) {
+		__m256i input;
+
+		if (len - i >= 32) {
+			input = _mm256_loadu_si256((const __m256i *)&src[i]);
+			if (dest) {
+				_mm256_storeu_si256((__m256i *)&dest[i], input);
+			}
+		} else {
+			// zero padding is ASCII, which flags any cut-off sequence
+			LSByte block[32] = { 0 };
+			memcpy(block, &src[i], len - i);
+			if (dest) {
+				memcpy(&dest[i], &src[i], len - i);
+			}
+
+			input = _mm256_loadu_si256((const __m256i *)block);
+		}
+
+		if (_mm256_movemask_epi8(input) == 0) {
+			error = _mm256_or_si256(error, prev_incomplete);
+			prev_incomplete = _mm256_setzero_si256();
+		} else {
+			error = _mm256_or_si256(error,
+					avx2_utf8_errors(input, prev_input));
+			prev_incomplete = avx2_incomplete(input);
+		}
+
+		prev_input = input;
+
+		// bail out early on long invalid inputs
+		if ((i & 4095) == 0 && !_mm256_testz_si256(error, error)) {
+			return false;
+		}
+	}
+
+	error = _mm256_or_si256(error, prev_incomplete);
+
+	return _mm256_testz_si256(error, error);
+}
+
+LS_TARGET_AVX2
+bool is_ascii_avx2(const LSByte *bytes, size_t len)
+{
+	__m256i acc = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; len - i >= 128; i += 128) {
+		const __m256i *block = (const __m256i *)&bytes[i];
+		__m256i a = _mm256_or_si256(_mm256_loadu_si256(&block[0]),
+				_mm256_loadu_si256(&block[1]));
+		__m256i b = _mm256_or_si256(_mm256_loadu_si256(&block[2]),
+				_mm256_loadu_si256(&block[3]));
+		acc = _mm256_or_si256(acc, _mm256_or_si256(a, b));
+
+		if (_mm256_movemask_epi8(acc) != 0) {
+			return false;
+		}
+	}
+
+	for (; len - i >= 32; i += 32) {
+		acc = _mm256_or_si256(acc,
+				_mm256_loadu_si256((const __m256i *)&bytes[i]));
+	}
+
+	return _mm256_movemask_epi8(acc) == 0
+			&& is_ascii_scalar(&bytes[i], len - i);
+}
+
+// Sums up the per-byte counters in `counters`.
+LS_TARGET_AVX2
+static inline size_t avx2_sum_counters(__m256i counters)
+{
+	__m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+
+	return _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+			+ _mm256_extract_epi64(sums, 2)
+			+ _mm256_extract_epi64(sums, 3);
+}
+
+LS_TARGET_AVX2
+size_t count_code_points_avx2(const LSByte *bytes, size_t len)
+{
+	size_t count = 0;
+
+	size_t i = 0;
+	while (len - i >= 32) {
+		// the per-byte counters would overflow after 255 blocks
+		__m256i counters = _mm256_setzero_si256();
+		for (size_t n = 0; n < 255 && len - i >= 32; ++n, i += 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+
+			// non-continuation bytes are those above 0xbf as signed values
+			__m256i is_lead = _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65));
+			counters = _mm256_sub_epi8(counters, is_lead);
+		}
+
+		count += avx2_sum_counters(counters);
+	}
+
+	return count + count_code_points_scalar(&bytes[i], len - i);
+}
+
+LS_TARGET_AVX2
+size_t count_utf16_units_avx2(const LSByte *bytes, size_t len)
+{
+	size_t count = 0;
+
+	size_t i = 0;
+	while (len - i >= 32) {
+		__m256i counters = _mm256_setzero_si256();
+		for (size_t n = 0; n < 127 && len - i >= 32; ++n, i += 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+
+			__m256i is_lead = _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65));
+			__m256i is_4_lead = _mm256_cmpeq_epi8(v,
+					_mm256_max_epu8(v, _mm256_set1_epi8((char)0xf0)));
+			counters = _mm256_sub_epi8(counters,
+					_mm256_add_epi8(is_lead, is_4_lead));
+		}
+
+		count += avx2_sum_counters(counters);
+	}
+
+	return count + count_utf16_units_scalar(&bytes[i], len - i);
+}
+
+#endif // LS_SIMD_X86
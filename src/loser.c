@@ -4,10 +4,16 @@
 #include <stddef.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <seifu/seifu.h>
 #include <tyrant/tyrant.h>
 
-static const LSByte EMPTY_STRING_BYTES[] = "";
+#include "loser-simd.h"
+
+static const LSByte EMPTY_STRING_BYTES[LS_TAIL_PADDING + 1] = "";
 const LSString LS_EMPTY_STRING = {
 	.len = 0,
 	.bytes = EMPTY_STRING_BYTES
@@ -21,6 +27,16 @@ static LSString create_string_unchecked(const LSByte *bytes, size_t len);
 static LSStatus bbuf_reserve_space(LSByteBuffer *bbuf, size_t len);
 static size_t three_halves_geom_growth(size_t cap);
 static size_t size_max(size_t a, size_t b);
+static void copy_bytes(LSByte *dest, const LSByte *src, size_t len);
+static bool short_string_reprs_equal(const LSShortString *a,
+		const LSShortString *b);
+static int compare_bytes(const LSByte *a, size_t a_len, const LSByte *b,
+		size_t b_len);
+static int compare_u64(uint64_t a, uint64_t b);
+static int compare_size(size_t a, size_t b);
+static uint64_t load_u64_be(const LSByte *bytes);
+static uint64_t load_prefix_be(const LSByte *bytes, size_t len);
+static const LSByte *find_byte(const LSByte *bytes, size_t len, LSByte byte);
 
 LSString ls_string_create(const LSByte *bytes, size_t len)
 {
@@ -47,7 +63,7 @@ void ls_string_destroy(LSString *string)
 
 LSShortString ls_short_string_create(const LSByte *bytes, size_t len)
 {
-	// null terminator comes free
+	// null terminator (and the zeroed tail equality relies on) comes free
 	LSShortString short_string = LS_AN_INVALID_SHORT_STRING;
 
 	if (len > LS_SHORT_STRING_MAX_LEN
@@ -56,7 +72,7 @@ LSShortString ls_short_string_create(const LSByte *bytes, size_t len)
 	}
 
 	short_string.len = len;
-	memcpy(short_string._mut_bytes, bytes, len);
+	copy_bytes(short_string._mut_bytes, bytes, len);
 
 	return short_string;
 }
@@ -97,7 +113,7 @@ LSByteBuffer ls_bbuf_create_with_init_cap(size_t cap)
 		return LS_AN_INVALID_BBUF;
 	}
 
-	LSByte *bytes = tyrant_alloc(cap);
+	LSByte *bytes = tyrant_alloc(ls_simd_padded_size(cap));
 	if (!bytes) {
 		return LS_AN_INVALID_BBUF;
 	}
@@ -238,7 +254,7 @@ LSByteBuffer ls_bbuf_from_sspan(LSStringSpan sspan)
 		return LS_AN_INVALID_BBUF;
 	}
 
-	memcpy(bbuf.bytes, sspan.bytes, sspan.len);
+	copy_bytes(bbuf.bytes, sspan.bytes, sspan.len);
 	bbuf.len = sspan.len;
 
 	return bbuf;
@@ -305,7 +321,7 @@ LSStatus ls_bbuf_append(LSByteBuffer *bbuf, const LSByte *bytes, size_t len)
 	}
 
 	LSByte *bytes_dest = &bbuf->bytes[bbuf->len];
-	memcpy(bytes_dest, bytes, len);
+	copy_bytes(bytes_dest, bytes, len);
 
 	bbuf->len += len;
 
@@ -355,13 +371,82 @@ LSStatus ls_bbuf_insert(LSByteBuffer *bbuf, size_t idx, const LSByte *bytes,
 	memmove(moving_bytes_dest, moving_bytes, nmoving_bytes);
 
 	LSByte *bytes_dest = &bbuf->bytes[idx];
-	memcpy(bytes_dest, bytes, len);
+	copy_bytes(bytes_dest, bytes, len);
 
 	bbuf->len += len;
 
 	return LS_SUCCESS;
 }
 
+LSStatus ls_bbuf_erase(LSByteBuffer *bbuf, size_t idx, size_t len)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| idx > bbuf->len
+			|| len > bbuf->len - idx) {
+		return LS_FAILURE;
+	}
+
+	LSByte *moving_bytes = &bbuf->bytes[idx + len];
+	size_t nmoving_bytes = bbuf->len - idx - len;
+	memmove(&bbuf->bytes[idx], moving_bytes, nmoving_bytes);
+
+	bbuf->len -= len;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_bbuf_splice(LSByteBuffer *bbuf, size_t idx, size_t del_len,
+		const LSByte *bytes, size_t ins_len)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| !bytes
+			|| idx > bbuf->len
+			|| del_len > bbuf->len - idx) {
+		return LS_FAILURE;
+	}
+
+	if (ins_len > del_len
+			&& ls_bbuf_reserve(bbuf, ins_len - del_len) != LS_SUCCESS) {
+		return LS_FAILURE;
+	}
+
+	if (ins_len != del_len) {
+		LSByte *moving_bytes = &bbuf->bytes[idx + del_len];
+		size_t nmoving_bytes = bbuf->len - idx - del_len;
+		LSByte *moving_bytes_dest = &bbuf->bytes[idx + ins_len];
+		memmove(moving_bytes_dest, moving_bytes, nmoving_bytes);
+	}
+
+	LSByte *bytes_dest = &bbuf->bytes[idx];
+	copy_bytes(bytes_dest, bytes, ins_len);
+
+	bbuf->len = bbuf->len - del_len + ins_len;
+
+	return LS_SUCCESS;
+}
+
+LSStatus ls_bbuf_consume(LSByteBuffer *bbuf, size_t *offset, size_t len)
+{
+	if (!ls_bbuf_is_valid(*bbuf)
+			|| *offset > bbuf->len
+			|| len > bbuf->len - *offset) {
+		return LS_FAILURE;
+	}
+
+	size_t consumed = *offset + len;
+	size_t remaining = bbuf->len - consumed;
+
+	if (consumed > remaining) {
+		memmove(bbuf->bytes, &bbuf->bytes[consumed], remaining);
+		bbuf->len = remaining;
+		consumed = 0;
+	}
+
+	*offset = consumed;
+
+	return LS_SUCCESS;
+}
+
 LSStatus ls_bbuf_expand_to(LSByteBuffer *bbuf, size_t new_cap)
 {
 	if (!ls_bbuf_is_valid(*bbuf)) {
@@ -373,7 +458,8 @@ LSStatus ls_bbuf_expand_to(LSByteBuffer *bbuf, size_t new_cap)
 	}
 
 	bool success;
-	bbuf->bytes = tyrant_realloc(bbuf->bytes, new_cap, &success);
+	bbuf->bytes = tyrant_realloc(bbuf->bytes, ls_simd_padded_size(new_cap),
+			&success);
 	if (!success) {
 		return LS_FAILURE;
 	}
@@ -402,6 +488,26 @@ LSStatus ls_bbuf_expand_by(LSByteBuffer *bbuf, size_t add_cap)
 	return ls_bbuf_expand_to(bbuf, new_cap);
 }
 
+LSStatus ls_bbuf_reserve(LSByteBuffer *bbuf, size_t len)
+{
+	if (!ls_bbuf_is_valid(*bbuf)) {
+		return LS_FAILURE;
+	}
+
+	size_t new_len;
+	SeifuStatus status = seifu_add(bbuf->len, len, &new_len);
+	if (status != SEIFU_OK) {
+		return LS_FAILURE;
+	}
+
+	return bbuf_reserve_space(bbuf, len);
+}
+
+size_t ls_get_tail_padding(void)
+{
+	return LS_TAIL_PADDING;
+}
+
 bool ls_string_equals(LSString a, LSString b)
 {
 	return a.len == b.len
@@ -411,13 +517,18 @@ bool ls_string_equals(LSString a, LSString b)
 
 bool ls_short_string_equals(LSShortString a, LSShortString b)
 {
-	return a.len == b.len
-			&& ls_short_string_is_valid(a) // implies b is valid
-			&& ls_bytes_equals(a._mut_bytes, b._mut_bytes, a.len);
+	// bitwise `&` so that both sides are always evaluated: no branches
+	return ls_short_string_is_valid(a) // with equal lengths implies b is valid
+			& short_string_reprs_equal(&a, &b);
 }
 
 bool ls_sso_equals(LSSSOString a, LSSSOString b)
 {
+	if (a.len <= LS_SHORT_STRING_MAX_LEN) {
+		// `b` can only be of the same length if it is short too
+		return short_string_reprs_equal(&a._short, &b._short);
+	}
+
 	const LSByte *a_bytes = ls_sso_get_bytes(&a);
 	const LSByte *b_bytes = ls_sso_get_bytes(&b);
 
@@ -433,6 +544,104 @@ bool ls_sspan_equals(LSStringSpan a, LSStringSpan b)
 			&& ls_bytes_equals(a.bytes, b.bytes, a.len);
 }
 
+int ls_string_compare(LSString a, LSString b)
+{
+	bool a_valid = ls_string_is_valid(a);
+	bool b_valid = ls_string_is_valid(b);
+	if (!a_valid || !b_valid) {
+		return (int)a_valid - (int)b_valid;
+	}
+
+	return compare_bytes(a.bytes, a.len, b.bytes, b.len);
+}
+
+int ls_short_string_compare(LSShortString a, LSShortString b)
+{
+	bool a_valid = ls_short_string_is_valid(a);
+	bool b_valid = ls_short_string_is_valid(b);
+	if (!a_valid || !b_valid) {
+		return (int)a_valid - (int)b_valid;
+	}
+
+	// both arrays are always `LS_SHORT_STRING_MAX_LEN + 1` bytes, so whole
+	// words can be loaded; bytes past the common length are masked off
+	size_t len = ls_simd_size_min(a.len, b.len);
+	for (size_t i = 0; i < len; i += 8) {
+		uint64_t a_word = load_u64_be(&a._mut_bytes[i]);
+		uint64_t b_word = load_u64_be(&b._mut_bytes[i]);
+
+		if (len - i < 8) {
+			uint64_t mask = UINT64_MAX << (8 * (8 - (len - i)));
+			a_word &= mask;
+			b_word &= mask;
+		}
+
+		if (a_word != b_word) {
+			return compare_u64(a_word, b_word);
+		}
+	}
+
+	return compare_size(a.len, b.len);
+}
+
+int ls_sso_compare(LSSSOString a, LSSSOString b)
+{
+	if (ls_sso_get_type(a) == LS_SSO_SHORT
+			&& ls_sso_get_type(b) == LS_SSO_SHORT) {
+		return ls_short_string_compare(a._short, b._short);
+	}
+
+	const LSByte *a_bytes = ls_sso_get_bytes(&a);
+	const LSByte *b_bytes = ls_sso_get_bytes(&b);
+	if (!a_bytes || !b_bytes) {
+		return (int)(a_bytes != NULL) - (int)(b_bytes != NULL);
+	}
+
+	return compare_bytes(a_bytes, a.len, b_bytes, b.len);
+}
+
+int ls_sspan_compare(LSStringSpan a, LSStringSpan b)
+{
+	bool a_valid = ls_sspan_is_valid(a);
+	bool b_valid = ls_sspan_is_valid(b);
+	if (!a_valid || !b_valid) {
+		return (int)a_valid - (int)b_valid;
+	}
+
+	return compare_bytes(a.bytes, a.len, b.bytes, b.len);
+}
+
+LSStatus ls_sspan_compare_many(LSStringSpan key, const LSStringSpan *sspans,
+		size_t nsspans, int *results)
+{
+	if (!ls_sspan_is_valid(key) || !sspans || !results) {
+		return LS_FAILURE;
+	}
+
+	/*
+	 * Zero-padded big-endian prefixes order the same way as the spans
+	 * themselves whenever they differ, so most comparisons are settled by a
+	 * single integer compare against the key's prefix, loaded only once.
+	 */
+	uint64_t key_prefix = load_prefix_be(key.bytes, key.len);
+
+	for (size_t i = 0; i < nsspans; ++i) {
+		LSStringSpan sspan = sspans[i];
+		if (!ls_sspan_is_valid(sspan)) {
+			results[i] = 1;
+			continue;
+		}
+
+		uint64_t prefix = load_prefix_be(sspan.bytes, sspan.len);
+		results[i] = key_prefix != prefix
+				? compare_u64(key_prefix, prefix)
+				: compare_bytes(key.bytes, key.len,
+						sspan.bytes, sspan.len);
+	}
+
+	return LS_SUCCESS;
+}
+
 bool ls_bytes_equals(const LSByte a[static 1], const LSByte b[static 1],
 		size_t len)
 {
@@ -445,14 +654,105 @@ bool ls_bytes_equals_nullsafe(const LSByte *a, const LSByte *b, size_t len)
 		&& ls_bytes_equals(a, b, len);
 }
 
+LSLineReader ls_line_reader_create(void)
+{
+	LSByteBuffer carry = ls_bbuf_create();
+	if (!ls_bbuf_is_valid(carry)) {
+		return LS_AN_INVALID_LINE_READER;
+	}
+
+	return (LSLineReader){
+		._chunk = LS_EMPTY_SSPAN,
+		._carry = carry,
+		._carry_yielded = false
+	};
+}
+
+void ls_line_reader_destroy(LSLineReader *reader)
+{
+	ls_bbuf_destroy(&reader->_carry);
+}
+
+void ls_line_reader_feed(LSLineReader *reader, LSStringSpan chunk)
+{
+	reader->_chunk = chunk;
+}
+
+LSStringSpan ls_line_reader_next(LSLineReader *reader)
+{
+	if (!ls_line_reader_is_valid(*reader)) {
+		return LS_AN_INVALID_SSPAN;
+	}
+
+	LSByteBuffer *carry = &reader->_carry;
+	if (reader->_carry_yielded) {
+		carry->len = 0;
+		reader->_carry_yielded = false;
+	}
+
+	LSStringSpan chunk = reader->_chunk;
+	if (chunk.len == 0) {
+		return LS_AN_INVALID_SSPAN;
+	}
+
+	const LSByte *newline = find_byte(chunk.bytes, chunk.len, '\n');
+	if (!newline) {
+		// the chunk ends mid-line; keep the start of it for later
+		reader->_chunk = LS_EMPTY_SSPAN;
+		if (ls_bbuf_append_sspan(carry, chunk) != LS_SUCCESS) {
+			ls_line_reader_destroy(reader);
+			*reader = LS_AN_INVALID_LINE_READER;
+		}
+
+		return LS_AN_INVALID_SSPAN;
+	}
+
+	size_t line_len = newline - chunk.bytes;
+	reader->_chunk = ls_sspan_create(newline + 1, chunk.len - line_len - 1);
+
+	if (carry->len == 0) {
+		return ls_sspan_create(chunk.bytes, line_len);
+	}
+
+	if (ls_bbuf_append(carry, chunk.bytes, line_len) != LS_SUCCESS) {
+		ls_line_reader_destroy(reader);
+		*reader = LS_AN_INVALID_LINE_READER;
+
+		return LS_AN_INVALID_SSPAN;
+	}
+
+	reader->_carry_yielded = true;
+
+	return ls_sspan_from_bbuf(*carry);
+}
+
+LSStringSpan ls_line_reader_finish(LSLineReader *reader)
+{
+	if (!ls_line_reader_is_valid(*reader)) {
+		return LS_AN_INVALID_SSPAN;
+	}
+
+	LSByteBuffer *carry = &reader->_carry;
+	if (reader->_carry_yielded || carry->len == 0) {
+		carry->len = 0;
+		reader->_carry_yielded = false;
+
+		return LS_AN_INVALID_SSPAN;
+	}
+
+	reader->_carry_yielded = true;
+
+	return ls_sspan_from_bbuf(*carry);
+}
+
 LSString create_string_unchecked(const LSByte *bytes, size_t len)
 {
-	LSByte *bytes_cpy = tyrant_alloc(len + 1);
+	LSByte *bytes_cpy = tyrant_alloc(ls_simd_padded_size(len + 1));
 	if (!bytes_cpy) {
 		return LS_AN_INVALID_STRING;
 	}
 
-	memcpy(bytes_cpy, bytes, len);
+	copy_bytes(bytes_cpy, bytes, len);
 	bytes_cpy[len] = '\0';
 
 	return (LSString){
@@ -486,3 +786,156 @@ size_t size_max(size_t a, size_t b)
 {
 	return a > b ? a : b;
 }
+
+/*
+ * `memcpy()` for the short lengths most strings have: up to 32 bytes are copied
+ * with (at most) two possibly overlapping fixed-size moves, one from each end,
+ * which compile to plain loads and stores with no call and no loop.
+ */
+void copy_bytes(LSByte *dest, const LSByte *src, size_t len)
+{
+	if (len > 32) {
+		memcpy(dest, src, len);
+	} else if (len >= 16) {
+		LSByte head[16];
+		LSByte tail[16];
+		memcpy(head, src, 16);
+		memcpy(tail, &src[len - 16], 16);
+		memcpy(dest, head, 16);
+		memcpy(&dest[len - 16], tail, 16);
+	} else if (len >= 8) {
+		uint64_t head;
+		uint64_t tail;
+		memcpy(&head, src, 8);
+		memcpy(&tail, &src[len - 8], 8);
+		memcpy(dest, &head, 8);
+		memcpy(&dest[len - 8], &tail, 8);
+	} else if (len >= 4) {
+		uint32_t head;
+		uint32_t tail;
+		memcpy(&head, src, 4);
+		memcpy(&tail, &src[len - 4], 4);
+		memcpy(dest, &head, 4);
+		memcpy(&dest[len - 4], &tail, 4);
+	} else if (len > 0) {
+		LSByte first = src[0];
+		LSByte middle = src[len / 2];
+		LSByte last = src[len - 1];
+		dest[0] = first;
+		dest[len / 2] = middle;
+		dest[len - 1] = last;
+	}
+}
+
+/*
+ * Since the bytes past the end of a short string are always zero (and the
+ * struct has no padding), two short strings are equal iff their whole
+ * representations are: a few word compares, with no dependence on the length.
+ *
+ * Comparing from the start of the struct, rather than length and array apart,
+ * keeps the loads lined up with the stores of a by-value argument.
+ */
+bool short_string_reprs_equal(const LSShortString *a, const LSShortString *b)
+{
+	const LSByte *a_repr = (const LSByte *)a;
+	const LSByte *b_repr = (const LSByte *)b;
+
+	uint64_t diff = 0;
+	size_t i = 0;
+	for (; sizeof(*a) - i >= 8; i += 8) {
+		uint64_t a_word;
+		uint64_t b_word;
+		memcpy(&a_word, &a_repr[i], sizeof(a_word));
+		memcpy(&b_word, &b_repr[i], sizeof(b_word));
+
+		diff |= a_word ^ b_word;
+	}
+
+	for (; i < sizeof(*a); ++i) {
+		diff |= a_repr[i] ^ b_repr[i];
+	}
+
+	return diff == 0;
+}
+
+// Orders like `memcmp()`, with a proper prefix ordering first.
+int compare_bytes(const LSByte *a, size_t a_len, const LSByte *b,
+		size_t b_len)
+{
+	int cmp = memcmp(a, b, ls_simd_size_min(a_len, b_len));
+	if (cmp != 0) {
+		return cmp < 0 ? -1 : 1;
+	}
+
+	return compare_size(a_len, b_len);
+}
+
+int compare_u64(uint64_t a, uint64_t b)
+{
+	return (a > b) - (a < b);
+}
+
+int compare_size(size_t a, size_t b)
+{
+	return (a > b) - (a < b);
+}
+
+// Loads 8 bytes such that comparing the results orders them like `memcmp()`.
+uint64_t load_u64_be(const LSByte *bytes)
+{
+	uint64_t word;
+	memcpy(&word, bytes, sizeof(word));
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) \
+		&& __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	return __builtin_bswap64(word);
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return word;
+#else
+	word = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		word = (word << 8) | bytes[i];
+	}
+
+	return word;
+#endif
+}
+
+// Like `load_u64_be()`, but pads spans shorter than 8 bytes with zeros.
+uint64_t load_prefix_be(const LSByte *bytes, size_t len)
+{
+	if (len >= 8) {
+		return load_u64_be(bytes);
+	}
+
+	LSByte padded[8] = { 0 };
+	memcpy(padded, bytes, len);
+
+	return load_u64_be(padded);
+}
+
+const LSByte *find_byte(const LSByte *bytes, size_t len, LSByte byte)
+{
+#ifdef __SSE2__
+	size_t i = 0;
+
+	__m128i needle = _mm_set1_epi8((char)byte);
+	for (; len - i >= 16; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)&bytes[i]);
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+		if (mask != 0) {
+			return &bytes[i + __builtin_ctz(mask)];
+		}
+	}
+
+	for (; i < len; ++i) {
+		if (bytes[i] == byte) {
+			return &bytes[i];
+		}
+	}
+
+	return NULL;
+#else
+	return memchr(bytes, byte, len);
+#endif
+}
@@ -1,6 +1,7 @@
 #ifndef loser_h
 #define loser_h
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -23,6 +24,21 @@
 
 enum { LS_SHORT_STRING_MAX_LEN = 23 };
 
+/*
+ * Opt-in allocation policy: when the library is built with `LS_TAIL_PADDING`
+ * set (e.g. `-DLS_TAIL_PADDING=64`), at least that many bytes starting at
+ * `bytes[len]` of every `LSString` and at `bytes[cap]` of every `LSByteBuffer`
+ * it allocates are readable, so that SIMD kernels can read whole blocks past
+ * the end instead of handling the tail byte by byte. The contents of those
+ * bytes are unspecified.
+ *
+ * NOTE: Use `ls_get_tail_padding()` to find out what the library was actually
+ * built with.
+ */
+#ifndef LS_TAIL_PADDING
+#define LS_TAIL_PADDING 0
+#endif
+
 typedef enum LSStatus {
 	LS_SUCCESS = 0,
 	LS_FAILURE = -1
@@ -39,7 +55,8 @@ typedef struct LSString {
 
 // A (null-terminated) short array of bytes.
 /*
- * Has a maximum length of `LS_SHORT_STRING_MAX_LEN`.
+ * Has a maximum length of `LS_SHORT_STRING_MAX_LEN`. Every byte past the end of
+ * the string is zero, so equality can compare the whole array at once.
  */
 typedef struct LSShortString {
 	size_t len;
@@ -79,6 +96,70 @@ typedef struct LSByteBuffer {
 	LSByte *bytes;
 } LSByteBuffer;
 
+// Splits a stream of chunks into lines.
+/*
+ * Lines are yielded without their terminating `'\n'`. A line lying entirely
+ * within one chunk is yielded as an `LSStringSpan` into that chunk. Only the
+ * lines straddling chunk boundaries are copied into an internal buffer.
+ */
+typedef struct LSLineReader {
+	LSStringSpan _chunk;
+	LSByteBuffer _carry;
+	bool _carry_yielded;
+} LSLineReader;
+
+// Splits CSV (or TSV) text into records of fields, per RFC 4180.
+/*
+ * Fields are yielded as `LSStringSpan`s into the input. Only quoted fields
+ * containing doubled quotes are copied, unescaped, into an internal buffer.
+ *
+ * The input is scanned 64 bytes at a time for delimiters, newlines and quotes,
+ * and `_mask` caches which of the bytes at `_mask_pos` are among them.
+ */
+typedef struct LSCsvReader {
+	LSStringSpan _input;
+	size_t _pos;
+	LSByte _delimiter;
+	size_t _mask_pos;
+	uint64_t _mask;
+	size_t _fields_cap;
+	LSStringSpan *_fields;
+	LSByteBuffer _scratch;
+} LSCsvReader;
+
+// Maps code point indices of a UTF-8 string to byte offsets.
+/*
+ * Stores the byte offset of every 64th code point, so that looking up any code
+ * point only has to walk a short stretch of the string.
+ */
+typedef struct LSUtf8Index {
+	size_t ncode_points;
+	size_t *_offsets;
+} LSUtf8Index;
+
+// A text with `{name}` placeholders, compiled for rendering.
+/*
+ * Compiled into a list of instructions, each of which copies either a stretch
+ * of literal text or the value of a slot. Every distinct name is a slot,
+ * numbered in order of first appearance.
+ */
+typedef struct LSTemplate {
+	size_t nslots;
+	size_t _ninstrs;
+	size_t _literals_len;
+	struct LSTemplateInstr *_instrs;
+	LSStringSpan *_names;
+} LSTemplate;
+
+// A set of bytes, as a 256-bit bitmap.
+/*
+ * Laid out for lookups by nibble with SIMD shuffles: the byte `h << 4 | l` is
+ * in the set iff bit `h % 8` of `_bits[h / 8][l]` is set.
+ */
+typedef struct LSByteSet {
+	uint8_t _bits[2][16];
+} LSByteSet;
+
 // The empty string constant (there can only be one).
 extern const LSString LS_EMPTY_STRING;
 
@@ -103,6 +184,24 @@ static const LSStringSpan LS_EMPTY_SSPAN = {
 #define LS_AN_INVALID_SHORT_STRING (LSShortString){ .len = SIZE_MAX }
 #define LS_AN_INVALID_SSPAN (LSStringSpan){ .bytes = NULL }
 #define LS_AN_INVALID_BBUF (LSByteBuffer){ .bytes = NULL }
+#define LS_AN_INVALID_LINE_READER \
+	(LSLineReader){ ._carry.bytes = NULL }
+#define LS_AN_INVALID_UTF8_INDEX (LSUtf8Index){ ._offsets = NULL }
+#define LS_AN_INVALID_TEMPLATE (LSTemplate){ ._instrs = NULL }
+#define LS_AN_INVALID_CSV_READER (LSCsvReader){ ._fields = NULL }
+
+// Bytes which may appear in a URL (component) unencoded, per RFC 3986.
+/*
+ * - `LS_URL_UNRESERVED_SET`: the unreserved characters, safe in any component
+ * - `LS_URL_PATH_SET`: those plus the sub-delimiters, `:`, `@` and `/`
+ * - `LS_URL_QUERY_SET`: those plus `?` (also right for fragments)
+ */
+extern const LSByteSet LS_URL_UNRESERVED_SET;
+extern const LSByteSet LS_URL_PATH_SET;
+extern const LSByteSet LS_URL_QUERY_SET;
+
+// ASCII whitespace: `' '`, `'\t'`, `'\n'`, `'\v'`, `'\f'` and `'\r'`.
+extern const LSByteSet LS_ASCII_WHITESPACE_SET;
 
 #define LS_LINKAGE inline
 #include "loser-inline-decls.h"
@@ -422,6 +521,63 @@ LSStatus ls_bbuf_insert_string(LSByteBuffer *bbuf, size_t idx,
 LSStatus ls_bbuf_insert_sspan(LSByteBuffer *bbuf, size_t idx,
 		LSStringSpan sspan);
 
+/*
+ * Removes the `len` bytes starting at `idx` from `bbuf`, moving the bytes after
+ * them down once.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `idx` is greater than `bbuf->len`
+ * - `len` is greater than `bbuf->len - idx`
+ */
+LSStatus ls_bbuf_erase(LSByteBuffer *bbuf, size_t idx, size_t len);
+
+/*
+ * Replaces the `del_len` bytes starting at `idx` in `bbuf` with `ins_len`
+ * bytes from `bytes`. Reserves at most once and moves the bytes after the
+ * range at most once.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ * - `bytes` points to an array of at least `ins_len` bytes
+ *        OR is `NULL`
+ * - `bytes` does not overlap the bytes of `bbuf`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `bytes` is `NULL`
+ * - `idx` is greater than `bbuf->len`
+ * - `del_len` is greater than `bbuf->len - idx`
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_splice(LSByteBuffer *bbuf, size_t idx, size_t del_len,
+		const LSByte *bytes, size_t ins_len);
+
+/*
+ * Consumes `len` bytes from the front of `bbuf`, treating it as a queue whose
+ * unconsumed bytes start at `*offset`. Usually this only advances `*offset`.
+ * Once the consumed bytes outnumber the unconsumed ones, the unconsumed bytes
+ * are moved to the front and `*offset` is reset to `0`. That way each byte is
+ * moved at most once on average, however small the steps.
+ *
+ * Appending to `bbuf` in between is fine. Other changes to its length must
+ * take `*offset` into account.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ * - `offset` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `*offset` is greater than `bbuf->len`
+ * - `len` is greater than `bbuf->len - *offset`
+ */
+LSStatus ls_bbuf_consume(LSByteBuffer *bbuf, size_t *offset, size_t len);
+
 /*
  * Constraints:
  * - `bbuf` is not `NULL`
@@ -433,6 +589,20 @@ LSStatus ls_bbuf_insert_sspan(LSByteBuffer *bbuf, size_t idx,
  */
 LSStatus ls_bbuf_expand_to(LSByteBuffer *bbuf, size_t new_cap);
 
+/*
+ * Makes sure that at least `len` more bytes fit in `bbuf` without reallocation,
+ * growing it geometrically if they don't.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_reserve(LSByteBuffer *bbuf, size_t len);
+
 /*
  * Constraints:
  * - `bbuf` is not `NULL`
@@ -444,6 +614,11 @@ LSStatus ls_bbuf_expand_to(LSByteBuffer *bbuf, size_t new_cap);
  */
 LSStatus ls_bbuf_expand_by(LSByteBuffer *bbuf, size_t add_cap);
 
+/*
+ * Returns the `LS_TAIL_PADDING` the library was built with (`0` by default).
+ */
+size_t ls_get_tail_padding(void);
+
 /*
  * NOTE: An invalid value never compares equal to another value--not even
  * another invalid value.
@@ -471,6 +646,800 @@ bool ls_bytes_equals(const LSByte a[static 1], const LSByte b[static 1],
  */
 bool ls_bytes_equals_nullsafe(const LSByte *a, const LSByte *b, size_t len);
 
+/*
+ * Orders `a` and `b` lexicographically by (unsigned) byte value, with a proper
+ * prefix ordering first. Returns a negative value, zero or a positive value if
+ * `a` orders before, the same as or after `b`, respectively.
+ *
+ * NOTE: Invalid values order before all valid values and the same as each
+ * other, so that any array of values can be sorted.
+ */
+int ls_string_compare(LSString a, LSString b);
+int ls_short_string_compare(LSShortString a, LSShortString b);
+int ls_sso_compare(LSSSOString a, LSSSOString b);
+int ls_sspan_compare(LSStringSpan a, LSStringSpan b);
+
+/*
+ * Stores `ls_sspan_compare(key, sspans[i])` in `results[i]` for every `i` below
+ * `nsspans`.
+ *
+ * Constraints:
+ * - `sspans` points to an array of at least `nsspans` spans
+ *         OR is `NULL`
+ * - `results` points to an array of at least `nsspans` `int`s
+ *          OR is `NULL`
+ *
+ * Fails if:
+ * - `key` is invalid
+ * - `sspans` is `NULL`
+ * - `results` is `NULL`
+ */
+LSStatus ls_sspan_compare_many(LSStringSpan key, const LSStringSpan *sspans,
+		size_t nsspans, int *results);
+
+/*
+ * Returns the index of the first element of `ssos` equal to `needle` (as by
+ * `ls_sso_equals()`).
+ *
+ * Constraints:
+ * - `ssos` points to an array of at least `nssos` `LSSSOString`s
+ *       OR is `NULL`
+ *
+ * Returns `SIZE_MAX` if:
+ * - no element is equal to `needle`
+ * - `needle` is invalid
+ * - `ssos` is `NULL`
+ */
+size_t ls_sso_find_equal(LSSSOString needle, const LSSSOString *ssos,
+		size_t nssos);
+
+/*
+ * Sets bit `i % 64` of `bitmap[i / 64]` iff `sspans[i]` equals `needle` (as by
+ * `ls_sspan_equals()`), for every `i` below `nsspans`. Bits past `nsspans` in
+ * the last word are cleared.
+ *
+ * Constraints:
+ * - `sspans` points to an array of at least `nsspans` spans
+ *         OR is `NULL`
+ * - `bitmap` points to an array of at least `(nsspans + 63) / 64` `uint64_t`s
+ *         OR is `NULL`
+ *
+ * Fails if:
+ * - `needle` is invalid
+ * - `sspans` is `NULL`
+ * - `bitmap` is `NULL`
+ */
+LSStatus ls_sspan_filter_equal(LSStringSpan needle, const LSStringSpan *sspans,
+		size_t nsspans, uint64_t *bitmap);
+
+/*
+ * Sorts `sspans` into ascending order (as by `ls_sspan_compare()`). The sort
+ * is not stable: equal spans may end up in any order relative to each other.
+ *
+ * Much faster than `qsort()` with `ls_sspan_compare()` for large arrays, but
+ * needs scratch memory of about twice the size of the array.
+ *
+ * Constraints:
+ * - `sspans` points to an array of at least `nsspans` spans
+ *         OR is `NULL`
+ *
+ * Fails if:
+ * - `sspans` is `NULL`
+ * - memory allocation fails
+ */
+LSStatus ls_sspan_sort(LSStringSpan *sspans, size_t nsspans);
+
+/*
+ * Sorts `ssos` into ascending order (as by `ls_sso_compare()`). The sort is not
+ * stable.
+ *
+ * Needs scratch memory of about twice the size of the array.
+ *
+ * Constraints:
+ * - `ssos` points to an array of at least `nssos` `LSSSOString`s
+ *       OR is `NULL`
+ *
+ * Fails if:
+ * - `ssos` is `NULL`
+ * - memory allocation fails
+ */
+LSStatus ls_sso_sort(LSSSOString *ssos, size_t nssos);
+
+/*
+ * Checks whether `sspan` holds well-formed UTF-8 (i.e. no overlong encodings,
+ * surrogates or code points above U+10FFFF).
+ *
+ * Returns `false` if `sspan` is invalid.
+ */
+bool ls_sspan_is_valid_utf8(LSStringSpan sspan);
+
+/*
+ * Returns `false` if `sspan` is invalid.
+ */
+bool ls_sspan_is_ascii(LSStringSpan sspan);
+
+/*
+ * Like `ls_string_create()`, but validates `bytes` as UTF-8 while copying them.
+ *
+ * Constraints:
+ * - `bytes` points to a array of at least `len` bytes
+ *        OR is `NULL`
+ *
+ * Fails if:
+ * - allocation fails
+ * - `bytes` is `NULL`
+ * - `bytes` is not well-formed UTF-8
+ */
+LSString ls_string_create_utf8(const LSByte *bytes, size_t len);
+
+/*
+ * Like `ls_sso_create()`, but validates `bytes` as UTF-8.
+ *
+ * Constraints:
+ * - `bytes` points to an array of at least `len` bytes
+ *        OR is `NULL`
+ *
+ * Fails if:
+ * - allocation is attempted and fails
+ * - `bytes` is `NULL`
+ * - `bytes` is not well-formed UTF-8
+ */
+LSSSOString ls_sso_create_utf8(const LSByte *bytes, size_t len);
+
+/*
+ * Counts the code points in `sspan`.
+ *
+ * If `sspan` is not well-formed UTF-8, the result is unspecified but no more
+ * than `sspan.len`.
+ *
+ * Returns `0` if `sspan` is invalid.
+ */
+size_t ls_sspan_utf8_count(LSStringSpan sspan);
+
+/*
+ * Counts the UTF-16 code units needed to hold the contents of `sspan`.
+ *
+ * If `sspan` is not well-formed UTF-8, the result is unspecified.
+ *
+ * Returns `0` if `sspan` is invalid.
+ */
+size_t ls_sspan_utf16_len(LSStringSpan sspan);
+
+/*
+ * Constraints:
+ * - `sspan` holds well-formed UTF-8
+ *
+ * Fails if:
+ * - allocation fails
+ * - `sspan` is invalid
+ */
+LSUtf8Index ls_utf8_index_create(LSStringSpan sspan);
+
+/*
+ * Constraints:
+ * - `index` is not `NULL`
+ * - `index` was not previously destroyed
+ */
+void ls_utf8_index_destroy(LSUtf8Index *index);
+
+/*
+ * Returns the byte offset of code point `cp_idx` in `sspan`. For `cp_idx` equal
+ * to `index->ncode_points`, returns `sspan.len`.
+ *
+ * Constraints:
+ * - `index` is not `NULL`
+ * - `index` was created from `sspan`
+ *
+ * Returns `SIZE_MAX` if:
+ * - `index` is invalid
+ * - `sspan` is invalid
+ * - `cp_idx` is greater than `index->ncode_points`
+ */
+size_t ls_utf8_index_get_offset(const LSUtf8Index *index, LSStringSpan sspan,
+		size_t cp_idx);
+
+/*
+ * Transcodes `sspan` to (native-endian) UTF-16, storing the number of code
+ * units written in `*nunits`. `ls_sspan_utf16_len()` gives the exact `cap`
+ * needed.
+ *
+ * Constraints:
+ * - `units` points to an array of at least `cap` `uint16_t`s
+ *        OR is `NULL`
+ * - `nunits` is not `NULL`
+ *
+ * Fails if:
+ * - `sspan` is invalid
+ * - `units` is `NULL`
+ * - `sspan` is not well-formed UTF-8
+ * - `cap` is too small
+ */
+LSStatus ls_sspan_to_utf16(LSStringSpan sspan, uint16_t *units, size_t cap,
+		size_t *nunits);
+
+/*
+ * Transcodes `nunits` (native-endian) UTF-16 code units to UTF-8 and appends
+ * them to `bbuf`, reserving the exact space needed up front.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ * - `units` points to an array of at least `nunits` `uint16_t`s
+ *        OR is `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `units` is `NULL`
+ * - `units` contains unpaired surrogates
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_from_utf16(LSByteBuffer *bbuf, const uint16_t *units,
+		size_t nunits);
+
+/*
+ * Like `ls_sspan_equals()`, but ASCII letters compare equal regardless of case.
+ * Non-ASCII bytes are compared as-is.
+ */
+bool ls_sspan_equals_icase(LSStringSpan a, LSStringSpan b);
+
+/*
+ * Hashes `sspan` such that spans which compare equal with
+ * `ls_sspan_equals_icase()` hash equal. The result is the same on every CPU,
+ * but is not meant to withstand adversarial input.
+ *
+ * Returns `0` if `sspan` is invalid.
+ */
+uint64_t ls_sspan_hash_icase(LSStringSpan sspan);
+
+/*
+ * Converts the ASCII letters in `bbuf` to lower (or upper) case in place.
+ * Non-ASCII bytes are left untouched.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ */
+LSStatus ls_bbuf_to_lower(LSByteBuffer *bbuf);
+LSStatus ls_bbuf_to_upper(LSByteBuffer *bbuf);
+
+/*
+ * Returns a copy of `sspan` with every occurrence of `needle` replaced by
+ * `replacement`. Occurrences are found left to right and do not overlap.
+ *
+ * The matches are counted first, so the result is allocated at its exact size
+ * and every byte is copied once.
+ *
+ * Fails if:
+ * - allocation fails
+ * - `sspan`, `needle` or `replacement` is invalid
+ * - `needle` is empty
+ * - resulting length would exceed `SIZE_MAX - 1`
+ */
+LSString ls_sspan_replace_all(LSStringSpan sspan, LSStringSpan needle,
+		LSStringSpan replacement);
+
+/*
+ * Like `ls_sspan_replace_all()`, but replaces in place. `bbuf` is reallocated
+ * at most once, and only if the replacement is longer than `needle`.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ * - `needle` and `replacement` do not overlap the bytes of `bbuf`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `needle` or `replacement` is invalid
+ * - `needle` is empty
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_replace_all(LSByteBuffer *bbuf, LSStringSpan needle,
+		LSStringSpan replacement);
+
+/*
+ * Appends `sspan` to `bbuf` escaped as the contents of a JSON string (without
+ * the surrounding quotes). Quotes, backslashes and control characters are
+ * escaped, everything else (including non-ASCII bytes) is copied as-is.
+ *
+ * The bytes to escape are found with SIMD where available, and the runs in
+ * between are copied in bulk.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `sspan` is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_json_escaped(LSByteBuffer *bbuf, LSStringSpan sspan);
+
+/*
+ * Returns the contents of the JSON string `sspan` (without the surrounding
+ * quotes) with its escapes resolved. `\uXXXX` escapes are encoded as UTF-8;
+ * surrogate pairs are combined. Other bytes are copied as-is.
+ *
+ * Fails if:
+ * - allocation fails
+ * - `sspan` is invalid
+ * - `sspan` contains an unescaped quote or control character
+ * - `sspan` contains an unknown or truncated escape
+ * - `sspan` contains an escaped surrogate which is not part of a pair
+ */
+LSString ls_sspan_json_unescape(LSStringSpan sspan);
+
+// Variants of base64, combined with `|`.
+typedef enum LSBase64Flags {
+	LS_BASE64_STANDARD = 0,
+	// `-` and `_` in place of `+` and `/` (the "base64url" of RFC 4648)
+	LS_BASE64_URL = 1 << 0,
+	// no `=` padding when encoding, and none allowed when decoding
+	LS_BASE64_NO_PADDING = 1 << 1
+} LSBase64Flags;
+
+/*
+ * Appends `sspan` to `bbuf` encoded as base64 (RFC 4648), reserving the exact
+ * length up front.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `sspan` is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_base64(LSByteBuffer *bbuf, LSStringSpan sspan,
+		LSBase64Flags flags);
+
+/*
+ * Decodes the base64 text `sspan` and appends the result to `bbuf`, reserving
+ * the exact length up front. Whitespace is not skipped, and the unused bits of
+ * the last character must be zero, so every input decodes in at most one way.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `sspan` is invalid
+ * - `sspan` contains a character outside the alphabet of `flags`
+ * - `sspan` is not padded as `flags` require
+ * - `sspan` has a length no encoding can have
+ * - `sspan` has non-zero unused bits
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_sspan_decode_base64(LSStringSpan sspan, LSBase64Flags flags,
+		LSByteBuffer *bbuf);
+
+/*
+ * Appends `sspan` to `bbuf` encoded as lowercase hexadecimal, two digits per
+ * byte, reserving the exact length up front. (Not to be confused with
+ * `ls_bbuf_append_hex()`, which formats an integer.)
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `sspan` is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_hex_encoded(LSByteBuffer *bbuf, LSStringSpan sspan);
+
+/*
+ * Decodes the hexadecimal text `sspan` (digits of either case, two per byte)
+ * and appends the result to `bbuf`, reserving the exact length up front.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `sspan` is invalid
+ * - `sspan` has an odd length
+ * - `sspan` contains a non-hexadecimal character
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_sspan_decode_hex(LSStringSpan sspan, LSByteBuffer *bbuf);
+
+/*
+ * Returns the set of the bytes in `sspan` (or in `cstr`, without its null
+ * terminator). An invalid `sspan` (or `NULL` `cstr`) gives the empty set.
+ */
+LSByteSet ls_byte_set_from_sspan(LSStringSpan sspan);
+LSByteSet ls_byte_set_from_cstr(const char *cstr);
+
+/*
+ * Returns the index of the first byte of `sspan` which is in `set`.
+ *
+ * Bytes are classified 32 at a time with SIMD where available, by looking up
+ * both of their nibbles in the bitmap of `set`.
+ *
+ * Constraints:
+ * - `set` is not `NULL`
+ *
+ * Returns `SIZE_MAX` if:
+ * - no byte of `sspan` is in `set`
+ * - `sspan` is invalid
+ */
+size_t ls_sspan_find_first_of(LSStringSpan sspan, const LSByteSet *set);
+
+/*
+ * Like `ls_sspan_find_first_of()`, for the first byte which is not in `set`.
+ */
+size_t ls_sspan_find_first_not_of(LSStringSpan sspan, const LSByteSet *set);
+
+/*
+ * Returns `sspan` without the bytes in `set` at its start and end (e.g. with
+ * `LS_ASCII_WHITESPACE_SET`). An `sspan` made up only of such bytes is trimmed
+ * to an empty span at its end.
+ *
+ * Constraints:
+ * - `set` is not `NULL`
+ *
+ * Fails if:
+ * - `sspan` is invalid
+ */
+LSStringSpan ls_sspan_trim(LSStringSpan sspan, const LSByteSet *set);
+
+/*
+ * Counts the bytes of `sspan` which are in `set`.
+ *
+ * Constraints:
+ * - `set` is not `NULL`
+ *
+ * Returns `0` if:
+ * - `sspan` is invalid
+ */
+size_t ls_sspan_count_of(LSStringSpan sspan, const LSByteSet *set);
+
+/*
+ * Appends `sspan` to `bbuf` percent-encoded: bytes in `charset` are copied
+ * as-is, all others (and `%` itself, always) become `%XX` with uppercase hex
+ * digits.
+ *
+ * The bytes to encode are found with SIMD where available, and the runs in
+ * between are copied in bulk.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ * - `charset` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `sspan` is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_percent_encoded(LSByteBuffer *bbuf, LSStringSpan sspan,
+		const LSByteSet *charset);
+
+/*
+ * Decodes every `%XX` (hex digits of either case) in `sspan` and appends the
+ * result to `bbuf`. Other bytes, `+` included, are copied as-is. At most
+ * `sspan.len` bytes are reserved, once.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `sspan` is invalid
+ * - `sspan` contains a `%` not followed by two hex digits
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_sspan_percent_decode(LSStringSpan sspan, LSByteBuffer *bbuf);
+
+/*
+ * Appends `value` in decimal (or, for `_hex`, in lowercase hexadecimal without
+ * a prefix) to `bbuf`.
+ *
+ * Much faster than `snprintf()`: the digits are written straight into `bbuf`.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_u64(LSByteBuffer *bbuf, uint64_t value);
+LSStatus ls_bbuf_append_i64(LSByteBuffer *bbuf, int64_t value);
+LSStatus ls_bbuf_append_hex(LSByteBuffer *bbuf, uint64_t value);
+
+/*
+ * Like the functions above, but pads the digits with leading zeros to at least
+ * `min_digits` digits. A minus sign goes before the padding and does not count
+ * as a digit (e.g. `-0042` for `-42` and `4`).
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_u64_padded(LSByteBuffer *bbuf, uint64_t value,
+		size_t min_digits);
+LSStatus ls_bbuf_append_i64_padded(LSByteBuffer *bbuf, int64_t value,
+		size_t min_digits);
+LSStatus ls_bbuf_append_hex_padded(LSByteBuffer *bbuf, uint64_t value,
+		size_t min_digits);
+
+/*
+ * Appends the shortest decimal which parses back to exactly `value` (e.g. `0.1`
+ * rather than `0.10000000000000001`) to `bbuf`.
+ *
+ * The layout is that of JavaScript's `Number.prototype.toString()`: plain
+ * digits from `1e-6` up to `1e21`, and `d.ddde+X` / `d.ddde-X` outside of that
+ * (e.g. `1e+21`, `5e-324`). Other values are `-0`, `inf`, `-inf` and `nan`.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_f64(LSByteBuffer *bbuf, double value);
+LSStatus ls_bbuf_append_f32(LSByteBuffer *bbuf, float value);
+
+/*
+ * Appends `value` with exactly `ndecimals` digits after the decimal point (and
+ * no point if `ndecimals` is `0`) to `bbuf`, like `snprintf()` with `%.*f`.
+ *
+ * Values are rounded half to even on their exact binary value, as glibc does.
+ * Up to 22 decimals of values below 2^54 are formatted without `snprintf()`.
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `ndecimals` is greater than `INT_MAX`
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_bbuf_append_f64_fixed(LSByteBuffer *bbuf, double value,
+		size_t ndecimals);
+LSStatus ls_bbuf_append_f32_fixed(LSByteBuffer *bbuf, float value,
+		size_t ndecimals);
+
+/*
+ * Appends `fmt`, formatted like `printf()` with the arguments after it, to
+ * `bbuf`. The output goes straight into `bbuf`, which grows at most once.
+ *
+ * Supports the flags `-`, `0`, `+` and ` `, widths and precisions (also as
+ * `*`), the length modifiers `hh`, `h`, `l`, `ll`, `j`, `z` and `t`, and the
+ * conversions `%d`, `%i`, `%u`, `%x`, `%X`, `%c`, `%s`, `%p`, `%f`, `%F`,
+ * `%e`, `%E`, `%g`, `%G`, `%a`, `%A` and `%%`. Two more take strings of this
+ * library (with the precision limiting their length, as for `%s`):
+ * - `%S` takes an `LSStringSpan`
+ * - `%T` takes an `LSString`
+ *
+ * `%p` is `0x` and lowercase hex digits. `%f` is exact and ignores the locale,
+ * as does everything else but `%e`, `%g` and `%a`, which go through
+ * `snprintf()` (twice).
+ *
+ * Constraints:
+ * - `bbuf` is not `NULL`
+ * - the arguments match `fmt`
+ *
+ * Fails if:
+ * - `bbuf` is invalid
+ * - `fmt` is `NULL`
+ * - `fmt` has an unsupported conversion (e.g. `%n`, `%o`, `%#x` or `%Lf`)
+ * - a `%s` argument is `NULL`
+ * - a `%S` or `%T` argument is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ *
+ * `bbuf` is left unchanged on failure.
+ */
+LSStatus ls_bbuf_appendf(LSByteBuffer *bbuf, const char *fmt, ...);
+LSStatus ls_bbuf_vappendf(LSByteBuffer *bbuf, const char *fmt, va_list args);
+
+/*
+ * Compiles `sspan` into a template: `{name}` is a placeholder for the value of
+ * the slot of `name`, and `{{` and `}}` stand for literal braces. Names are
+ * taken byte for byte (e.g. `{ a }` is not `{a}`).
+ *
+ * Fails if:
+ * - allocation fails
+ * - `sspan` is invalid
+ * - `sspan` has an unmatched brace, a brace within a name or an empty name
+ */
+LSTemplate ls_template_create(LSStringSpan sspan);
+
+/*
+ * Constraints:
+ * - `tmpl` is not `NULL`
+ * - `tmpl` was not previously destroyed
+ */
+void ls_template_destroy(LSTemplate *tmpl);
+
+/*
+ * Returns the slot of the placeholder `name` (without braces), i.e. the index
+ * of its value for `ls_template_render()`.
+ *
+ * Constraints:
+ * - `tmpl` is not `NULL`
+ *
+ * Returns `SIZE_MAX` if:
+ * - `tmpl` is invalid
+ * - `name` is invalid
+ * - `tmpl` has no placeholder `name`
+ */
+size_t ls_template_get_slot(const LSTemplate *tmpl, LSStringSpan name);
+
+/*
+ * Appends `tmpl` to `bbuf`, with every placeholder replaced by the value of its
+ * slot, `values[slot]`. The exact length is reserved up front, so rendering is
+ * one reservation plus copying.
+ *
+ * Constraints:
+ * - `tmpl` is not `NULL`
+ * - `values` points to an array of at least `nvalues` spans
+ *        OR is `NULL`
+ * - `bbuf` is not `NULL`
+ *
+ * Fails if:
+ * - `tmpl` is invalid
+ * - `bbuf` is invalid
+ * - `nvalues` is less than `tmpl->nslots`
+ * - `values` is `NULL` while `nvalues` is not `0`
+ * - a value is invalid
+ * - resulting length would exceed `SIZE_MAX`
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_template_render(const LSTemplate *tmpl, const LSStringSpan *values,
+		size_t nvalues, LSByteBuffer *bbuf);
+
+/*
+ * Parses the number at the start of `sspan` into `*value`, storing the number
+ * of bytes it takes up in `*nconsumed`. Whatever follows the number is left
+ * alone: compare `*nconsumed` with `sspan.len` to require nothing else.
+ *
+ * Integers are decimal digits after an optional sign (`+`, or also `-` for
+ * `_i64`), without any whitespace. Leading zeros are allowed.
+ *
+ * Nothing is allocated and no null terminator is needed.
+ *
+ * Constraints:
+ * - `value` is not `NULL`
+ * - `nconsumed` is not `NULL`
+ *
+ * Fails if:
+ * - `sspan` is invalid
+ * - `sspan` does not start with a number (`*nconsumed` is `0`)
+ * - the number is out of range (`*nconsumed` is its length and `*value` is
+ *   the nearest value in range)
+ */
+LSStatus ls_sspan_parse_u64(LSStringSpan sspan, uint64_t *value,
+		size_t *nconsumed);
+LSStatus ls_sspan_parse_i64(LSStringSpan sspan, int64_t *value,
+		size_t *nconsumed);
+
+/*
+ * Like the functions above, but for the syntax of `strtod()` without hex
+ * floats or leading whitespace: an optional sign, then digits with an optional
+ * decimal point (`.`, whatever the locale) and an optional exponent (e.g.
+ * `-1.5e+3`), or `inf`, `infinity` or `nan` in any case. Rounds to nearest,
+ * ties to even.
+ *
+ * Underflow is not an error: values too small for a `double` become `0` (or
+ * `-0`). Values too large fail with `*value` set to infinity.
+ */
+LSStatus ls_sspan_parse_f64(LSStringSpan sspan, double *value,
+		size_t *nconsumed);
+
+/*
+ * Fails if:
+ * - allocation fails
+ */
+LSLineReader ls_line_reader_create(void);
+
+/*
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `reader` was not previously destroyed
+ */
+void ls_line_reader_destroy(LSLineReader *reader);
+
+/*
+ * Makes `chunk` the next piece of the stream to be split into lines.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `chunk` is valid
+ * - `chunk` outlives all lines yielded from it
+ * - all lines of the previous chunk have been consumed (i.e.
+ *   `ls_line_reader_next()` has returned an invalid `LSStringSpan`)
+ */
+void ls_line_reader_feed(LSLineReader *reader, LSStringSpan chunk);
+
+/*
+ * Yields the next complete line. A yielded line remains valid until the next
+ * call to `ls_line_reader_next()` or `ls_line_reader_finish()`.
+ *
+ * Once no complete lines are left in the current chunk, its remaining bytes are
+ * carried over to the next one and an invalid `LSStringSpan` is returned.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ *
+ * Fails if:
+ * - `reader` is invalid
+ * - there are no complete lines left in the current chunk
+ * - reallocation is attempted and fails (`reader` is then invalidated)
+ */
+LSStringSpan ls_line_reader_next(LSLineReader *reader);
+
+/*
+ * Yields the final line of the stream, if it didn't end with a `'\n'`.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - all lines of the current chunk have been consumed
+ *
+ * Fails if:
+ * - `reader` is invalid
+ * - there is no unterminated line left
+ */
+LSStringSpan ls_line_reader_finish(LSLineReader *reader);
+
+/*
+ * Creates a reader over `input`, with fields separated by `delimiter` (e.g.
+ * `','` or `'\t'`) and records by `"\n"` or `"\r\n"`.
+ *
+ * Constraints:
+ * - `input` outlives the reader and all fields yielded from it
+ *
+ * Fails if:
+ * - `input` is invalid
+ * - `delimiter` is `'"'`, `'\n'` or `'\r'`
+ * - allocation fails
+ */
+LSCsvReader ls_csv_reader_create(LSStringSpan input, LSByte delimiter);
+
+/*
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `reader` was not previously destroyed
+ */
+void ls_csv_reader_destroy(LSCsvReader *reader);
+
+/*
+ * Yields the next record as `*nfields` fields at `*fields`, which remain valid
+ * until the next call to `ls_csv_reader_next()`. At the end of the input,
+ * `*nfields` is set to `0`.
+ *
+ * A field starting with `'"'` is quoted: it runs up to the next lone `'"'`, and
+ * may contain delimiters, newlines and doubled quotes (each standing for one
+ * `'"'`). Anywhere else, `'"'` is an ordinary byte. An empty line is a record
+ * with one empty field, but a final newline does not start another record.
+ *
+ * Constraints:
+ * - `reader` is not `NULL`
+ * - `fields` is not `NULL`
+ * - `nfields` is not `NULL`
+ *
+ * Fails if:
+ * - `reader` is invalid
+ * - the record has a quoted field which is not closed, or whose closing quote
+ *   is followed by anything but a delimiter or the end of the record (the
+ *   reader then stays at the start of the record)
+ * - reallocation is attempted and fails
+ */
+LSStatus ls_csv_reader_next(LSCsvReader *reader, const LSStringSpan **fields,
+		size_t *nfields);
+
 inline bool ls_string_is_valid(LSString string)
 {
 	return string.bytes != NULL;
@@ -501,6 +1470,26 @@ inline bool ls_bbuf_is_valid(LSByteBuffer bbuf)
 	return bbuf.bytes != NULL;
 }
 
+inline bool ls_line_reader_is_valid(LSLineReader reader)
+{
+	return ls_bbuf_is_valid(reader._carry);
+}
+
+inline bool ls_utf8_index_is_valid(LSUtf8Index index)
+{
+	return index._offsets != NULL;
+}
+
+inline bool ls_template_is_valid(LSTemplate tmpl)
+{
+	return tmpl._instrs != NULL;
+}
+
+inline bool ls_csv_reader_is_valid(LSCsvReader reader)
+{
+	return reader._fields != NULL;
+}
+
 inline LSSSOStringType ls_sso_get_type(LSSSOString sso)
 {
 	if (ls_short_string_is_valid(sso._short)) {
@@ -897,4 +1886,19 @@ inline LSStatus ls_bbuf_insert_sso(LSByteBuffer *bbuf, size_t idx,
 	return ls_bbuf_insert(bbuf, idx, bytes, sso.len);
 }
 
+inline void ls_byte_set_add(LSByteSet *set, LSByte byte)
+{
+	set->_bits[byte >> 7][byte & 0x0f] |= (uint8_t)(1u << ((byte >> 4) & 7));
+}
+
+inline void ls_byte_set_remove(LSByteSet *set, LSByte byte)
+{
+	set->_bits[byte >> 7][byte & 0x0f] &= (uint8_t)~(1u << ((byte >> 4) & 7));
+}
+
+inline bool ls_byte_set_contains(const LSByteSet *set, LSByte byte)
+{
+	return (set->_bits[byte >> 7][byte & 0x0f] >> ((byte >> 4) & 7)) & 1;
+}
+
 #endif // loser_h
@@ -0,0 +1,280 @@
+#define _GNU_SOURCE
+
+#include <loser/loser.h>
+#include <loser/loser-async-reader.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NFILES
+#define NFILES 2000
+#endif
+
+#ifndef FILE_SIZE
+#define FILE_SIZE 16384
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 5
+#endif
+
+#ifndef QUEUE_DEPTH
+#define QUEUE_DEPTH 64
+#endif
+
+#define NELEMS(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+enum Method {
+	SEQUENTIAL_READ = 0,
+	ASYNC_READER_URING,
+	ASYNC_READER_THREADS,
+
+	NMETHODS
+};
+
+static const char *METHOD_NAMES[NMETHODS] = {
+	[SEQUENTIAL_READ]      = "sequential read()",
+	[ASYNC_READER_URING]   = "LSAsyncReader (io_uring)",
+	[ASYNC_READER_THREADS] = "LSAsyncReader (threads)",
+};
+
+static char **paths;
+static size_t npaths;
+
+static void generate_files(const char *dir);
+static void list_files(const char *dir);
+static void remove_files(const char *dir);
+static size_t read_sequential(void);
+static size_t read_async(LSAsyncReaderFlags flags, LSAsyncReaderBackend *backend);
+static double now(void);
+
+int main(int argc, char **argv)
+{
+	char tmp_dir[] = "/tmp/loser-bench-XXXXXX";
+	const char *dir = argc > 1 ? argv[1] : NULL;
+
+	if (!dir) {
+		dir = mkdtemp(tmp_dir);
+		if (!dir) {
+			perror("mkdtemp");
+			return 1;
+		}
+
+		fprintf(stderr, "Generating %d files of %d bytes in %s\n",
+				NFILES, FILE_SIZE, dir);
+		generate_files(dir);
+	}
+
+	list_files(dir);
+	fprintf(stderr, "Benchmarking %zu files in %s\n", npaths, dir);
+
+	double best[NMETHODS];
+	size_t nbytes[NMETHODS] = { 0 };
+	bool available[NMETHODS] = { true, true, true };
+	for (size_t m = 0; m < NMETHODS; ++m) {
+		best[m] = 1e300;
+	}
+
+	// the first sequential pass warms the page cache for everyone
+	read_sequential();
+
+	for (size_t round = 0; round < NROUNDS; ++round) {
+		for (size_t m = 0; m < NMETHODS; ++m) {
+			LSAsyncReaderBackend backend;
+
+			double start = now();
+			switch (m) {
+			case SEQUENTIAL_READ:
+				nbytes[m] = read_sequential();
+				break;
+			case ASYNC_READER_URING:
+				nbytes[m] = read_async(LS_ASYNC_READER_DEFAULT,
+						&backend);
+				available[m] = backend == LS_ASYNC_READER_URING;
+				break;
+			case ASYNC_READER_THREADS:
+				nbytes[m] = read_async(LS_ASYNC_READER_NO_URING,
+						&backend);
+				break;
+			}
+			double elapsed = now() - start;
+
+			if (elapsed < best[m]) {
+				best[m] = elapsed;
+			}
+		}
+	}
+
+	printf("== Async Reader Benchmarks (best of %d rounds) ==\n\n",
+			NROUNDS);
+	printf("%-26s : %12s %12s %12s\n", "METHOD", "SECONDS", "FILES/SEC",
+			"MIB/SEC");
+	for (size_t m = 0; m < NMETHODS; ++m) {
+		if (!available[m]) {
+			printf("%-26s : %12s\n", METHOD_NAMES[m], "unavailable");
+			continue;
+		}
+
+		printf("%-26s : %12.6f %12.0f %12.1f\n", METHOD_NAMES[m],
+				best[m], npaths / best[m],
+				nbytes[m] / best[m] / (1024.0 * 1024.0));
+	}
+
+	if (dir == tmp_dir) {
+		remove_files(dir);
+	}
+
+	return 0;
+}
+
+void generate_files(const char *dir)
+{
+	static char contents[FILE_SIZE];
+	for (size_t i = 0; i < sizeof(contents); ++i) {
+		contents[i] = 'a' + i % 26;
+	}
+
+	for (size_t i = 0; i < NFILES; ++i) {
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%zu.txt", dir, i);
+
+		FILE *file = fopen(path, "wb");
+		if (!file) {
+			perror("fopen");
+			exit(1);
+		}
+
+		fwrite(contents, 1, sizeof(contents), file);
+		fclose(file);
+	}
+}
+
+void list_files(const char *dir)
+{
+	DIR *d = opendir(dir);
+	if (!d) {
+		perror("opendir");
+		exit(1);
+	}
+
+	size_t cap = 64;
+	paths = malloc(cap * sizeof(*paths));
+
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL) {
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+		struct stat st;
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		if (npaths == cap) {
+			cap *= 2;
+			paths = realloc(paths, cap * sizeof(*paths));
+		}
+
+		paths[npaths] = malloc(strlen(path) + 1);
+		strcpy(paths[npaths], path);
+		npaths++;
+	}
+
+	closedir(d);
+}
+
+void remove_files(const char *dir)
+{
+	for (size_t i = 0; i < npaths; ++i) {
+		unlink(paths[i]);
+		free(paths[i]);
+	}
+	free(paths);
+
+	rmdir(dir);
+}
+
+size_t read_sequential(void)
+{
+	size_t total = 0;
+
+	for (size_t i = 0; i < npaths; ++i) {
+		int fd = open(paths[i], O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			continue;
+		}
+
+		struct stat st;
+		fstat(fd, &st);
+
+		size_t cap = st.st_size > 0 ? (size_t)st.st_size : 4096;
+		LSByteBuffer bbuf = ls_bbuf_create_with_init_cap(cap);
+
+		ssize_t nread;
+		while ((nread = read(fd, &bbuf.bytes[bbuf.len],
+				bbuf.cap - bbuf.len)) > 0) {
+			bbuf.len += nread;
+			if (bbuf.len == bbuf.cap) {
+				ls_bbuf_expand_by(&bbuf, bbuf.cap);
+			}
+		}
+
+		close(fd);
+
+		total += bbuf.len;
+		ls_bbuf_destroy(&bbuf);
+	}
+
+	return total;
+}
+
+size_t read_async(LSAsyncReaderFlags flags, LSAsyncReaderBackend *backend)
+{
+	LSAsyncReader *reader = ls_async_reader_create(QUEUE_DEPTH, flags);
+	if (!reader) {
+		fputs("Failed to create LSAsyncReader\n", stderr);
+		exit(1);
+	}
+
+	*backend = ls_async_reader_get_backend(reader);
+
+	size_t total = 0;
+	size_t next = 0;
+	LSAsyncRead reads[QUEUE_DEPTH];
+
+	while (next < npaths || ls_async_reader_get_inflight(reader) > 0) {
+		while (next < npaths
+				&& ls_async_reader_get_inflight(reader)
+				< QUEUE_DEPTH) {
+			ls_async_reader_submit(reader, paths[next], NULL);
+			next++;
+		}
+
+		size_t nreads = ls_async_reader_reap(reader, reads,
+				NELEMS(reads), 1);
+		for (size_t i = 0; i < nreads; ++i) {
+			if (reads[i].status == LS_SUCCESS) {
+				total += reads[i].bbuf.len;
+				ls_async_reader_recycle(reader, &reads[i].bbuf);
+			}
+		}
+	}
+
+	ls_async_reader_destroy(reader);
+
+	return total;
+}
+
+double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
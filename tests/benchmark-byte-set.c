@@ -0,0 +1,136 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef DATA_LEN
+#define DATA_LEN (16 * 1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 20
+#endif
+
+enum Function {
+	NAIVE_FIND_FIRST_OF = 0,
+	LS_SSPAN_FIND_FIRST_OF,
+	LS_SSPAN_FIND_FIRST_NOT_OF,
+	NAIVE_COUNT_OF,
+	LS_SSPAN_COUNT_OF,
+	LS_SSPAN_TRIM,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[NAIVE_FIND_FIRST_OF]        = "naive find_first_of loop",
+	[LS_SSPAN_FIND_FIRST_OF]     = "ls_sspan_find_first_of",
+	[LS_SSPAN_FIND_FIRST_NOT_OF] = "ls_sspan_find_first_not_of",
+	[NAIVE_COUNT_OF]             = "naive count_of loop",
+	[LS_SSPAN_COUNT_OF]          = "ls_sspan_count_of",
+	[LS_SSPAN_TRIM]              = "ls_sspan_trim",
+};
+
+static double gbps[NFUNCTIONS];
+
+static size_t naive_find_first_of(LSStringSpan sspan, const LSByteSet *set);
+static size_t naive_count_of(LSStringSpan sspan, const LSByteSet *set);
+
+/*
+ * Scans letters and digits for a set of punctuation (a tokenizer looking for
+ * its next delimiter), with the only delimiter at the very end, so that every
+ * function has to look at every byte. Trimming does the same with whitespace
+ * padding on both sides.
+ */
+int main(void)
+{
+	static const char WORD[] = "abcdefghijklmnopqrstuvwxyzABCDEF0123456789";
+
+	LSByte *data = malloc(DATA_LEN);
+	LSByte *padded = malloc(DATA_LEN);
+
+	for (size_t i = 0; i < DATA_LEN; ++i) {
+		data[i] = (LSByte)WORD[i % (sizeof(WORD) - 1)];
+		padded[i] = i < DATA_LEN / 2 ? ' ' : '\n';
+	}
+	data[DATA_LEN - 1] = ';';
+	padded[DATA_LEN / 2] = 'x';
+
+	LSByteSet delimiters = ls_byte_set_from_cstr(",;:(){}[]<>=+-*/\"'");
+	LSByteSet word_bytes = ls_byte_set_from_cstr(WORD);
+
+	LSStringSpan sspan = ls_sspan_create(data, DATA_LEN);
+	LSStringSpan padded_sspan = ls_sspan_create(padded, DATA_LEN);
+	volatile size_t vol_size;
+
+	fprintf(stderr, "Benchmarking %d bytes\n", DATA_LEN);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		Stopwatch stopwatch = stopwatch_create();
+		stopwatch_start(&stopwatch);
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			switch (func) {
+			case NAIVE_FIND_FIRST_OF:
+				vol_size = naive_find_first_of(sspan, &delimiters);
+				break;
+			case LS_SSPAN_FIND_FIRST_OF:
+				vol_size = ls_sspan_find_first_of(sspan, &delimiters);
+				break;
+			case LS_SSPAN_FIND_FIRST_NOT_OF:
+				vol_size = ls_sspan_find_first_not_of(sspan, &word_bytes);
+				break;
+			case NAIVE_COUNT_OF:
+				vol_size = naive_count_of(sspan, &delimiters);
+				break;
+			case LS_SSPAN_COUNT_OF:
+				vol_size = ls_sspan_count_of(sspan, &delimiters);
+				break;
+			case LS_SSPAN_TRIM:
+				vol_size = ls_sspan_trim(padded_sspan,
+						&LS_ASCII_WHITESPACE_SET).len;
+				break;
+			}
+		}
+		stopwatch_stop(&stopwatch);
+
+		double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+				/ CLOCKS_PER_SEC;
+		gbps[func] = secs > 0 ? (double)DATA_LEN * NROUNDS / secs / 1e9 : 0;
+	}
+
+	(void)vol_size;
+
+	puts("== Throughput (GB/s) ==\n");
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s : %10.2f\n", FUNC_NAMES[func], gbps[func]);
+	}
+
+	free(padded);
+	free(data);
+
+	return 0;
+}
+
+size_t naive_find_first_of(LSStringSpan sspan, const LSByteSet *set)
+{
+	for (size_t i = 0; i < sspan.len; ++i) {
+		if (ls_byte_set_contains(set, sspan.bytes[i])) {
+			return i;
+		}
+	}
+
+	return SIZE_MAX;
+}
+
+size_t naive_count_of(LSStringSpan sspan, const LSByteSet *set)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < sspan.len; ++i) {
+		n += ls_byte_set_contains(set, sspan.bytes[i]);
+	}
+
+	return n;
+}
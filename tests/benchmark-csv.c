@@ -0,0 +1,165 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef NRECORDS
+#define NRECORDS (256 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 5
+#endif
+
+enum Function {
+	NAIVE_SPLIT_AND_COPY = 0,
+	LS_CSV_READER_NEXT,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[NAIVE_SPLIT_AND_COPY] = "byte loop + ls_string_from_sspan",
+	[LS_CSV_READER_NEXT]   = "ls_csv_reader_next",
+};
+
+static double mbps[NFUNCTIONS];
+
+static size_t naive_split_and_copy(LSStringSpan csv);
+static size_t read_all(LSStringSpan csv);
+
+/*
+ * Reads records of 8 fields: numbers, short words, and a free text column
+ * which is quoted about a third of the time (sometimes with doubled quotes in
+ * it). The naive parser walks the bytes one by one and allocates an `LSString`
+ * per field, as a simple ETL job would.
+ */
+int main(void)
+{
+	static const char *const WORDS[] = {
+		"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta",
+	};
+
+	LSByteBuffer csv = ls_bbuf_create();
+
+	srand(1);
+	for (size_t r = 0; r < NRECORDS; ++r) {
+		ls_bbuf_appendf(&csv, "%zu,%d,%s,%s,%d.%02d,",
+				r, rand() % 100000, WORDS[rand() % 8], WORDS[rand() % 8],
+				rand() % 1000, rand() % 100);
+
+		switch (rand() % 6) {
+		case 0:
+			ls_bbuf_appendf(&csv, "\"%s, %s and %s\"",
+					WORDS[rand() % 8], WORDS[rand() % 8],
+					WORDS[rand() % 8]);
+			break;
+		case 1:
+			ls_bbuf_appendf(&csv, "\"the \"\"%s\"\" one\"",
+					WORDS[rand() % 8]);
+			break;
+		default:
+			ls_bbuf_appendf(&csv, "%s %s", WORDS[rand() % 8],
+					WORDS[rand() % 8]);
+			break;
+		}
+
+		ls_bbuf_appendf(&csv, ",%d,%s\n", rand() % 2, WORDS[rand() % 8]);
+	}
+
+	LSStringSpan sspan = ls_sspan_from_bbuf(csv);
+	volatile size_t vol_nfields;
+
+	fprintf(stderr, "Benchmarking %zu bytes\n", sspan.len);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		Stopwatch stopwatch = stopwatch_create();
+		stopwatch_start(&stopwatch);
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			switch (func) {
+			case NAIVE_SPLIT_AND_COPY:
+				vol_nfields = naive_split_and_copy(sspan);
+				break;
+			case LS_CSV_READER_NEXT:
+				vol_nfields = read_all(sspan);
+				break;
+			}
+		}
+		stopwatch_stop(&stopwatch);
+
+		double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+				/ CLOCKS_PER_SEC;
+		mbps[func] = secs > 0 ? (double)sspan.len * NROUNDS / secs / 1e6 : 0;
+	}
+
+	(void)vol_nfields;
+
+	puts("== Throughput (MB/s) ==\n");
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-33s : %10.1f\n", FUNC_NAMES[func], mbps[func]);
+	}
+
+	ls_bbuf_destroy(&csv);
+
+	return 0;
+}
+
+size_t naive_split_and_copy(LSStringSpan csv)
+{
+	LSByteBuffer field = ls_bbuf_create();
+	size_t nfields = 0;
+
+	bool quoted = false;
+	for (size_t i = 0; i <= csv.len; ++i) {
+		LSByte byte = i < csv.len ? csv.bytes[i] : '\n';
+
+		if (quoted) {
+			if (byte != '"') {
+				ls_bbuf_append(&field, &byte, 1);
+			} else if (i + 1 < csv.len && csv.bytes[i + 1] == '"') {
+				ls_bbuf_append(&field, &byte, 1);
+				++i;
+			} else {
+				quoted = false;
+			}
+		} else if (byte == '"' && field.len == 0) {
+			quoted = true;
+		} else if (byte == ',' || byte == '\n') {
+			if (i == csv.len && byte == '\n' && field.len == 0) {
+				break;
+			}
+
+			LSString string = ls_string_from_sspan(
+					ls_sspan_from_bbuf(field));
+			ls_string_destroy(&string);
+			field.len = 0;
+			++nfields;
+		} else {
+			ls_bbuf_append(&field, &byte, 1);
+		}
+	}
+
+	ls_bbuf_destroy(&field);
+
+	return nfields;
+}
+
+size_t read_all(LSStringSpan csv)
+{
+	LSCsvReader reader = ls_csv_reader_create(csv, ',');
+	size_t total = 0;
+
+	const LSStringSpan *fields;
+	size_t nfields;
+	while (ls_csv_reader_next(&reader, &fields, &nfields) == LS_SUCCESS
+			&& nfields > 0) {
+		total += nfields;
+	}
+
+	ls_csv_reader_destroy(&reader);
+
+	return total;
+}
@@ -0,0 +1,151 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef DATA_LEN
+#define DATA_LEN (12 * 1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 10
+#endif
+
+enum Function {
+	NAIVE_BASE64_ENCODE = 0,
+	LS_BBUF_APPEND_BASE64,
+	LS_SSPAN_DECODE_BASE64,
+	NAIVE_HEX_ENCODE,
+	LS_BBUF_APPEND_HEX_ENCODED,
+	LS_SSPAN_DECODE_HEX,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[NAIVE_BASE64_ENCODE]        = "naive base64 table loop",
+	[LS_BBUF_APPEND_BASE64]      = "ls_bbuf_append_base64",
+	[LS_SSPAN_DECODE_BASE64]     = "ls_sspan_decode_base64",
+	[NAIVE_HEX_ENCODE]           = "naive hex table loop",
+	[LS_BBUF_APPEND_HEX_ENCODED] = "ls_bbuf_append_hex_encoded",
+	[LS_SSPAN_DECODE_HEX]        = "ls_sspan_decode_hex",
+};
+
+static double gbps[NFUNCTIONS];
+
+static void naive_base64_encode(LSByteBuffer *bbuf, LSStringSpan sspan);
+static void naive_hex_encode(LSByteBuffer *bbuf, LSStringSpan sspan);
+
+/*
+ * Encodes random binary data, and decodes it back. Throughput is measured in
+ * bytes of binary data. The naive loops reserve up front too, so they only
+ * differ in the encoding itself.
+ */
+int main(void)
+{
+	LSByte *data = malloc(DATA_LEN);
+
+	srand(1);
+	for (size_t i = 0; i < DATA_LEN; ++i) {
+		data[i] = (LSByte)rand();
+	}
+
+	LSStringSpan sspan = ls_sspan_create(data, DATA_LEN);
+
+	LSByteBuffer base64 = ls_bbuf_create();
+	LSByteBuffer hex = ls_bbuf_create();
+	ls_bbuf_append_base64(&base64, sspan, LS_BASE64_STANDARD);
+	ls_bbuf_append_hex_encoded(&hex, sspan);
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	volatile size_t vol_size;
+
+	fprintf(stderr, "Benchmarking %d bytes\n", DATA_LEN);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		Stopwatch stopwatch = stopwatch_create();
+		stopwatch_start(&stopwatch);
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			bbuf.len = 0;
+
+			switch (func) {
+			case NAIVE_BASE64_ENCODE:
+				naive_base64_encode(&bbuf, sspan);
+				break;
+			case LS_BBUF_APPEND_BASE64:
+				ls_bbuf_append_base64(&bbuf, sspan, LS_BASE64_STANDARD);
+				break;
+			case LS_SSPAN_DECODE_BASE64:
+				ls_sspan_decode_base64(ls_sspan_from_bbuf(base64),
+						LS_BASE64_STANDARD, &bbuf);
+				break;
+			case NAIVE_HEX_ENCODE:
+				naive_hex_encode(&bbuf, sspan);
+				break;
+			case LS_BBUF_APPEND_HEX_ENCODED:
+				ls_bbuf_append_hex_encoded(&bbuf, sspan);
+				break;
+			case LS_SSPAN_DECODE_HEX:
+				ls_sspan_decode_hex(ls_sspan_from_bbuf(hex), &bbuf);
+				break;
+			}
+
+			vol_size = bbuf.len;
+		}
+		stopwatch_stop(&stopwatch);
+
+		double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+				/ CLOCKS_PER_SEC;
+		gbps[func] = secs > 0 ? (double)DATA_LEN * NROUNDS / secs / 1e9 : 0;
+	}
+
+	(void)vol_size;
+
+	puts("== Throughput (GB/s) ==\n");
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s : %10.2f\n", FUNC_NAMES[func], gbps[func]);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+	ls_bbuf_destroy(&hex);
+	ls_bbuf_destroy(&base64);
+	free(data);
+
+	return 0;
+}
+
+void naive_base64_encode(LSByteBuffer *bbuf, LSStringSpan sspan)
+{
+	static const char ALPHABET[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	// `DATA_LEN` is a multiple of 3, so there is no tail
+	ls_bbuf_reserve(bbuf, sspan.len / 3 * 4);
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	for (size_t i = 0; i + 3 <= sspan.len; i += 3) {
+		const LSByte *src = &sspan.bytes[i];
+		*dest++ = (LSByte)ALPHABET[src[0] >> 2];
+		*dest++ = (LSByte)ALPHABET[(src[0] & 0x03) << 4 | src[1] >> 4];
+		*dest++ = (LSByte)ALPHABET[(src[1] & 0x0f) << 2 | src[2] >> 6];
+		*dest++ = (LSByte)ALPHABET[src[2] & 0x3f];
+	}
+
+	bbuf->len += sspan.len / 3 * 4;
+}
+
+void naive_hex_encode(LSByteBuffer *bbuf, LSStringSpan sspan)
+{
+	static const char DIGITS[] = "0123456789abcdef";
+
+	ls_bbuf_reserve(bbuf, sspan.len * 2);
+	LSByte *dest = &bbuf->bytes[bbuf->len];
+	for (size_t i = 0; i < sspan.len; ++i) {
+		*dest++ = (LSByte)DIGITS[sspan.bytes[i] >> 4];
+		*dest++ = (LSByte)DIGITS[sspan.bytes[i] & 0x0f];
+	}
+
+	bbuf->len += sspan.len * 2;
+}
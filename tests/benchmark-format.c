@@ -0,0 +1,198 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef NVALUES
+#define NVALUES (1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 10
+#endif
+
+enum Function {
+	SNPRINTF_U64 = 0,
+	LS_BBUF_APPEND_U64,
+	SNPRINTF_I64,
+	LS_BBUF_APPEND_I64,
+	SNPRINTF_HEX,
+	LS_BBUF_APPEND_HEX,
+	SNPRINTF_F64,
+	LS_BBUF_APPEND_F64,
+	SNPRINTF_F32,
+	LS_BBUF_APPEND_F32,
+	SNPRINTF_F64_FIXED,
+	LS_BBUF_APPEND_F64_FIXED,
+	SNPRINTF_LOG_LINE,
+	LS_BBUF_APPENDF_LOG_LINE,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[SNPRINTF_U64]       = "snprintf (%llu)",
+	[LS_BBUF_APPEND_U64] = "ls_bbuf_append_u64",
+	[SNPRINTF_I64]       = "snprintf (%lld)",
+	[LS_BBUF_APPEND_I64] = "ls_bbuf_append_i64",
+	[SNPRINTF_HEX]       = "snprintf (%llx)",
+	[LS_BBUF_APPEND_HEX] = "ls_bbuf_append_hex",
+	[SNPRINTF_F64]       = "snprintf (%.17g)",
+	[LS_BBUF_APPEND_F64] = "ls_bbuf_append_f64",
+	[SNPRINTF_F32]       = "snprintf (%.9g)",
+	[LS_BBUF_APPEND_F32] = "ls_bbuf_append_f32",
+	[SNPRINTF_F64_FIXED]       = "snprintf (%.6f)",
+	[LS_BBUF_APPEND_F64_FIXED] = "ls_bbuf_append_f64_fixed (6)",
+	[SNPRINTF_LOG_LINE]        = "snprintf (log line)",
+	[LS_BBUF_APPENDF_LOG_LINE] = "ls_bbuf_appendf (log line)",
+};
+
+static double mvps[NFUNCTIONS];
+
+static uint64_t random_u64(void);
+
+/*
+ * The values are random, with their magnitudes spread evenly over all digit
+ * counts (for floats, from 1e-6 to 1e9, like typical metrics). The
+ * `snprintf()` rows include appending the result, since that is what the
+ * library functions replace. `%.17g` and `%.9g` are what it takes for
+ * `snprintf()` to round-trip, although the output is often longer. The log
+ * lines mix a string, a span, both integers and a fixed-point float.
+ */
+int main(void)
+{
+	static const double SCALES[] = { 1e-6, 1e-3, 1, 1e3, 1e6, 1e9 };
+
+	uint64_t *values = malloc(NVALUES * sizeof(*values));
+	double *fvalues = malloc(NVALUES * sizeof(*fvalues));
+
+	srand(1);
+	for (size_t i = 0; i < NVALUES; ++i) {
+		values[i] = random_u64() >> (rand() % 64);
+		fvalues[i] = (double)(random_u64() >> 11) * 0x1p-53
+				* SCALES[rand() % 6];
+	}
+
+	static const char LOG_FORMAT[] =
+			"%s [%.*s] id=%llu offset=%lld latency=%.3fms\n";
+	static const char LS_LOG_FORMAT[] =
+			"%s [%S] id=%llu offset=%lld latency=%.3fms\n";
+	LSStringSpan component = ls_sspan_from_cstr("http.server");
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	volatile size_t vol_size;
+
+	fprintf(stderr, "Benchmarking %d values\n", NVALUES);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		Stopwatch stopwatch = stopwatch_create();
+		stopwatch_start(&stopwatch);
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			bbuf.len = 0;
+
+			for (size_t i = 0; i < NVALUES; ++i) {
+				uint64_t value = values[i];
+				double fvalue = fvalues[i];
+				char chars[128];
+				int len;
+
+				switch (func) {
+				case SNPRINTF_U64:
+					len = snprintf(chars, sizeof(chars), "%llu",
+							(unsigned long long)value);
+					ls_bbuf_append(&bbuf, (LSByte *)chars, len);
+					break;
+				case LS_BBUF_APPEND_U64:
+					ls_bbuf_append_u64(&bbuf, value);
+					break;
+				case SNPRINTF_I64:
+					len = snprintf(chars, sizeof(chars), "%lld",
+							(long long)value);
+					ls_bbuf_append(&bbuf, (LSByte *)chars, len);
+					break;
+				case LS_BBUF_APPEND_I64:
+					ls_bbuf_append_i64(&bbuf, (int64_t)value);
+					break;
+				case SNPRINTF_HEX:
+					len = snprintf(chars, sizeof(chars), "%llx",
+							(unsigned long long)value);
+					ls_bbuf_append(&bbuf, (LSByte *)chars, len);
+					break;
+				case LS_BBUF_APPEND_HEX:
+					ls_bbuf_append_hex(&bbuf, value);
+					break;
+				case SNPRINTF_F64:
+					len = snprintf(chars, sizeof(chars), "%.17g",
+							fvalue);
+					ls_bbuf_append(&bbuf, (LSByte *)chars, len);
+					break;
+				case LS_BBUF_APPEND_F64:
+					ls_bbuf_append_f64(&bbuf, fvalue);
+					break;
+				case SNPRINTF_F32:
+					len = snprintf(chars, sizeof(chars), "%.9g",
+							(double)(float)fvalue);
+					ls_bbuf_append(&bbuf, (LSByte *)chars, len);
+					break;
+				case LS_BBUF_APPEND_F32:
+					ls_bbuf_append_f32(&bbuf, (float)fvalue);
+					break;
+				case SNPRINTF_F64_FIXED:
+					len = snprintf(chars, sizeof(chars), "%.6f",
+							fvalue);
+					ls_bbuf_append(&bbuf, (LSByte *)chars, len);
+					break;
+				case LS_BBUF_APPEND_F64_FIXED:
+					ls_bbuf_append_f64_fixed(&bbuf, fvalue, 6);
+					break;
+				case SNPRINTF_LOG_LINE:
+					len = snprintf(chars, sizeof(chars), LOG_FORMAT,
+							"INFO", (int)component.len,
+							(const char *)component.bytes,
+							(unsigned long long)value,
+							(long long)value, fvalue);
+					ls_bbuf_append(&bbuf, (LSByte *)chars, len);
+					break;
+				case LS_BBUF_APPENDF_LOG_LINE:
+					ls_bbuf_appendf(&bbuf, LS_LOG_FORMAT, "INFO",
+							component, (unsigned long long)value,
+							(long long)value, fvalue);
+					break;
+				}
+			}
+
+			vol_size = bbuf.len;
+		}
+		stopwatch_stop(&stopwatch);
+
+		double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+				/ CLOCKS_PER_SEC;
+		mvps[func] = secs > 0 ? (double)NVALUES * NROUNDS / secs / 1e6 : 0;
+	}
+
+	(void)vol_size;
+
+	puts("== Throughput (million values/s) ==\n");
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s : %10.1f\n", FUNC_NAMES[func], mvps[func]);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+	free(fvalues);
+	free(values);
+
+	return 0;
+}
+
+uint64_t random_u64(void)
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		value = (value << 16) ^ (uint64_t)(rand() & 0xffff);
+	}
+
+	return value;
+}
@@ -74,6 +74,7 @@ enum Function {
 	UOA_LS_SHORT_STRING_FROM_SSPAN,
 	UOA_LS_SHORT_STRING_FROM_CHARS,
 	UOA_LS_SHORT_STRING_FROM_CSTR,
+	UOA_LS_SHORT_STRING_EQUALS,
 	UOA_LS_SHORT_STRING_INVALIDATE,
 	UOA_LS_SSO_GET_TYPE,
 	UOA_LS_SSO_IS_VALID,
@@ -85,6 +86,7 @@ enum Function {
 	UOA_LS_SSO_FROM_SSPAN,
 	UOA_LS_SSO_FROM_CHARS,
 	UOA_LS_SSO_FROM_CSTR,
+	UOA_LS_SSO_EQUALS,
 	UOA_LS_SSO_DESTROY,
 	UOA_LS_SSO_INVALIDATE,
 	UOA_LS_SSO_MOVE,
@@ -130,6 +132,7 @@ enum Function {
 	AOU_LS_SHORT_STRING_FROM_SSPAN,
 	AOU_LS_SHORT_STRING_FROM_CHARS,
 	AOU_LS_SHORT_STRING_FROM_CSTR,
+	AOU_LS_SHORT_STRING_EQUALS,
 	AOU_LS_SHORT_STRING_INVALIDATE,
 	AOU_LS_SSO_GET_TYPE,
 	AOU_LS_SSO_IS_VALID,
@@ -141,6 +144,7 @@ enum Function {
 	AOU_LS_SSO_FROM_SSPAN,
 	AOU_LS_SSO_FROM_CHARS,
 	AOU_LS_SSO_FROM_CSTR,
+	AOU_LS_SSO_EQUALS,
 	AOU_LS_SSO_DESTROY,
 	AOU_LS_SSO_INVALIDATE,
 	AOU_LS_SSO_MOVE,
@@ -195,6 +199,7 @@ static const char *FUNC_NAMES[NFUNCTIONS] = {
 	[UOA_LS_SHORT_STRING_FROM_SSPAN]      = "[uoa]ls_short_string_from_sspan",
 	[UOA_LS_SHORT_STRING_FROM_CHARS]      = "[uoa]ls_short_string_from_chars",
 	[UOA_LS_SHORT_STRING_FROM_CSTR]       = "[uoa]ls_short_string_from_cstr",
+	[UOA_LS_SHORT_STRING_EQUALS]          = "[uoa]ls_short_string_equals",
 	[UOA_LS_SHORT_STRING_INVALIDATE]      = "[uoa]ls_short_string_invalidate",
 	[UOA_LS_SSO_GET_TYPE]                 = "[uoa]ls_sso_get_type",
 	[UOA_LS_SSO_IS_VALID]                 = "[uoa]ls_sso_is_valid",
@@ -206,6 +211,7 @@ static const char *FUNC_NAMES[NFUNCTIONS] = {
 	[UOA_LS_SSO_FROM_SSPAN]               = "[uoa]ls_sso_from_sspan",
 	[UOA_LS_SSO_FROM_CHARS]               = "[uoa]ls_sso_from_chars",
 	[UOA_LS_SSO_FROM_CSTR]                = "[uoa]ls_sso_from_cstr",
+	[UOA_LS_SSO_EQUALS]                   = "[uoa]ls_sso_equals",
 	[UOA_LS_SSO_DESTROY]                  = "[uoa]ls_sso_destroy",
 	[UOA_LS_SSO_INVALIDATE]               = "[uoa]ls_sso_invalidate",
 	[UOA_LS_SSO_MOVE]                     = "[uoa]ls_sso_move",
@@ -251,6 +257,7 @@ static const char *FUNC_NAMES[NFUNCTIONS] = {
 	[AOU_LS_SHORT_STRING_FROM_SSPAN]      = "[aou]ls_short_string_from_sspan",
 	[AOU_LS_SHORT_STRING_FROM_CHARS]      = "[aou]ls_short_string_from_chars",
 	[AOU_LS_SHORT_STRING_FROM_CSTR]       = "[aou]ls_short_string_from_cstr",
+	[AOU_LS_SHORT_STRING_EQUALS]          = "[aou]ls_short_string_equals",
 	[AOU_LS_SHORT_STRING_INVALIDATE]      = "[aou]ls_short_string_invalidate",
 	[AOU_LS_SSO_GET_TYPE]                 = "[aou]ls_sso_get_type",
 	[AOU_LS_SSO_IS_VALID]                 = "[aou]ls_sso_is_valid",
@@ -262,6 +269,7 @@ static const char *FUNC_NAMES[NFUNCTIONS] = {
 	[AOU_LS_SSO_FROM_SSPAN]               = "[aou]ls_sso_from_sspan",
 	[AOU_LS_SSO_FROM_CHARS]               = "[aou]ls_sso_from_chars",
 	[AOU_LS_SSO_FROM_CSTR]                = "[aou]ls_sso_from_cstr",
+	[AOU_LS_SSO_EQUALS]                   = "[aou]ls_sso_equals",
 	[AOU_LS_SSO_DESTROY]                  = "[aou]ls_sso_destroy",
 	[AOU_LS_SSO_INVALIDATE]               = "[aou]ls_sso_invalidate",
 	[AOU_LS_SSO_MOVE]                     = "[aou]ls_sso_move",
@@ -537,6 +545,11 @@ void benchmark_text(const char *cstr, size_t len_tag_idx)
 				*iter = ls_short_string_from_cstr(cstr);
 			});
 
+	BENCHMARK(UOA_LS_SHORT_STRING_EQUALS, len_tag_idx,
+			FOREACH (LSShortString, iter, uoa.short_strings) {
+				vol_int = ls_short_string_equals(*iter, short_string);
+			});
+
 	BENCHMARK(UOA_LS_SHORT_STRING_INVALIDATE, len_tag_idx,
 			FOREACH (LSShortString, iter, uoa.short_strings) {
 				ls_short_string_invalidate(iter);
@@ -624,6 +637,11 @@ void benchmark_text(const char *cstr, size_t len_tag_idx)
 				*iter = ls_sso_from_cstr(cstr);
 			});
 
+	BENCHMARK(UOA_LS_SSO_EQUALS, len_tag_idx,
+			FOREACH (LSSSOString, iter, uoa.ssos) {
+				vol_int = ls_sso_equals(*iter, sso);
+			});
+
 	BENCHMARK(UOA_LS_SSO_DESTROY, len_tag_idx,
 			FOREACH (LSSSOString, iter, uoa.ssos) {
 				ls_sso_destroy(iter);
@@ -986,6 +1004,11 @@ void benchmark_text(const char *cstr, size_t len_tag_idx)
 				*iter = ls_short_string_from_cstr(cstr);
 			});
 
+	BENCHMARK(AOU_LS_SHORT_STRING_EQUALS, len_tag_idx,
+			FOREACH_AOU (StringUnion, LSShortString, short_string, iter, aou) {
+				vol_int = ls_short_string_equals(*iter, short_string);
+			});
+
 	BENCHMARK(AOU_LS_SHORT_STRING_INVALIDATE, len_tag_idx,
 			FOREACH_AOU (StringUnion, LSShortString, short_string, iter, aou) {
 				ls_short_string_invalidate(iter);
@@ -1065,6 +1088,11 @@ void benchmark_text(const char *cstr, size_t len_tag_idx)
 				*iter = ls_sso_from_cstr(cstr);
 			});
 
+	BENCHMARK(AOU_LS_SSO_EQUALS, len_tag_idx,
+			FOREACH_AOU (StringUnion, LSSSOString, sso, iter, aou) {
+				vol_int = ls_sso_equals(*iter, sso);
+			});
+
 	BENCHMARK(AOU_LS_SSO_DESTROY, len_tag_idx,
 			FOREACH_AOU (StringUnion, LSSSOString, sso, iter, aou) {
 				ls_sso_destroy(iter);
@@ -0,0 +1,178 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef TEXT_LEN
+#define TEXT_LEN (16 * 1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 10
+#endif
+
+enum Text {
+	TEXT_CLEAN = 0,
+	TEXT_SPARSE,
+	TEXT_DENSE,
+
+	NTEXTS
+};
+
+static const char *TEXT_NAMES[NTEXTS] = {
+	[TEXT_CLEAN]  = "clean",
+	[TEXT_SPARSE] = "sparse",
+	[TEXT_DENSE]  = "dense",
+};
+
+// one byte in this many needs escaping
+static const int ESCAPE_PERIODS[NTEXTS] = {
+	[TEXT_CLEAN]  = 0,
+	[TEXT_SPARSE] = 200,
+	[TEXT_DENSE]  = 10,
+};
+
+enum Function {
+	NAIVE_ESCAPE = 0,
+	LS_BBUF_APPEND_JSON_ESCAPED,
+	LS_SSPAN_JSON_UNESCAPE,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[NAIVE_ESCAPE]                = "naive byte-by-byte escaping",
+	[LS_BBUF_APPEND_JSON_ESCAPED] = "ls_bbuf_append_json_escaped",
+	[LS_SSPAN_JSON_UNESCAPE]      = "ls_sspan_json_unescape",
+};
+
+static double gbps[NFUNCTIONS][NTEXTS];
+
+static void naive_escape(LSByteBuffer *bbuf, LSStringSpan sspan);
+
+/*
+ * Escapes (and unescapes) text which is mostly ASCII letters and spaces, with
+ * quotes, backslashes and newlines mixed in at different rates. Throughput is
+ * measured in unescaped bytes.
+ */
+int main(void)
+{
+	static const LSByte SPECIALS[] = { '"', '\\', '\n', '\t', 0x01 };
+
+	LSByte *texts[NTEXTS];
+	LSByteBuffer escaped[NTEXTS];
+
+	srand(1);
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		texts[kind] = malloc(TEXT_LEN);
+		for (size_t i = 0; i < TEXT_LEN; ++i) {
+			int period = ESCAPE_PERIODS[kind];
+			texts[kind][i] = period != 0 && rand() % period == 0
+					? SPECIALS[rand() % sizeof(SPECIALS)]
+					: rand() % 8 == 0 ? ' '
+					: (LSByte)('a' + rand() % 26);
+		}
+
+		escaped[kind] = ls_bbuf_create();
+		ls_bbuf_append_json_escaped(&escaped[kind],
+				ls_sspan_create(texts[kind], TEXT_LEN));
+	}
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	volatile size_t vol_size;
+
+	fprintf(stderr, "Benchmarking %d bytes\n", TEXT_LEN);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		for (size_t kind = 0; kind < NTEXTS; ++kind) {
+			LSStringSpan sspan = ls_sspan_create(texts[kind], TEXT_LEN);
+			LSString string;
+
+			Stopwatch stopwatch = stopwatch_create();
+			stopwatch_start(&stopwatch);
+			for (size_t round = 0; round < NROUNDS; ++round) {
+				switch (func) {
+				case NAIVE_ESCAPE:
+					bbuf.len = 0;
+					naive_escape(&bbuf, sspan);
+					vol_size = bbuf.len;
+					break;
+				case LS_BBUF_APPEND_JSON_ESCAPED:
+					bbuf.len = 0;
+					ls_bbuf_append_json_escaped(&bbuf, sspan);
+					vol_size = bbuf.len;
+					break;
+				case LS_SSPAN_JSON_UNESCAPE:
+					string = ls_sspan_json_unescape(
+							ls_sspan_from_bbuf(escaped[kind]));
+					vol_size = string.len;
+					ls_string_destroy(&string);
+					break;
+				}
+			}
+			stopwatch_stop(&stopwatch);
+
+			double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+					/ CLOCKS_PER_SEC;
+			gbps[func][kind] = secs > 0
+					? (double)TEXT_LEN * NROUNDS / secs / 1e9
+					: 0;
+		}
+	}
+
+	(void)vol_size;
+
+	puts("== Throughput (GB/s) ==\n");
+	printf("%-30s :", "TEXT");
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		printf("%10s", TEXT_NAMES[kind]);
+	}
+	putchar('\n');
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s :", FUNC_NAMES[func]);
+		for (size_t kind = 0; kind < NTEXTS; ++kind) {
+			printf("%10.2f", gbps[func][kind]);
+		}
+		putchar('\n');
+	}
+
+	ls_bbuf_destroy(&bbuf);
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		ls_bbuf_destroy(&escaped[kind]);
+		free(texts[kind]);
+	}
+
+	return 0;
+}
+
+void naive_escape(LSByteBuffer *bbuf, LSStringSpan sspan)
+{
+	for (size_t i = 0; i < sspan.len; ++i) {
+		LSByte byte = sspan.bytes[i];
+		switch (byte) {
+		case '"':
+			ls_bbuf_append(bbuf, (const LSByte *)"\\\"", 2);
+			break;
+		case '\\':
+			ls_bbuf_append(bbuf, (const LSByte *)"\\\\", 2);
+			break;
+		case '\n':
+			ls_bbuf_append(bbuf, (const LSByte *)"\\n", 2);
+			break;
+		case '\t':
+			ls_bbuf_append(bbuf, (const LSByte *)"\\t", 2);
+			break;
+		default:
+			if (byte < 0x20) {
+				ls_bbuf_appendf(bbuf, "\\u%04x", (unsigned)byte);
+			} else {
+				ls_bbuf_append(bbuf, &byte, 1);
+			}
+			break;
+		}
+	}
+}
@@ -0,0 +1,124 @@
+#define _GNU_SOURCE
+
+#include <loser/loser.h>
+#include <loser/loser-thread-pool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NELEMS
+#define NELEMS (4 * 1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 3
+#endif
+
+#define NELEMS_OF(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+/*
+ * Thread counts beyond the number of online CPUs are skipped, as they can only
+ * measure oversubscription.
+ */
+static const size_t THREAD_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+enum { MIN_LEN = 8, MAX_LEN = 40 };
+
+static void fill_sspans(LSStringSpan *sspans, LSByte *pool);
+static double now(void);
+
+int main(void)
+{
+	LSByte *pool_bytes = malloc((size_t)NELEMS * MAX_LEN);
+	LSStringSpan *sspans = malloc(NELEMS * sizeof(*sspans));
+	LSStringSpan *work = malloc(NELEMS * sizeof(*work));
+
+	fill_sspans(sspans, pool_bytes);
+
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	fprintf(stderr, "Benchmarking %d random strings on %ld CPUs\n",
+			NELEMS, ncpus);
+
+	// the single-threaded sort is the baseline for the speedups
+	double baseline = 0;
+	for (size_t round = 0; round < NROUNDS; ++round) {
+		memcpy(work, sspans, NELEMS * sizeof(*work));
+
+		double start = now();
+		ls_sspan_sort(work, NELEMS);
+		double secs = now() - start;
+
+		if (round == 0 || secs < baseline) {
+			baseline = secs;
+		}
+	}
+
+	puts("== Wall time per sort (best of rounds) ==\n");
+	printf("%-30s : %10.3f s\n", "ls_sspan_sort", baseline);
+
+	for (size_t t = 0; t < NELEMS_OF(THREAD_COUNTS); ++t) {
+		size_t nthreads = THREAD_COUNTS[t];
+		if (nthreads > 1 && ncpus > 0 && nthreads > (size_t)ncpus) {
+			break;
+		}
+
+		LSThreadPool *pool = ls_thread_pool_create(nthreads);
+		if (!pool) {
+			fprintf(stderr, "Could not create %zu threads\n", nthreads);
+			break;
+		}
+
+		double best = 0;
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			memcpy(work, sspans, NELEMS * sizeof(*work));
+
+			double start = now();
+			ls_sspan_parallel_sort(pool, work, NELEMS);
+			double secs = now() - start;
+
+			if (round == 0 || secs < best) {
+				best = secs;
+			}
+		}
+
+		ls_thread_pool_destroy(pool);
+
+		char name[64];
+		snprintf(name, sizeof(name), "ls_sspan_parallel_sort (%zu)",
+				nthreads);
+		printf("%-30s : %10.3f s  (%.2fx)\n", name, best,
+				best > 0 ? baseline / best : 0);
+	}
+
+	free(pool_bytes);
+	free(sspans);
+	free(work);
+
+	return 0;
+}
+
+void fill_sspans(LSStringSpan *sspans, LSByte *pool)
+{
+	srand(1);
+
+	for (size_t i = 0; i < NELEMS; ++i) {
+		LSByte *bytes = &pool[i * MAX_LEN];
+		size_t len = MIN_LEN + rand() % (MAX_LEN - MIN_LEN + 1);
+
+		for (size_t j = 0; j < len; ++j) {
+			bytes[j] = 'a' + rand() % 26;
+		}
+
+		sspans[i] = ls_sspan_create(bytes, len);
+	}
+}
+
+double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,170 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef NVALUES
+#define NVALUES (1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 10
+#endif
+
+enum Function {
+	STRTOULL = 0,
+	LS_SSPAN_PARSE_U64,
+	STRTOLL,
+	LS_SSPAN_PARSE_I64,
+	STRTOD,
+	LS_SSPAN_PARSE_F64,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[STRTOULL]           = "strtoull (copied)",
+	[LS_SSPAN_PARSE_U64] = "ls_sspan_parse_u64",
+	[STRTOLL]            = "strtoll (copied)",
+	[LS_SSPAN_PARSE_I64] = "ls_sspan_parse_i64",
+	[STRTOD]             = "strtod (copied)",
+	[LS_SSPAN_PARSE_F64] = "ls_sspan_parse_f64",
+};
+
+static double mvps[NFUNCTIONS];
+
+static uint64_t random_u64(void);
+
+/*
+ * The tokens are spans into one comma-separated text, like fields of a CSV
+ * line: integers with their magnitudes spread evenly over all digit counts,
+ * and shortest round-trip doubles from 1e-6 to 1e9. The `strto*()` rows
+ * include copying each token into an `LSString` first, since that is what
+ * the library functions replace.
+ */
+int main(void)
+{
+	static const double SCALES[] = { 1e-6, 1e-3, 1, 1e3, 1e6, 1e9 };
+
+	LSByteBuffer int_text = ls_bbuf_create();
+	LSByteBuffer float_text = ls_bbuf_create();
+	size_t *int_ends = malloc(NVALUES * sizeof(*int_ends));
+	size_t *float_ends = malloc(NVALUES * sizeof(*float_ends));
+
+	srand(1);
+	for (size_t i = 0; i < NVALUES; ++i) {
+		uint64_t value = random_u64() >> (rand() % 64);
+		ls_bbuf_append_i64(&int_text, (int64_t)(value >> 1));
+		int_ends[i] = int_text.len;
+		ls_bbuf_append(&int_text, (const LSByte *)",", 1);
+
+		double fvalue = (double)(random_u64() >> 11) * 0x1p-53
+				* SCALES[rand() % 6];
+		ls_bbuf_append_f64(&float_text, fvalue);
+		float_ends[i] = float_text.len;
+		ls_bbuf_append(&float_text, (const LSByte *)",", 1);
+	}
+
+	LSStringSpan *int_tokens = malloc(NVALUES * sizeof(*int_tokens));
+	LSStringSpan *float_tokens = malloc(NVALUES * sizeof(*float_tokens));
+	for (size_t i = 0; i < NVALUES; ++i) {
+		size_t int_start = i == 0 ? 0 : int_ends[i - 1] + 1;
+		size_t float_start = i == 0 ? 0 : float_ends[i - 1] + 1;
+
+		int_tokens[i] = ls_sspan_create(&int_text.bytes[int_start],
+				int_ends[i] - int_start);
+		float_tokens[i] = ls_sspan_create(&float_text.bytes[float_start],
+				float_ends[i] - float_start);
+	}
+
+	volatile uint64_t vol_sum;
+
+	fprintf(stderr, "Benchmarking %d values\n", NVALUES);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		Stopwatch stopwatch = stopwatch_create();
+		stopwatch_start(&stopwatch);
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			uint64_t sum = 0;
+
+			for (size_t i = 0; i < NVALUES; ++i) {
+				LSStringSpan token = func < STRTOD ? int_tokens[i]
+						: float_tokens[i];
+				uint64_t u;
+				int64_t s;
+				double d;
+				size_t nconsumed;
+				LSString copy;
+
+				switch (func) {
+				case STRTOULL:
+					copy = ls_string_from_sspan(token);
+					sum += strtoull((const char *)copy.bytes, NULL,
+							10);
+					ls_string_destroy(&copy);
+					break;
+				case LS_SSPAN_PARSE_U64:
+					ls_sspan_parse_u64(token, &u, &nconsumed);
+					sum += u;
+					break;
+				case STRTOLL:
+					copy = ls_string_from_sspan(token);
+					sum += (uint64_t)strtoll(
+							(const char *)copy.bytes, NULL, 10);
+					ls_string_destroy(&copy);
+					break;
+				case LS_SSPAN_PARSE_I64:
+					ls_sspan_parse_i64(token, &s, &nconsumed);
+					sum += (uint64_t)s;
+					break;
+				case STRTOD:
+					copy = ls_string_from_sspan(token);
+					sum += (uint64_t)strtod(
+							(const char *)copy.bytes, NULL);
+					ls_string_destroy(&copy);
+					break;
+				case LS_SSPAN_PARSE_F64:
+					ls_sspan_parse_f64(token, &d, &nconsumed);
+					sum += (uint64_t)d;
+					break;
+				}
+			}
+
+			vol_sum = sum;
+		}
+		stopwatch_stop(&stopwatch);
+
+		double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+				/ CLOCKS_PER_SEC;
+		mvps[func] = secs > 0 ? (double)NVALUES * NROUNDS / secs / 1e6 : 0;
+	}
+
+	(void)vol_sum;
+
+	puts("== Throughput (million values/s) ==\n");
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s : %10.1f\n", FUNC_NAMES[func], mvps[func]);
+	}
+
+	free(float_tokens);
+	free(int_tokens);
+	free(float_ends);
+	free(int_ends);
+	ls_bbuf_destroy(&float_text);
+	ls_bbuf_destroy(&int_text);
+
+	return 0;
+}
+
+uint64_t random_u64(void)
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		value = (value << 16) ^ (uint64_t)(rand() & 0xffff);
+	}
+
+	return value;
+}
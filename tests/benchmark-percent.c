@@ -0,0 +1,164 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef TEXT_LEN
+#define TEXT_LEN (16 * 1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 10
+#endif
+
+enum Text {
+	TEXT_CLEAN = 0,
+	TEXT_SPARSE,
+	TEXT_DENSE,
+
+	NTEXTS
+};
+
+static const char *TEXT_NAMES[NTEXTS] = {
+	[TEXT_CLEAN]  = "clean",
+	[TEXT_SPARSE] = "sparse",
+	[TEXT_DENSE]  = "dense",
+};
+
+// one byte in this many needs encoding
+static const int ENCODE_PERIODS[NTEXTS] = {
+	[TEXT_CLEAN]  = 0,
+	[TEXT_SPARSE] = 100,
+	[TEXT_DENSE]  = 8,
+};
+
+enum Function {
+	NAIVE_ENCODE = 0,
+	LS_BBUF_APPEND_PERCENT_ENCODED,
+	LS_SSPAN_PERCENT_DECODE,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[NAIVE_ENCODE]                   = "naive byte-by-byte encoding",
+	[LS_BBUF_APPEND_PERCENT_ENCODED] = "ls_bbuf_append_percent_encoded",
+	[LS_SSPAN_PERCENT_DECODE]        = "ls_sspan_percent_decode",
+};
+
+static double gbps[NFUNCTIONS][NTEXTS];
+
+static void naive_encode(LSByteBuffer *bbuf, LSStringSpan sspan,
+		const LSByteSet *charset);
+
+/*
+ * Encodes (and decodes) text which is mostly letters, digits and `/`, with
+ * spaces, `?`, `#` and non-ASCII bytes mixed in at different rates, as a path
+ * component. Throughput is measured in unencoded bytes.
+ */
+int main(void)
+{
+	static const LSByte UNSAFE[] = { ' ', '?', '#', '"', 0xc3, 0xa9 };
+	static const char SAFE[] = "abcdefghijklmnopqrstuvwxyz0123456789/-.";
+
+	LSByte *texts[NTEXTS];
+	LSByteBuffer encoded[NTEXTS];
+
+	srand(1);
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		texts[kind] = malloc(TEXT_LEN);
+		for (size_t i = 0; i < TEXT_LEN; ++i) {
+			int period = ENCODE_PERIODS[kind];
+			texts[kind][i] = period != 0 && rand() % period == 0
+					? UNSAFE[rand() % sizeof(UNSAFE)]
+					: (LSByte)SAFE[rand() % (sizeof(SAFE) - 1)];
+		}
+
+		encoded[kind] = ls_bbuf_create();
+		ls_bbuf_append_percent_encoded(&encoded[kind],
+				ls_sspan_create(texts[kind], TEXT_LEN),
+				&LS_URL_PATH_SET);
+	}
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	volatile size_t vol_size;
+
+	fprintf(stderr, "Benchmarking %d bytes\n", TEXT_LEN);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		for (size_t kind = 0; kind < NTEXTS; ++kind) {
+			LSStringSpan sspan = ls_sspan_create(texts[kind], TEXT_LEN);
+
+			Stopwatch stopwatch = stopwatch_create();
+			stopwatch_start(&stopwatch);
+			for (size_t round = 0; round < NROUNDS; ++round) {
+				bbuf.len = 0;
+
+				switch (func) {
+				case NAIVE_ENCODE:
+					naive_encode(&bbuf, sspan, &LS_URL_PATH_SET);
+					break;
+				case LS_BBUF_APPEND_PERCENT_ENCODED:
+					ls_bbuf_append_percent_encoded(&bbuf, sspan,
+							&LS_URL_PATH_SET);
+					break;
+				case LS_SSPAN_PERCENT_DECODE:
+					ls_sspan_percent_decode(
+							ls_sspan_from_bbuf(encoded[kind]),
+							&bbuf);
+					break;
+				}
+
+				vol_size = bbuf.len;
+			}
+			stopwatch_stop(&stopwatch);
+
+			double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+					/ CLOCKS_PER_SEC;
+			gbps[func][kind] = secs > 0
+					? (double)TEXT_LEN * NROUNDS / secs / 1e9
+					: 0;
+		}
+	}
+
+	(void)vol_size;
+
+	puts("== Throughput (GB/s) ==\n");
+	printf("%-30s :", "TEXT");
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		printf("%10s", TEXT_NAMES[kind]);
+	}
+	putchar('\n');
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s :", FUNC_NAMES[func]);
+		for (size_t kind = 0; kind < NTEXTS; ++kind) {
+			printf("%10.2f", gbps[func][kind]);
+		}
+		putchar('\n');
+	}
+
+	ls_bbuf_destroy(&bbuf);
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		ls_bbuf_destroy(&encoded[kind]);
+		free(texts[kind]);
+	}
+
+	return 0;
+}
+
+void naive_encode(LSByteBuffer *bbuf, LSStringSpan sspan,
+		const LSByteSet *charset)
+{
+	for (size_t i = 0; i < sspan.len; ++i) {
+		LSByte byte = sspan.bytes[i];
+		if (byte != '%' && ls_byte_set_contains(charset, byte)) {
+			ls_bbuf_append(bbuf, &byte, 1);
+		} else {
+			ls_bbuf_appendf(bbuf, "%%%02X", (unsigned)byte);
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef TEXT_LEN
+#define TEXT_LEN (64 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 200
+#endif
+
+enum Function {
+	FIND_AND_INSERT = 0,
+	LS_SSPAN_REPLACE_ALL,
+	LS_BBUF_REPLACE_ALL,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[FIND_AND_INSERT]      = "find + ls_bbuf_insert",
+	[LS_SSPAN_REPLACE_ALL] = "ls_sspan_replace_all",
+	[LS_BBUF_REPLACE_ALL]  = "ls_bbuf_replace_all",
+};
+
+static double mbps[NFUNCTIONS];
+
+static void find_and_insert(LSByteBuffer *bbuf);
+
+/*
+ * Escapes every `&` of a text as `&amp;`, like an HTML sanitizer. Roughly one
+ * byte in a hundred is an `&`. "find + ls_bbuf_insert" finds each `&` and
+ * inserts `amp;` after it, moving the rest of the text every time.
+ */
+int main(void)
+{
+	LSByteBuffer text = ls_bbuf_create();
+
+	srand(1);
+	for (size_t i = 0; i < TEXT_LEN; ++i) {
+		LSByte byte = rand() % 100 == 0 ? '&' : (LSByte)('a' + rand() % 26);
+		ls_bbuf_append(&text, &byte, 1);
+	}
+
+	LSStringSpan sspan = ls_sspan_from_bbuf(text);
+	LSStringSpan needle = ls_sspan_from_cstr("&");
+	LSStringSpan replacement = ls_sspan_from_cstr("&amp;");
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	volatile size_t vol_len;
+
+	fprintf(stderr, "Benchmarking %d bytes\n", TEXT_LEN);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		Stopwatch stopwatch = stopwatch_create();
+		stopwatch_start(&stopwatch);
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			LSString string;
+
+			switch (func) {
+			case FIND_AND_INSERT:
+				bbuf.len = 0;
+				ls_bbuf_append_sspan(&bbuf, sspan);
+				find_and_insert(&bbuf);
+				vol_len = bbuf.len;
+				break;
+			case LS_SSPAN_REPLACE_ALL:
+				string = ls_sspan_replace_all(sspan, needle,
+						replacement);
+				vol_len = string.len;
+				ls_string_destroy(&string);
+				break;
+			case LS_BBUF_REPLACE_ALL:
+				bbuf.len = 0;
+				ls_bbuf_append_sspan(&bbuf, sspan);
+				ls_bbuf_replace_all(&bbuf, needle, replacement);
+				vol_len = bbuf.len;
+				break;
+			}
+		}
+		stopwatch_stop(&stopwatch);
+
+		double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+				/ CLOCKS_PER_SEC;
+		mbps[func] = secs > 0 ? (double)TEXT_LEN * NROUNDS / secs / 1e6 : 0;
+	}
+
+	(void)vol_len;
+
+	puts("== Throughput (MB/s) ==\n");
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s : %10.1f\n", FUNC_NAMES[func], mbps[func]);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+	ls_bbuf_destroy(&text);
+
+	return 0;
+}
+
+void find_and_insert(LSByteBuffer *bbuf)
+{
+	size_t pos = 0;
+	while (pos < bbuf->len) {
+		const LSByte *amp = memchr(&bbuf->bytes[pos], '&', bbuf->len - pos);
+		if (!amp) {
+			break;
+		}
+
+		size_t idx = (size_t)(amp - bbuf->bytes) + 1;
+		ls_bbuf_insert(bbuf, idx, (const LSByte *)"amp;", 4);
+		pos = idx + 4;
+	}
+}
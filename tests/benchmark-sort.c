@@ -0,0 +1,186 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef NELEMS
+#define NELEMS (1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 3
+#endif
+
+enum Dataset {
+	DATASET_RANDOM = 0,
+	DATASET_SORTED,
+	DATASET_PREFIXED,
+
+	NDATASETS
+};
+
+static const char *DATASET_NAMES[NDATASETS] = {
+	[DATASET_RANDOM]   = "random",
+	[DATASET_SORTED]   = "sorted",
+	[DATASET_PREFIXED] = "prefixed",
+};
+
+enum Function {
+	QSORT_SSPANS = 0,
+	LS_SSPAN_SORT,
+	QSORT_SSOS,
+	LS_SSO_SORT,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[QSORT_SSPANS]  = "qsort (LSStringSpan)",
+	[LS_SSPAN_SORT] = "ls_sspan_sort",
+	[QSORT_SSOS]    = "qsort (LSSSOString)",
+	[LS_SSO_SORT]   = "ls_sso_sort",
+};
+
+static double secs_per_round[NFUNCTIONS][NDATASETS];
+
+static void fill_sspans(LSStringSpan *sspans, LSByte *pool,
+		enum Dataset dataset);
+static int compare_sspans(const void *a, const void *b);
+static int compare_ssos(const void *a, const void *b);
+
+/*
+ * Every dataset holds `NELEMS` strings of 8 to 40 bytes: "random" ones,
+ * "sorted" ones (the random ones, presorted) and "prefixed" ones, which are
+ * random apart from sharing one of a few 24-byte prefixes (like URLs or paths).
+ */
+enum { MAX_LEN = 40 };
+
+int main(void)
+{
+	LSByte *pool = malloc((size_t)NELEMS * MAX_LEN);
+	LSStringSpan *sspans = malloc(NELEMS * sizeof(*sspans));
+	LSStringSpan *work = malloc(NELEMS * sizeof(*work));
+	LSSSOString *ssos = malloc(NELEMS * sizeof(*ssos));
+
+	for (size_t dataset = 0; dataset < NDATASETS; ++dataset) {
+		fill_sspans(sspans, pool, dataset);
+
+		fprintf(stderr, "Benchmarking %s dataset (%d strings)\n",
+				DATASET_NAMES[dataset], NELEMS);
+
+		for (size_t func = 0; func < NFUNCTIONS; ++func) {
+			clock_t elapsed = 0;
+
+			for (size_t round = 0; round < NROUNDS; ++round) {
+				// setup is not timed
+				for (size_t i = 0; i < NELEMS; ++i) {
+					work[i] = sspans[i];
+					if (func == QSORT_SSOS || func == LS_SSO_SORT) {
+						ssos[i] = ls_sso_create(sspans[i].bytes,
+								sspans[i].len);
+					}
+				}
+
+				Stopwatch stopwatch = stopwatch_create();
+				stopwatch_start(&stopwatch);
+				switch (func) {
+				case QSORT_SSPANS:
+					qsort(work, NELEMS, sizeof(*work),
+							compare_sspans);
+					break;
+				case LS_SSPAN_SORT:
+					ls_sspan_sort(work, NELEMS);
+					break;
+				case QSORT_SSOS:
+					qsort(ssos, NELEMS, sizeof(*ssos),
+							compare_ssos);
+					break;
+				case LS_SSO_SORT:
+					ls_sso_sort(ssos, NELEMS);
+					break;
+				}
+				stopwatch_stop(&stopwatch);
+				elapsed += stopwatch_get_elapsed_time(stopwatch);
+
+				if (func == QSORT_SSOS || func == LS_SSO_SORT) {
+					for (size_t i = 0; i < NELEMS; ++i) {
+						ls_sso_destroy(&ssos[i]);
+					}
+				}
+			}
+
+			secs_per_round[func][dataset] = (double)elapsed
+					/ CLOCKS_PER_SEC / NROUNDS;
+		}
+	}
+
+	puts("== Time per sort (s) ==\n");
+	printf("%-30s :", "DATASET");
+	for (size_t dataset = 0; dataset < NDATASETS; ++dataset) {
+		printf("%10s", DATASET_NAMES[dataset]);
+	}
+	putchar('\n');
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s :", FUNC_NAMES[func]);
+		for (size_t dataset = 0; dataset < NDATASETS; ++dataset) {
+			printf("%10.3f", secs_per_round[func][dataset]);
+		}
+		putchar('\n');
+	}
+
+	free(pool);
+	free(sspans);
+	free(work);
+	free(ssos);
+
+	return 0;
+}
+
+void fill_sspans(LSStringSpan *sspans, LSByte *pool, enum Dataset dataset)
+{
+	static const char *const PREFIXES[] = {
+		"https://example.com/api/",
+		"https://example.com/img/",
+		"https://example.org/api/",
+		"/usr/share/doc/packages/",
+	};
+	enum { PREFIX_LEN = 24 };
+
+	srand(1);
+
+	for (size_t i = 0; i < NELEMS; ++i) {
+		LSByte *bytes = &pool[i * MAX_LEN];
+		size_t len = 8 + rand() % (MAX_LEN - 8 + 1);
+
+		size_t j = 0;
+		if (dataset == DATASET_PREFIXED) {
+			memcpy(bytes, PREFIXES[rand() % 4], PREFIX_LEN);
+			j = PREFIX_LEN;
+		}
+
+		for (; j < len; ++j) {
+			bytes[j] = 'a' + rand() % 26;
+		}
+
+		sspans[i] = ls_sspan_create(bytes, len);
+	}
+
+	if (dataset == DATASET_SORTED) {
+		qsort(sspans, NELEMS, sizeof(*sspans), compare_sspans);
+	}
+}
+
+int compare_sspans(const void *a, const void *b)
+{
+	return ls_sspan_compare(*(const LSStringSpan *)a,
+			*(const LSStringSpan *)b);
+}
+
+int compare_ssos(const void *a, const void *b)
+{
+	return ls_sso_compare(*(const LSSSOString *)a, *(const LSSSOString *)b);
+}
@@ -0,0 +1,176 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef NRENDERS
+#define NRENDERS (1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 10
+#endif
+
+enum Function {
+	SCAN_AND_REPLACE = 0,
+	LS_BBUF_APPENDF,
+	LS_TEMPLATE_RENDER,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[SCAN_AND_REPLACE]   = "scan and replace",
+	[LS_BBUF_APPENDF]    = "ls_bbuf_appendf",
+	[LS_TEMPLATE_RENDER] = "ls_template_render",
+};
+
+static const char TEMPLATE[] =
+	"<li class=\"{class}\"><a href=\"/users/{id}\">{name}</a>"
+	" last seen {when}, id {id}</li>\n";
+static const char FORMAT[] =
+	"<li class=\"%S\"><a href=\"/users/%S\">%S</a>"
+	" last seen %S, id %S</li>\n";
+static const char *const NAMES[] = { "class", "id", "name", "when" };
+
+enum {
+	NNAMES = sizeof(NAMES) / sizeof(NAMES[0]),
+	NVALUE_SETS = 64
+};
+
+static double mvps[NFUNCTIONS];
+
+static void scan_and_replace(LSStringSpan text, const LSStringSpan *values,
+		LSByteBuffer *bbuf);
+
+/*
+ * Renders one HTML list item per iteration from a template with four
+ * placeholders, one of them used twice. "scan and replace" looks for the
+ * placeholders and their names in the text on every render, like a template
+ * that is never compiled.
+ */
+int main(void)
+{
+	LSByteBuffer value_text = ls_bbuf_create();
+	size_t value_ends[NVALUE_SETS][NNAMES];
+	for (size_t set = 0; set < NVALUE_SETS; ++set) {
+		ls_bbuf_appendf(&value_text, "%s", set % 2 ? "odd" : "even");
+		value_ends[set][0] = value_text.len;
+		ls_bbuf_appendf(&value_text, "%zu", set * 7919);
+		value_ends[set][1] = value_text.len;
+		ls_bbuf_appendf(&value_text, "user number %zu", set);
+		value_ends[set][2] = value_text.len;
+		ls_bbuf_appendf(&value_text, "%zu minutes ago", set * 3);
+		value_ends[set][3] = value_text.len;
+	}
+
+	LSStringSpan values[NVALUE_SETS][NNAMES];
+	size_t start = 0;
+	for (size_t set = 0; set < NVALUE_SETS; ++set) {
+		for (size_t i = 0; i < NNAMES; ++i) {
+			values[set][i] = ls_sspan_create(&value_text.bytes[start],
+					value_ends[set][i] - start);
+			start = value_ends[set][i];
+		}
+	}
+
+	LSStringSpan text = ls_sspan_from_cstr(TEMPLATE);
+	LSTemplate tmpl = ls_template_create(text);
+
+	// the compiled template numbers its slots by first appearance
+	LSStringSpan slot_values[NVALUE_SETS][NNAMES];
+	for (size_t set = 0; set < NVALUE_SETS; ++set) {
+		for (size_t i = 0; i < NNAMES; ++i) {
+			size_t slot = ls_template_get_slot(&tmpl,
+					ls_sspan_from_cstr(NAMES[i]));
+			slot_values[set][slot] = values[set][i];
+		}
+	}
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	volatile size_t vol_len;
+
+	fprintf(stderr, "Benchmarking %d renders\n", NRENDERS);
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		Stopwatch stopwatch = stopwatch_create();
+		stopwatch_start(&stopwatch);
+		for (size_t round = 0; round < NROUNDS; ++round) {
+			size_t len = 0;
+
+			for (size_t i = 0; i < NRENDERS; ++i) {
+				const LSStringSpan *set = values[i % NVALUE_SETS];
+				bbuf.len = 0;
+
+				switch (func) {
+				case SCAN_AND_REPLACE:
+					scan_and_replace(text, set, &bbuf);
+					break;
+				case LS_BBUF_APPENDF:
+					ls_bbuf_appendf(&bbuf, FORMAT, set[0], set[1],
+							set[2], set[3], set[1]);
+					break;
+				case LS_TEMPLATE_RENDER:
+					ls_template_render(&tmpl,
+							slot_values[i % NVALUE_SETS],
+							NNAMES, &bbuf);
+					break;
+				}
+
+				len += bbuf.len;
+			}
+
+			vol_len = len;
+		}
+		stopwatch_stop(&stopwatch);
+
+		double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+				/ CLOCKS_PER_SEC;
+		mvps[func] = secs > 0 ? (double)NRENDERS * NROUNDS / secs / 1e6 : 0;
+	}
+
+	(void)vol_len;
+
+	puts("== Throughput (million renders/s) ==\n");
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s : %10.1f\n", FUNC_NAMES[func], mvps[func]);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+	ls_template_destroy(&tmpl);
+	ls_bbuf_destroy(&value_text);
+
+	return 0;
+}
+
+void scan_and_replace(LSStringSpan text, const LSStringSpan *values,
+		LSByteBuffer *bbuf)
+{
+	const LSByte *bytes = text.bytes;
+	const LSByte *end = &text.bytes[text.len];
+
+	while (bytes < end) {
+		const LSByte *open = memchr(bytes, '{', (size_t)(end - bytes));
+		if (!open) {
+			ls_bbuf_append(bbuf, bytes, (size_t)(end - bytes));
+			return;
+		}
+
+		ls_bbuf_append(bbuf, bytes, (size_t)(open - bytes));
+
+		const LSByte *close = memchr(open, '}', (size_t)(end - open));
+		LSStringSpan name = ls_sspan_create(open + 1,
+				(size_t)(close - open - 1));
+		for (size_t i = 0; i < NNAMES; ++i) {
+			if (ls_sspan_equals(name, ls_sspan_from_cstr(NAMES[i]))) {
+				ls_bbuf_append_sspan(bbuf, values[i]);
+				break;
+			}
+		}
+
+		bytes = close + 1;
+	}
+}
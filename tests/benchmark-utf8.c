@@ -0,0 +1,248 @@
+#include <loser/loser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stopwatch.h"
+
+#ifndef TEXT_LEN
+#define TEXT_LEN (16 * 1024 * 1024)
+#endif
+
+#ifndef NROUNDS
+#define NROUNDS 20
+#endif
+
+enum Text {
+	TEXT_ASCII = 0,
+	TEXT_LATIN,
+	TEXT_MIXED,
+
+	NTEXTS
+};
+
+static const char *TEXT_NAMES[NTEXTS] = {
+	[TEXT_ASCII] = "ascii",
+	[TEXT_LATIN] = "latin",
+	[TEXT_MIXED] = "mixed",
+};
+
+enum Function {
+	NAIVE_VALIDATE = 0,
+	LS_SSPAN_IS_VALID_UTF8,
+	LS_SSPAN_IS_ASCII,
+	LS_STRING_CREATE,
+	LS_STRING_CREATE_UTF8,
+	NAIVE_COUNT,
+	LS_SSPAN_UTF8_COUNT,
+	LS_SSPAN_UTF16_LEN,
+	LS_SSPAN_TO_UTF16,
+	LS_BBUF_APPEND_FROM_UTF16,
+
+	NFUNCTIONS
+};
+
+static const char *FUNC_NAMES[NFUNCTIONS] = {
+	[NAIVE_VALIDATE]         = "naive byte-by-byte validation",
+	[LS_SSPAN_IS_VALID_UTF8] = "ls_sspan_is_valid_utf8",
+	[LS_SSPAN_IS_ASCII]      = "ls_sspan_is_ascii",
+	[LS_STRING_CREATE]       = "ls_string_create",
+	[LS_STRING_CREATE_UTF8]  = "ls_string_create_utf8",
+	[NAIVE_COUNT]            = "naive code point counting",
+	[LS_SSPAN_UTF8_COUNT]    = "ls_sspan_utf8_count",
+	[LS_SSPAN_UTF16_LEN]     = "ls_sspan_utf16_len",
+	[LS_SSPAN_TO_UTF16]      = "ls_sspan_to_utf16",
+	[LS_BBUF_APPEND_FROM_UTF16] = "ls_bbuf_append_from_utf16",
+};
+
+static double gbps[NFUNCTIONS][NTEXTS];
+
+static void fill_text(LSByte *text, size_t len, enum Text kind);
+static bool naive_validate(const LSByte *bytes, size_t len);
+static size_t naive_count(const LSByte *bytes, size_t len);
+
+int main(void)
+{
+	LSByte *text = malloc(TEXT_LEN);
+	uint16_t *units = malloc(TEXT_LEN * sizeof(*units));
+	volatile int vol_int;
+	volatile size_t vol_size;
+
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		fill_text(text, TEXT_LEN, kind);
+		LSStringSpan sspan = ls_sspan_create(text, TEXT_LEN);
+
+		size_t nunits = ls_sspan_utf16_len(sspan);
+		ls_sspan_to_utf16(sspan, units, nunits, &nunits);
+
+		fprintf(stderr, "Benchmarking %s text (%d bytes)\n",
+				TEXT_NAMES[kind], TEXT_LEN);
+
+		for (size_t func = 0; func < NFUNCTIONS; ++func) {
+			Stopwatch stopwatch = stopwatch_create();
+			stopwatch_start(&stopwatch);
+			for (size_t round = 0; round < NROUNDS; ++round) {
+				LSString string;
+				LSByteBuffer bbuf;
+				size_t nwritten;
+
+				switch (func) {
+				case NAIVE_VALIDATE:
+					vol_int = naive_validate(text, TEXT_LEN);
+					break;
+				case LS_SSPAN_IS_VALID_UTF8:
+					vol_int = ls_sspan_is_valid_utf8(sspan);
+					break;
+				case LS_SSPAN_IS_ASCII:
+					vol_int = ls_sspan_is_ascii(sspan);
+					break;
+				case LS_STRING_CREATE:
+					string = ls_string_create(text, TEXT_LEN);
+					ls_string_destroy(&string);
+					break;
+				case LS_STRING_CREATE_UTF8:
+					string = ls_string_create_utf8(text, TEXT_LEN);
+					ls_string_destroy(&string);
+					break;
+				case NAIVE_COUNT:
+					vol_size = naive_count(text, TEXT_LEN);
+					break;
+				case LS_SSPAN_UTF8_COUNT:
+					vol_size = ls_sspan_utf8_count(sspan);
+					break;
+				case LS_SSPAN_UTF16_LEN:
+					vol_size = ls_sspan_utf16_len(sspan);
+					break;
+				case LS_SSPAN_TO_UTF16:
+					ls_sspan_to_utf16(sspan, units, nunits, &nwritten);
+					vol_size = nwritten;
+					break;
+				case LS_BBUF_APPEND_FROM_UTF16:
+					bbuf = ls_bbuf_create();
+					ls_bbuf_append_from_utf16(&bbuf, units, nunits);
+					ls_bbuf_destroy(&bbuf);
+					break;
+				}
+			}
+			stopwatch_stop(&stopwatch);
+
+			double secs = (double)stopwatch_get_elapsed_time(stopwatch)
+					/ CLOCKS_PER_SEC;
+			gbps[func][kind] = secs > 0
+					? (double)TEXT_LEN * NROUNDS / secs / 1e9
+					: 0;
+		}
+	}
+
+	(void)vol_int;
+	(void)vol_size;
+
+	puts("== Throughput (GB/s) ==\n");
+	printf("%-30s :", "TEXT (GB of UTF-8)");
+	for (size_t kind = 0; kind < NTEXTS; ++kind) {
+		printf("%10s", TEXT_NAMES[kind]);
+	}
+	putchar('\n');
+
+	for (size_t func = 0; func < NFUNCTIONS; ++func) {
+		printf("%-30s :", FUNC_NAMES[func]);
+		for (size_t kind = 0; kind < NTEXTS; ++kind) {
+			printf("%10.2f", gbps[func][kind]);
+		}
+		putchar('\n');
+	}
+
+	free(text);
+	free(units);
+
+	return 0;
+}
+
+void fill_text(LSByte *text, size_t len, enum Text kind)
+{
+	static const char *const PIECES[NTEXTS][4] = {
+		[TEXT_ASCII] = { "hello ", "world ", "lorem ", "ipsum " },
+		[TEXT_LATIN] = { "caf\xc3\xa9 ", "na\xc3\xafve ", "hello ", "world " },
+		[TEXT_MIXED] = { "\xe6\x97\xa5\xe6\x9c\xac ", "\xf0\x9f\x98\x80 ",
+			"caf\xc3\xa9 ", "ascii " },
+	};
+
+	srand(1);
+
+	size_t i = 0;
+	while (i < len) {
+		const char *piece = PIECES[kind][rand() % 4];
+		size_t piece_len = strlen(piece);
+
+		if (piece_len > len - i) {
+			memset(&text[i], ' ', len - i);
+			break;
+		}
+
+		memcpy(&text[i], piece, piece_len);
+		i += piece_len;
+	}
+}
+
+// The kind of validator this library's kernels are meant to replace.
+bool naive_validate(const LSByte *bytes, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		LSByte lead = bytes[i];
+		size_t seq_len;
+		uint32_t cp;
+
+		if (lead < 0x80) {
+			i++;
+			continue;
+		} else if ((lead & 0xe0) == 0xc0) {
+			seq_len = 2;
+			cp = lead & 0x1f;
+		} else if ((lead & 0xf0) == 0xe0) {
+			seq_len = 3;
+			cp = lead & 0x0f;
+		} else if ((lead & 0xf8) == 0xf0) {
+			seq_len = 4;
+			cp = lead & 0x07;
+		} else {
+			return false;
+		}
+
+		if (len - i < seq_len) {
+			return false;
+		}
+
+		for (size_t j = 1; j < seq_len; ++j) {
+			if ((bytes[i + j] & 0xc0) != 0x80) {
+				return false;
+			}
+			cp = (cp << 6) | (bytes[i + j] & 0x3f);
+		}
+
+		static const uint32_t MIN_CP[] = { 0, 0, 0x80, 0x800, 0x10000 };
+		if (cp < MIN_CP[seq_len] || cp > 0x10ffff
+				|| (cp >= 0xd800 && cp <= 0xdfff)) {
+			return false;
+		}
+
+		i += seq_len;
+	}
+
+	return true;
+}
+
+size_t naive_count(const LSByte *bytes, size_t len)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < len; ++i) {
+		if ((bytes[i] & 0xc0) != 0x80) {
+			count++;
+		}
+	}
+
+	return count;
+}
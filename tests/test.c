@@ -1,8 +1,17 @@
 #include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <loser/loser.h>
+#include <loser/loser-thread-pool.h>
+
+#ifdef __linux__
+#include <loser/loser-async-reader.h>
+#endif
 
 static void test_constructors(void);
 static void test_conversions(void);
@@ -15,10 +24,47 @@ static void test_insert_very_big(void);
 static void test_append_many(void);
 static void test_insert_many(void);
 
+static void test_tail_padding(void);
+
 static void test_move_funcs(void);
 static void test_move_to_funcs(void);
 
 static void test_equals_funcs(void);
+static void test_compare_funcs(void);
+static void test_find_funcs(void);
+static void test_sort_funcs(void);
+static void test_thread_pool(void);
+
+static void test_line_reader(void);
+static void test_utf8_funcs(void);
+static void test_utf8_counting_and_transcoding(void);
+static void test_case_funcs(void);
+static void test_format_funcs(void);
+static void test_float_format_funcs(void);
+static void test_parse_funcs(void);
+static void test_appendf_funcs(void);
+static void test_template_funcs(void);
+static void test_replace_funcs(void);
+static void test_bbuf_range_funcs(void);
+static void test_json_funcs(void);
+static void test_encoding_funcs(void);
+static void test_percent_funcs(void);
+static void test_csv_reader(void);
+static void test_byte_set_funcs(void);
+
+#ifdef __linux__
+static void test_async_reader(void);
+#endif
+
+static int sspan_compare_for_qsort(const void *a, const void *b);
+static void mark_task(void *ctx, size_t task_idx);
+static void hash_spans(void *ctx, const LSStringSpan *sspans, size_t nsspans,
+		size_t first_idx);
+static void assert_appendf_like_snprintf(const char *fmt, ...);
+static void assert_next_record(LSCsvReader *reader,
+		const char *const *expected, size_t nexpected);
+static void assert_replace_all_like_naive(LSStringSpan sspan,
+		LSStringSpan needle, LSStringSpan replacement);
 
 static const LSByte SMALL_BYTES[] = "deadbeef";
 static size_t SMALL_LEN = sizeof(SMALL_BYTES) - 1;
@@ -42,10 +88,37 @@ int main(void)
 	test_append_many();
 	test_insert_many();
 
+	test_tail_padding();
+
 	test_move_funcs();
 	test_move_to_funcs();
 
 	test_equals_funcs();
+	test_compare_funcs();
+	test_find_funcs();
+	test_sort_funcs();
+	test_thread_pool();
+
+	test_line_reader();
+	test_utf8_funcs();
+	test_utf8_counting_and_transcoding();
+	test_case_funcs();
+	test_format_funcs();
+	test_float_format_funcs();
+	test_parse_funcs();
+	test_appendf_funcs();
+	test_template_funcs();
+	test_replace_funcs();
+	test_bbuf_range_funcs();
+	test_json_funcs();
+	test_encoding_funcs();
+	test_percent_funcs();
+	test_csv_reader();
+	test_byte_set_funcs();
+
+#ifdef __linux__
+	test_async_reader();
+#endif
 
 	return 0;
 }
@@ -862,6 +935,41 @@ void test_insert_many(void)
 	ls_bbuf_destroy(&bbuf);
 }
 
+void test_tail_padding(void)
+{
+	size_t padding = ls_get_tail_padding();
+	assert(padding == LS_TAIL_PADDING);
+
+	// reading the padding must be fine (run under a sanitizer to be sure)
+	volatile LSByte sink;
+	for (size_t len = 0; len <= 2 * LS_SHORT_STRING_MAX_LEN; ++len) {
+		LSString string = ls_string_create((const LSByte *)
+				"0123456789012345678901234567890123456789012345", len);
+		assert(ls_string_is_valid(string));
+		for (size_t i = 0; i < padding; ++i) {
+			sink = string.bytes[len + i];
+		}
+		ls_string_destroy(&string);
+
+		LSByteBuffer bbuf = ls_bbuf_create_with_init_cap(len + 1);
+		assert(ls_bbuf_is_valid(bbuf));
+		for (size_t i = 0; i < padding; ++i) {
+			sink = bbuf.bytes[bbuf.cap + i];
+		}
+		assert(ls_bbuf_expand_by(&bbuf, len + 1) == LS_SUCCESS);
+		for (size_t i = 0; i < padding; ++i) {
+			sink = bbuf.bytes[bbuf.cap + i];
+		}
+		ls_bbuf_destroy(&bbuf);
+	}
+
+	for (size_t i = 0; i < padding; ++i) {
+		sink = LS_EMPTY_STRING.bytes[i];
+	}
+
+	(void)sink;
+}
+
 void test_move_funcs(void)
 {
 	{
@@ -1138,3 +1246,2460 @@ void test_equals_funcs(void)
 		assert(!ls_bytes_equals_nullsafe(empty1, NULL, 0));
 	}
 }
+
+void test_compare_funcs(void)
+{
+	// in ascending order; includes prefixes, bytes above 0x7f and strings on
+	// both sides of `LS_SHORT_STRING_MAX_LEN` and of the 8-byte word boundaries
+	static const char *SORTED[] = {
+		"",
+		"\x01",
+		"a",
+		"a\x01",
+		"abcdefg",
+		"abcdefgh",
+		"abcdefghijklmnopqrstuvw",
+		"abcdefghijklmnopqrstuvwx",
+		"abcdefghijklmnopqrstuvwxyz",
+		"abcdefghijklmnopqrstuvx",
+		"abcdefgh\x7f",
+		"abcdefgh\x80",
+		"b",
+		"\x7f",
+		"\x80",
+		"\xff\xff\xff\xff\xff\xff\xff\xff\xff",
+	};
+	enum { NSORTED = sizeof(SORTED) / sizeof(SORTED[0]) };
+
+	LSStringSpan sspans[NSORTED];
+	LSString strings[NSORTED];
+	LSSSOString ssos[NSORTED];
+	for (size_t i = 0; i < NSORTED; ++i) {
+		sspans[i] = ls_sspan_from_cstr(SORTED[i]);
+		strings[i] = ls_string_from_cstr(SORTED[i]);
+		ssos[i] = ls_sso_from_cstr(SORTED[i]);
+	}
+
+	for (size_t i = 0; i < NSORTED; ++i) {
+		for (size_t j = 0; j < NSORTED; ++j) {
+			int expected = (i > j) - (i < j);
+
+			assert((ls_sspan_compare(sspans[i], sspans[j]) > 0)
+					- (ls_sspan_compare(sspans[i], sspans[j]) < 0)
+					== expected);
+			assert((ls_string_compare(strings[i], strings[j]) > 0)
+					- (ls_string_compare(strings[i], strings[j]) < 0)
+					== expected);
+			assert((ls_sso_compare(ssos[i], ssos[j]) > 0)
+					- (ls_sso_compare(ssos[i], ssos[j]) < 0)
+					== expected);
+
+			if (sspans[i].len <= LS_SHORT_STRING_MAX_LEN
+					&& sspans[j].len <= LS_SHORT_STRING_MAX_LEN) {
+				LSShortString a = ls_short_string_from_sspan(sspans[i]);
+				LSShortString b = ls_short_string_from_sspan(sspans[j]);
+				int cmp = ls_short_string_compare(a, b);
+				assert((cmp > 0) - (cmp < 0) == expected);
+			}
+		}
+
+		int results[NSORTED];
+		assert(ls_sspan_compare_many(sspans[i], sspans, NSORTED, results)
+				== LS_SUCCESS);
+		for (size_t j = 0; j < NSORTED; ++j) {
+			assert((results[j] > 0) - (results[j] < 0)
+					== (i > j) - (i < j));
+		}
+	}
+
+	{
+		// bytes past the length of a short string must not matter
+		LSShortString a = ls_short_string_from_cstr("abc");
+		LSShortString b = ls_short_string_from_cstr("abc");
+		a._mut_bytes[4] = 'x';
+		b._mut_bytes[4] = 'y';
+		assert(ls_short_string_compare(a, b) == 0);
+	}
+	{
+		LSStringSpan invalid_sspan = LS_AN_INVALID_SSPAN;
+		LSString invalid_string = LS_AN_INVALID_STRING;
+		LSShortString invalid_short = LS_AN_INVALID_SHORT_STRING;
+		LSSSOString invalid_sso = LS_AN_INVALID_SSO;
+
+		assert(ls_sspan_compare(invalid_sspan, LS_EMPTY_SSPAN) < 0);
+		assert(ls_sspan_compare(LS_EMPTY_SSPAN, invalid_sspan) > 0);
+		assert(ls_sspan_compare(invalid_sspan, invalid_sspan) == 0);
+		assert(ls_string_compare(invalid_string, LS_EMPTY_STRING) < 0);
+		assert(ls_short_string_compare(invalid_short,
+				LS_EMPTY_SHORT_STRING) < 0);
+		assert(ls_sso_compare(invalid_sso, LS_EMPTY_SSO) < 0);
+		assert(ls_sso_compare(LS_EMPTY_SSO, invalid_sso) > 0);
+
+		LSStringSpan with_invalid[] = { LS_EMPTY_SSPAN, invalid_sspan };
+		int results[2];
+		assert(ls_sspan_compare_many(LS_EMPTY_SSPAN, with_invalid, 2,
+				results) == LS_SUCCESS);
+		assert(results[0] == 0 && results[1] > 0);
+
+		assert(ls_sspan_compare_many(invalid_sspan, sspans, NSORTED,
+				results) == LS_FAILURE);
+		assert(ls_sspan_compare_many(LS_EMPTY_SSPAN, NULL, 0, results)
+				== LS_FAILURE);
+		assert(ls_sspan_compare_many(LS_EMPTY_SSPAN, sspans, 0, NULL)
+				== LS_FAILURE);
+	}
+
+	for (size_t i = 0; i < NSORTED; ++i) {
+		ls_string_destroy(&strings[i]);
+		ls_sso_destroy(&ssos[i]);
+	}
+}
+
+void test_find_funcs(void)
+{
+	static const char *CSTRS[] = {
+		"",
+		"key",
+		"kex",
+		"keys",
+		"a key of exactly 23 b.",
+		"a key of exactly 23 by",
+		"a key that is too long for a short string",
+		"a key that is too long for a short strinG",
+		"a key that is too long for a short string!",
+	};
+	enum {
+		NCSTRS = sizeof(CSTRS) / sizeof(CSTRS[0]),
+		// spans several batches, with a partial one at the end
+		NELEMS = 150
+	};
+
+	LSSSOString ssos[NELEMS];
+	LSStringSpan sspans[NELEMS];
+	for (size_t i = 0; i < NELEMS; ++i) {
+		// every 7th element is invalid
+		if (i % 7 == 6) {
+			ssos[i] = LS_AN_INVALID_SSO;
+			sspans[i] = LS_AN_INVALID_SSPAN;
+			continue;
+		}
+
+		ssos[i] = ls_sso_from_cstr(CSTRS[i % NCSTRS]);
+		sspans[i] = ls_sspan_from_cstr(CSTRS[i % NCSTRS]);
+	}
+
+	for (size_t c = 0; c < NCSTRS; ++c) {
+		LSSSOString needle = ls_sso_from_cstr(CSTRS[c]);
+		LSStringSpan sspan_needle = ls_sspan_from_cstr(CSTRS[c]);
+
+		size_t expected_first = SIZE_MAX;
+		size_t expected_second = SIZE_MAX;
+		uint64_t expected_bitmap[(NELEMS + 63) / 64] = { 0 };
+		for (size_t i = 0; i < NELEMS; ++i) {
+			if (ls_sso_equals(needle, ssos[i])) {
+				assert(ls_sspan_equals(sspan_needle, sspans[i]));
+				expected_bitmap[i / 64] |= (uint64_t)1 << (i % 64);
+				if (expected_first == SIZE_MAX) {
+					expected_first = i;
+				} else if (expected_second == SIZE_MAX) {
+					expected_second = i;
+				}
+			}
+		}
+		assert(expected_second != SIZE_MAX);
+
+		size_t after_first = expected_first + 1;
+		assert(ls_sso_find_equal(needle, ssos, NELEMS) == expected_first);
+		assert(ls_sso_find_equal(needle, &ssos[after_first],
+				NELEMS - after_first)
+				== expected_second - after_first);
+
+		// all 0xff to check that the bits past the end are cleared
+		uint64_t bitmap[(NELEMS + 63) / 64];
+		memset(bitmap, 0xff, sizeof(bitmap));
+		assert(ls_sspan_filter_equal(sspan_needle, sspans, NELEMS, bitmap)
+				== LS_SUCCESS);
+		assert(memcmp(bitmap, expected_bitmap, sizeof(bitmap)) == 0);
+
+		ls_sso_destroy(&needle);
+	}
+
+	{
+		LSSSOString needle = ls_sso_from_cstr("not there");
+		uint64_t bitmap[(NELEMS + 63) / 64];
+
+		assert(ls_sso_find_equal(needle, ssos, NELEMS) == SIZE_MAX);
+		assert(ls_sso_find_equal(needle, ssos, 0) == SIZE_MAX);
+		assert(ls_sso_find_equal(needle, NULL, 0) == SIZE_MAX);
+		assert(ls_sso_find_equal(LS_AN_INVALID_SSO, ssos, NELEMS)
+				== SIZE_MAX);
+
+		assert(ls_sspan_filter_equal(ls_sspan_from_cstr("not there"),
+				sspans, NELEMS, bitmap) == LS_SUCCESS);
+		for (size_t i = 0; i < (NELEMS + 63) / 64; ++i) {
+			assert(bitmap[i] == 0);
+		}
+
+		assert(ls_sspan_filter_equal(LS_AN_INVALID_SSPAN, sspans, NELEMS,
+				bitmap) == LS_FAILURE);
+		assert(ls_sspan_filter_equal(LS_EMPTY_SSPAN, NULL, 0, bitmap)
+				== LS_FAILURE);
+		assert(ls_sspan_filter_equal(LS_EMPTY_SSPAN, sspans, NELEMS, NULL)
+				== LS_FAILURE);
+
+		ls_sso_destroy(&needle);
+	}
+
+	for (size_t i = 0; i < NELEMS; ++i) {
+		if (ls_sso_is_valid(ssos[i])) {
+			ls_sso_destroy(&ssos[i]);
+		}
+	}
+}
+
+void test_sort_funcs(void)
+{
+	enum {
+		// plenty of partitioning, then insertion sort at every depth
+		NELEMS = 3000,
+		MAX_LEN = 40
+	};
+	// zeros and long shared prefixes stress the handling of string ends
+	static const LSByte ALPHABET[] = { 0x00, 'a', 'b', 0xff };
+
+	static LSByte pool[NELEMS][MAX_LEN];
+	static LSStringSpan sspans[NELEMS];
+	static LSStringSpan expected[NELEMS];
+	static LSSSOString ssos[NELEMS];
+
+	uint32_t seed = 1;
+	for (size_t i = 0; i < NELEMS; ++i) {
+		seed = seed * 1103515245 + 12345;
+		size_t len = (seed >> 16) % (MAX_LEN + 1);
+		size_t shared = (seed >> 8) % 4 == 0 ? len : 0;
+
+		for (size_t j = 0; j < len; ++j) {
+			seed = seed * 1103515245 + 12345;
+			pool[i][j] = j < shared ? 'p' : ALPHABET[(seed >> 16) % 4];
+		}
+
+		if (i % 97 == 13) {
+			sspans[i] = LS_AN_INVALID_SSPAN;
+			ssos[i] = LS_AN_INVALID_SSO;
+		} else {
+			sspans[i] = ls_sspan_create(pool[i], len);
+			ssos[i] = ls_sso_create(pool[i], len);
+		}
+		expected[i] = sspans[i];
+	}
+
+	qsort(expected, NELEMS, sizeof(expected[0]), sspan_compare_for_qsort);
+
+	assert(ls_sspan_sort(sspans, NELEMS) == LS_SUCCESS);
+	assert(ls_sso_sort(ssos, NELEMS) == LS_SUCCESS);
+	for (size_t i = 0; i < NELEMS; ++i) {
+		assert(ls_sspan_compare(sspans[i], expected[i]) == 0);
+		assert(ls_sspan_compare(ls_sspan_from_sso(&ssos[i]), expected[i])
+				== 0);
+	}
+
+	// already sorted, and all equal
+	assert(ls_sspan_sort(sspans, NELEMS) == LS_SUCCESS);
+	for (size_t i = 0; i < NELEMS; ++i) {
+		assert(ls_sspan_compare(sspans[i], expected[i]) == 0);
+		sspans[i] = ls_sspan_from_cstr("same");
+	}
+	assert(ls_sspan_sort(sspans, NELEMS) == LS_SUCCESS);
+	for (size_t i = 0; i < NELEMS; ++i) {
+		assert(ls_sspan_equals(sspans[i], ls_sspan_from_cstr("same")));
+	}
+
+	assert(ls_sspan_sort(sspans, 0) == LS_SUCCESS);
+	assert(ls_sspan_sort(NULL, 0) == LS_FAILURE);
+	assert(ls_sso_sort(ssos, 0) == LS_SUCCESS);
+	assert(ls_sso_sort(NULL, 0) == LS_FAILURE);
+
+	for (size_t i = 0; i < NELEMS; ++i) {
+		if (ls_sso_is_valid(ssos[i])) {
+			ls_sso_destroy(&ssos[i]);
+		}
+	}
+}
+
+void test_thread_pool(void)
+{
+	assert(ls_thread_pool_create(0) == NULL);
+	assert(ls_thread_pool_create(LS_THREAD_POOL_MAX_THREADS + 1) == NULL);
+
+	{
+		LSThreadPool *pool = ls_thread_pool_create(4);
+		assert(pool);
+		assert(ls_thread_pool_get_nthreads(pool) == 4);
+
+		// several batches in a row, so that threads wake up late
+		unsigned char marks[1000];
+		for (size_t round = 0; round < 20; ++round) {
+			size_t ntasks = 1 + round * 49;
+			memset(marks, 0, sizeof(marks));
+			ls_thread_pool_run(pool, ntasks, mark_task, marks);
+
+			for (size_t i = 0; i < sizeof(marks); ++i) {
+				assert(marks[i] == (i < ntasks));
+			}
+		}
+		ls_thread_pool_run(pool, 0, mark_task, marks);
+
+		ls_thread_pool_destroy(pool);
+	}
+
+	{
+		enum {
+			// enough to take the parallel path
+			NELEMS = 200000,
+			MAX_LEN = 12
+		};
+		static LSByte pool_bytes[NELEMS][MAX_LEN];
+		static LSStringSpan sspans[NELEMS];
+		static LSStringSpan expected[NELEMS];
+
+		LSThreadPool *pool = ls_thread_pool_create(3);
+		assert(pool);
+
+		for (size_t dups = 0; dups < 2; ++dups) {
+			uint32_t seed = 1;
+			for (size_t i = 0; i < NELEMS; ++i) {
+				seed = seed * 1103515245 + 12345;
+				// few distinct strings in the second round
+				size_t len = dups ? (seed >> 16) % 3
+						: (seed >> 16) % (MAX_LEN + 1);
+
+				for (size_t j = 0; j < len; ++j) {
+					seed = seed * 1103515245 + 12345;
+					pool_bytes[i][j] = "\0abz"[(seed >> 16) % 4];
+				}
+
+				sspans[i] = i % 1001 == 7 ? LS_AN_INVALID_SSPAN
+						: ls_sspan_create(pool_bytes[i], len);
+				expected[i] = sspans[i];
+			}
+
+			assert(ls_sspan_sort(expected, NELEMS) == LS_SUCCESS);
+			assert(ls_sspan_parallel_sort(pool, sspans, NELEMS)
+					== LS_SUCCESS);
+			for (size_t i = 0; i < NELEMS; ++i) {
+				assert(ls_sspan_compare(sspans[i], expected[i]) == 0);
+			}
+		}
+
+		assert(ls_sspan_parallel_sort(pool, sspans, 0) == LS_SUCCESS);
+		assert(ls_sspan_parallel_sort(pool, NULL, 0) == LS_FAILURE);
+
+		ls_thread_pool_destroy(pool);
+	}
+
+	{
+		enum { NELEMS = 100000, MAX_LEN = 4096 };
+		static LSByte bytes[MAX_LEN];
+		static LSStringSpan sspans[NELEMS];
+		static uint64_t hashes[NELEMS];
+
+		memset(bytes, 'x', sizeof(bytes));
+		for (size_t i = 0; i < NELEMS; ++i) {
+			// uneven costs, to give the threads something to steal
+			sspans[i] = ls_sspan_create(bytes, i % 1000 == 0
+					? MAX_LEN : i % 37);
+		}
+
+		for (size_t nthreads = 1; nthreads <= 4; nthreads += 3) {
+			LSThreadPool *pool = ls_thread_pool_create(nthreads);
+			assert(pool);
+
+			size_t lens[] = { 0, 1, 100, NELEMS };
+			for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); ++l) {
+				memset(hashes, 0, sizeof(hashes));
+				ls_parallel_for_spans(pool, sspans, lens[l], hash_spans,
+						hashes);
+
+				for (size_t i = 0; i < NELEMS; ++i) {
+					// the low bit counts the visits
+					uint64_t expected = i < lens[l]
+							? ls_sspan_hash_icase(sspans[i]) | 1
+							: 0;
+					assert(hashes[i] == expected);
+				}
+			}
+
+			ls_thread_pool_destroy(pool);
+		}
+	}
+}
+
+void test_line_reader(void)
+{
+	static const char TEXT[] =
+			"first line\n"
+			"\n"
+			"a line which is long enough to straddle several chunks\n"
+			"x\n"
+			"unterminated";
+	static const char *LINES[] = {
+		"first line",
+		"",
+		"a line which is long enough to straddle several chunks",
+		"x",
+		"unterminated"
+	};
+	enum { NLINES = sizeof(LINES) / sizeof(LINES[0]) };
+
+	size_t text_len = sizeof(TEXT) - 1;
+
+	for (size_t chunk_len = 1; chunk_len <= text_len; ++chunk_len) {
+		LSLineReader reader = ls_line_reader_create();
+		assert(ls_line_reader_is_valid(reader));
+
+		size_t nlines = 0;
+		for (size_t i = 0; i < text_len; i += chunk_len) {
+			size_t len = text_len - i < chunk_len ? text_len - i : chunk_len;
+
+			// copy into scratch space to make sure carried over lines
+			// don't point into stale chunks
+			char chunk[sizeof(TEXT)];
+			memcpy(chunk, &TEXT[i], len);
+			ls_line_reader_feed(&reader, ls_sspan_from_chars(chunk, len));
+
+			LSStringSpan line;
+			while (ls_sspan_is_valid(line = ls_line_reader_next(&reader))) {
+				assert(nlines < NLINES);
+				assert(ls_sspan_equals(line, ls_sspan_from_cstr(LINES[nlines])));
+				nlines++;
+			}
+			memset(chunk, '?', sizeof(chunk));
+		}
+
+		LSStringSpan last = ls_line_reader_finish(&reader);
+		assert(ls_sspan_equals(last, ls_sspan_from_cstr(LINES[NLINES - 1])));
+		assert(!ls_sspan_is_valid(ls_line_reader_finish(&reader)));
+		assert(nlines == NLINES - 1);
+		assert(ls_line_reader_is_valid(reader));
+
+		ls_line_reader_destroy(&reader);
+	}
+	{
+		LSLineReader reader = ls_line_reader_create();
+
+		ls_line_reader_feed(&reader, ls_sspan_from_cstr("terminated\n"));
+		LSStringSpan line = ls_line_reader_next(&reader);
+		assert(ls_sspan_equals(line, ls_sspan_from_cstr("terminated")));
+		assert(!ls_sspan_is_valid(ls_line_reader_next(&reader)));
+		assert(!ls_sspan_is_valid(ls_line_reader_finish(&reader)));
+
+		ls_line_reader_destroy(&reader);
+	}
+	{
+		LSLineReader invalid = LS_AN_INVALID_LINE_READER;
+
+		assert(!ls_line_reader_is_valid(invalid));
+		assert(!ls_sspan_is_valid(ls_line_reader_next(&invalid)));
+		assert(!ls_sspan_is_valid(ls_line_reader_finish(&invalid)));
+	}
+}
+
+void test_utf8_funcs(void)
+{
+	static const struct {
+		const char *cstr;
+		bool valid;
+	} SEQS[] = {
+		{ "a", true },
+		{ "\xc2\xa9", true },              // U+00A9
+		{ "\xe2\x82\xac", true },          // U+20AC
+		{ "\xf0\x9f\x98\x80", true },      // U+1F600
+		{ "\xf4\x8f\xbf\xbf", true },      // U+10FFFF
+		{ "\xed\x9f\xbf", true },          // U+D7FF
+		{ "\x80", false },                  // lone continuation
+		{ "\xc2", false },                  // cut off
+		{ "\xe2\x82", false },              // cut off
+		{ "\xf0\x9f\x98", false },          // cut off
+		{ "\xc0\xaf", false },              // overlong 2-byte
+		{ "\xe0\x80\xaf", false },          // overlong 3-byte
+		{ "\xf0\x80\x80\xaf", false },      // overlong 4-byte
+		{ "\xed\xa0\x80", false },          // surrogate
+		{ "\xf4\x90\x80\x80", false },      // above U+10FFFF
+		{ "\xf5\x80\x80\x80", false },      // invalid lead
+		{ "\xff", false },
+		{ "\xc2\xa9\xa9", false },          // too many continuations
+	};
+
+	// embed each sequence at every offset around the 32-byte block size
+	for (size_t s = 0; s < sizeof(SEQS) / sizeof(SEQS[0]); ++s) {
+		size_t seq_len = strlen(SEQS[s].cstr);
+
+		for (size_t offset = 0; offset < 80; ++offset) {
+			for (size_t trailing = 0; trailing < 3; ++trailing) {
+				LSByte buf[128];
+				size_t len = offset + seq_len + trailing;
+
+				memset(buf, 'x', sizeof(buf));
+				memcpy(&buf[offset], SEQS[s].cstr, seq_len);
+
+				LSStringSpan sspan = ls_sspan_create(buf, len);
+				assert(ls_sspan_is_valid_utf8(sspan) == SEQS[s].valid);
+				assert(ls_sspan_is_ascii(sspan) == (SEQS[s].cstr[0] == 'a'));
+
+				LSString string = ls_string_create_utf8(buf, len);
+				assert(ls_string_is_valid(string) == SEQS[s].valid);
+				if (ls_string_is_valid(string)) {
+					assert(string.len == len);
+					assert(memcmp(string.bytes, buf, len) == 0);
+					assert(string.bytes[len] == '\0');
+				}
+				ls_string_destroy(&string);
+
+				LSSSOString sso = ls_sso_create_utf8(buf, len);
+				assert(ls_sso_is_valid(sso) == SEQS[s].valid);
+				ls_sso_destroy(&sso);
+			}
+		}
+	}
+	{
+		LSByte buf[1000];
+		for (size_t i = 0; i < sizeof(buf); i += 2) {
+			buf[i] = 0xc3;     // U+00E9
+			buf[i + 1] = 0xa9;
+		}
+
+		assert(ls_sspan_is_valid_utf8(ls_sspan_create(buf, sizeof(buf))));
+		assert(!ls_sspan_is_valid_utf8(ls_sspan_create(buf, sizeof(buf) - 1)));
+		assert(!ls_sspan_is_valid_utf8(ls_sspan_create(&buf[1], sizeof(buf) - 1)));
+		assert(!ls_sspan_is_ascii(ls_sspan_create(buf, sizeof(buf))));
+	}
+	{
+		assert(ls_sspan_is_valid_utf8(LS_EMPTY_SSPAN));
+		assert(ls_sspan_is_ascii(LS_EMPTY_SSPAN));
+		assert(!ls_sspan_is_valid_utf8(LS_AN_INVALID_SSPAN));
+		assert(!ls_sspan_is_ascii(LS_AN_INVALID_SSPAN));
+
+		LSString empty = ls_string_create_utf8(LS_EMPTY_BYTES, 0);
+		assert(ls_string_is_valid(empty));
+		assert(!ls_string_is_valid(ls_string_create_utf8(NULL, 0)));
+		assert(!ls_sso_is_valid(ls_sso_create_utf8(NULL, 0)));
+	}
+}
+
+void test_utf8_counting_and_transcoding(void)
+{
+	// 1, 2, 3 and 4-byte sequences
+	static const char *PIECES[] = {
+		"a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80"
+	};
+	static const uint16_t PIECE_UNITS[][2] = {
+		{ 0x0061 }, { 0x00e9 }, { 0x20ac }, { 0xd83d, 0xde00 }
+	};
+
+	LSByte text[4096];
+	size_t offsets[1024];
+	uint16_t expected_units[2048];
+
+	// runs of ASCII mixed with everything else, to exercise the fast paths
+	size_t len = 0;
+	size_t ncode_points = 0;
+	size_t nunits = 0;
+	for (size_t i = 0; len < sizeof(text) - 64; ++i) {
+		size_t piece = (i / 20) % 2 == 0 ? 0 : i % 4;
+		size_t piece_len = strlen(PIECES[piece]);
+
+		offsets[ncode_points++] = len;
+		memcpy(&text[len], PIECES[piece], piece_len);
+		len += piece_len;
+
+		expected_units[nunits++] = PIECE_UNITS[piece][0];
+		if (piece == 3) {
+			expected_units[nunits++] = PIECE_UNITS[piece][1];
+		}
+
+		if (ncode_points == sizeof(offsets) / sizeof(offsets[0])) {
+			break;
+		}
+	}
+
+	LSStringSpan sspan = ls_sspan_create(text, len);
+	assert(ls_sspan_is_valid_utf8(sspan));
+
+	for (size_t prefix = 0; prefix <= ncode_points; ++prefix) {
+		size_t prefix_len = prefix == ncode_points ? len : offsets[prefix];
+		LSStringSpan prefix_sspan = ls_sspan_create(text, prefix_len);
+
+		assert(ls_sspan_utf8_count(prefix_sspan) == prefix);
+	}
+	assert(ls_sspan_utf16_len(sspan) == nunits);
+	assert(ls_sspan_utf8_count(LS_EMPTY_SSPAN) == 0);
+	assert(ls_sspan_utf8_count(LS_AN_INVALID_SSPAN) == 0);
+	{
+		LSUtf8Index index = ls_utf8_index_create(sspan);
+		assert(ls_utf8_index_is_valid(index));
+		assert(index.ncode_points == ncode_points);
+
+		for (size_t i = 0; i < ncode_points; ++i) {
+			assert(ls_utf8_index_get_offset(&index, sspan, i) == offsets[i]);
+		}
+		assert(ls_utf8_index_get_offset(&index, sspan, ncode_points) == len);
+		assert(ls_utf8_index_get_offset(&index, sspan, ncode_points + 1)
+				== SIZE_MAX);
+
+		ls_utf8_index_destroy(&index);
+
+		LSUtf8Index empty = ls_utf8_index_create(LS_EMPTY_SSPAN);
+		assert(ls_utf8_index_is_valid(empty));
+		assert(ls_utf8_index_get_offset(&empty, LS_EMPTY_SSPAN, 0) == 0);
+		ls_utf8_index_destroy(&empty);
+
+		assert(!ls_utf8_index_is_valid(
+				ls_utf8_index_create(LS_AN_INVALID_SSPAN)));
+	}
+	{
+		uint16_t units[2048];
+		size_t nwritten = 0;
+
+		assert(ls_sspan_to_utf16(sspan, units, nunits, &nwritten)
+				== LS_SUCCESS);
+		assert(nwritten == nunits);
+		assert(memcmp(units, expected_units, nunits * sizeof(units[0])) == 0);
+
+		assert(ls_sspan_to_utf16(sspan, units, nunits - 1, &nwritten)
+				== LS_FAILURE);
+		assert(ls_sspan_to_utf16(ls_sspan_from_cstr("\xc0\xaf"), units,
+				2, &nwritten) == LS_FAILURE);
+		assert(ls_sspan_to_utf16(LS_AN_INVALID_SSPAN, units, 2, &nwritten)
+				== LS_FAILURE);
+
+		LSByteBuffer bbuf = ls_bbuf_create();
+		assert(ls_bbuf_append(&bbuf, (const LSByte *)"<", 1) == LS_SUCCESS);
+		assert(ls_bbuf_append_from_utf16(&bbuf, units, nunits) == LS_SUCCESS);
+		assert(bbuf.len == len + 1);
+		assert(memcmp(&bbuf.bytes[1], text, len) == 0);
+
+		static const uint16_t LONE_HIGH[] = { 'a', 0xd83d, 'b' };
+		static const uint16_t LONE_LOW[] = { 'a', 0xde00 };
+		static const uint16_t CUT_OFF[] = { 'a', 0xd83d };
+		assert(ls_bbuf_append_from_utf16(&bbuf, LONE_HIGH, 3) == LS_FAILURE);
+		assert(ls_bbuf_append_from_utf16(&bbuf, LONE_LOW, 2) == LS_FAILURE);
+		assert(ls_bbuf_append_from_utf16(&bbuf, CUT_OFF, 2) == LS_FAILURE);
+		assert(bbuf.len == len + 1);
+
+		ls_bbuf_destroy(&bbuf);
+	}
+}
+
+void test_case_funcs(void)
+{
+	// long enough to go through the vector loops and the scalar tails, and
+	// with the bytes just outside 'A'..'Z' and 'a'..'z' next to the letters
+	static const char MIXED[] =
+			"@AZ[`az{ Hello, World! \xc3\x89t\xc3\xa9 Content-Length \xc0\xda"
+			"0123456789 The Quick Brown Fox Jumps Over The Lazy Dog";
+	static const char LOWER[] =
+			"@az[`az{ hello, world! \xc3\x89t\xc3\xa9 content-length \xc0\xda"
+			"0123456789 the quick brown fox jumps over the lazy dog";
+	static const char UPPER[] =
+			"@AZ[`AZ{ HELLO, WORLD! \xc3\x89T\xc3\xa9 CONTENT-LENGTH \xc0\xda"
+			"0123456789 THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG";
+	size_t len = sizeof(MIXED) - 1;
+
+	{
+		LSByteBuffer bbuf = ls_bbuf_create();
+		LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+
+		// every prefix, so that each tail length is covered
+		for (size_t i = 0; i <= len; ++i) {
+			bbuf.len = 0;
+			ls_bbuf_append(&bbuf, (const LSByte *)MIXED, i);
+
+			assert(ls_bbuf_to_lower(&bbuf) == LS_SUCCESS);
+			assert(bbuf.len == i);
+			assert(memcmp(bbuf.bytes, LOWER, i) == 0);
+
+			assert(ls_bbuf_to_upper(&bbuf) == LS_SUCCESS);
+			assert(memcmp(bbuf.bytes, UPPER, i) == 0);
+		}
+
+		assert(ls_bbuf_to_lower(&invalid) == LS_FAILURE);
+		assert(ls_bbuf_to_upper(&invalid) == LS_FAILURE);
+
+		ls_bbuf_destroy(&bbuf);
+	}
+	{
+		LSStringSpan mixed = ls_sspan_from_chars(MIXED, len);
+		LSStringSpan lower = ls_sspan_from_chars(LOWER, len);
+		LSStringSpan upper = ls_sspan_from_chars(UPPER, len);
+		LSStringSpan invalid = LS_AN_INVALID_SSPAN;
+
+		for (size_t i = 0; i <= len; ++i) {
+			LSStringSpan a = ls_sspan_subspan(mixed, 0, i);
+			LSStringSpan b = ls_sspan_subspan(lower, 0, i);
+			LSStringSpan c = ls_sspan_subspan(upper, 0, i);
+
+			assert(ls_sspan_equals_icase(a, b));
+			assert(ls_sspan_equals_icase(b, c));
+			assert(ls_sspan_hash_icase(a) == ls_sspan_hash_icase(b));
+			assert(ls_sspan_hash_icase(b) == ls_sspan_hash_icase(c));
+		}
+
+		// a single differing byte anywhere must be noticed
+		LSByte bytes[sizeof(MIXED)];
+		memcpy(bytes, MIXED, len);
+		for (size_t i = 0; i < len; ++i) {
+			bytes[i] ^= 0x01;
+			assert(!ls_sspan_equals_icase(mixed,
+					ls_sspan_create(bytes, len)));
+			bytes[i] ^= 0x01;
+		}
+
+		// only letters fold: '@' vs '`' and '[' vs '{' differ by 0x20 too
+		assert(!ls_sspan_equals_icase(ls_sspan_from_cstr("@["),
+				ls_sspan_from_cstr("`{")));
+		assert(!ls_sspan_equals_icase(ls_sspan_from_cstr("\xc3\x89"),
+				ls_sspan_from_cstr("\xe3\xa9")));
+
+		assert(!ls_sspan_equals_icase(ls_sspan_from_cstr("abc"),
+				ls_sspan_from_cstr("abcd")));
+		assert(ls_sspan_hash_icase(ls_sspan_from_cstr("Host"))
+				!= ls_sspan_hash_icase(ls_sspan_from_cstr("Hosts")));
+		assert(ls_sspan_equals_icase(ls_sspan_from_cstr(""),
+				ls_sspan_from_cstr("")));
+
+		assert(!ls_sspan_equals_icase(invalid, invalid));
+		assert(!ls_sspan_equals_icase(mixed, invalid));
+		assert(ls_sspan_hash_icase(invalid) == 0);
+	}
+}
+
+void test_format_funcs(void)
+{
+	// every power of ten, and its neighbours, plus the extremes
+	uint64_t values[3 * 20 + 4];
+	size_t nvalues = 0;
+	uint64_t power = 1;
+	for (size_t i = 0; i < 20; ++i, power *= 10) {
+		values[nvalues++] = power - 1;
+		values[nvalues++] = power;
+		values[nvalues++] = power + 1;
+	}
+	values[nvalues++] = UINT64_MAX;
+	values[nvalues++] = (uint64_t)INT64_MAX;
+	values[nvalues++] = (uint64_t)INT64_MAX + 1;
+	values[nvalues++] = UINT64_C(0xdeadbeef);
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	char expected[128];
+
+	for (size_t i = 0; i < nvalues; ++i) {
+		uint64_t u = values[i];
+		int64_t pos = (int64_t)(u & INT64_MAX);
+		int64_t neg = -pos - (u >> 63);
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_u64(&bbuf, u) == LS_SUCCESS);
+		snprintf(expected, sizeof(expected), "%llu", (unsigned long long)u);
+		assert(bbuf.len == strlen(expected));
+		assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_i64(&bbuf, neg) == LS_SUCCESS);
+		snprintf(expected, sizeof(expected), "%lld", (long long)neg);
+		assert(bbuf.len == strlen(expected));
+		assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_hex(&bbuf, u) == LS_SUCCESS);
+		snprintf(expected, sizeof(expected), "%llx", (unsigned long long)u);
+		assert(bbuf.len == strlen(expected));
+		assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+		// (`%.0llu` prints nothing for `0`, so start at `1`)
+		for (size_t min_digits = 1; min_digits <= 25; min_digits += 3) {
+			int width = (int)min_digits;
+
+			bbuf.len = 0;
+			assert(ls_bbuf_append_u64_padded(&bbuf, u, min_digits)
+					== LS_SUCCESS);
+			snprintf(expected, sizeof(expected), "%.*llu", width,
+					(unsigned long long)u);
+			assert(bbuf.len == strlen(expected));
+			assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+			bbuf.len = 0;
+			assert(ls_bbuf_append_i64_padded(&bbuf, neg, min_digits)
+					== LS_SUCCESS);
+			snprintf(expected, sizeof(expected), "%.*lld", width,
+					(long long)neg);
+			assert(bbuf.len == strlen(expected));
+			assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+			bbuf.len = 0;
+			assert(ls_bbuf_append_hex_padded(&bbuf, u, min_digits)
+					== LS_SUCCESS);
+			snprintf(expected, sizeof(expected), "%.*llx", width,
+					(unsigned long long)u);
+			assert(bbuf.len == strlen(expected));
+			assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+		}
+	}
+
+	// appends rather than overwrites
+	bbuf.len = 0;
+	assert(ls_bbuf_append_i64(&bbuf, -7) == LS_SUCCESS);
+	assert(ls_bbuf_append_u64_padded(&bbuf, 7, 3) == LS_SUCCESS);
+	assert(ls_bbuf_append_hex_padded(&bbuf, 0, 2) == LS_SUCCESS);
+	assert(bbuf.len == 7 && memcmp(bbuf.bytes, "-700700", 7) == 0);
+
+	{
+		LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+		assert(ls_bbuf_append_u64(&invalid, 1) == LS_FAILURE);
+		assert(ls_bbuf_append_i64(&invalid, 1) == LS_FAILURE);
+		assert(ls_bbuf_append_hex(&invalid, 1) == LS_FAILURE);
+		assert(ls_bbuf_append_u64_padded(&bbuf, 1, SIZE_MAX)
+				== LS_FAILURE);
+		assert(ls_bbuf_append_i64_padded(&bbuf, -1, SIZE_MAX)
+				== LS_FAILURE);
+		assert(ls_bbuf_append_hex_padded(&bbuf, 1, SIZE_MAX)
+				== LS_FAILURE);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_float_format_funcs(void)
+{
+	static const struct {
+		double value;
+		const char *expected;
+	} CASES[] = {
+		{ 0.0, "0" },
+		{ -0.0, "-0" },
+		{ 1.0, "1" },
+		{ -1.5, "-1.5" },
+		{ 0.1, "0.1" },
+		{ 0.3, "0.3" },
+		{ 100.0, "100" },
+		{ 123456.789, "123456.789" },
+		{ 1e20, "100000000000000000000" },
+		{ 1e21, "1e+21" },
+		{ 1.5e300, "1.5e+300" },
+		{ 0.000001, "0.000001" },
+		{ 1e-7, "1e-7" },
+		{ 1.25e-7, "1.25e-7" },
+		{ 5e-324, "5e-324" },
+		{ 2.2250738585072014e-308, "2.2250738585072014e-308" },
+		{ 1.7976931348623157e+308, "1.7976931348623157e+308" },
+		{ 9007199254740993.0, "9007199254740992" },
+	};
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	char expected[512];
+	char cstr[64];
+
+	for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i) {
+		bbuf.len = 0;
+		assert(ls_bbuf_append_f64(&bbuf, CASES[i].value) == LS_SUCCESS);
+		assert(bbuf.len == strlen(CASES[i].expected));
+		assert(memcmp(bbuf.bytes, CASES[i].expected, bbuf.len) == 0);
+	}
+
+	bbuf.len = 0;
+	assert(ls_bbuf_append_f32(&bbuf, 0.1f) == LS_SUCCESS);
+	assert(ls_bbuf_append_f32(&bbuf, 16777216.0f) == LS_SUCCESS);
+	assert(ls_bbuf_append_f32(&bbuf, 1e-45f) == LS_SUCCESS);
+	assert(bbuf.len == 16 && memcmp(bbuf.bytes, "0.1167772161e-45", 16) == 0);
+
+	{
+		double inf = 1e308 * 10.0;
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_f64(&bbuf, inf) == LS_SUCCESS);
+		assert(ls_bbuf_append_f64(&bbuf, -inf) == LS_SUCCESS);
+		assert(ls_bbuf_append_f64(&bbuf, inf - inf) == LS_SUCCESS);
+		assert(ls_bbuf_append_f32_fixed(&bbuf, (float)-inf, 2)
+				== LS_SUCCESS);
+		assert(bbuf.len == 14
+				&& memcmp(bbuf.bytes, "inf-infnan-inf", 14) == 0);
+	}
+
+	// random bit patterns round-trip, and no shorter `%.*e` would
+	uint64_t state = UINT64_C(0x9e3779b97f4a7c15);
+	for (size_t i = 0; i < 100000; ++i) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		double value;
+		memcpy(&value, &state, sizeof(value));
+		if (value != value || value - value != 0) {
+			continue;
+		}
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_f64(&bbuf, value) == LS_SUCCESS);
+		assert(bbuf.len < sizeof(cstr));
+		memcpy(cstr, bbuf.bytes, bbuf.len);
+		cstr[bbuf.len] = '\0';
+		assert(strtod(cstr, NULL) == value);
+
+		// significant digits, without the zeros around them
+		char digits[64];
+		size_t ndigits = 0;
+		for (const char *c = cstr; *c && *c != 'e'; ++c) {
+			if (*c >= '0' && *c <= '9' && (ndigits > 0 || *c != '0')) {
+				digits[ndigits++] = *c;
+			}
+		}
+		while (ndigits > 0 && digits[ndigits - 1] == '0') {
+			ndigits--;
+		}
+		if (ndigits > 1) {
+			snprintf(expected, sizeof(expected), "%.*e",
+					(int)ndigits - 2, value);
+			assert(strtod(expected, NULL) != value);
+		}
+
+		float value32;
+		uint32_t bits32 = (uint32_t)(state >> 32);
+		memcpy(&value32, &bits32, sizeof(value32));
+		if (value32 != value32 || value32 - value32 != 0) {
+			continue;
+		}
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_f32(&bbuf, value32) == LS_SUCCESS);
+		assert(bbuf.len < sizeof(cstr));
+		memcpy(cstr, bbuf.bytes, bbuf.len);
+		cstr[bbuf.len] = '\0';
+		assert(strtof(cstr, NULL) == value32);
+	}
+
+	// the fixed variants match `printf()`, including ties and huge values
+	static const double FIXED_VALUES[] = {
+		0.0, -0.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.375, 1.005, -0.001,
+		123456.789, 5e-324, 1e-10, 0.1, 9007199254740993.0, 1e22, 1e300,
+		-1.7976931348623157e+308,
+	};
+	for (size_t i = 0; i < sizeof(FIXED_VALUES) / sizeof(FIXED_VALUES[0]);
+			++i) {
+		for (int ndecimals = 0; ndecimals <= 25; ++ndecimals) {
+			double value = FIXED_VALUES[i];
+
+			bbuf.len = 0;
+			assert(ls_bbuf_append_f64_fixed(&bbuf, value, ndecimals)
+					== LS_SUCCESS);
+			snprintf(expected, sizeof(expected), "%.*f", ndecimals,
+					value);
+			assert(bbuf.len == strlen(expected));
+			assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+			bbuf.len = 0;
+			assert(ls_bbuf_append_f32_fixed(&bbuf, (float)value,
+					ndecimals) == LS_SUCCESS);
+			snprintf(expected, sizeof(expected), "%.*f", ndecimals,
+					(double)(float)value);
+			assert(bbuf.len == strlen(expected));
+			assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+		}
+	}
+
+	{
+		LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+		assert(ls_bbuf_append_f64(&invalid, 1.0) == LS_FAILURE);
+		assert(ls_bbuf_append_f32(&invalid, 1.0f) == LS_FAILURE);
+		assert(ls_bbuf_append_f64_fixed(&invalid, 1.0, 2) == LS_FAILURE);
+		assert(ls_bbuf_append_f64_fixed(&bbuf, 1.0, (size_t)INT_MAX + 1)
+				== LS_FAILURE);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_parse_funcs(void)
+{
+	static const struct {
+		const char *cstr;
+		LSStatus status;
+		uint64_t value;
+		size_t nconsumed;
+	} U64_CASES[] = {
+		{ "0", LS_SUCCESS, 0, 1 },
+		{ "+42", LS_SUCCESS, 42, 3 },
+		{ "123456789012 apples", LS_SUCCESS, UINT64_C(123456789012), 12 },
+		{ "000000000000000000000000007", LS_SUCCESS, 7, 27 },
+		{ "18446744073709551615", LS_SUCCESS, UINT64_MAX, 20 },
+		{ "18446744073709551616", LS_FAILURE, UINT64_MAX, 20 },
+		{ "99999999999999999999", LS_FAILURE, UINT64_MAX, 20 },
+		{ "100000000000000000000", LS_FAILURE, UINT64_MAX, 21 },
+		{ "", LS_FAILURE, 0, 0 },
+		{ "+", LS_FAILURE, 0, 0 },
+		{ "-1", LS_FAILURE, 0, 0 },
+		{ " 1", LS_FAILURE, 0, 0 },
+	};
+	static const struct {
+		const char *cstr;
+		LSStatus status;
+		int64_t value;
+		size_t nconsumed;
+	} I64_CASES[] = {
+		{ "-0", LS_SUCCESS, 0, 2 },
+		{ "-42x", LS_SUCCESS, -42, 3 },
+		{ "9223372036854775807", LS_SUCCESS, INT64_MAX, 19 },
+		{ "9223372036854775808", LS_FAILURE, INT64_MAX, 19 },
+		{ "-9223372036854775808", LS_SUCCESS, INT64_MIN, 20 },
+		{ "-9223372036854775809", LS_FAILURE, INT64_MIN, 20 },
+		{ "-", LS_FAILURE, 0, 0 },
+		{ "--1", LS_FAILURE, 0, 0 },
+	};
+	static const struct {
+		const char *cstr;
+		LSStatus status;
+		double value;
+		size_t nconsumed;
+	} F64_CASES[] = {
+		{ "0", LS_SUCCESS, 0.0, 1 },
+		{ "-0.0", LS_SUCCESS, -0.0, 4 },
+		{ "1.5e3,", LS_SUCCESS, 1500.0, 5 },
+		{ ".25", LS_SUCCESS, 0.25, 3 },
+		{ "1.", LS_SUCCESS, 1.0, 2 },
+		{ "1.e2", LS_SUCCESS, 100.0, 4 },
+		{ "2e", LS_SUCCESS, 2.0, 1 },
+		{ "2e+", LS_SUCCESS, 2.0, 1 },
+		{ "2E-1", LS_SUCCESS, 0.2, 4 },
+		{ "5e-324", LS_SUCCESS, 5e-324, 6 },
+		{ "2e-324", LS_SUCCESS, 0.0, 6 },
+		{ "1e-400", LS_SUCCESS, 0.0, 6 },
+		{ "1.7976931348623157e308", LS_SUCCESS, 1.7976931348623157e308, 22 },
+		{ "9007199254740993", LS_SUCCESS, 9007199254740992.0, 16 },
+		{ "9007199254740993.0000000000001", LS_SUCCESS,
+				9007199254740994.0, 30 },
+		{ "1e99999999999999999999", LS_FAILURE, 1e308 * 10.0, 22 },
+		{ "-1e400", LS_FAILURE, -1e308 * 10.0, 6 },
+		{ "INF", LS_SUCCESS, 1e308 * 10.0, 3 },
+		{ "-Infinity", LS_SUCCESS, -1e308 * 10.0, 9 },
+		{ "infinit", LS_SUCCESS, 1e308 * 10.0, 3 },
+		{ "", LS_FAILURE, 0.0, 0 },
+		{ "-", LS_FAILURE, 0.0, 0 },
+		{ ".", LS_FAILURE, 0.0, 0 },
+		{ "+.e1", LS_FAILURE, 0.0, 0 },
+		{ "e5", LS_FAILURE, 0.0, 0 },
+		{ "in", LS_FAILURE, 0.0, 0 },
+	};
+
+	uint64_t u;
+	int64_t i;
+	double d;
+	size_t nconsumed;
+
+	for (size_t c = 0; c < sizeof(U64_CASES) / sizeof(U64_CASES[0]); ++c) {
+		LSStringSpan sspan = ls_sspan_from_cstr(U64_CASES[c].cstr);
+		assert(ls_sspan_parse_u64(sspan, &u, &nconsumed)
+				== U64_CASES[c].status);
+		assert(u == U64_CASES[c].value);
+		assert(nconsumed == U64_CASES[c].nconsumed);
+	}
+
+	for (size_t c = 0; c < sizeof(I64_CASES) / sizeof(I64_CASES[0]); ++c) {
+		LSStringSpan sspan = ls_sspan_from_cstr(I64_CASES[c].cstr);
+		assert(ls_sspan_parse_i64(sspan, &i, &nconsumed)
+				== I64_CASES[c].status);
+		assert(i == I64_CASES[c].value);
+		assert(nconsumed == I64_CASES[c].nconsumed);
+	}
+
+	for (size_t c = 0; c < sizeof(F64_CASES) / sizeof(F64_CASES[0]); ++c) {
+		LSStringSpan sspan = ls_sspan_from_cstr(F64_CASES[c].cstr);
+		assert(ls_sspan_parse_f64(sspan, &d, &nconsumed)
+				== F64_CASES[c].status);
+		assert(memcmp(&d, &F64_CASES[c].value, sizeof(d)) == 0);
+		assert(nconsumed == F64_CASES[c].nconsumed);
+	}
+
+	{
+		LSStringSpan nan = ls_sspan_from_cstr("NaN");
+		assert(ls_sspan_parse_f64(nan, &d, &nconsumed) == LS_SUCCESS);
+		assert(d != d && nconsumed == 3);
+
+		LSStringSpan invalid = LS_AN_INVALID_SSPAN;
+		assert(ls_sspan_parse_u64(invalid, &u, &nconsumed) == LS_FAILURE);
+		assert(ls_sspan_parse_i64(invalid, &i, &nconsumed) == LS_FAILURE);
+		assert(ls_sspan_parse_f64(invalid, &d, &nconsumed) == LS_FAILURE);
+		assert(nconsumed == 0);
+	}
+
+	// a value just above halfway between `1` and the next double, with the
+	// deciding digit past anything the fast paths can look at
+	{
+		static const char HALFWAY[] =
+				"1.00000000000000011102230246251565404236316680908203125";
+		char cstr[2048];
+		size_t len = strlen(HALFWAY);
+		memcpy(cstr, HALFWAY, len);
+		memset(&cstr[len], '0', 1000);
+		len += 1000;
+
+		LSStringSpan sspan = ls_sspan_from_chars(cstr, len);
+		assert(ls_sspan_parse_f64(sspan, &d, &nconsumed) == LS_SUCCESS);
+		assert(d == 1.0 && nconsumed == len);
+
+		cstr[len++] = '1';
+		sspan.len = len;
+		assert(ls_sspan_parse_f64(sspan, &d, &nconsumed) == LS_SUCCESS);
+		assert(d > 1.0 && nconsumed == len);
+	}
+
+	// random strings over the alphabet of numbers parse like `strto*()`
+	static const char ALPHABET[] = "0000123456789999..eE+-";
+	uint64_t state = UINT64_C(0x2545f4914f6cdd1d);
+	for (size_t round = 0; round < 200000; ++round) {
+		char cstr[64];
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		size_t len = (size_t)(state % 48);
+		uint64_t bits = state;
+		for (size_t j = 0; j < len; ++j) {
+			if (j % 8 == 0) {
+				bits ^= bits << 13;
+				bits ^= bits >> 7;
+				bits ^= bits << 17;
+			}
+
+			// mostly digits, so that most strings are numbers
+			size_t pick = (bits >> (8 * (j % 8))) & 0xff;
+			cstr[j] = pick < 200 ? (char)('0' + pick % 10)
+					: ALPHABET[pick % (sizeof(ALPHABET) - 1)];
+		}
+		cstr[len] = '\0';
+
+		LSStringSpan sspan = ls_sspan_from_chars(cstr, len);
+		char *end;
+
+		double expected_d = strtod(cstr, &end);
+		LSStatus status = ls_sspan_parse_f64(sspan, &d, &nconsumed);
+		assert(memcmp(&d, &expected_d, sizeof(d)) == 0);
+		assert(nconsumed == (size_t)(end - cstr));
+		assert(status == LS_SUCCESS || d - d != 0 || nconsumed == 0);
+
+		if (cstr[0] != '-') {
+			unsigned long long expected_u = strtoull(cstr, &end, 10);
+			status = ls_sspan_parse_u64(sspan, &u, &nconsumed);
+			assert(u == expected_u);
+			assert(nconsumed == (size_t)(end - cstr));
+			assert((status == LS_SUCCESS)
+					== (nconsumed > 0 && u != UINT64_MAX));
+		}
+
+		long long expected_i = strtoll(cstr, &end, 10);
+		status = ls_sspan_parse_i64(sspan, &i, &nconsumed);
+		assert(i == expected_i);
+		assert(nconsumed == (size_t)(end - cstr));
+	}
+
+	// formatted doubles round-trip
+	LSByteBuffer bbuf = ls_bbuf_create();
+	for (size_t round = 0; round < 100000; ++round) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		double value;
+		memcpy(&value, &state, sizeof(value));
+		if (value != value || value - value != 0) {
+			continue;
+		}
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_f64(&bbuf, value) == LS_SUCCESS);
+		assert(ls_sspan_parse_f64(ls_sspan_from_bbuf(bbuf), &d, &nconsumed)
+				== LS_SUCCESS);
+		assert(memcmp(&d, &value, sizeof(d)) == 0);
+		assert(nconsumed == bbuf.len);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_appendf_funcs(void)
+{
+	assert_appendf_like_snprintf("plain text");
+	assert_appendf_like_snprintf("");
+	assert_appendf_like_snprintf("100%% of %d%s", 42, "s");
+	assert_appendf_like_snprintf("[%d|%i|%u|%x|%X]", -7, INT_MIN, UINT_MAX,
+			0xbeefu, 0xbeefu);
+	assert_appendf_like_snprintf("[%hhd|%hd|%ld|%lld|%jd|%zd|%td]", -129,
+			70000, LONG_MIN, LLONG_MIN, INTMAX_MAX, (ptrdiff_t)-5,
+			(ptrdiff_t)PTRDIFF_MAX);
+	assert_appendf_like_snprintf("[%hhu|%hu|%lu|%llu|%ju|%zu|%zx]", 257u,
+			70000u, ULONG_MAX, ULLONG_MAX, UINTMAX_MAX, SIZE_MAX,
+			(size_t)0xabc);
+	assert_appendf_like_snprintf("[%5d|%-5d|%05d|%+d|% d|%+05d|% 5d]", 42, 42,
+			-42, 42, 42, 42, -42);
+	assert_appendf_like_snprintf("[%.5d|%8.5d|%-8.5x|%08.5d|%.0d|%5.0d|%+.0d]",
+			42, -42, 0xfu, 42, 0, 0, 0);
+	assert_appendf_like_snprintf("[%08x|%08X|%016lx|%-08x|%+08x]", 0xabu,
+			0xfu, 0xdeadbeefUL, 0xabu, 0xcu);
+	assert_appendf_like_snprintf("[%08f|%+08f|%08e|%08g|%08.1f]", INFINITY,
+			-INFINITY, NAN, INFINITY, -1.5);
+	assert_appendf_like_snprintf("[%*d|%-*d|%*d|%.*d|%.*d]", 6, 1, 6, 2, -6,
+			3, 4, 5, -4, 6);
+	assert_appendf_like_snprintf("[%c|%3c|%-3c]", 'a', 'b', 'c');
+	assert_appendf_like_snprintf("[%s|%.3s|%8s|%-8s|%.10s]", "hello",
+			"hello", "hi", "hi", "short");
+	assert_appendf_like_snprintf("[%f|%.0f|%.3f|%10.2f|%-10.2f|%010.2f]",
+			3.14159, 2.5, -0.0005, 1.005, -1.5, -1.5);
+	assert_appendf_like_snprintf("[%+f|% f|%F|%f|%F|%08f]", 1.0, 1.0,
+			1e300 * 1e10, -1e300 * 1e10, 0.0 / 0.0 * 0.0, 1e300 * 1e10);
+	assert_appendf_like_snprintf("[%.30f|%f|%.20f]", 0.1, 1e300, 1e-300);
+	assert_appendf_like_snprintf("[%e|%.3E|%g|%G|%12.4g|%-+12g|%012g]",
+			12345.678, 0.000123, 1e-5, 1e21, 3.14159, 2.0, -2.5);
+	assert_appendf_like_snprintf("[%a|%.2A]", 1.0, -0.1);
+	assert_appendf_like_snprintf("[%lf|%le]", 1.5, 1.5);
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+
+	{
+		LSStringSpan sspan = ls_sspan_from_cstr("span");
+		LSString string = ls_string_from_cstr("string");
+
+		assert(ls_bbuf_appendf(&bbuf, "<%S|%T|%.2S|%6S|%-7T|%p>", sspan,
+				string, sspan, sspan, string, (void *)0x1f) == LS_SUCCESS);
+		static const char EXPECTED[] = "<span|string|sp|  span|string |0x1f>";
+		assert(bbuf.len == strlen(EXPECTED));
+		assert(memcmp(bbuf.bytes, EXPECTED, bbuf.len) == 0);
+
+		ls_string_destroy(&string);
+	}
+
+	// appends, and grows only once for a long output
+	{
+		LSByteBuffer small = ls_bbuf_create_with_init_cap(1);
+		char long_cstr[1000];
+		memset(long_cstr, 'x', sizeof(long_cstr) - 1);
+		long_cstr[sizeof(long_cstr) - 1] = '\0';
+
+		assert(ls_bbuf_append(&small, (const LSByte *)">", 1)
+				== LS_SUCCESS);
+		assert(ls_bbuf_appendf(&small, "%s%d%s", long_cstr, 1, long_cstr)
+				== LS_SUCCESS);
+		assert(small.len == 2000 && small.bytes[0] == '>');
+		assert(small.bytes[1000] == '1');
+
+		// running out of space halfway, then finding an invalid argument
+		LSByteBuffer tiny = ls_bbuf_create_with_init_cap(4);
+		assert(ls_bbuf_appendf(&tiny, "%d%s%d%S", 1, long_cstr, 2,
+				LS_AN_INVALID_SSPAN) == LS_FAILURE);
+		assert(tiny.len == 0);
+
+		ls_bbuf_destroy(&tiny);
+		ls_bbuf_destroy(&small);
+	}
+
+	// failures leave the buffer as it was
+	{
+		bbuf.len = 0;
+		assert(ls_bbuf_appendf(&bbuf, "kept") == LS_SUCCESS);
+
+		LSStringSpan invalid_sspan = LS_AN_INVALID_SSPAN;
+		LSString invalid_string = LS_AN_INVALID_STRING;
+		assert(ls_bbuf_appendf(&bbuf, "%d %S", 1, invalid_sspan)
+				== LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%d %T", 1, invalid_string)
+				== LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%d %s", 1, (char *)NULL)
+				== LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%d %n", 1, (int *)NULL)
+				== LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%d %o", 1, 1u) == LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%d %#x", 1, 1u) == LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%d %Lf", 1, 1.0L) == LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%d %ls", 1, (void *)NULL)
+				== LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "trailing %") == LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, "%99999999999d", 1) == LS_FAILURE);
+		assert(ls_bbuf_appendf(&bbuf, NULL) == LS_FAILURE);
+		assert(bbuf.len == 4 && memcmp(bbuf.bytes, "kept", 4) == 0);
+
+		LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+		assert(ls_bbuf_appendf(&invalid, "x") == LS_FAILURE);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_template_funcs(void)
+{
+	LSByteBuffer bbuf = ls_bbuf_create();
+	assert(ls_bbuf_is_valid(bbuf));
+
+	{
+		LSTemplate tmpl = ls_template_create(ls_sspan_from_cstr(
+				"{greeting}, {name}! {{{name}}} says {greeting}}}"));
+		assert(ls_template_is_valid(tmpl));
+		assert(tmpl.nslots == 2);
+		assert(ls_template_get_slot(&tmpl, ls_sspan_from_cstr("greeting"))
+				== 0);
+		assert(ls_template_get_slot(&tmpl, ls_sspan_from_cstr("name")) == 1);
+		assert(ls_template_get_slot(&tmpl, ls_sspan_from_cstr("nam"))
+				== SIZE_MAX);
+		assert(ls_template_get_slot(&tmpl, LS_AN_INVALID_SSPAN) == SIZE_MAX);
+
+		LSStringSpan values[] = {
+			ls_sspan_from_cstr("Hello"),
+			ls_sspan_from_cstr("world"),
+		};
+		assert(ls_bbuf_append(&bbuf, (const LSByte *)">", 1) == LS_SUCCESS);
+		assert(ls_template_render(&tmpl, values, 2, &bbuf) == LS_SUCCESS);
+
+		const char *expected = ">Hello, world! {world} says Hello}";
+		assert(bbuf.len == strlen(expected));
+		assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+		// values are looked up by slot, extra values are ignored
+		bbuf.len = 0;
+		LSStringSpan more_values[] = {
+			LS_EMPTY_SSPAN,
+			ls_sspan_from_cstr("x"),
+			LS_AN_INVALID_SSPAN,
+		};
+		assert(ls_template_render(&tmpl, more_values, 3, &bbuf)
+				== LS_SUCCESS);
+		expected = ", x! {x} says }";
+		assert(bbuf.len == strlen(expected));
+		assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+		// failure leaves `bbuf` unchanged
+		size_t len = bbuf.len;
+		assert(ls_template_render(&tmpl, values, 1, &bbuf) == LS_FAILURE);
+		assert(ls_template_render(&tmpl, NULL, 2, &bbuf) == LS_FAILURE);
+		assert(ls_template_render(&tmpl, &more_values[1], 2, &bbuf)
+				== LS_FAILURE);
+		assert(bbuf.len == len);
+
+		LSByteBuffer invalid_bbuf = LS_AN_INVALID_BBUF;
+		assert(ls_template_render(&tmpl, values, 2, &invalid_bbuf)
+				== LS_FAILURE);
+
+		ls_template_destroy(&tmpl);
+	}
+	{
+		LSTemplate literal = ls_template_create(
+				ls_sspan_from_cstr("no {{placeholders}} here"));
+		assert(ls_template_is_valid(literal));
+		assert(literal.nslots == 0);
+
+		bbuf.len = 0;
+		assert(ls_template_render(&literal, NULL, 0, &bbuf) == LS_SUCCESS);
+		assert(bbuf.len == 22);
+		assert(memcmp(bbuf.bytes, "no {placeholders} here", 22) == 0);
+		ls_template_destroy(&literal);
+
+		LSTemplate empty = ls_template_create(LS_EMPTY_SSPAN);
+		assert(ls_template_is_valid(empty));
+		assert(empty.nslots == 0);
+		assert(ls_template_render(&empty, NULL, 0, &bbuf) == LS_SUCCESS);
+		assert(bbuf.len == 22);
+		ls_template_destroy(&empty);
+
+		LSTemplate only_slots = ls_template_create(
+				ls_sspan_from_cstr("{a}{b}{a}"));
+		assert(ls_template_is_valid(only_slots));
+		assert(only_slots.nslots == 2);
+
+		bbuf.len = 0;
+		LSStringSpan values[] = {
+			ls_sspan_from_cstr("ab"),
+			ls_sspan_from_cstr("{c}"),
+		};
+		assert(ls_template_render(&only_slots, values, 2, &bbuf)
+				== LS_SUCCESS);
+		assert(bbuf.len == 7 && memcmp(bbuf.bytes, "ab{c}ab", 7) == 0);
+		ls_template_destroy(&only_slots);
+
+		LSTemplate invalid = LS_AN_INVALID_TEMPLATE;
+		assert(!ls_template_is_valid(invalid));
+		assert(ls_template_get_slot(&invalid, ls_sspan_from_cstr("a"))
+				== SIZE_MAX);
+		assert(ls_template_render(&invalid, NULL, 0, &bbuf) == LS_FAILURE);
+	}
+	{
+		static const char *const MALFORMED[] = {
+			"{", "}", "{}", "a{b", "a}b", "{a{b}}", "{a}}", "{{a}", "x{a}{",
+		};
+
+		for (size_t i = 0; i < sizeof(MALFORMED) / sizeof(MALFORMED[0]);
+				++i) {
+			LSTemplate tmpl = ls_template_create(
+					ls_sspan_from_cstr(MALFORMED[i]));
+			assert(!ls_template_is_valid(tmpl));
+		}
+
+		assert(!ls_template_is_valid(
+				ls_template_create(LS_AN_INVALID_SSPAN)));
+	}
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_replace_funcs(void)
+{
+	{
+		LSString string = ls_sspan_replace_all(
+				ls_sspan_from_cstr("a.b..c..."),
+				ls_sspan_from_cstr(".."), ls_sspan_from_cstr("<>"));
+		assert(ls_string_is_valid(string));
+		assert(string.len == 9);
+		assert(strcmp((const char *)string.bytes, "a.b<>c<>.") == 0);
+		ls_string_destroy(&string);
+
+		string = ls_sspan_replace_all(ls_sspan_from_cstr("aaaa"),
+				ls_sspan_from_cstr("aa"), LS_EMPTY_SSPAN);
+		assert(ls_string_is_valid(string) && string.len == 0);
+		ls_string_destroy(&string);
+
+		string = ls_sspan_replace_all(LS_EMPTY_SSPAN,
+				ls_sspan_from_cstr("a"), ls_sspan_from_cstr("b"));
+		assert(ls_string_is_valid(string) && string.len == 0);
+		ls_string_destroy(&string);
+
+		assert(!ls_string_is_valid(ls_sspan_replace_all(
+				ls_sspan_from_cstr("a"), LS_EMPTY_SSPAN,
+				ls_sspan_from_cstr("b"))));
+		assert(!ls_string_is_valid(ls_sspan_replace_all(
+				LS_AN_INVALID_SSPAN, ls_sspan_from_cstr("a"),
+				ls_sspan_from_cstr("b"))));
+		assert(!ls_string_is_valid(ls_sspan_replace_all(
+				ls_sspan_from_cstr("a"), ls_sspan_from_cstr("a"),
+				LS_AN_INVALID_SSPAN)));
+	}
+	{
+		LSByteBuffer bbuf = ls_bbuf_create();
+		assert(ls_bbuf_append(&bbuf, (const LSByte *)"x&y&&z", 6)
+				== LS_SUCCESS);
+
+		assert(ls_bbuf_replace_all(&bbuf, ls_sspan_from_cstr("&"),
+				ls_sspan_from_cstr("&amp;")) == LS_SUCCESS);
+		assert(bbuf.len == 18);
+		assert(memcmp(bbuf.bytes, "x&amp;y&amp;&amp;z", 18) == 0);
+
+		assert(ls_bbuf_replace_all(&bbuf, ls_sspan_from_cstr("&amp;"),
+				ls_sspan_from_cstr("+")) == LS_SUCCESS);
+		assert(bbuf.len == 6 && memcmp(bbuf.bytes, "x+y++z", 6) == 0);
+
+		assert(ls_bbuf_replace_all(&bbuf, ls_sspan_from_cstr("?"),
+				ls_sspan_from_cstr("??")) == LS_SUCCESS);
+		assert(bbuf.len == 6 && memcmp(bbuf.bytes, "x+y++z", 6) == 0);
+
+		assert(ls_bbuf_replace_all(&bbuf, LS_EMPTY_SSPAN,
+				ls_sspan_from_cstr("-")) == LS_FAILURE);
+		assert(ls_bbuf_replace_all(&bbuf, ls_sspan_from_cstr("+"),
+				LS_AN_INVALID_SSPAN) == LS_FAILURE);
+		assert(bbuf.len == 6 && memcmp(bbuf.bytes, "x+y++z", 6) == 0);
+
+		LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+		assert(ls_bbuf_replace_all(&invalid, ls_sspan_from_cstr("+"),
+				ls_sspan_from_cstr("-")) == LS_FAILURE);
+
+		ls_bbuf_destroy(&bbuf);
+	}
+
+	// random text over a small alphabet, long enough to leave the tail loop
+	srand(44);
+	for (size_t round = 0; round < 2000; ++round) {
+		LSByte text[300];
+		LSByte needle[6];
+		LSByte replacement[10];
+
+		size_t len = (size_t)rand() % (sizeof(text) + 1);
+		size_t needle_len = 1 + (size_t)rand() % sizeof(needle);
+		size_t replacement_len = (size_t)rand() % (sizeof(replacement) + 1);
+		for (size_t i = 0; i < len; ++i) {
+			text[i] = (LSByte)"aab"[rand() % 3];
+		}
+		for (size_t i = 0; i < needle_len; ++i) {
+			needle[i] = (LSByte)"aab"[rand() % 3];
+		}
+		for (size_t i = 0; i < replacement_len; ++i) {
+			replacement[i] = (LSByte)"abc"[rand() % 3];
+		}
+
+		assert_replace_all_like_naive(ls_sspan_create(text, len),
+				ls_sspan_create(needle, needle_len),
+				ls_sspan_create(replacement, replacement_len));
+	}
+}
+
+void test_bbuf_range_funcs(void)
+{
+	LSByteBuffer bbuf = ls_bbuf_from_sspan(ls_sspan_from_cstr("0123456789"));
+	assert(ls_bbuf_is_valid(bbuf));
+
+	assert(ls_bbuf_erase(&bbuf, 2, 3) == LS_SUCCESS);
+	assert(bbuf.len == 7 && memcmp(bbuf.bytes, "0156789", 7) == 0);
+	assert(ls_bbuf_erase(&bbuf, 5, 2) == LS_SUCCESS);
+	assert(bbuf.len == 5 && memcmp(bbuf.bytes, "01567", 5) == 0);
+	assert(ls_bbuf_erase(&bbuf, 5, 0) == LS_SUCCESS);
+	assert(ls_bbuf_erase(&bbuf, 5, 1) == LS_FAILURE);
+	assert(ls_bbuf_erase(&bbuf, 6, 0) == LS_FAILURE);
+	assert(ls_bbuf_erase(&bbuf, 1, SIZE_MAX) == LS_FAILURE);
+	assert(bbuf.len == 5 && memcmp(bbuf.bytes, "01567", 5) == 0);
+
+	// growing, shrinking, same length, pure insert and pure delete
+	const LSByte *abc = (const LSByte *)"abc";
+	assert(ls_bbuf_splice(&bbuf, 1, 1, abc, 3) == LS_SUCCESS);
+	assert(bbuf.len == 7 && memcmp(bbuf.bytes, "0abc567", 7) == 0);
+	assert(ls_bbuf_splice(&bbuf, 4, 3, abc, 1) == LS_SUCCESS);
+	assert(bbuf.len == 5 && memcmp(bbuf.bytes, "0abca", 5) == 0);
+	assert(ls_bbuf_splice(&bbuf, 0, 2, abc, 2) == LS_SUCCESS);
+	assert(bbuf.len == 5 && memcmp(bbuf.bytes, "abbca", 5) == 0);
+	assert(ls_bbuf_splice(&bbuf, 5, 0, abc, 3) == LS_SUCCESS);
+	assert(bbuf.len == 8 && memcmp(bbuf.bytes, "abbcaabc", 8) == 0);
+	assert(ls_bbuf_splice(&bbuf, 0, 8, abc, 0) == LS_SUCCESS);
+	assert(bbuf.len == 0);
+
+	assert(ls_bbuf_splice(&bbuf, 0, 0, NULL, 0) == LS_FAILURE);
+	assert(ls_bbuf_splice(&bbuf, 1, 0, abc, 1) == LS_FAILURE);
+	assert(ls_bbuf_splice(&bbuf, 0, 1, abc, 1) == LS_FAILURE);
+	assert(bbuf.len == 0);
+
+	LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+	size_t offset = 0;
+	assert(ls_bbuf_erase(&invalid, 0, 0) == LS_FAILURE);
+	assert(ls_bbuf_splice(&invalid, 0, 0, abc, 1) == LS_FAILURE);
+	assert(ls_bbuf_consume(&invalid, &offset, 0) == LS_FAILURE);
+
+	{
+		// a framer consuming 3-byte messages while more data arrives
+		assert(ls_bbuf_append(&bbuf, (const LSByte *)"AAABBBCCCDDD", 12)
+				== LS_SUCCESS);
+
+		assert(ls_bbuf_consume(&bbuf, &offset, 3) == LS_SUCCESS);
+		assert(offset == 3 && bbuf.len == 12);
+		assert(ls_bbuf_consume(&bbuf, &offset, 3) == LS_SUCCESS);
+		assert(offset == 6 && bbuf.len == 12);
+		assert(memcmp(&bbuf.bytes[offset], "CCCDDD", 6) == 0);
+
+		// more consumed than left: the rest moves to the front
+		assert(ls_bbuf_consume(&bbuf, &offset, 3) == LS_SUCCESS);
+		assert(offset == 0 && bbuf.len == 3);
+		assert(memcmp(bbuf.bytes, "DDD", 3) == 0);
+
+		assert(ls_bbuf_append(&bbuf, (const LSByte *)"EEE", 3)
+				== LS_SUCCESS);
+		assert(ls_bbuf_consume(&bbuf, &offset, 7) == LS_FAILURE);
+		assert(ls_bbuf_consume(&bbuf, &offset, 6) == LS_SUCCESS);
+		assert(offset == 0 && bbuf.len == 0);
+
+		offset = 1;
+		assert(ls_bbuf_consume(&bbuf, &offset, 0) == LS_FAILURE);
+	}
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_json_funcs(void)
+{
+	{
+		LSByteBuffer bbuf = ls_bbuf_create();
+		assert(ls_bbuf_append(&bbuf, (const LSByte *)"\"", 1) == LS_SUCCESS);
+
+		static const LSByte RAW[] = "say \"hi\"\\\b\f\n\r\t\x01\x1f\x7f \xc3\xa9/";
+		LSStringSpan raw = ls_sspan_create(RAW, sizeof(RAW) - 1);
+		assert(ls_bbuf_append_json_escaped(&bbuf, raw) == LS_SUCCESS);
+
+		const char *expected = "\"say \\\"hi\\\"\\\\\\b\\f\\n\\r\\t\\u0001"
+				"\\u001f\x7f \xc3\xa9/";
+		assert(bbuf.len == strlen(expected));
+		assert(memcmp(bbuf.bytes, expected, bbuf.len) == 0);
+
+		LSString unescaped = ls_sspan_json_unescape(ls_sspan_create(
+				&bbuf.bytes[1], bbuf.len - 1));
+		assert(ls_string_is_valid(unescaped));
+		assert(unescaped.len == raw.len);
+		assert(memcmp(unescaped.bytes, RAW, raw.len) == 0);
+		ls_string_destroy(&unescaped);
+
+		size_t len = bbuf.len;
+		assert(ls_bbuf_append_json_escaped(&bbuf, LS_EMPTY_SSPAN)
+				== LS_SUCCESS);
+		assert(ls_bbuf_append_json_escaped(&bbuf, LS_AN_INVALID_SSPAN)
+				== LS_FAILURE);
+		assert(bbuf.len == len);
+
+		LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+		assert(ls_bbuf_append_json_escaped(&invalid, raw) == LS_FAILURE);
+
+		ls_bbuf_destroy(&bbuf);
+	}
+	{
+		static const struct {
+			const char *escaped;
+			const char *unescaped;
+		} CASES[] = {
+			{ "", "" },
+			{ "plain", "plain" },
+			{ "\\/\\u0041\\u00e9\\u20AC", "/A\xc3\xa9\xe2\x82\xac" },
+			{ "\\ud83d\\ude00!", "\xf0\x9f\x98\x80!" },
+			{ "\\u0000", "" },
+		};
+
+		for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i) {
+			LSString string = ls_sspan_json_unescape(
+					ls_sspan_from_cstr(CASES[i].escaped));
+			assert(ls_string_is_valid(string));
+			assert(strcmp((const char *)string.bytes,
+					CASES[i].unescaped) == 0);
+			ls_string_destroy(&string);
+		}
+
+		static const char *const MALFORMED[] = {
+			"\"", "a\nb", "\\", "\\x", "\\u12", "\\u12g4", "\\ud83d",
+			"\\ud83dx", "\\ud83d\\u0041", "\\ude00", "\\ude00\\ud83d",
+		};
+
+		for (size_t i = 0; i < sizeof(MALFORMED) / sizeof(MALFORMED[0]);
+				++i) {
+			assert(!ls_string_is_valid(ls_sspan_json_unescape(
+					ls_sspan_from_cstr(MALFORMED[i]))));
+		}
+
+		assert(!ls_string_is_valid(
+				ls_sspan_json_unescape(LS_AN_INVALID_SSPAN)));
+	}
+
+	// random bytes, mostly clean, both sides of the SIMD block size
+	srand(46);
+	LSByteBuffer bbuf = ls_bbuf_create();
+	for (size_t round = 0; round < 2000; ++round) {
+		LSByte raw[200];
+		size_t len = (size_t)rand() % (sizeof(raw) + 1);
+		for (size_t i = 0; i < len; ++i) {
+			raw[i] = rand() % 16 == 0 ? (LSByte)(rand() % 256)
+					: (LSByte)('a' + rand() % 26);
+		}
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_json_escaped(&bbuf, ls_sspan_create(raw, len))
+				== LS_SUCCESS);
+
+		size_t nexpected = 0;
+		for (size_t i = 0; i < len; ++i) {
+			bool is_short = raw[i] == '"' || raw[i] == '\\'
+					|| raw[i] == '\b' || raw[i] == '\f'
+					|| raw[i] == '\n' || raw[i] == '\r'
+					|| raw[i] == '\t';
+			nexpected += is_short ? 2 : raw[i] < 0x20 ? 6 : 1;
+		}
+		assert(bbuf.len == nexpected);
+
+		for (size_t i = 0; i < bbuf.len; ++i) {
+			assert(bbuf.bytes[i] >= 0x20);
+		}
+
+		LSString unescaped = ls_sspan_json_unescape(ls_sspan_from_bbuf(bbuf));
+		assert(ls_string_is_valid(unescaped));
+		assert(unescaped.len == len);
+		assert(memcmp(unescaped.bytes, raw, len) == 0);
+		ls_string_destroy(&unescaped);
+	}
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_encoding_funcs(void)
+{
+	static const char *const RFC_4648_VECTORS[][3] = {
+		{ "", "", "" },
+		{ "f", "Zg==", "66" },
+		{ "fo", "Zm8=", "666f" },
+		{ "foo", "Zm9v", "666f6f" },
+		{ "foob", "Zm9vYg==", "666f6f62" },
+		{ "fooba", "Zm9vYmE=", "666f6f6261" },
+		{ "foobar", "Zm9vYmFy", "666f6f626172" },
+	};
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+
+	for (size_t i = 0; i < sizeof(RFC_4648_VECTORS)
+			/ sizeof(RFC_4648_VECTORS[0]); ++i) {
+		LSStringSpan raw = ls_sspan_from_cstr(RFC_4648_VECTORS[i][0]);
+		const char *base64 = RFC_4648_VECTORS[i][1];
+		const char *hex = RFC_4648_VECTORS[i][2];
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_base64(&bbuf, raw, LS_BASE64_STANDARD)
+				== LS_SUCCESS);
+		assert(bbuf.len == strlen(base64));
+		assert(memcmp(bbuf.bytes, base64, bbuf.len) == 0);
+
+		size_t unpadded_len = strcspn(base64, "=");
+		bbuf.len = 0;
+		assert(ls_bbuf_append_base64(&bbuf, raw, LS_BASE64_NO_PADDING)
+				== LS_SUCCESS);
+		assert(bbuf.len == unpadded_len);
+		assert(memcmp(bbuf.bytes, base64, bbuf.len) == 0);
+
+		bbuf.len = 0;
+		assert(ls_sspan_decode_base64(ls_sspan_from_cstr(base64),
+				LS_BASE64_STANDARD, &bbuf) == LS_SUCCESS);
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(bbuf), raw));
+
+		bbuf.len = 0;
+		assert(ls_sspan_decode_base64(ls_sspan_create(
+				(const LSByte *)base64, unpadded_len),
+				LS_BASE64_NO_PADDING, &bbuf) == LS_SUCCESS);
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(bbuf), raw));
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_hex_encoded(&bbuf, raw) == LS_SUCCESS);
+		assert(bbuf.len == strlen(hex));
+		assert(memcmp(bbuf.bytes, hex, bbuf.len) == 0);
+
+		bbuf.len = 0;
+		assert(ls_sspan_decode_hex(ls_sspan_from_cstr(hex), &bbuf)
+				== LS_SUCCESS);
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(bbuf), raw));
+	}
+	{
+		LSStringSpan raw = ls_sspan_from_cstr("\xfb\xff\xbf?");
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_base64(&bbuf, raw, LS_BASE64_STANDARD)
+				== LS_SUCCESS);
+		assert(bbuf.len == 8 && memcmp(bbuf.bytes, "+/+/Pw==", 8) == 0);
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_base64(&bbuf, raw,
+				LS_BASE64_URL | LS_BASE64_NO_PADDING) == LS_SUCCESS);
+		assert(bbuf.len == 6 && memcmp(bbuf.bytes, "-_-_Pw", 6) == 0);
+
+		bbuf.len = 0;
+		assert(ls_sspan_decode_base64(ls_sspan_from_cstr("-_-_Pw=="),
+				LS_BASE64_URL, &bbuf) == LS_SUCCESS);
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(bbuf), raw));
+
+		bbuf.len = 0;
+		assert(ls_sspan_decode_hex(ls_sspan_from_cstr("FbfFBF3f"), &bbuf)
+				== LS_SUCCESS);
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(bbuf), raw));
+	}
+	{
+		static const struct {
+			const char *text;
+			LSBase64Flags flags;
+		} MALFORMED_BASE64[] = {
+			{ "Zg=", LS_BASE64_STANDARD },
+			{ "Zg", LS_BASE64_STANDARD },
+			{ "Zg==", LS_BASE64_NO_PADDING },
+			{ "Z===", LS_BASE64_STANDARD },
+			{ "====", LS_BASE64_STANDARD },
+			{ "Z", LS_BASE64_NO_PADDING },
+			{ "Zh==", LS_BASE64_STANDARD },
+			{ "Zm9=", LS_BASE64_STANDARD },
+			{ "Zm 9v", LS_BASE64_NO_PADDING },
+			{ "Zm=v", LS_BASE64_STANDARD },
+			{ "+/+/", LS_BASE64_URL },
+			{ "-_-_", LS_BASE64_STANDARD },
+		};
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append(&bbuf, (const LSByte *)"kept", 4)
+				== LS_SUCCESS);
+
+		for (size_t i = 0; i < sizeof(MALFORMED_BASE64)
+				/ sizeof(MALFORMED_BASE64[0]); ++i) {
+			assert(ls_sspan_decode_base64(
+					ls_sspan_from_cstr(MALFORMED_BASE64[i].text),
+					MALFORMED_BASE64[i].flags, &bbuf) == LS_FAILURE);
+		}
+
+		assert(ls_sspan_decode_hex(ls_sspan_from_cstr("abc"), &bbuf)
+				== LS_FAILURE);
+		assert(ls_sspan_decode_hex(ls_sspan_from_cstr("0g"), &bbuf)
+				== LS_FAILURE);
+		assert(ls_sspan_decode_hex(LS_AN_INVALID_SSPAN, &bbuf)
+				== LS_FAILURE);
+		assert(ls_sspan_decode_base64(LS_AN_INVALID_SSPAN,
+				LS_BASE64_STANDARD, &bbuf) == LS_FAILURE);
+		assert(ls_bbuf_append_hex_encoded(&bbuf, LS_AN_INVALID_SSPAN)
+				== LS_FAILURE);
+		assert(ls_bbuf_append_base64(&bbuf, LS_AN_INVALID_SSPAN,
+				LS_BASE64_STANDARD) == LS_FAILURE);
+		assert(bbuf.len == 4 && memcmp(bbuf.bytes, "kept", 4) == 0);
+
+		LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+		assert(ls_bbuf_append_base64(&invalid, LS_EMPTY_SSPAN,
+				LS_BASE64_STANDARD) == LS_FAILURE);
+		assert(ls_sspan_decode_base64(LS_EMPTY_SSPAN, LS_BASE64_STANDARD,
+				&invalid) == LS_FAILURE);
+		assert(ls_bbuf_append_hex_encoded(&invalid, LS_EMPTY_SSPAN)
+				== LS_FAILURE);
+		assert(ls_sspan_decode_hex(LS_EMPTY_SSPAN, &invalid) == LS_FAILURE);
+	}
+
+	/*
+	 * Long inputs go through the SIMD kernels where available. They must agree
+	 * with encoding 3 bytes (or 1 for hex) at a time, and decode back.
+	 */
+	srand(47);
+	LSByteBuffer chunked = ls_bbuf_create();
+	LSByteBuffer decoded = ls_bbuf_create();
+	for (size_t round = 0; round < 500; ++round) {
+		LSByte raw[400];
+		size_t len = (size_t)rand() % (sizeof(raw) + 1);
+		for (size_t i = 0; i < len; ++i) {
+			raw[i] = (LSByte)rand();
+		}
+		LSStringSpan sspan = ls_sspan_create(raw, len);
+		LSBase64Flags flags = (LSBase64Flags)(rand() % 4);
+
+		bbuf.len = 0;
+		chunked.len = 0;
+		assert(ls_bbuf_append_base64(&bbuf, sspan, flags) == LS_SUCCESS);
+		for (size_t i = 0; i < len; i += 3) {
+			size_t chunk_len = len - i < 3 ? len - i : 3;
+			assert(ls_bbuf_append_base64(&chunked,
+					ls_sspan_create(&raw[i], chunk_len), flags)
+					== LS_SUCCESS);
+		}
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(bbuf),
+				ls_sspan_from_bbuf(chunked)));
+
+		decoded.len = 0;
+		assert(ls_sspan_decode_base64(ls_sspan_from_bbuf(bbuf), flags,
+				&decoded) == LS_SUCCESS);
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(decoded), sspan));
+
+		// any byte outside the alphabet is rejected, wherever it is (`=`
+		// could make valid padding, so it is left out)
+		if (bbuf.len > 0) {
+			LSByte invalid_byte;
+			do {
+				invalid_byte = (LSByte)rand();
+			} while (strchr((flags & LS_BASE64_URL)
+					? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+					  "0123456789-_="
+					: "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+					  "0123456789+/=", invalid_byte) != NULL);
+
+			bbuf.bytes[(size_t)rand() % bbuf.len] = invalid_byte;
+			assert(ls_sspan_decode_base64(ls_sspan_from_bbuf(bbuf), flags,
+					&decoded) == LS_FAILURE);
+		}
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_hex_encoded(&bbuf, sspan) == LS_SUCCESS);
+		assert(bbuf.len == 2 * len);
+		for (size_t i = 0; i < len; ++i) {
+			char digits[3];
+			snprintf(digits, sizeof(digits), "%02x", raw[i]);
+			assert(memcmp(&bbuf.bytes[2 * i], digits, 2) == 0);
+		}
+
+		// mixed case decodes the same
+		for (size_t i = 0; i < bbuf.len; ++i) {
+			if (rand() % 2 == 0 && bbuf.bytes[i] >= 'a') {
+				bbuf.bytes[i] -= 'a' - 'A';
+			}
+		}
+
+		decoded.len = 0;
+		assert(ls_sspan_decode_hex(ls_sspan_from_bbuf(bbuf), &decoded)
+				== LS_SUCCESS);
+		assert(ls_sspan_equals(ls_sspan_from_bbuf(decoded), sspan));
+
+		if (bbuf.len > 0) {
+			bbuf.bytes[(size_t)rand() % bbuf.len] = 'g';
+			assert(ls_sspan_decode_hex(ls_sspan_from_bbuf(bbuf), &decoded)
+					== LS_FAILURE);
+		}
+	}
+
+	ls_bbuf_destroy(&decoded);
+	ls_bbuf_destroy(&chunked);
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_percent_funcs(void)
+{
+	static const char UNRESERVED[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~";
+
+	LSByteSet unreserved = ls_byte_set_from_cstr(UNRESERVED);
+	LSByteSet path = ls_byte_set_from_cstr(UNRESERVED);
+	LSByteSet query = ls_byte_set_from_cstr(UNRESERVED);
+	for (const char *c = "!$&'()*+,;=:@/"; *c; ++c) {
+		ls_byte_set_add(&path, (LSByte)*c);
+		ls_byte_set_add(&query, (LSByte)*c);
+	}
+	ls_byte_set_add(&query, '?');
+
+	for (int byte = 0; byte < 256; ++byte) {
+		LSByte b = (LSByte)byte;
+		assert(ls_byte_set_contains(&unreserved, b)
+				== (byte != 0 && strchr(UNRESERVED, byte) != NULL));
+		assert(ls_byte_set_contains(&LS_URL_UNRESERVED_SET, b)
+				== ls_byte_set_contains(&unreserved, b));
+		assert(ls_byte_set_contains(&LS_URL_PATH_SET, b)
+				== ls_byte_set_contains(&path, b));
+		assert(ls_byte_set_contains(&LS_URL_QUERY_SET, b)
+				== ls_byte_set_contains(&query, b));
+	}
+	{
+		LSByteSet set = ls_byte_set_from_cstr(NULL);
+		ls_byte_set_add(&set, 0xff);
+		assert(ls_byte_set_contains(&set, 0xff));
+		assert(!ls_byte_set_contains(&set, 0x7f));
+		ls_byte_set_remove(&set, 0xff);
+		assert(!ls_byte_set_contains(&set, 0xff));
+	}
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	{
+		static const struct {
+			const char *raw;
+			const LSByteSet *charset;
+			const char *encoded;
+		} CASES[] = {
+			{ "", &LS_URL_UNRESERVED_SET, "" },
+			{ "a b&c=d/e?f", &LS_URL_UNRESERVED_SET,
+					"a%20b%26c%3Dd%2Fe%3Ff" },
+			{ "a b&c=d/e?f", &LS_URL_PATH_SET, "a%20b&c=d/e%3Ff" },
+			{ "a b&c=d/e?f", &LS_URL_QUERY_SET, "a%20b&c=d/e?f" },
+			{ "100%", &LS_URL_QUERY_SET, "100%25" },
+			{ "caf\xc3\xa9 \x7f\x00", &LS_URL_UNRESERVED_SET,
+					"caf%C3%A9%20%7F" },
+		};
+
+		for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i) {
+			LSStringSpan raw = ls_sspan_from_cstr(CASES[i].raw);
+
+			bbuf.len = 0;
+			assert(ls_bbuf_append_percent_encoded(&bbuf, raw,
+					CASES[i].charset) == LS_SUCCESS);
+			assert(bbuf.len == strlen(CASES[i].encoded));
+			assert(memcmp(bbuf.bytes, CASES[i].encoded, bbuf.len) == 0);
+
+			LSStringSpan encoded = ls_sspan_from_cstr(CASES[i].encoded);
+			bbuf.len = 0;
+			assert(ls_sspan_percent_decode(encoded, &bbuf) == LS_SUCCESS);
+			assert(ls_sspan_equals(ls_sspan_from_bbuf(bbuf), raw));
+		}
+	}
+	{
+		LSStringSpan raw = ls_sspan_create((const LSByte *)"a\0b", 3);
+
+		bbuf.len = 0;
+		assert(ls_bbuf_append_percent_encoded(&bbuf, raw,
+				&LS_URL_UNRESERVED_SET) == LS_SUCCESS);
+		assert(bbuf.len == 5 && memcmp(bbuf.bytes, "a%00b", 5) == 0);
+
+		bbuf.len = 0;
+		assert(ls_sspan_percent_decode(ls_sspan_from_cstr("%3d%3D+"), &bbuf)
+				== LS_SUCCESS);
+		assert(bbuf.len == 3 && memcmp(bbuf.bytes, "==+", 3) == 0);
+	}
+	{
+		static const char *const MALFORMED[] = {
+			"%", "%2", "abc%", "abc%4", "%zz", "%2g", "%g2", "a%%20",
+		};
+
+		for (size_t i = 0; i < sizeof(MALFORMED) / sizeof(MALFORMED[0]);
+				++i) {
+			bbuf.len = 0;
+			ls_bbuf_append(&bbuf, (const LSByte *)"keep", 4);
+			assert(ls_sspan_percent_decode(
+					ls_sspan_from_cstr(MALFORMED[i]), &bbuf)
+					== LS_FAILURE);
+			assert(bbuf.len == 4 && memcmp(bbuf.bytes, "keep", 4) == 0);
+		}
+	}
+	{
+		// every byte, at every offset, through the SIMD path and the tail
+		LSByte raw[300];
+		for (size_t i = 0; i < sizeof(raw); ++i) {
+			raw[i] = (LSByte)(i * 7);
+		}
+
+		const LSByteSet *CHARSETS[] = {
+			&LS_URL_UNRESERVED_SET, &LS_URL_PATH_SET, &LS_URL_QUERY_SET,
+		};
+
+		LSByteBuffer decoded = ls_bbuf_create();
+		for (size_t c = 0; c < sizeof(CHARSETS) / sizeof(CHARSETS[0]);
+				++c) {
+			for (size_t offset = 0; offset < 40; ++offset) {
+				LSStringSpan sspan = ls_sspan_create(&raw[offset],
+						sizeof(raw) - offset);
+
+				bbuf.len = 0;
+				assert(ls_bbuf_append_percent_encoded(&bbuf, sspan,
+						CHARSETS[c]) == LS_SUCCESS);
+
+				size_t nescapes = 0;
+				for (size_t i = 0; i < sspan.len; ++i) {
+					if (sspan.bytes[i] == '%' || !ls_byte_set_contains(
+							CHARSETS[c], sspan.bytes[i])) {
+						++nescapes;
+					}
+				}
+				assert(bbuf.len == sspan.len + 2 * nescapes);
+
+				for (size_t i = 0; i < bbuf.len; ++i) {
+					assert(bbuf.bytes[i] == '%' || ls_byte_set_contains(
+							CHARSETS[c], bbuf.bytes[i]));
+				}
+
+				decoded.len = 0;
+				assert(ls_sspan_percent_decode(ls_sspan_from_bbuf(bbuf),
+						&decoded) == LS_SUCCESS);
+				assert(ls_sspan_equals(ls_sspan_from_bbuf(decoded),
+						sspan));
+			}
+		}
+		ls_bbuf_destroy(&decoded);
+	}
+
+	LSByteBuffer invalid = LS_AN_INVALID_BBUF;
+	assert(ls_bbuf_append_percent_encoded(&invalid,
+			ls_sspan_from_cstr("a"), &LS_URL_PATH_SET) == LS_FAILURE);
+	assert(ls_bbuf_append_percent_encoded(&bbuf, LS_AN_INVALID_SSPAN,
+			&LS_URL_PATH_SET) == LS_FAILURE);
+	assert(ls_sspan_percent_decode(LS_AN_INVALID_SSPAN, &bbuf)
+			== LS_FAILURE);
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void test_csv_reader(void)
+{
+	{
+		LSCsvReader reader = ls_csv_reader_create(ls_sspan_from_cstr(
+				"a,\"b,c\",\"d\"\"e\"\r\n"
+				",\n"
+				"\n"
+				"f\"g,\"\",\"h\ni\"\r\n"
+				"j\r\n"
+				"k,"), ',');
+		assert(ls_csv_reader_is_valid(reader));
+
+		assert_next_record(&reader,
+				(const char *[]){ "a", "b,c", "d\"e" }, 3);
+		assert_next_record(&reader, (const char *[]){ "", "" }, 2);
+		assert_next_record(&reader, (const char *[]){ "" }, 1);
+		assert_next_record(&reader,
+				(const char *[]){ "f\"g", "", "h\ni" }, 3);
+		assert_next_record(&reader, (const char *[]){ "j" }, 1);
+		assert_next_record(&reader, (const char *[]){ "k", "" }, 2);
+		assert_next_record(&reader, NULL, 0);
+		assert_next_record(&reader, NULL, 0);
+
+		ls_csv_reader_destroy(&reader);
+	}
+	{
+		LSCsvReader reader = ls_csv_reader_create(
+				ls_sspan_from_cstr("a\tb,c\t\"\"\"\"\n"), '\t');
+
+		assert_next_record(&reader,
+				(const char *[]){ "a", "b,c", "\"" }, 3);
+		assert_next_record(&reader, NULL, 0);
+
+		ls_csv_reader_destroy(&reader);
+	}
+	{
+		LSCsvReader reader = ls_csv_reader_create(LS_EMPTY_SSPAN, ',');
+		assert_next_record(&reader, NULL, 0);
+		ls_csv_reader_destroy(&reader);
+	}
+	{
+		static const char *const MALFORMED[] = {
+			"\"abc", "\"a\"b,c", "a,\"b\"\"", "\"a\"\r", "x,\"a\" \n",
+		};
+
+		for (size_t i = 0; i < sizeof(MALFORMED) / sizeof(MALFORMED[0]);
+				++i) {
+			LSCsvReader reader = ls_csv_reader_create(
+					ls_sspan_from_cstr(MALFORMED[i]), ',');
+
+			const LSStringSpan *fields;
+			size_t nfields;
+			assert(ls_csv_reader_next(&reader, &fields, &nfields)
+					== LS_FAILURE);
+			// the reader does not move past the bad record
+			assert(ls_csv_reader_next(&reader, &fields, &nfields)
+					== LS_FAILURE);
+
+			ls_csv_reader_destroy(&reader);
+		}
+	}
+	{
+		// records of many fields, with quoting that straddles blocks
+		static const char *const VALUES[] = {
+			"", "x", "plain text", "a,b", "say \"hi\"", "\"", "line\nbreak",
+			"crlf\r\n", "0123456789012345678901234567890123456789",
+		};
+		enum { NVALUES = sizeof(VALUES) / sizeof(VALUES[0]) };
+
+		srand(1);
+
+		size_t value_idxs[40][50];
+		size_t nfields[40];
+		LSByteBuffer csv = ls_bbuf_create();
+		for (size_t r = 0; r < 40; ++r) {
+			nfields[r] = 1 + (size_t)rand() % 50;
+			for (size_t f = 0; f < nfields[r]; ++f) {
+				// a lone empty field would be an empty line
+				size_t idx = nfields[r] == 1
+						? 1 + (size_t)rand() % (NVALUES - 1)
+						: (size_t)rand() % NVALUES;
+				value_idxs[r][f] = idx;
+
+				const char *value = VALUES[idx];
+				if (f > 0) {
+					ls_bbuf_append(&csv, (const LSByte *)",", 1);
+				}
+
+				bool quote = strpbrk(value, ",\"\r\n") || rand() % 4 == 0;
+				if (!quote) {
+					ls_bbuf_append(&csv, (const LSByte *)value,
+							strlen(value));
+					continue;
+				}
+
+				ls_bbuf_append(&csv, (const LSByte *)"\"", 1);
+				for (const char *c = value; *c; ++c) {
+					ls_bbuf_append(&csv, (const LSByte *)c, 1);
+					if (*c == '"') {
+						ls_bbuf_append(&csv, (const LSByte *)c, 1);
+					}
+				}
+				ls_bbuf_append(&csv, (const LSByte *)"\"", 1);
+			}
+
+			if (r % 2 == 0) {
+				ls_bbuf_append(&csv, (const LSByte *)"\r\n", 2);
+			} else {
+				ls_bbuf_append(&csv, (const LSByte *)"\n", 1);
+			}
+		}
+
+		LSCsvReader reader = ls_csv_reader_create(ls_sspan_from_bbuf(csv),
+				',');
+		for (size_t r = 0; r < 40; ++r) {
+			const char *expected[50];
+			for (size_t f = 0; f < nfields[r]; ++f) {
+				expected[f] = VALUES[value_idxs[r][f]];
+			}
+
+			assert_next_record(&reader, expected, nfields[r]);
+		}
+		assert_next_record(&reader, NULL, 0);
+
+		ls_csv_reader_destroy(&reader);
+		ls_bbuf_destroy(&csv);
+	}
+
+	assert(!ls_csv_reader_is_valid(
+			ls_csv_reader_create(LS_AN_INVALID_SSPAN, ',')));
+	assert(!ls_csv_reader_is_valid(
+			ls_csv_reader_create(ls_sspan_from_cstr("a"), '"')));
+	assert(!ls_csv_reader_is_valid(
+			ls_csv_reader_create(ls_sspan_from_cstr("a"), '\n')));
+
+	LSCsvReader invalid = LS_AN_INVALID_CSV_READER;
+	const LSStringSpan *fields;
+	size_t nfields;
+	assert(ls_csv_reader_next(&invalid, &fields, &nfields) == LS_FAILURE);
+}
+
+void test_byte_set_funcs(void)
+{
+	{
+		LSByteSet whitespace = ls_byte_set_from_cstr(" \t\n\v\f\r");
+		for (int byte = 0; byte < 256; ++byte) {
+			assert(ls_byte_set_contains(&LS_ASCII_WHITESPACE_SET,
+					(LSByte)byte)
+					== ls_byte_set_contains(&whitespace, (LSByte)byte));
+		}
+	}
+	{
+		const LSByteSet *ws = &LS_ASCII_WHITESPACE_SET;
+		LSStringSpan sspan = ls_sspan_from_cstr(" \t key = value\r\n");
+
+		assert(ls_sspan_find_first_not_of(sspan, ws) == 3);
+		assert(ls_sspan_find_first_of(sspan, ws) == 0);
+
+		LSByteSet equals = ls_byte_set_from_cstr("=");
+		assert(ls_sspan_find_first_of(sspan, &equals) == 7);
+		assert(ls_sspan_count_of(sspan, ws) == 7);
+
+		LSStringSpan trimmed = ls_sspan_trim(sspan, ws);
+		assert(ls_sspan_equals(trimmed, ls_sspan_from_cstr("key = value")));
+		assert(trimmed.bytes == &sspan.bytes[3]);
+
+		LSStringSpan blank = ls_sspan_from_cstr(" \r\n ");
+		trimmed = ls_sspan_trim(blank, ws);
+		assert(trimmed.len == 0 && trimmed.bytes == &blank.bytes[4]);
+		assert(ls_sspan_find_first_not_of(blank, ws) == SIZE_MAX);
+		assert(ls_sspan_find_first_of(LS_EMPTY_SSPAN, ws) == SIZE_MAX);
+		assert(ls_sspan_trim(LS_EMPTY_SSPAN, ws).len == 0);
+	}
+	{
+		// random sets against a byte loop, at every offset and length
+		LSByte bytes[200];
+		srand(1);
+		for (size_t round = 0; round < 20; ++round) {
+			LSByteSet set = { 0 };
+			int density = 1 + rand() % 8;
+			for (int byte = 0; byte < 256; ++byte) {
+				if (rand() % density == 0) {
+					ls_byte_set_add(&set, (LSByte)byte);
+				}
+			}
+
+			// runs of members and non-members, to exercise every lane
+			for (size_t i = 0; i < sizeof(bytes); ++i) {
+				bytes[i] = rand() % 4 == 0 ? (LSByte)rand()
+						: i > 0 ? bytes[i - 1] : 0;
+			}
+
+			for (size_t offset = 0; offset < 8; ++offset) {
+				for (size_t len = 0; offset + len <= sizeof(bytes);
+						len += 1 + len / 8) {
+					LSStringSpan sspan = ls_sspan_create(&bytes[offset],
+							len);
+
+					size_t first_of = SIZE_MAX;
+					size_t first_not_of = SIZE_MAX;
+					size_t last_not_of = SIZE_MAX;
+					size_t count = 0;
+					for (size_t i = 0; i < len; ++i) {
+						bool in = ls_byte_set_contains(&set,
+								sspan.bytes[i]);
+						count += in;
+						if (in && first_of == SIZE_MAX) {
+							first_of = i;
+						}
+						if (!in) {
+							if (first_not_of == SIZE_MAX) {
+								first_not_of = i;
+							}
+							last_not_of = i;
+						}
+					}
+
+					assert(ls_sspan_find_first_of(sspan, &set)
+							== first_of);
+					assert(ls_sspan_find_first_not_of(sspan, &set)
+							== first_not_of);
+					assert(ls_sspan_count_of(sspan, &set) == count);
+
+					LSStringSpan trimmed = ls_sspan_trim(sspan, &set);
+					if (first_not_of == SIZE_MAX) {
+						assert(trimmed.len == 0);
+					} else {
+						assert(trimmed.bytes
+								== &sspan.bytes[first_not_of]);
+						assert(trimmed.len
+								== last_not_of - first_not_of + 1);
+					}
+				}
+			}
+		}
+	}
+	{
+		// long enough for the vector counters to be flushed
+		size_t len = 3 * 255 * 32 + 77;
+		LSByte *bytes = malloc(len);
+		for (size_t i = 0; i < len; ++i) {
+			bytes[i] = i % 3 == 0 ? 0xe9 : 'a';
+		}
+
+		LSByteSet set = ls_byte_set_from_cstr("\xe9");
+		assert(ls_sspan_count_of(ls_sspan_create(bytes, len), &set)
+				== (len + 2) / 3);
+
+		free(bytes);
+	}
+
+	assert(ls_sspan_find_first_of(LS_AN_INVALID_SSPAN,
+			&LS_ASCII_WHITESPACE_SET) == SIZE_MAX);
+	assert(ls_sspan_find_first_not_of(LS_AN_INVALID_SSPAN,
+			&LS_ASCII_WHITESPACE_SET) == SIZE_MAX);
+	assert(!ls_sspan_is_valid(ls_sspan_trim(LS_AN_INVALID_SSPAN,
+			&LS_ASCII_WHITESPACE_SET)));
+	assert(ls_sspan_count_of(LS_AN_INVALID_SSPAN,
+			&LS_ASCII_WHITESPACE_SET) == 0);
+}
+
+#ifdef __linux__
+void test_async_reader(void)
+{
+	static const char PATH[] = "loser-test-async-reader.tmp";
+	static const char MISSING_PATH[] = "loser-test-async-reader.missing";
+
+	FILE *file = fopen(PATH, "wb");
+	assert(file);
+	for (size_t i = 0; i < 1000; ++i) {
+		fwrite(BIG_BYTES, 1, BIG_LEN, file);
+	}
+	fclose(file);
+
+	LSAsyncReaderFlags flags[] = {
+		LS_ASYNC_READER_DEFAULT,
+		LS_ASYNC_READER_NO_URING
+	};
+
+	for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); ++f) {
+		LSAsyncReader *reader = ls_async_reader_create(2, flags[f]);
+		assert(reader);
+
+		if (flags[f] == LS_ASYNC_READER_NO_URING) {
+			assert(ls_async_reader_get_backend(reader)
+					== LS_ASYNC_READER_THREADS);
+		}
+
+		assert(ls_async_reader_submit(reader, MISSING_PATH, NULL)
+				== LS_FAILURE);
+
+		// read the same file a few times to exercise buffer recycling
+		for (size_t round = 0; round < 3; ++round) {
+			int tags[2] = { 0, 1 };
+
+			assert(ls_async_reader_submit(reader, PATH, &tags[0])
+					== LS_SUCCESS);
+			// size of 0 but not empty
+			assert(ls_async_reader_submit(reader, "/proc/self/stat",
+					&tags[1]) == LS_SUCCESS);
+			assert(ls_async_reader_submit(reader, PATH, NULL)
+					== LS_FAILURE);
+			assert(ls_async_reader_get_inflight(reader) == 2);
+
+			LSAsyncRead reads[2];
+			size_t nreads = 0;
+			while (nreads < 2) {
+				nreads += ls_async_reader_reap(reader,
+						&reads[nreads], 2 - nreads, 1);
+			}
+			assert(ls_async_reader_get_inflight(reader) == 0);
+
+			for (size_t i = 0; i < nreads; ++i) {
+				assert(reads[i].status == LS_SUCCESS);
+				assert(ls_bbuf_is_valid(reads[i].bbuf));
+
+				if (reads[i].user_data == &tags[0]) {
+					assert(reads[i].bbuf.len == 1000 * BIG_LEN);
+					assert(memcmp(&reads[i].bbuf.bytes[BIG_LEN * 999],
+							BIG_BYTES, BIG_LEN) == 0);
+				} else {
+					assert(reads[i].user_data == &tags[1]);
+					assert(reads[i].bbuf.len > 0);
+				}
+
+				ls_async_reader_recycle(reader, &reads[i].bbuf);
+				assert(!ls_bbuf_is_valid(reads[i].bbuf));
+			}
+		}
+
+		// unreaped reads are cleaned up by the reader
+		assert(ls_async_reader_submit(reader, PATH, NULL) == LS_SUCCESS);
+		ls_async_reader_destroy(reader);
+	}
+
+	remove(PATH);
+}
+#endif
+
+int sspan_compare_for_qsort(const void *a, const void *b)
+{
+	return ls_sspan_compare(*(const LSStringSpan *)a,
+			*(const LSStringSpan *)b);
+}
+
+void mark_task(void *ctx, size_t task_idx)
+{
+	unsigned char *marks = ctx;
+	marks[task_idx]++;
+}
+
+void hash_spans(void *ctx, const LSStringSpan *sspans, size_t nsspans,
+		size_t first_idx)
+{
+	uint64_t *hashes = ctx;
+
+	for (size_t i = 0; i < nsspans; ++i) {
+		// adding (rather than storing) catches spans visited twice
+		hashes[first_idx + i] += ls_sspan_hash_icase(sspans[i]) | 1;
+	}
+}
+
+void assert_appendf_like_snprintf(const char *fmt, ...)
+{
+	char expected[1024];
+	va_list args;
+
+	va_start(args, fmt);
+	int len = vsnprintf(expected, sizeof(expected), fmt, args);
+	va_end(args);
+	assert(len >= 0 && (size_t)len < sizeof(expected));
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	assert(ls_bbuf_append(&bbuf, (const LSByte *)"@", 1) == LS_SUCCESS);
+
+	va_start(args, fmt);
+	assert(ls_bbuf_vappendf(&bbuf, fmt, args) == LS_SUCCESS);
+	va_end(args);
+
+	assert(bbuf.len == 1 + (size_t)len);
+	assert(bbuf.bytes[0] == '@');
+	assert(memcmp(&bbuf.bytes[1], expected, len) == 0);
+
+	ls_bbuf_destroy(&bbuf);
+}
+
+void assert_replace_all_like_naive(LSStringSpan sspan, LSStringSpan needle,
+		LSStringSpan replacement)
+{
+	LSByteBuffer expected = ls_bbuf_create();
+	for (size_t i = 0; i < sspan.len; ) {
+		if (sspan.len - i >= needle.len
+				&& memcmp(&sspan.bytes[i], needle.bytes, needle.len) == 0) {
+			ls_bbuf_append_sspan(&expected, replacement);
+			i += needle.len;
+		} else {
+			ls_bbuf_append(&expected, &sspan.bytes[i], 1);
+			++i;
+		}
+	}
+
+	LSString string = ls_sspan_replace_all(sspan, needle, replacement);
+	assert(ls_string_is_valid(string));
+	assert(string.len == expected.len);
+	assert(memcmp(string.bytes, expected.bytes, expected.len) == 0);
+	assert(string.bytes[string.len] == '\0');
+	ls_string_destroy(&string);
+
+	LSByteBuffer bbuf = ls_bbuf_create();
+	assert(ls_bbuf_append_sspan(&bbuf, sspan) == LS_SUCCESS);
+	assert(ls_bbuf_replace_all(&bbuf, needle, replacement) == LS_SUCCESS);
+	assert(bbuf.len == expected.len);
+	assert(memcmp(bbuf.bytes, expected.bytes, expected.len) == 0);
+	ls_bbuf_destroy(&bbuf);
+
+	ls_bbuf_destroy(&expected);
+}
+
+void assert_next_record(LSCsvReader *reader, const char *const *expected,
+		size_t nexpected)
+{
+	const LSStringSpan *fields;
+	size_t nfields;
+	assert(ls_csv_reader_next(reader, &fields, &nfields) == LS_SUCCESS);
+	assert(nfields == nexpected);
+
+	for (size_t i = 0; i < nfields; ++i) {
+		assert(ls_sspan_equals(fields[i], ls_sspan_from_cstr(expected[i])));
+	}
+}